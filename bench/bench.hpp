@@ -0,0 +1,54 @@
+#ifndef _BENCH_HPP_
+#define _BENCH_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#ifndef WORKDIR
+#define WORKDIR "../../"
+#endif
+
+// Benchmark registry
+using bench_fn = void (*)();
+int register_bench(char const* name, bench_fn fn);
+
+#define BENCH(name)                                                  \
+    static void bench_##name();                                      \
+    static int  bench_##name##_registered = register_bench(#name, bench_##name); \
+    static void bench_##name()
+
+/**
+ * @brief
+ * 	Wall clock stopwatch in milliseconds
+ */
+struct bench_timer
+{
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+
+    void reset() { start = std::chrono::high_resolution_clock::now(); }
+    [[nodiscard]] double ms() const
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+};
+
+/**
+ * @brief
+ * 	Best of n runs, to filter out cold caches and scheduler noise
+ */
+template<typename F>
+double bench_best_ms(int runs, F&& f)
+{
+    double best = 1e30;
+    for (int i = 0; i < runs; ++i)
+    {
+        bench_timer t;
+        f();
+        best = std::min(best, t.ms());
+    }
+    return best;
+}
+
+#endif
@@ -0,0 +1,75 @@
+#include "bench_scene.hpp"
+#include "geometry.hpp"
+#include <bit>
+#include <cstdio>
+
+namespace {
+    // Nodes by object count: 0, 1, 2-3, 4-7...
+    void print_histogram(Octree<scene_object> const& tree)
+    {
+        std::size_t buckets[12] = {};
+        unsigned    depth       = 0;
+        for (auto const& [loc, n] : tree.m_nodes) {
+            buckets[std::min<std::size_t>(std::bit_width(n->object_count), 11)]++;
+            depth = std::max(depth, Octree<scene_object>::depth(loc));
+        }
+        std::printf("    %zu nodes, depth %u:", tree.m_nodes.size(), depth);
+        for (unsigned i = 0; i < 12; ++i)
+            if (buckets[i])
+                std::printf("  [%u,%u] %zu", i ? 1u << (i - 1) : 0u, i ? (1u << i) - 1 : 0u, buckets[i]);
+        std::printf("\n");
+    }
+}
+
+BENCH(adaptive_octree)
+{
+    auto objects = load_scene_objects(load_mesh_bounds());
+
+    std::vector<std::vector<frustrum>> paths;
+    for (char const* path_name : { "flythrough", "orbit", "overview" }) {
+        paths.emplace_back();
+        for (auto const& frame : camera_path(path_name))
+            paths.back().emplace_back(camera_view_projection(frame));
+    }
+
+    std::printf("  %-16s %9s %12s %12s %10s %9s\n", "tree", "build ms", "nodes", "objects", "visible", "ms");
+    auto run = [&](char const* name, auto&& build) {
+        for (auto& obj : objects) {
+            obj.m_octree_node     = nullptr;
+            obj.m_octree_next_obj = obj.m_octree_prev_obj = nullptr;
+        }
+        Octree<scene_object> tree;
+        bench_timer          timer;
+        build(tree);
+        double build_ms = timer.ms();
+
+        for (auto const& frustums : paths) {
+            cull_counts total;
+            double      ms = bench_best_ms(5, [&] {
+                total = {};
+                for (auto const& f : frustums)
+                    cull_octree(tree, f, true, total, [](scene_object const&) {});
+            });
+            double frames = static_cast<double>(frustums.size());
+            std::printf("  %-16s %9.2f %12.1f %12.1f %10.1f %9.4f\n", name, build_ms, total.nodes / frames, total.objects / frames,
+                        total.visible / frames, ms / frames);
+        }
+        print_histogram(tree);
+    };
+
+    for (unsigned levels : { 4u, 5u, 6u, 7u }) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "fixed %u", levels);
+        run(name, [&](Octree<scene_object>& tree) { build_scene_octree(tree, objects, 1u << 10, levels); });
+    }
+    for (unsigned split : { 8u, 16u, 32u, 64u }) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "adaptive %u/%u", split, split / 4);
+        run(name, [&](Octree<scene_object>& tree) {
+            tree.set_root_size(1u << 10);
+            tree.set_adaptive(true, { .split_count = split, .merge_count = split / 4, .max_depth = 8 });
+            for (auto& obj : objects)
+                tree.insert(obj);
+        });
+    }
+}
@@ -0,0 +1,41 @@
+#include "bench_scene.hpp"
+#include "geometry.hpp"
+#include <cstdio>
+
+BENCH(aggregate_bounds)
+{
+    auto                 objects = load_scene_objects(load_mesh_bounds());
+    Octree<scene_object> tree;
+    build_scene_octree(tree, objects);
+
+    std::printf("  %-10s %-9s %10s %12s %10s %9s\n", "path", "bounds", "nodes", "objects", "visible", "ms");
+    for (char const* path_name : { "flythrough", "orbit", "overview" }) {
+        auto const            path = camera_path(path_name);
+        std::vector<frustrum> frustums;
+        for (auto const& frame : path)
+            frustums.emplace_back(camera_view_projection(frame));
+
+        for (bool aggregate : { false, true }) {
+            cull_counts total;
+            double      ms = bench_best_ms(5, [&] {
+                total = {};
+                for (auto const& f : frustums)
+                    cull_octree(tree, f, aggregate, total, [](scene_object const&) {});
+            });
+            double frames = static_cast<double>(path.size());
+            std::printf("  %-10s %-9s %10.1f %12.1f %10.1f %9.4f\n", path_name, aggregate ? "aggregate" : "cell", total.nodes / frames,
+                        total.objects / frames, total.visible / frames, ms / frames);
+        }
+    }
+
+    // Refit cost: move every object a bit and back
+    bench_timer timer;
+    for (auto& obj : objects) {
+        aabb bv = obj.bv;
+        obj.bv  = aabb(bv.min + vec3(0.5f), bv.max + vec3(0.5f));
+        tree.relocate(obj, LocationalCode::compute_locational_code(obj.bv, tree.root_size(), tree.levels()));
+        obj.bv = bv;
+        tree.relocate(obj, LocationalCode::compute_locational_code(obj.bv, tree.root_size(), tree.levels()));
+    }
+    std::printf("  relocate %zu objects twice  %8.2f ms\n", objects.size(), timer.ms());
+}
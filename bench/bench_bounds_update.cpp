@@ -0,0 +1,100 @@
+#include "bench_scene.hpp"
+#include "bounds_update.hpp"
+#include <cstdio>
+#include <random>
+
+namespace {
+    // Objects over a 2 km square, a fraction of them spinning in place every frame
+    struct props
+    {
+        std::vector<scene_object> objects;
+        std::vector<aabb>         locals;
+        std::vector<uint32_t>     moving;
+    };
+
+    props make_props(std::size_t count, float moving_fraction)
+    {
+        std::mt19937                          rng(47);
+        std::uniform_real_distribution<float> ground(-1000.0f, 1000.0f), unit(0.0f, 1.0f);
+        props                                 p;
+        p.objects.resize(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            vec3 h = vec3(0.5f) + 2.0f * vec3(unit(rng), unit(rng), unit(rng));
+            p.locals.emplace_back(-h, h);
+            p.objects[i].m2w = glm::translate(mat4(1.0f), vec3(ground(rng), 5.0f, ground(rng))); // Off the center plane of the root
+            p.objects[i].bv  = transform_aabb(p.locals[i], p.objects[i].m2w);
+            if (unit(rng) < moving_fraction)
+                p.moving.push_back(static_cast<uint32_t>(i));
+        }
+        return p;
+    }
+
+    void animate(props& p, int frame)
+    {
+        for (uint32_t i : p.moving)
+            p.objects[i].m2w = glm::rotate(p.objects[i].m2w, 0.01f + 0.001f * static_cast<float>(frame % 7), vec3(0, 1, 0));
+    }
+}
+
+BENCH(bounds_update)
+{
+    constexpr int frames = 5;
+    std::printf("  %-9s %-7s %12s %12s %12s %14s %14s\n", "objects", "moving", "transform_aabb", "updater", "unchanged", "+relocate", "+batch relocate");
+    for (std::size_t count : { std::size_t(100000), std::size_t(1000000) })
+        for (float fraction : { 0.01f, 0.1f, 1.0f }) {
+            double single_ms = 0.0, batched_ms = 0.0, scan_ms = 0.0, single_total = 0.0, batched_total = 0.0;
+
+            // One transform_aabb and relocate per moving object, too slow past 100k moving objects
+            {
+                props                p = make_props(count, fraction);
+                Octree<scene_object> tree;
+                build_scene_octree(tree, p.objects, 1u << 11, 7);
+                bool relocate = p.moving.size() <= 100000;
+                for (int frame = 0; frame < frames; ++frame) {
+                    animate(p, frame);
+                    bench_timer timer;
+                    for (uint32_t i : p.moving)
+                        p.objects[i].bv = transform_aabb(p.locals[i], p.objects[i].m2w);
+                    single_ms += timer.ms();
+                    if (relocate)
+                        for (uint32_t i : p.moving)
+                            tree.relocate(p.objects[i], LocationalCode::compute_locational_code(p.objects[i].bv, tree.root_size(), tree.levels()));
+                    single_total += relocate ? timer.ms() : -1e30;
+                }
+            }
+
+            // The updater given the moved transforms, refreshing and relocating them as a batch
+            {
+                props                p = make_props(count, fraction);
+                Octree<scene_object> tree;
+                build_scene_octree(tree, p.objects, 1u << 11, 7);
+                bounds_updater bounds;
+                for (std::size_t i = 0; i < count; ++i)
+                    bounds.add(p.locals[i], p.objects[i].m2w);
+                bounds.update();
+                for (int frame = 0; frame < frames; ++frame) {
+                    animate(p, frame);
+                    bench_timer timer;
+                    for (uint32_t i : p.moving)
+                        bounds.set_transform(i, p.objects[i].m2w);
+                    bounds.update();
+                    batched_ms += timer.ms();
+                    relocate_dirty<scene_object>(tree, p.objects, bounds);
+                    batched_total += timer.ms();
+
+                    // Every transform handed again, none changed
+                    timer.reset();
+                    for (std::size_t i = 0; i < count; ++i)
+                        bounds.set_transform(static_cast<uint32_t>(i), p.objects[i].m2w);
+                    bounds.update();
+                    scan_ms += timer.ms();
+                }
+            }
+
+            std::printf("  %-9zu %5.0f%% %14.2f %12.2f %12.2f ", count, fraction * 100.0f, single_ms / frames, batched_ms / frames, scan_ms / frames);
+            if (single_total < 0.0)
+                std::printf("%14s %14.2f\n", "-", batched_total / frames);
+            else
+                std::printf("%14.2f %14.2f\n", single_total / frames, batched_total / frames);
+        }
+}
@@ -0,0 +1,121 @@
+#include "bench_scene.hpp"
+#include "bvh.hpp"
+#include <cstdio>
+#include <random>
+
+namespace {
+    struct workload
+    {
+        std::vector<frustrum>                  frustums;
+        std::vector<std::pair<vec3, vec3>>     rays;    // Origin, direction
+        std::vector<aabb>                      regions;
+        std::vector<vec3>                      points;  // kNN
+    };
+
+    workload make_workload(std::vector<scene_object> const& objects, float extent)
+    {
+        workload w;
+        for (char const* path_name : { "flythrough", "orbit", "overview" })
+            for (auto const& frame : camera_path(path_name))
+                w.frustums.emplace_back(camera_view_projection(frame));
+
+        // Rays from random points towards random objects, so most of them hit
+        std::mt19937                          rng(21);
+        std::uniform_real_distribution<float> position(-extent, extent);
+        std::uniform_int_distribution<std::size_t> pick(0, objects.size() - 1);
+        for (int i = 0; i < 20000; ++i) {
+            vec3 origin = vec3(position(rng), position(rng) * 0.1f, position(rng));
+            auto const& target = objects[pick(rng)].bv;
+            w.rays.emplace_back(origin, glm::normalize((target.min + target.max) * 0.5f - origin));
+        }
+        for (int i = 0; i < 20000; ++i) {
+            vec3 p = vec3(position(rng), position(rng) * 0.1f, position(rng));
+            w.regions.emplace_back(p, p + vec3(32.0f));
+            w.points.push_back(p);
+        }
+        return w;
+    }
+
+    void compare(char const* name, std::vector<scene_object>& objects, float extent)
+    {
+        workload w = make_workload(objects, extent);
+
+        Octree<scene_object> octree;
+        bench_timer          timer;
+        build_scene_octree(octree, objects);
+        double octree_build = timer.ms();
+        std::size_t in_root = 0;
+        for (auto* obj = octree.find_node(1u)->first; obj; obj = obj->m_octree_next_obj)
+            in_root++;
+
+        std::vector<scene_object*> pointers;
+        for (auto& obj : objects)
+            pointers.push_back(&obj);
+        bvh<scene_object> tree;
+        timer.reset();
+        tree.build(pointers);
+        double bvh_build = timer.ms();
+        timer.reset();
+        tree.refit();
+        double bvh_refit = timer.ms();
+
+        std::printf("  %s: %zu objects, %zu in the octree root\n", name, objects.size(), in_root);
+        std::printf("    %-7s %9s %9s %10s %12s %12s %12s\n", "", "build ms", "KB", "cull ms", "rays/s", "boxes/s", "8-nn/s");
+        auto run = [&](char const* tree_name, auto const& t, double build_ms, std::size_t bytes) {
+            std::size_t count = 0;
+            double      cull  = bench_best_ms(3, [&] {
+                for (auto const& f : w.frustums)
+                    t.frustum(f, [&](scene_object&) { count++; });
+            }) / static_cast<double>(w.frustums.size());
+            double rays = bench_best_ms(3, [&] {
+                for (auto const& [o, d] : w.rays)
+                    count += t.raycast(o, d).object != nullptr;
+            });
+            double boxes = bench_best_ms(3, [&] {
+                for (auto const& r : w.regions)
+                    t.query(r, [&](scene_object&) { count++; });
+            });
+            std::vector<scene_object*> knn;
+            double                     nearest = bench_best_ms(3, [&] {
+                for (auto const& p : w.points) {
+                    t.nearest(p, 8, knn);
+                    count += knn.size();
+                }
+            });
+            std::printf("    %-7s %9.2f %9.1f %10.4f %12.0f %12.0f %12.0f%s\n", tree_name, build_ms, bytes / 1024.0, cull,
+                        w.rays.size() / (rays / 1000.0), w.regions.size() / (boxes / 1000.0), w.points.size() / (nearest / 1000.0), count ? "" : " ?");
+        };
+        run("octree", octree, octree_build,
+            octree.m_nodes.size() * (sizeof(Octree<scene_object>::node) + 2 * sizeof(void*)));
+        run("bvh", tree, bvh_build, tree.nodes().size() * sizeof(bvh<scene_object>::node) + tree.objects().size() * sizeof(void*));
+        std::printf("    bvh refit %.2f ms\n", bvh_refit);
+    }
+
+    std::vector<scene_object> synthetic(char const* kind, std::size_t count)
+    {
+        std::mt19937                          rng(22);
+        std::uniform_real_distribution<float> position(-400.0f, 400.0f), unit(0.0f, 1.0f);
+        std::lognormal_distribution<float>    varied(0.0f, 1.2f);
+        std::vector<scene_object>             objects(count);
+        for (auto& obj : objects) {
+            vec3 p = vec3(position(rng), position(rng) * 0.1f, position(rng));
+            vec3 s = vec3(1.0f);
+            if (kind[0] == 'v') // varied
+                s = vec3(varied(rng));
+            else if (kind[0] == 't') // thin
+                s[rng() % 3] = 20.0f + 80.0f * unit(rng);
+            obj.bv = aabb(p, p + s);
+        }
+        return objects;
+    }
+}
+
+BENCH(bvh)
+{
+    auto objects = load_scene_objects(load_mesh_bounds());
+    compare("scene.txt", objects, 300.0f);
+    for (char const* kind : { "uniform", "varied", "thin" }) {
+        auto synthetic_objects = synthetic(kind, 50000);
+        compare(kind, synthetic_objects, 400.0f);
+    }
+}
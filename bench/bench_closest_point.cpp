@@ -0,0 +1,77 @@
+#include "bench_scene.hpp"
+#include "geometry.hpp"
+#include "mesh_bvh.hpp"
+#include <cstdio>
+#include <random>
+
+BENCH(closest_point)
+{
+    auto const            meshes  = load_meshes();
+    auto                  objects = load_scene_objects(load_mesh_bounds());
+    std::vector<mesh_bvh> trees;
+    for (auto const& mesh : meshes)
+        trees.emplace_back(mesh);
+    Octree<scene_object> octree;
+    build_scene_octree(octree, objects);
+
+    // Points off the surface of random objects, at most radius away from it
+    std::mt19937                          rng(50);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f), signed_unit(-1.0f, 1.0f);
+    auto                                  make_points = [&](float radius) {
+        std::vector<vec3> points;
+        for (int i = 0; i < 20000; ++i) {
+            auto const&     obj = objects[static_cast<std::size_t>(unit(rng) * (objects.size() - 1))];
+            auto const&     tri = meshes[obj.mesh][static_cast<std::size_t>(unit(rng) * (meshes[obj.mesh].size() - 1))];
+            float           u = unit(rng), v = unit(rng) * (1.0f - u);
+            vec3            p      = vec3(obj.m2w * vec4(tri.a + u * (tri.b - tri.a) + v * (tri.c - tri.a), 1.0f));
+            vec3            offset = vec3(signed_unit(rng), signed_unit(rng), signed_unit(rng));
+            points.push_back(p + offset * (radius * unit(rng) / std::max(glm::length(offset), 1e-3f)));
+        }
+        return points;
+    };
+
+    std::printf("  %zu objects, %zu meshes\n", objects.size(), meshes.size());
+    std::printf("  %-8s %8s %12s %12s %14s %12s\n", "radius", "found", "queries/s", "meshes/query", "box query + all", "meshes/query");
+    for (float radius : { 0.25f, 1.0f, 4.0f, 16.0f }) {
+        auto const points = make_points(radius);
+
+        // Best first over node and object bounds, then the mesh BVH of each object in world space
+        std::size_t found = 0, tested = 0;
+        double      ms    = bench_best_ms(3, [&]() {
+            found = tested = 0;
+            for (auto const& p : points) {
+                auto hit = octree.closest(p, radius, [&](scene_object& obj, float max_distance) {
+                    tested++;
+                    auto closest = trees[obj.mesh].closest_point(p, obj.m2w, max_distance);
+                    return closest.triangle == UINT32_MAX ? -1.0f : closest.distance;
+                });
+                found += hit.object != nullptr;
+            }
+        });
+
+        // Every object whose bv is within the box around the point, in octree order
+        std::size_t box_found = 0, box_tested = 0;
+        double      box_ms    = bench_best_ms(3, [&]() {
+            box_found = box_tested = 0;
+            for (auto const& p : points) {
+                float best = radius;
+                bool  hit  = false;
+                octree.query(aabb(p - radius, p + radius), [&](scene_object& obj) {
+                    box_tested++;
+                    auto closest = trees[obj.mesh].closest_point(p, obj.m2w, best);
+                    if (closest.triangle != UINT32_MAX) {
+                        best = closest.distance;
+                        hit  = true;
+                    }
+                });
+                box_found += hit;
+            }
+        });
+
+        double n = static_cast<double>(points.size());
+        std::printf("  %-8.2f %7.1f%% %12.0f %12.2f %14.0f %12.2f\n", radius, 100.0 * found / n, n / (ms / 1000.0), tested / n, n / (box_ms / 1000.0),
+                    box_tested / n);
+        if (box_found != found)
+            std::printf("  found %zu with the box query, %zu best first\n", box_found, found);
+    }
+}
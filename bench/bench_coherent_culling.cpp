@@ -0,0 +1,80 @@
+#include "bench_scene.hpp"
+#include "coherent_culling.hpp"
+#include "geometry.hpp"
+#include <cstdio>
+
+namespace {
+    struct path_result
+    {
+        std::size_t visible = 0;
+        std::size_t tested  = 0;
+        std::size_t reused  = 0;
+        std::size_t resets  = 0;
+    };
+}
+
+BENCH(coherent_culling)
+{
+    auto                 objects = load_scene_objects(load_mesh_bounds());
+    Octree<scene_object> tree;
+    build_scene_octree(tree, objects);
+
+    // The flythrough with a jump to the orbit every 60 frames, every jump must reset the cache
+    auto teleport = camera_path("flythrough");
+    auto orbit    = camera_path("orbit");
+    for (std::size_t i = 60; i < teleport.size(); i += 60)
+        teleport.insert(teleport.begin() + static_cast<std::ptrdiff_t>(i), orbit[i]);
+
+    // Tests count cells and objects
+    std::printf("  %-10s %9s %9s %12s %12s %8s %7s\n", "path", "full ms", "coh. ms", "full tests", "coh. tests", "reused", "resets");
+    for (char const* path_name : { "flythrough", "orbit", "overview", "teleport" }) {
+        auto const path = std::string(path_name) == "teleport" ? teleport : camera_path(path_name);
+        std::vector<frustrum> frustums;
+        for (auto const& frame : path)
+            frustums.emplace_back(camera_view_projection(frame));
+
+        path_result full;
+        double      full_ms = bench_best_ms(5, [&] {
+            full = {};
+            for (auto const& f : frustums)
+                traverse_octree(
+                    tree, tree.find_node(1u), false,
+                    [&](Octree<scene_object>::node const& n) {
+                        if (n.locational_code == 1u)
+                            return eOVERLAPPING;
+                        full.tested++;
+                        return classify_frustum_aabb_naive(f, cell_bv(tree, n));
+                    },
+                    [&](scene_object const& obj) {
+                        full.tested++;
+                        return classify_frustum_aabb_naive(f, obj.bv);
+                    },
+                    [&](scene_object const&) { full.visible++; }, [](Octree<scene_object>::node const&, bool) { return true; });
+        });
+
+        path_result coherent;
+        double      coherent_ms = bench_best_ms(5, [&] {
+            coherent = {};
+            coherent_culler                     culler;
+            std::vector<coherent_culler::entry> cached(objects.size());
+            for (std::size_t i = 0; i < path.size(); ++i) {
+                culler.begin_frame(frustums[i], path[i].eye);
+                traverse_octree(
+                    tree, tree.find_node(1u), false,
+                    [&](Octree<scene_object>::node const& n) {
+                        return n.locational_code == 1u ? eOVERLAPPING : culler.classify(n.locational_code, cell_bv(tree, n));
+                    },
+                    [&](scene_object const& obj) { return culler.classify(cached[static_cast<std::size_t>(&obj - objects.data())], obj.bv); },
+                    [&](scene_object const&) { coherent.visible++; }, [](Octree<scene_object>::node const&, bool) { return true; });
+                coherent.tested += culler.frame_stats().tested;
+                coherent.reused += culler.frame_stats().reused;
+                coherent.resets += culler.frame_stats().reset;
+            }
+        });
+
+        double frames = static_cast<double>(path.size());
+        std::printf("  %-10s %9.4f %9.4f %12.1f %12.1f %7.1f%% %7zu%s\n", path_name, full_ms / frames, coherent_ms / frames, full.tested / frames,
+                    coherent.tested / frames, 100.0 * coherent.reused / static_cast<double>(coherent.reused + coherent.tested), coherent.resets,
+                    full.visible == coherent.visible ? "" : "  VISIBLE SET MISMATCH");
+    }
+}
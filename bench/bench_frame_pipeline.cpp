@@ -0,0 +1,71 @@
+#include "bench_scene.hpp"
+#include "frame_pipeline.hpp"
+#include "geometry.hpp"
+#include <cstdio>
+
+namespace {
+    // Stands in for the GL submission: reads the visible set, then spins for the given time
+    float submit(std::vector<scene_object const*> const& visible, double ms)
+    {
+        float checksum = 0.0f;
+        for (auto const* obj : visible)
+            checksum += obj->m2w[3][0];
+        bench_timer timer;
+        while (timer.ms() < ms) {
+        }
+        return checksum;
+    }
+}
+
+BENCH(frame_pipeline)
+{
+    auto                 objects = load_scene_objects(load_mesh_bounds());
+    Octree<scene_object> tree;
+    build_scene_octree(tree, objects);
+
+    // Culling and submission can only overlap with a second core
+    std::printf("  hardware threads: %u\n", std::thread::hardware_concurrency());
+    for (char const* path_name : { "flythrough", "orbit" }) {
+        auto const path = camera_path(path_name);
+
+        // Culling cost alone
+        std::vector<scene_object const*> visible;
+        cull_counts                      counts;
+        double                           cull_ms = bench_best_ms(3, [&] {
+            for (auto const& frame : path) {
+                visible.clear();
+                cull_octree(tree, frustrum(camera_view_projection(frame)), false, counts, [&](scene_object const& obj) { visible.push_back(&obj); });
+            }
+        }) / static_cast<double>(path.size());
+
+        for (double ratio : { 0.5, 1.0, 2.0 }) {
+            double submit_ms = cull_ms * ratio;
+            float  checksum  = 0.0f;
+            std::printf("  %-10s cull %.3f ms, submit %.3f ms:", path_name, cull_ms, submit_ms);
+
+            for (bool pipelined : { false, true }) {
+                frame_pipeline                   pipeline(pipelined);
+                std::vector<scene_object const*> sets[2];
+                int                              front = 0;
+                double                           ms    = bench_best_ms(3, [&] {
+                    for (auto const& frame : path) {
+                        if (pipeline.wait())
+                            front ^= 1;
+                        pipeline.start([&tree, &set = sets[front ^ 1], f = frustrum(camera_view_projection(frame))]() {
+                            set.clear();
+                            cull_counts counts;
+                            cull_octree(tree, f, false, counts, [&](scene_object const& obj) { set.push_back(&obj); });
+                        });
+                        if (!pipelined && pipeline.wait())
+                            front ^= 1;
+                        checksum += submit(sets[front], submit_ms);
+                    }
+                    if (pipeline.wait())
+                        front ^= 1;
+                }) / static_cast<double>(path.size());
+                std::printf("  %s %.3f ms/frame", pipelined ? "pipelined" : "sequential", ms);
+            }
+            std::printf("  (sum %.3f, max %.3f)%s\n", cull_ms + submit_ms, std::max(cull_ms, submit_ms), checksum == 0.0f ? " ?" : "");
+        }
+    }
+}
@@ -0,0 +1,136 @@
+#include "bench_scene.hpp"
+#include "hash_grid.hpp"
+#include <cstdio>
+#include <random>
+
+namespace {
+    struct crowd
+    {
+        std::vector<scene_object> agents;
+        std::vector<vec3>         velocities;
+    };
+
+    // Agents on the ground around a few squares, each walking at its own speed
+    crowd make_crowd(std::size_t count)
+    {
+        std::mt19937                          rng(31);
+        std::uniform_real_distribution<float> square(-400.0f, 400.0f), size(0.5f, 2.0f), speed(-1.5f, 1.5f);
+        std::normal_distribution<float>       spread(0.0f, 40.0f);
+        std::vector<vec3>                     squares(24);
+        for (auto& s : squares)
+            s = vec3(square(rng), 0.0f, square(rng));
+
+        crowd c;
+        c.agents.resize(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            vec3 p = squares[i % squares.size()] + vec3(spread(rng), 0.0f, spread(rng));
+            float s = size(rng);
+            c.agents[i].bv = aabb(p, p + vec3(s, 2.0f * s, s));
+            c.velocities.push_back(vec3(speed(rng), 0.0f, speed(rng)));
+        }
+        return c;
+    }
+
+    // One step, turning around at the edge of the world
+    void step(crowd& c)
+    {
+        for (std::size_t i = 0; i < c.agents.size(); ++i) {
+            aabb& bv = c.agents[i].bv;
+            vec3& v  = c.velocities[i];
+            for (int axis : { 0, 2 })
+                if (bv.min[axis] + v[axis] < -500.0f || bv.max[axis] + v[axis] > 500.0f)
+                    v[axis] = -v[axis];
+            bv = aabb(bv.min + v, bv.max + v);
+        }
+    }
+
+    struct workload
+    {
+        std::vector<aabb>     regions; // Neighbourhood of some agents
+        std::vector<frustrum> frustums;
+    };
+
+    template<typename Update, typename Query, typename Cull>
+    void run(char const* name, crowd c, workload const& w, int frames, Update&& update, Query&& query, Cull&& cull)
+    {
+        double      update_ms = 0.0, query_ms = 0.0, cull_ms = 0.0;
+        std::size_t found = 0, visible = 0;
+        for (int frame = 0; frame < frames; ++frame) {
+            step(c);
+            bench_timer timer;
+            update(c.agents);
+            update_ms += timer.ms();
+
+            timer.reset();
+            for (auto const& r : w.regions)
+                query(r, found);
+            query_ms += timer.ms();
+
+            timer.reset();
+            cull(w.frustums[frame % w.frustums.size()], visible);
+            cull_ms += timer.ms();
+        }
+        std::printf("  %-22s %10.2f %12.0f %10.2f %10zu %10zu\n", name, update_ms / frames, w.regions.size() * frames / (query_ms / 1000.0),
+                    cull_ms / frames, found / (w.regions.size() * frames), visible / frames);
+    }
+}
+
+BENCH(hash_grid)
+{
+    constexpr int frames = 30;
+    crowd const   c      = make_crowd(100000);
+
+    workload                              w;
+    std::mt19937                          rng(32);
+    std::uniform_int_distribution<std::size_t> pick(0, c.agents.size() - 1);
+    for (int i = 0; i < 2000; ++i) {
+        vec3 p = c.agents[pick(rng)].bv.min;
+        w.regions.emplace_back(p - vec3(8.0f, 2.0f, 8.0f), p + vec3(8.0f, 4.0f, 8.0f));
+    }
+    for (int i = 0; i < frames; ++i) {
+        float a   = glm::two_pi<float>() * static_cast<float>(i) / frames;
+        vec3  eye = vec3(300.0f * std::cos(a), 40.0f, 300.0f * std::sin(a));
+        w.frustums.emplace_back(camera_projection() * glm::lookAt(eye, vec3(0.0f), vec3(0, 1, 0)));
+    }
+
+    std::printf("  %zu agents, %d frames, %zu 16x6x16 region queries per frame\n", c.agents.size(), frames, w.regions.size());
+    std::printf("  %-22s %10s %12s %10s %10s %10s\n", "", "update ms", "queries/s", "cull ms", "found", "visible");
+
+    for (unsigned levels : { 6u, 8u }) {
+        Octree<scene_object> tree;
+        char                 name[32];
+        std::snprintf(name, sizeof(name), "octree 2^10, %u levels", levels);
+        crowd copy = c;
+        run(name, copy, w, frames,
+            [&](std::vector<scene_object>& agents) {
+                if (tree.m_nodes.empty())
+                    build_scene_octree(tree, agents, 1u << 10, levels);
+                for (auto& obj : agents)
+                    tree.relocate(obj, LocationalCode::compute_locational_code(obj.bv, tree.root_size(), tree.levels()));
+            },
+            [&](aabb const& r, std::size_t& found) { tree.query(r, [&](scene_object&) { found++; }); },
+            [&](frustrum const& f, std::size_t& visible) { tree.frustum(f, [&](scene_object&) { visible++; }); });
+    }
+
+    for (float cell_size : { 2.0f, 4.0f, 8.0f, 16.0f }) {
+        hash_grid<scene_object> grid;
+        char                    name[32];
+        std::snprintf(name, sizeof(name), "hash grid, cell %g", cell_size);
+        crowd copy = c;
+        run(name, copy, w, frames,
+            [&](std::vector<scene_object>& agents) {
+                if (grid.objects().empty()) {
+                    std::vector<scene_object*> pointers;
+                    for (auto& obj : agents)
+                        pointers.push_back(&obj);
+                    grid.build(pointers, { .cell_size = cell_size });
+                }
+                else
+                    grid.rebuild();
+            },
+            [&](aabb const& r, std::size_t& found) { grid.query(r, [&](scene_object&) { found++; }); },
+            [&](frustrum const& f, std::size_t& visible) { grid.frustum(f, [&](scene_object&) { visible++; }); });
+        std::printf("  %-22s %zu entries, %zu buckets, %zu large, %.1f KB\n", "", grid.entry_count(), grid.bucket_count(), grid.large_count(),
+                    grid.memory() / 1024.0);
+    }
+}
@@ -0,0 +1,69 @@
+#include "bench_scene.hpp"
+#include "geometry.hpp"
+#include "hlod.hpp"
+#include "lod.hpp"
+#include <cstdio>
+
+namespace {
+    struct frame_counts
+    {
+        std::size_t objects = 0;
+        std::size_t proxies = 0;
+    };
+}
+
+BENCH(hlod_draws)
+{
+    auto const mesh_bvs = load_mesh_bounds();
+    std::vector<std::vector<triangle>> meshes;
+    for (std::size_t i = 0; i < mesh_bvs.size(); ++i) {
+        std::string prefix = WORKDIR "assets/mirlo_" + std::to_string(i);
+        auto        mesh   = load_binary_mesh(prefix + "_lod3.binary");
+        meshes.push_back(mesh.empty() ? load_binary_mesh(prefix + ".binary") : mesh);
+    }
+
+    auto                 objects = load_scene_objects(mesh_bvs);
+    Octree<scene_object> tree;
+    build_scene_octree(tree, objects);
+
+    bench_timer timer;
+    auto        hlod = hlod_cache::build(tree, 0, {}, [&](scene_object const& obj, std::vector<triangle>& out) {
+        for (auto t : meshes[obj.mesh]) {
+            for (int v = 0; v < 3; ++v)
+                t[v] = vec3(obj.m2w * vec4(t[v], 1.0f));
+            out.push_back(t);
+        }
+    });
+    std::printf("  build %zu proxies (%u triangles)  %8.2f ms\n", hlod.proxies().size(), hlod.info().triangle_count, timer.ms());
+
+    Lod::settings settings;
+    for (char const* path_name : { "flythrough", "orbit", "overview" }) {
+        auto const path = camera_path(path_name);
+        for (bool use_hlod : { false, true }) {
+            frame_counts total;
+            std::size_t  worst = 0;
+            for (auto const& frame : path) {
+                frame_counts   counts;
+                frustrum const f(camera_view_projection(frame));
+                traverse_octree(
+                    tree, tree.find_node(1u), false,
+                    [&](Octree<scene_object>::node const& n) { return n.locational_code == 1u ? eOVERLAPPING : classify_frustum_aabb_naive(f, cell_bv(tree, n)); },
+                    [&](scene_object const& obj) { return classify_frustum_aabb_naive(f, obj.bv); }, [&](scene_object const&) { counts.objects++; },
+                    [&](Octree<scene_object>::node const& n, bool) {
+                        if (use_hlod && n.locational_code != 1u && Lod::screen_size(cell_bv(tree, n), frame.eye, camera_projection()[1][1]) < settings.hlod_threshold &&
+                            hlod.find(n.locational_code)) {
+                            counts.proxies++;
+                            return false;
+                        }
+                        return true;
+                    });
+                total.objects += counts.objects;
+                total.proxies += counts.proxies;
+                worst = std::max(worst, counts.objects + counts.proxies);
+            }
+            double frames = static_cast<double>(path.size());
+            std::printf("  %-10s %-7s %8.1f objects + %6.1f proxies /frame  (worst %zu)\n", path_name, use_hlod ? "hlod" : "objects",
+                        total.objects / frames, total.proxies / frames, worst);
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#include "bench_scene.hpp"
+#include "kd_tree.hpp"
+#include "mesh_bvh.hpp"
+#include <cstdio>
+#include <random>
+#include <thread>
+
+namespace {
+    // Rolling heightfield, two triangles per quad
+    std::vector<triangle> make_terrain(int quads)
+    {
+        auto height = [](float x, float z) { return 8.0f * std::sin(x * 0.05f) * std::cos(z * 0.07f) + 2.0f * std::sin(x * 0.31f + z * 0.23f); };
+        std::vector<triangle> triangles;
+        triangles.reserve(2 * quads * quads);
+        for (int i = 0; i < quads; ++i)
+            for (int j = 0; j < quads; ++j) {
+                float x0 = static_cast<float>(i), x1 = x0 + 1.0f, z0 = static_cast<float>(j), z1 = z0 + 1.0f;
+                vec3  a(x0, height(x0, z0), z0), b(x1, height(x1, z0), z0), c(x1, height(x1, z1), z1), d(x0, height(x0, z1), z1);
+                triangles.emplace_back(a, b, c);
+                triangles.emplace_back(a, c, d);
+            }
+        return triangles;
+    }
+
+    // The first scene.txt objects, in world space, until there are count triangles
+    std::vector<triangle> make_city(std::size_t count)
+    {
+        auto                  objects = load_scene_objects(load_mesh_bounds());
+        std::vector<triangle> triangles;
+        for (auto const& obj : objects) {
+            for (auto const& t : load_binary_mesh(WORKDIR "assets/mirlo_" + std::to_string(obj.mesh) + ".binary"))
+                triangles.emplace_back(vec3(obj.m2w * vec4(t.a, 1.0f)), vec3(obj.m2w * vec4(t.b, 1.0f)), vec3(obj.m2w * vec4(t.c, 1.0f)));
+            if (triangles.size() >= count)
+                break;
+        }
+        return triangles;
+    }
+
+    void run(char const* name, std::vector<triangle> const& triangles)
+    {
+        std::printf("  %s: %zu triangles\n", name, triangles.size());
+
+        kd_tree tree;
+        for (unsigned threads : { 1u, 4u }) {
+            bench_timer timer;
+            tree.build(triangles, { .threads = threads });
+            std::printf("    build %u thread%s %8.1f ms\n", threads, threads > 1 ? "s" : " ", timer.ms());
+        }
+        std::size_t leaves = 0;
+        for (auto const& n : tree.nodes())
+            leaves += n.leaf();
+        std::printf("    %zu nodes (%zu leaves), %.2f references per triangle, depth %u, %.1f MB\n", tree.nodes().size(), leaves,
+                    tree.indices().size() / static_cast<double>(triangles.size()), tree.depth(), tree.memory() / (1024.0 * 1024.0));
+
+        bench_timer timer;
+        mesh_bvh    bvh(triangles);
+        std::printf("    mesh_bvh for comparison: build %.1f ms, %.1f MB with its triangle copy\n", timer.ms(), bvh.memory() / (1024.0 * 1024.0));
+
+        // Queries from random points inside the bounds
+        aabb const                            bounds = tree.bounds();
+        std::mt19937                          rng(51);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f), direction(-1.0f, 1.0f);
+        std::vector<vec3>                     points, dirs;
+        for (int i = 0; i < 20000; ++i) {
+            points.push_back(bounds.min + (bounds.max - bounds.min) * vec3(unit(rng), unit(rng), unit(rng)));
+            dirs.push_back(glm::normalize(vec3(direction(rng), direction(rng), direction(rng))));
+        }
+
+        std::size_t hits = 0;
+        double      kd_rays = bench_best_ms(3, [&] {
+            for (std::size_t i = 0; i < points.size(); ++i)
+                hits += tree.raycast(points[i], dirs[i]).triangle != UINT32_MAX;
+        });
+        double bvh_rays = bench_best_ms(3, [&] {
+            for (std::size_t i = 0; i < points.size(); ++i)
+                hits += bvh.raycast(points[i], dirs[i]).triangle != UINT32_MAX;
+        });
+        double closest = bench_best_ms(3, [&] {
+            for (auto const& p : points)
+                hits += tree.closest_point(p).triangle != UINT32_MAX;
+        });
+        std::vector<uint32_t> found;
+        double                boxes = bench_best_ms(3, [&] {
+            for (auto const& p : points) {
+                tree.query(aabb(p - vec3(2.0f), p + vec3(2.0f)), found);
+                hits += found.size();
+            }
+        });
+
+        // Brute force on a few of them
+        std::size_t const brute_count = 20;
+        double            brute       = bench_best_ms(1, [&] {
+            for (std::size_t i = 0; i < brute_count; ++i) {
+                float best = FLT_MAX;
+                for (auto const& t : triangles)
+                    best = std::min(best, glm::distance(points[i], closest_point_triangle(points[i], t.a, t.b, t.c)));
+                hits += best < FLT_MAX;
+            }
+        });
+
+        auto per_second = [](std::size_t count, double ms) { return count / (ms / 1000.0); };
+        std::printf("    rays/s %10.0f (mesh_bvh %.0f)   closest points/s %9.0f (brute force %.1f)   4x4x4 boxes/s %9.0f%s\n",
+                    per_second(points.size(), kd_rays), per_second(points.size(), bvh_rays), per_second(points.size(), closest),
+                    per_second(brute_count, brute), per_second(points.size(), boxes), hits ? "" : " ?");
+    }
+}
+
+BENCH(kd_tree)
+{
+    std::printf("  hardware threads: %u\n", std::thread::hardware_concurrency());
+    run("terrain", make_terrain(708));
+    run("city", make_city(1000000));
+}
@@ -0,0 +1,85 @@
+#include "bench_scene.hpp"
+#include "geometry.hpp"
+#include "lod.hpp"
+#include "mesh_simplify.hpp"
+#include "scene_format.hpp"
+#include <cstdio>
+
+namespace {
+    // Triangles of every LOD of every mesh, from the lod_build output if present
+    std::vector<std::vector<std::size_t>> load_lod_triangles(bool& generated)
+    {
+        std::vector<std::vector<std::size_t>> meshes;
+        generated = false;
+        for (;;) {
+            std::string prefix = WORKDIR "assets/mirlo_" + std::to_string(meshes.size());
+            auto        lod0   = load_binary_mesh(prefix + ".binary");
+            if (lod0.empty())
+                break;
+
+            std::vector<std::size_t> counts{ lod0.size() };
+            while (counts.size() < Lod::max_lods) {
+                auto lod = load_binary_mesh(prefix + "_lod" + std::to_string(counts.size()) + ".binary");
+                if (lod.empty())
+                    break;
+                counts.push_back(lod.size());
+            }
+            if (counts.size() == 1) {
+                counts.clear();
+                for (auto const& lod : build_lod_chain(lod0, Lod::max_lods))
+                    counts.push_back(lod.size());
+                generated |= counts.size() > 1;
+            }
+            meshes.push_back(counts);
+        }
+        return meshes;
+    }
+}
+
+BENCH(lod_triangles)
+{
+    bool       generated = false;
+    auto const lods      = load_lod_triangles(generated);
+    auto const mesh_bvs  = load_mesh_bounds();
+    if (generated)
+        std::printf("  (no lod_build output, LODs generated in memory)\n");
+
+    struct object
+    {
+        unsigned mesh;
+        aabb     bv;
+        unsigned lod;
+    };
+    std::vector<object> objects;
+    for (auto const& e : SceneFormat::load_text(WORKDIR "assets/scene.txt"))
+        objects.push_back({ static_cast<unsigned>(e.mesh_index), transform_aabb(mesh_bvs.at(e.mesh_index), e.m2w), 0 });
+
+    float const proj_y_scale = camera_projection()[1][1];
+    for (char const* path_name : { "flythrough", "orbit" }) {
+        auto const path = camera_path(path_name);
+        for (float hysteresis : { 0.0f, Lod::settings{}.hysteresis }) {
+            Lod::settings settings;
+            settings.hysteresis = hysteresis;
+            for (auto& obj : objects)
+                obj.lod = 0;
+
+            std::size_t full = 0, submitted = 0, switches = 0;
+            for (auto const& frame : path) {
+                frustrum f(camera_view_projection(frame));
+                for (auto& obj : objects) {
+                    if (classify_frustum_aabb_naive(f, obj.bv) == eOUTSIDE)
+                        continue;
+                    auto const& mesh = lods[obj.mesh];
+                    unsigned    lod  = Lod::select(settings, Lod::screen_size(obj.bv, frame.eye, proj_y_scale), obj.lod, static_cast<unsigned>(mesh.size()));
+                    switches += lod != obj.lod;
+                    obj.lod = lod;
+                    full += mesh[0];
+                    submitted += mesh[lod];
+                }
+            }
+            double frames = static_cast<double>(path.size());
+            std::printf("  %-10s hysteresis %.2f  full %9.0f  lod %9.0f tris/frame (%4.1f%%)  %6.1f switches/frame\n", path_name, hysteresis,
+                        full / frames, submitted / frames, 100.0 * static_cast<double>(submitted) / static_cast<double>(full), switches / frames);
+        }
+    }
+}
@@ -0,0 +1,166 @@
+#include "bench_scene.hpp"
+#include "geometry.hpp"
+#include "mesh_bvh.hpp"
+#include <cstdio>
+#include <random>
+
+namespace {
+    // The cross product test intersection_time_ray_triangle used before the watertight one
+    float cross_product_test(vec3 const& rayorigin, vec3 const& raydir, vec3 const& a, vec3 const& b, vec3 const& c)
+    {
+        vec3  ab(b - a), bc(c - b);
+        vec3  n = glm::normalize(glm::cross(ab, bc));
+        float t = (glm::dot(n, a) - glm::dot(n, rayorigin)) / glm::dot(n, raydir);
+        if (t < 0)
+            return -1.0f;
+        vec3 point = rayorigin + raydir * t;
+        if (glm::dot(n, glm::cross(ab, point - a)) < 0 || glm::dot(n, glm::cross(bc, point - b)) < 0 || glm::dot(n, glm::cross(a - c, point - c)) < 0)
+            return -1.0f;
+        return t;
+    }
+}
+
+BENCH(mesh_bvh)
+{
+    auto const meshes = load_meshes();
+
+    // Bottom level, once per mesh
+    std::vector<mesh_bvh> trees;
+    std::size_t           triangles = 0, bytes = 0;
+    unsigned              depth     = 0;
+    bench_timer           timer;
+    for (auto const& mesh : meshes)
+        trees.emplace_back(mesh);
+    double build_ms = timer.ms();
+    for (auto const& tree : trees) {
+        triangles += tree.triangles().size();
+        bytes += tree.memory();
+        depth = std::max(depth, tree.depth());
+    }
+    std::printf("  %zu meshes, %zu triangles: built in %.1f ms, %.1f KB, depth up to %u\n", meshes.size(), triangles, build_ms, bytes / 1024.0, depth);
+
+    // Kernels alone over every triangle of a mesh
+    std::mt19937                          rng(41);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f), fraction(0.0f, 1.0f);
+    {
+        auto const&       mesh = meshes[5];
+        std::vector<vec3> dirs;
+        for (int i = 0; i < 2000; ++i)
+            dirs.push_back(glm::normalize(vec3(unit(rng), unit(rng), unit(rng))));
+        vec3   origin(0.0f);
+        float  sink  = 0.0f;
+        double cross = bench_best_ms(3, [&] {
+            for (auto const& d : dirs)
+                for (auto const& t : mesh)
+                    sink += cross_product_test(origin, d, t.a, t.b, t.c);
+        });
+        double watertight = bench_best_ms(3, [&] {
+            for (auto const& d : dirs) {
+                auto ray = make_ray_triangle_setup(origin, d);
+                for (auto const& t : mesh)
+                    sink += intersection_time_ray_triangle(ray, t.a, t.b, t.c);
+            }
+        });
+        double tests = static_cast<double>(dirs.size() * mesh.size());
+        std::printf("  kernel: cross product %.1f M tests/s, watertight %.1f M tests/s%s\n", tests / (cross * 1000.0), tests / (watertight * 1000.0),
+                    sink == 0.0f ? " ?" : "");
+    }
+
+    // Rays through an edge shared by two triangles seen on both sides of it must hit one of them, silhouette edges can miss both
+    {
+        auto opposite = [](triangle const& t, vec3 const& a, vec3 const& b) -> vec3 const* {
+            bool has_a = t.a == a || t.b == a || t.c == a, has_b = t.a == b || t.b == b || t.c == b;
+            if (!has_a || !has_b || a == b)
+                return nullptr;
+            return t.a != a && t.a != b ? &t.a : t.b != a && t.b != b ? &t.b : &t.c;
+        };
+        std::size_t rays = 0, cross_misses = 0, watertight_misses = 0;
+        for (std::size_t m = 0; m < meshes.size(); m += 7) {
+            auto const& mesh = meshes[m];
+            for (int i = 0; i < 200; ++i) {
+                triangle const& t      = mesh[rng() % mesh.size()];
+                vec3            target = glm::mix(t.a, t.b, fraction(rng));
+                vec3            eye    = target + glm::normalize(vec3(unit(rng), unit(rng), unit(rng))) * 50.0f;
+                vec3            side   = glm::cross(t.b - t.a, eye - t.a);
+                bool            crossed = false;
+                for (auto const& other : mesh)
+                    if (vec3 const* c = &other != &t ? opposite(other, t.a, t.b) : nullptr)
+                        crossed = crossed || glm::dot(side, *c - t.a) * glm::dot(side, t.c - t.a) < 0.0f;
+                if (!crossed)
+                    continue;
+
+                bool hit = false;
+                for (auto const& other : mesh)
+                    hit = hit || cross_product_test(eye, target - eye, other.a, other.b, other.c) >= 0.0f;
+                cross_misses += !hit;
+                watertight_misses += trees[m].raycast(eye, target - eye).t < 0.0f;
+                rays++;
+            }
+        }
+        std::printf("  %zu rays through shared edges: %zu missed with the cross product test, %zu watertight\n", rays, cross_misses, watertight_misses);
+    }
+
+    // Two levels over scene.txt: octree of objects, mesh BVH of the ones whose bv is hit
+    auto                 objects = load_scene_objects(load_mesh_bounds());
+    Octree<scene_object> octree;
+    build_scene_octree(octree, objects);
+    std::vector<mat4> w2m;
+    for (auto const& obj : objects)
+        w2m.push_back(glm::inverse(obj.m2w));
+
+    std::vector<std::pair<vec3, vec3>> rays;
+    for (char const* path_name : { "flythrough", "orbit" })
+        for (auto const& frame : camera_path(path_name, 60)) {
+            mat4 inv = glm::inverse(camera_view_projection(frame));
+            for (int i = 0; i < 100; ++i) {
+                vec4 p = inv * vec4(unit(rng), unit(rng), 1.0f, 1.0f);
+                rays.emplace_back(frame.eye, glm::normalize(vec3(p) / p.w - frame.eye));
+            }
+        }
+
+    auto exact = [&](vec3 const& origin, vec3 const& dir, bool use_bvh, std::size_t& tested) {
+        vec3 inv = 1.0f / dir;
+        return octree.raycast(origin, dir, FLT_MAX, [&](scene_object& obj, float tmax) {
+            if (intersection_time_ray_box(origin, inv, obj.bv.min, obj.bv.max, tmax) < 0.0f)
+                return -1.0f;
+            tested++;
+            std::size_t index = static_cast<std::size_t>(&obj - objects.data());
+            if (use_bvh)
+                return trees[obj.mesh].raycast(origin, dir, w2m[index], tmax).t;
+            vec3  o = vec3(w2m[index] * vec4(origin, 1.0f)), d = vec3(w2m[index] * vec4(dir, 0.0f));
+            float closest = -1.0f;
+            for (auto const& t : meshes[obj.mesh])
+                if (float hit = cross_product_test(o, d, t.a, t.b, t.c); hit >= 0.0f && hit <= tmax && (closest < 0.0f || hit < closest))
+                    closest = hit;
+            return closest;
+        });
+    };
+
+    std::size_t bv_hits = 0, exact_hits = 0, tested = 0, differ = 0;
+    for (auto const& [o, d] : rays) {
+        auto bv_hit = octree.raycast(o, d);
+        auto hit    = exact(o, d, true, tested);
+        bv_hits += bv_hit.object != nullptr;
+        exact_hits += hit.object != nullptr;
+        differ += bv_hit.object != hit.object;
+    }
+    std::printf("  %zu camera rays over scene.txt: %zu hit a bv, %zu a triangle, %zu hit another object than the bv test says\n", rays.size(), bv_hits,
+                exact_hits, differ);
+    std::printf("  %.1f objects tested per ray\n", tested / static_cast<double>(rays.size()));
+
+    double bv_ms = bench_best_ms(3, [&] {
+        for (auto const& [o, d] : rays)
+            bv_hits += octree.raycast(o, d).object != nullptr;
+    });
+    double bvh_ms = bench_best_ms(3, [&] {
+        for (auto const& [o, d] : rays)
+            exact_hits += exact(o, d, true, tested).object != nullptr;
+    });
+    std::size_t brute_rays = rays.size() / 10;
+    double      brute_ms   = bench_best_ms(1, [&] {
+        for (std::size_t i = 0; i < brute_rays; ++i)
+            exact_hits += exact(rays[i * 10].first, rays[i * 10].second, false, tested).object != nullptr;
+    });
+    std::printf("  rays/s: %.0f bv only, %.0f exact with mesh BVHs, %.0f exact testing every triangle\n", rays.size() / (bv_ms / 1000.0),
+                rays.size() / (bvh_ms / 1000.0), brute_rays / (brute_ms / 1000.0));
+}
@@ -0,0 +1,59 @@
+#include "bench_scene.hpp"
+#include "octree_image.hpp"
+#include "scene_format.hpp"
+#include "geometry.hpp"
+#include <cstdio>
+
+namespace {
+    struct bench_object
+    {
+        aabb bv = {};
+        Octree<bench_object>::node* m_octree_node = nullptr;
+        bench_object* m_octree_next_obj = nullptr;
+        bench_object* m_octree_prev_obj = nullptr;
+    };
+}
+
+BENCH(octree_image_first_query)
+{
+    unsigned const levels = 6, root_size = 1u << 10;
+    frustrum const f(glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.01f, 1000.0f) *
+                     glm::lookAt(vec3(0, 10, -10), vec3(0), vec3(0, 1, 0)));
+    auto const mesh_bvs = load_mesh_bounds();
+
+    // Rebuild: parse the scene, compute the world bounds, build, query
+    std::size_t visible = 0;
+    std::vector<bench_object> objects;
+    Octree<bench_object> tree;
+    double ms = bench_best_ms(3, [&]() {
+        tree.clear();
+        objects.clear();
+        for (auto const& e : SceneFormat::load_text(WORKDIR "assets/scene.txt")) {
+            bench_object obj;
+            obj.bv = transform_aabb(mesh_bvs.at(e.mesh_index), e.m2w);
+            objects.push_back(obj);
+        }
+        tree.set_root_size(root_size);
+        tree.set_levels(levels);
+        for (auto& obj : objects)
+            tree.insert(obj, LocationalCode::compute_locational_code(obj.bv, root_size, levels));
+        cull_counts counts;
+        cull_octree(tree, f, false, counts, [](bench_object const&) {});
+        visible = counts.visible;
+    });
+    std::printf("  rebuild + query        %8.2f ms  (%zu visible)\n", ms, visible);
+
+    char const* path = "bench_scene.octree";
+    octree_image::write(path, octree_image::build(tree, 0, [&](bench_object const& obj) { return &obj - objects.data(); }));
+
+    // Snapshot: map the image and query it in place
+    std::vector<uint32_t> result;
+    ms = bench_best_ms(3, [&]() {
+        octree_image image;
+        image.open(path, 0);
+        result.clear();
+        image.query_frustum(f, result);
+    });
+    std::printf("  mapped image + query   %8.2f ms  (%zu visible)\n", ms, result.size());
+    std::remove(path);
+}
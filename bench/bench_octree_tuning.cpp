@@ -0,0 +1,34 @@
+#include "bench_scene.hpp"
+#include "octree_tuning.hpp"
+#include <cstdio>
+#include <iostream>
+
+BENCH(octree_tuning)
+{
+    auto const        objects = load_scene_objects(load_mesh_bounds());
+    std::vector<aabb> bvs;
+    for (auto const& obj : objects)
+        bvs.push_back(obj.bv);
+
+    // Views of every path, the tuner picks what culls them fastest
+    std::vector<frustrum> views;
+    for (char const* path_name : { "flythrough", "orbit", "overview" })
+        for (auto const& frame : camera_path(path_name))
+            views.emplace_back(camera_view_projection(frame));
+
+    bench_timer timer;
+    auto        estimate = tune_octree(bvs);
+    std::printf("  statistics only: %.2f ms\n", timer.ms());
+    estimate.print(std::cout);
+
+    timer.reset();
+    auto report = tune_octree(bvs, views);
+    std::printf("  with benchmark: %.2f ms\n", timer.ms());
+    report.print(std::cout);
+
+    // Demo defaults, root 2^10 with 6 levels
+    for (auto const& c : report.candidates)
+        if (c.size_bit == 10 && c.levels == 6 && c.ms >= 0.0f)
+            std::printf("  default 2^10/6: %.4f ms per view, tuned 2^%u/%u\n", c.ms, report.size_bit, report.levels);
+    std::printf("  objects outside a 2^7 root: %zu\n", octree_objects_outside(bvs, 1u << 7));
+}
@@ -0,0 +1,107 @@
+#include "bench.hpp"
+#include "octree.hpp"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+    template<unsigned Dim>
+    struct agent
+    {
+        using tree_type = Octree<agent, Dim>;
+
+        typename tree_type::bounds_type bv;
+        typename tree_type::node*       m_octree_node     = nullptr;
+        agent*                          m_octree_next_obj = nullptr;
+        agent*                          m_octree_prev_obj = nullptr;
+    };
+
+    // Top down 2D world: agents around a few towns, the 3D tree sees them as flat boxes
+    std::vector<rect> make_agents(std::size_t count, float world)
+    {
+        std::mt19937                          rng(11);
+        std::uniform_real_distribution<float> town(-world * 0.4f, world * 0.4f), size(0.5f, 3.0f);
+        std::normal_distribution<float>       spread(0.0f, world * 0.05f);
+        std::vector<glm::vec2>                towns(16);
+        for (auto& t : towns)
+            t = glm::vec2(town(rng), town(rng));
+
+        std::vector<rect> agents(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            glm::vec2 p = towns[i % towns.size()] + glm::vec2(spread(rng), spread(rng));
+            agents[i]   = rect(p, p + glm::vec2(size(rng), size(rng)));
+        }
+        return agents;
+    }
+
+    template<unsigned Dim>
+    typename Octree<agent<Dim>, Dim>::bounds_type to_bounds(rect const& r)
+    {
+        if constexpr (Dim == 2)
+            return r;
+        else
+            return aabb(vec3(r.min.x, r.min.y, 0.0f), vec3(r.max.x, r.max.y, 1.0f));
+    }
+
+    template<unsigned Dim>
+    void run(char const* name, std::vector<rect> const& agents, std::vector<rect> const& regions, unsigned root_size, unsigned levels)
+    {
+        using tree_type = Octree<agent<Dim>, Dim>;
+        std::vector<agent<Dim>> objects(agents.size());
+        for (std::size_t i = 0; i < agents.size(); ++i)
+            objects[i].bv = to_bounds<Dim>(agents[i]);
+
+        tree_type   tree;
+        bench_timer timer;
+        tree.set_root_size(root_size);
+        tree.set_levels(levels);
+        for (auto& obj : objects)
+            tree.insert(obj, LocationalCode::compute_locational_code<Dim>(obj.bv, tree.root_size(), tree.levels()));
+        double build_ms = timer.ms();
+
+        std::size_t found = 0;
+        double      query_ms = bench_best_ms(3, [&] {
+            found = 0;
+            for (auto const& region : regions)
+                tree.query(to_bounds<Dim>(region), [&](agent<Dim> const&) { found++; });
+        });
+
+        // Every agent takes a small step
+        timer.reset();
+        for (auto& obj : objects) {
+            obj.bv.min += 0.75f;
+            obj.bv.max += 0.75f;
+            tree.relocate(obj, LocationalCode::compute_locational_code<Dim>(obj.bv, tree.root_size(), tree.levels()));
+        }
+        double move_ms = timer.ms();
+
+        std::size_t in_root = 0;
+        for (auto* obj = tree.find_node(1u)->first; obj; obj = obj->m_octree_next_obj)
+            in_root++;
+        std::printf("  %-9s 2^%-2u %2u levels %8zu nodes %8.1f KB %7zu in root %8.2f ms build %10.0f queries/s %8.2f ms move  (%zu found)\n", name,
+                    std::bit_width(root_size) - 1, levels, tree.m_nodes.size(),
+                    tree.m_nodes.size() * (sizeof(typename tree_type::node) + sizeof(void*) * 2) / 1024.0, in_root, build_ms,
+                    regions.size() / (query_ms / 1000.0), move_ms, found / regions.size());
+    }
+}
+
+BENCH(quadtree)
+{
+    std::vector<rect> const agents = make_agents(100000, 1024.0f);
+
+    std::mt19937                          rng(12);
+    std::uniform_real_distribution<float> position(-480.0f, 416.0f);
+    std::vector<rect>                     regions(10000);
+    for (auto& r : regions) {
+        glm::vec2 p(position(rng), position(rng));
+        r = rect(p, p + glm::vec2(64.0f));
+    }
+
+    std::printf("  %zu agents, %zu 64x64 region queries\n", agents.size(), regions.size());
+    for (unsigned levels : { 5u, 7u, 9u }) {
+        run<3>("octree", agents, regions, 1024, levels);
+        run<2>("quadtree", agents, regions, 1024, levels);
+    }
+    // Two bits per level leave room for a larger root at the same cell size
+    run<2>("quadtree", agents, regions, 1u << 12, 11);
+}
@@ -0,0 +1,113 @@
+#include "bench_scene.hpp"
+#include "octree_image.hpp"
+#include "quantized_octree.hpp"
+#include <cstdio>
+#include <random>
+
+namespace {
+    // Buildings in blocks over a 4 km square, with smaller props around them
+    std::vector<scene_object> make_city(std::size_t count)
+    {
+        std::mt19937                          rng(46);
+        std::uniform_real_distribution<float> ground(-2000.0f, 2000.0f), unit(0.0f, 1.0f);
+        std::vector<scene_object>             objects(count);
+        for (auto& obj : objects) {
+            vec3  p(ground(rng), 0.0f, ground(rng));
+            bool  building = unit(rng) < 0.2f;
+            vec3  size     = building ? vec3(8.0f + 20.0f * unit(rng), 10.0f + 60.0f * unit(rng), 8.0f + 20.0f * unit(rng))
+                                      : vec3(0.5f + 2.0f * unit(rng), 0.5f + 3.0f * unit(rng), 0.5f + 2.0f * unit(rng));
+            obj.bv = aabb(p, p + size);
+        }
+        return objects;
+    }
+
+    std::vector<frustrum> city_frustums(int count)
+    {
+        std::vector<frustrum> frustums;
+        for (int i = 0; i < count; ++i) {
+            float a   = glm::two_pi<float>() * static_cast<float>(i) / static_cast<float>(count);
+            vec3  eye = vec3(1200.0f * std::cos(a), 40.0f, 1200.0f * std::sin(a));
+            frustums.emplace_back(camera_projection() * glm::lookAt(eye, vec3(0.0f), vec3(0, 1, 0)));
+        }
+        return frustums;
+    }
+
+    // Full float bounds with the same plane test, to separate the storage from the test
+    void cull_float(octree_image const& image, QuantizedBounds::frustum_planes const& planes, std::vector<uint32_t>& out)
+    {
+        std::vector<std::pair<uint32_t, bool>> stack{ { 0u, false } };
+        while (!stack.empty()) {
+            auto [index, inside] = stack.back();
+            stack.pop_back();
+            auto const& n = image.nodes()[index];
+            if (!inside) {
+                eResult c = planes.classify(n.bv_min, n.bv_max);
+                if (c == eOUTSIDE)
+                    continue;
+                inside = c == eINSIDE;
+            }
+            for (auto const& obj : image.objects().subspan(n.first_object, n.object_count))
+                if (inside || planes.classify(obj.bv_min, obj.bv_max) != eOUTSIDE)
+                    out.push_back(obj.index);
+            for (unsigned c = 0, count = std::popcount(n.child_mask); c < count; ++c)
+                stack.emplace_back(n.first_child + c, inside);
+        }
+    }
+
+    void run(char const* name, std::vector<scene_object>& objects, unsigned root_size, unsigned levels, std::vector<frustrum> const& frustums)
+    {
+        Octree<scene_object> tree;
+        build_scene_octree(tree, objects, root_size, levels);
+        auto index_of = [&](scene_object const& obj) { return &obj - objects.data(); };
+
+        std::vector<char> bytes = octree_image::build(tree, 0, index_of);
+        octree_image      image;
+        image.view(bytes.data(), bytes.size());
+        quantized_octree<uint16_t> q16;
+        quantized_octree<uint8_t>  q8;
+        q16.build(tree, index_of);
+        q8.build(tree, index_of);
+
+        std::printf("  %s: %zu objects, %zu nodes\n", name, objects.size(), tree.m_nodes.size());
+        std::printf("    %-30s %10s %9s %12s %10s\n", "", "MB", "B/object", "ms/frustum", "visible");
+
+        auto report = [&](char const* label, std::size_t bytes, auto&& cull) {
+            std::vector<uint32_t> out;
+            std::size_t           visible = 0;
+            double                ms      = bench_best_ms(3, [&]() {
+                visible = 0;
+                for (auto const& f : frustums) {
+                    out.clear();
+                    cull(f, out);
+                    visible += out.size();
+                }
+            });
+            std::printf("    %-30s %10.2f %9.1f %12.3f %10zu\n", label, bytes / 1048576.0, static_cast<double>(bytes) / objects.size(),
+                        ms / frustums.size(), visible / frustums.size());
+        };
+
+        // aabb per object plus the octree links, the nodes live in the hash map
+        std::size_t live = objects.size() * (sizeof(aabb) + 3 * sizeof(void*)) + tree.m_nodes.size() * sizeof(Octree<scene_object>::node);
+        report("Octree::frustum (aabb)", live, [&](frustrum const& f, std::vector<uint32_t>& out) {
+            tree.frustum(f, [&](scene_object const& obj) { out.push_back(static_cast<uint32_t>(index_of(obj))); });
+        });
+        report("octree_image (float, naive)", bytes.size(), [&](frustrum const& f, std::vector<uint32_t>& out) { image.query_frustum(f, out); });
+        report("octree_image (float, planes)", bytes.size(), [&](frustrum const& f, std::vector<uint32_t>& out) {
+            cull_float(image, QuantizedBounds::frustum_planes(f), out);
+        });
+        report("quantized 16 bit", q16.memory(), [&](frustrum const& f, std::vector<uint32_t>& out) { q16.frustum(f, out); });
+        report("quantized 8 bit", q8.memory(), [&](frustrum const& f, std::vector<uint32_t>& out) { q8.frustum(f, out); });
+    }
+}
+
+BENCH(quantized_octree)
+{
+    auto objects = load_scene_objects(load_mesh_bounds());
+    std::vector<frustrum> frustums;
+    for (auto const& c : camera_path("flythrough", 60))
+        frustums.emplace_back(camera_view_projection(c));
+    run("scene.txt flythrough", objects, 1u << 10, 6, frustums);
+
+    auto city = make_city(1000000);
+    run("city", city, 1u << 12, 8, city_frustums(24));
+}
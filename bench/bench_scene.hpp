@@ -0,0 +1,199 @@
+#ifndef _BENCH_SCENE_HPP_
+#define _BENCH_SCENE_HPP_
+
+#include "bench.hpp"
+#include "geometry.hpp"
+#include "octree.hpp"
+#include "scene_format.hpp"
+#include "shapes.hpp"
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+/**
+ * @brief
+ * 	Model space bounds of the mirlo meshes, in mesh index order
+ */
+inline std::vector<aabb> load_mesh_bounds()
+{
+    std::vector<aabb> bvs;
+    for (;;) {
+        std::stringstream ss;
+        ss << WORKDIR "assets/mirlo_" << bvs.size() << ".binary";
+        auto tris = load_binary_mesh(ss.str());
+        if (tris.empty())
+            break;
+        vec3 mn = tris.front().a, mx = mn;
+        for (auto const& t : tris)
+            for (int v = 0; v < 3; ++v) {
+                mn = glm::min(mn, t[v]);
+                mx = glm::max(mx, t[v]);
+            }
+        bvs.emplace_back(mn, mx);
+    }
+    return bvs;
+}
+
+/**
+ * @brief
+ * 	Model space triangles of the mirlo meshes, in mesh index order
+ */
+inline std::vector<std::vector<triangle>> load_meshes()
+{
+    std::vector<std::vector<triangle>> meshes;
+    for (;;) {
+        auto triangles = load_binary_mesh(WORKDIR "assets/mirlo_" + std::to_string(meshes.size()) + ".binary");
+        if (triangles.empty())
+            break;
+        meshes.push_back(std::move(triangles));
+    }
+    return meshes;
+}
+
+/**
+ * @brief
+ * 	Object of scene.txt, linkable into an Octree
+ */
+struct scene_object
+{
+    aabb     bv = {};
+    mat4     m2w;
+    unsigned mesh = 0;
+
+    Octree<scene_object>::node* m_octree_node     = nullptr;
+    scene_object*               m_octree_next_obj = nullptr;
+    scene_object*               m_octree_prev_obj = nullptr;
+};
+
+inline std::vector<scene_object> load_scene_objects(std::vector<aabb> const& mesh_bvs)
+{
+    std::vector<scene_object> objects;
+    for (auto const& e : SceneFormat::load_text(WORKDIR "assets/scene.txt"))
+        objects.push_back({ transform_aabb(mesh_bvs.at(e.mesh_index), e.m2w), e.m2w, static_cast<unsigned>(e.mesh_index) });
+    return objects;
+}
+
+inline void build_scene_octree(Octree<scene_object>& tree, std::vector<scene_object>& objects, unsigned root_size = 1u << 10, unsigned levels = 6)
+{
+    tree.set_root_size(root_size);
+    tree.set_levels(levels);
+    for (auto& obj : objects)
+        tree.insert(obj, LocationalCode::compute_locational_code(obj.bv, tree.root_size(), tree.levels()));
+}
+
+template<typename T>
+aabb cell_bv(Octree<T> const& tree, typename Octree<T>::node const& n)
+{
+    return LocationalCode::compute_bv(n.locational_code, static_cast<float>(tree.root_size()));
+}
+
+/**
+ * @brief
+ * 	Frustum traversal of scene::OctreeCheck from n. classify_node(n) is
+ * 	called for the nodes not known to be inside and classify_object(obj)
+ * 	for the objects of the overlapping ones, visit(obj) gets the objects
+ * 	not outside. descend(n, inside) can stop at a node that is not
+ * 	outside, before its objects, as the HLOD proxies do.
+ */
+template<typename T, typename ClassifyNode, typename ClassifyObject, typename Visit, typename Descend>
+void traverse_octree(Octree<T> const& tree, typename Octree<T>::node const* n, bool inside, ClassifyNode&& classify_node,
+                     ClassifyObject&& classify_object, Visit&& visit, Descend&& descend)
+{
+    if (!inside) {
+        eResult c = classify_node(*n);
+        if (c == eOUTSIDE)
+            return;
+        inside = c == eINSIDE;
+    }
+    if (!descend(*n, inside))
+        return;
+    for (auto const* obj = n->first; obj; obj = obj->m_octree_next_obj)
+        if (inside || classify_object(*obj) != eOUTSIDE)
+            visit(*obj);
+    tree.for_each_child(n, [&](auto const* child) {
+        traverse_octree(tree, child, inside, classify_node, classify_object, visit, descend);
+    });
+}
+
+struct cull_counts
+{
+    std::size_t nodes   = 0; // Nodes tested
+    std::size_t objects = 0; // Objects tested
+    std::size_t visible = 0;
+};
+
+/**
+ * @brief
+ * 	scene::OctreeCheck without LOD nor HLOD, testing the cells of the nodes
+ * 	but the root, or their aggregate bounds
+ */
+template<typename T, typename Visit>
+void cull_octree(Octree<T> const& tree, frustrum const& f, bool aggregate, cull_counts& counts, Visit&& visit)
+{
+    auto const* root = tree.find_node(1u);
+    if (!root)
+        return;
+    traverse_octree(
+        tree, root, false,
+        [&](typename Octree<T>::node const& n) {
+            if (!aggregate && n.locational_code == 1u)
+                return eOVERLAPPING;
+            counts.nodes++;
+            return classify_frustum_aabb_naive(f, aggregate ? n.bounds : cell_bv(tree, n));
+        },
+        [&](T const& obj) {
+            counts.objects++;
+            return classify_frustum_aabb_naive(f, obj.bv);
+        },
+        [&](T const& obj) {
+            counts.visible++;
+            visit(obj);
+        },
+        [](typename Octree<T>::node const&, bool) { return true; });
+}
+
+struct camera_frame
+{
+    vec3 eye;
+    vec3 target;
+};
+
+/**
+ * @brief
+ * 	Fixed camera paths over scene.txt, so runs can be compared:
+ * 	"flythrough" crosses the scene along +z at street level, "orbit"
+ * 	circles it from above looking at its center and "overview" does the
+ * 	same from close to the far plane
+ */
+inline std::vector<camera_frame> camera_path(char const* name, int frames = 240)
+{
+    std::vector<camera_frame> path;
+    for (int i = 0; i < frames; ++i) {
+        float t = static_cast<float>(i) / static_cast<float>(frames - 1);
+        if (std::strcmp(name, "orbit") == 0 || std::strcmp(name, "overview") == 0) {
+            bool  far    = std::strcmp(name, "overview") == 0;
+            float a      = glm::two_pi<float>() * t;
+            float radius = far ? 800.0f : 300.0f;
+            vec3  c(-20, 0, 200);
+            path.push_back({ c + vec3(radius * std::cos(a), far ? 250.0f : 60.0f, radius * std::sin(a)), c });
+        }
+        else {
+            vec3 eye(0, 10, glm::mix(-50.0f, 450.0f, t));
+            path.push_back({ eye, eye + vec3(0.3f, -0.05f, 1) });
+        }
+    }
+    return path;
+}
+
+// Same projection as the demo camera
+inline mat4 camera_projection()
+{
+    return glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.01f, 1000.0f);
+}
+
+inline mat4 camera_view_projection(camera_frame const& c)
+{
+    return camera_projection() * glm::lookAt(c.eye, c.target, vec3(0, 1, 0));
+}
+
+#endif
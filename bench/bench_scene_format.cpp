@@ -0,0 +1,57 @@
+#include "bench.hpp"
+#include "scene_format.hpp"
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+namespace {
+    // The original scene loader, kept as the baseline
+    std::size_t load_text_ifstream(std::string const& filename)
+    {
+        std::ifstream fs(filename, std::ios::binary);
+        std::vector<SceneFormat::text_entry> entries;
+        while (!fs.bad() && !fs.eof()) {
+            SceneFormat::text_entry e{};
+            fs >> e.mesh_index;
+            for (mat4::length_type c = 0; c < 4; ++c)
+                for (mat4::length_type r = 0; r < 4; ++r)
+                    fs >> e.m2w[c][r];
+            if (fs.bad() || fs.eof()) break;
+            entries.push_back(e);
+        }
+        return entries.size();
+    }
+}
+
+BENCH(scene_format_load)
+{
+    std::string const text_file   = WORKDIR "assets/scene.txt";
+    std::string const binary_file = "bench_scene.bin";
+
+    std::size_t count = 0;
+    double ms = bench_best_ms(3, [&]() { count = load_text_ifstream(text_file); });
+    std::printf("  text ifstream          %8.2f ms  (%zu objects)\n", ms, count);
+
+    unsigned const hw = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; threads <= hw; threads *= 2) {
+        ms = bench_best_ms(3, [&]() { count = SceneFormat::load_text(text_file, threads).size(); });
+        std::printf("  text from_chars x%-3u   %8.2f ms  (%zu objects)\n", threads, ms, count);
+    }
+
+    // Bounds only matter for culling, not for load time
+    std::vector<SceneFormat::record> records;
+    for (auto const& e : SceneFormat::load_text(text_file))
+        records.push_back(SceneFormat::make_record(e.mesh_index, e.m2w, aabb(vec3(-1), vec3(1))));
+    SceneFormat::write_binary(binary_file, records);
+
+    ms = bench_best_ms(3, [&]() {
+        mapped_file file(binary_file);
+        auto        view = SceneFormat::binary_records(file);
+        double      sum  = 0.0; // Touch every record so the pages are actually read
+        for (auto const& r : view)
+            sum += r.bv_min.x;
+        count = view.size() + (sum == 0.123 ? 1 : 0);
+    });
+    std::printf("  binary mmap            %8.2f ms  (%zu objects)\n", ms, count);
+    std::remove(binary_file.c_str());
+}
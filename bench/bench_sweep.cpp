@@ -0,0 +1,91 @@
+#include "bench_scene.hpp"
+#include "geometry.hpp"
+#include <cstdio>
+#include <random>
+
+namespace {
+    // Crates and thin wall panels over a 1 km square
+    std::vector<scene_object> make_yard(std::size_t count)
+    {
+        std::mt19937                          rng(49);
+        std::uniform_real_distribution<float> ground(-500.0f, 500.0f), unit(0.0f, 1.0f);
+        std::vector<scene_object>             objects(count);
+        for (auto& obj : objects) {
+            vec3 p(ground(rng), 2.0f + 30.0f * unit(rng), ground(rng));
+            vec3 size = unit(rng) < 0.3f ? (unit(rng) < 0.5f ? vec3(6.0f, 4.0f, 0.1f) : vec3(0.1f, 4.0f, 6.0f)) // Panels
+                                         : vec3(0.5f) + 2.0f * vec3(unit(rng), unit(rng), unit(rng));
+            obj.bv = aabb(p, p + size);
+        }
+        return objects;
+    }
+
+    struct mover
+    {
+        vec3 center;
+        vec3 displacement; // In one frame
+    };
+}
+
+BENCH(sweep)
+{
+    auto                 objects = make_yard(200000);
+    Octree<scene_object> tree;
+    build_scene_octree(tree, objects, 1u << 10, 7);
+
+    // Projectiles at 600 m/s and vehicles at 40 m/s over a 60 Hz frame
+    std::mt19937                          rng(7);
+    std::uniform_real_distribution<float> ground(-450.0f, 450.0f), unit(-1.0f, 1.0f);
+    std::vector<mover>                    movers(20000);
+    for (auto& m : movers) {
+        vec3 dir       = glm::normalize(vec3(unit(rng), 0.2f * unit(rng), unit(rng)));
+        m.center       = vec3(ground(rng), 3.0f + 25.0f * (0.5f + 0.5f * unit(rng)), ground(rng));
+        m.displacement = dir * 10.0f;
+    }
+    std::vector<mover> vehicles = movers;
+    for (auto& m : vehicles)
+        m.displacement *= 40.0f / 600.0f;
+
+    auto run = [&](char const* label, std::vector<mover> const& set, vec3 half, float radius) {
+        std::printf("  %s, %zu movers\n", label, set.size());
+        std::printf("    %-22s %10s %10s %10s\n", "", "us/mover", "hits", "missed");
+
+        std::size_t sweep_hits = 0;
+        double      ms         = bench_best_ms(3, [&]() {
+            sweep_hits = 0;
+            for (auto const& m : set)
+                sweep_hits += tree.sweep_aabb(aabb(m.center - half, m.center + half), m.displacement).object != nullptr;
+        });
+        std::printf("    %-22s %10.3f %10zu %10s\n", "sweep_aabb", 1e3 * ms / set.size(), sweep_hits, "-");
+
+        std::size_t sphere_hits = 0;
+        ms                      = bench_best_ms(3, [&]() {
+            sphere_hits = 0;
+            for (auto const& m : set)
+                sphere_hits += tree.sweep_sphere(m.center, radius, m.displacement).object != nullptr;
+        });
+        std::printf("    %-22s %10.3f %10zu %10s\n", "sweep_sphere", 1e3 * ms / set.size(), sphere_hits, "-");
+
+        // Overlap query of the box at the end of every substep, the first one hitting anything stops
+        for (int steps : { 4, 16, 64 }) {
+            std::size_t hits = 0;
+            ms               = bench_best_ms(3, [&]() {
+                hits = 0;
+                for (auto const& m : set)
+                    for (int s = 1; s <= steps; ++s) {
+                        vec3 c     = m.center + m.displacement * (static_cast<float>(s) / static_cast<float>(steps));
+                        bool found = false;
+                        tree.query(aabb(c - half, c + half), [&](scene_object const&) { found = true; });
+                        if (found) {
+                            hits++;
+                            break;
+                        }
+                    }
+            });
+            char name[32];
+            std::snprintf(name, sizeof(name), "%d substep queries", steps);
+            std::printf("    %-22s %10.3f %10zu %10zu\n", name, 1e3 * ms / set.size(), hits, sweep_hits - std::min(hits, sweep_hits));
+        }
+    };
+    run("projectiles, 10 m per frame, 0.1 m box", movers, vec3(0.05f), 0.05f);
+    run("vehicles, 0.67 m per frame, 2 m box", vehicles, vec3(1.0f), 1.0f);
+}
@@ -0,0 +1,73 @@
+#include "bench.hpp"
+#include "triangle_format.hpp"
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace {
+    // The original load_triangles, kept as the baseline
+    std::vector<triangle> load_triangles_getline(std::string const& filename)
+    {
+        std::vector<triangle> tris;
+        std::ifstream         file(filename);
+        std::string           line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#')
+                continue;
+            std::stringstream ss(line);
+            std::string       type;
+            ss >> type;
+            if (type == "f") {
+                triangle t;
+                ss >> t.a.x >> t.a.y >> t.a.z;
+                ss >> t.b.x >> t.b.y >> t.b.z;
+                ss >> t.c.x >> t.c.y >> t.c.z;
+                tris.push_back(t);
+            }
+        }
+        return tris;
+    }
+
+    std::size_t write_triangles(std::string const& filename, std::size_t count)
+    {
+        std::mt19937                          rng(45);
+        std::uniform_real_distribution<float> coord(-1000.0f, 1000.0f);
+        std::FILE*                            f = std::fopen(filename.c_str(), "wb");
+        for (std::size_t i = 0; i < count; ++i)
+            std::fprintf(f, "f %.6g %.6g %.6g %.6g %.6g %.6g %.6g %.6g %.6g\n", coord(rng), coord(rng), coord(rng), coord(rng),
+                         coord(rng), coord(rng), coord(rng), coord(rng), coord(rng));
+        std::size_t size = static_cast<std::size_t>(std::ftell(f));
+        std::fclose(f);
+        return size;
+    }
+}
+
+BENCH(triangle_format_load)
+{
+    std::string const file  = "bench_triangles.txt";
+    std::size_t const bytes = write_triangles(file, 2000000);
+    double const      mb    = bytes / (1024.0 * 1024.0);
+    std::printf("  %.1f MB, 2000000 triangles\n", mb);
+
+    std::size_t count = 0;
+    double      ms    = bench_best_ms(2, [&]() { count = load_triangles_getline(file).size(); });
+    std::printf("  getline + stringstream   %8.1f ms %7.1f MB/s  (%zu triangles)\n", ms, mb / (ms / 1000.0), count);
+
+    unsigned const hw = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned threads = 1; threads <= std::max(hw, 4u); threads *= 2) {
+        ms = bench_best_ms(3, [&]() { count = TriangleFormat::load_text(file, threads).size(); });
+        std::printf("  mmap from_chars x%-3u     %8.1f ms %7.1f MB/s  (%zu triangles)\n", threads, ms, mb / (ms / 1000.0), count);
+    }
+
+    // Streaming only keeps one window of triangles alive
+    std::size_t peak = 0;
+    ms = bench_best_ms(3, [&]() {
+        count = TriangleFormat::stream_file(file, [&](std::size_t, std::span<triangle const> batch) { peak = std::max(peak, batch.size()); },
+                                            hw);
+    });
+    std::printf("  streamed x%-3u            %8.1f ms %7.1f MB/s  (%zu triangles, at most %zu in memory)\n", hw, ms, mb / (ms / 1000.0),
+                count, peak);
+    std::remove(file.c_str());
+}
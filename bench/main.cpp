@@ -0,0 +1,38 @@
+#include "bench.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace {
+    struct entry
+    {
+        char const* name;
+        bench_fn    fn;
+    };
+
+    std::vector<entry>& registry()
+    {
+        static std::vector<entry> benches;
+        return benches;
+    }
+}
+
+int register_bench(char const* name, bench_fn fn)
+{
+    registry().push_back({ name, fn });
+    return static_cast<int>(registry().size());
+}
+
+int main(int argc, char** argv)
+{
+    std::string filter = argc > 1 ? argv[1] : "";
+
+    auto& benches = registry();
+    std::sort(benches.begin(), benches.end(), [](entry const& a, entry const& b) { return std::string(a.name) < b.name; });
+    for (auto const& b : benches) {
+        if (!filter.empty() && std::string(b.name).find(filter) == std::string::npos)
+            continue;
+        std::printf("[ %s ]\n", b.name);
+        b.fn();
+    }
+    return 0;
+}
@@ -10,6 +10,10 @@
 #include "shape_utils.hpp"
 #include "scene.hpp"
 #include <chrono>
+#include <cctype>
+#include <string>
+#include <iostream>
+#include <sstream>
 #include <functional>
 
 #undef max
@@ -23,12 +27,17 @@ using node_t = Octree<GameObject>::node;
  */
 struct demo_options
 {
-    int  render_mode       = 0;    // 0-Bruteforce, 1-Frustum check, 2-Octrees
+    int  render_mode       = 0;    // 0-Bruteforce, 1-Frustum check, 2-Octrees, 3-BVH
     bool skyview_enabled   = false; //
     bool debug_draw_octree = false; //
     int  highlight_level   = -1;   // If -1, will draw all levels
     int  octree_levels     = 3;    // How many levels should the octree have
     int  octree_size_bit   = 7;    // Octree root size is restricted to 2^k. (This parameter is k)
+    bool adaptive_octree   = false; // Split and merge octree nodes by object count, up to octree_levels deep
+    std::vector<frustrum> recorded_views; // Last frames, benchmarked by the octree auto-tuner
+    std::string           tuning_report;
+    float contribution_pixels = 1.0f; // Octree check culls what is smaller on screen, 0 disables
+    bool  pipelined           = true; // Cull the next frame on a worker while this one is submitted
 
     struct
     {
@@ -92,14 +101,25 @@ void update_camera(float dt, window const& window, camera& camera)
     }
 }
 
-int main()
+int main(int argc, char** argv)
 {
+    // --stream [budget MB]: keep only the octree cells around the camera in memory
+    bool             stream = false;
+    streaming_config streaming;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--stream") {
+            stream = true;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])))
+                streaming.budget_bytes = std::stoull(argv[++i]) << 20;
+        }
+    }
+
     ::window       w(1920, 1080, "Open World Space Partitioning", true);
     ::camera       cam;
     ::camera       sky_cam;
     ::debug_system debug(&cam);
     ::demo_options options;
-    ::scene        scene;
+    ::scene        scene(stream ? &streaming : nullptr);
 
     glfwSwapInterval(0); // Disable vsync
     imgui_init(w.GetHandle());
@@ -120,88 +140,11 @@ int main()
         update_camera(dt, w, cam);
         cam.update();
 
-        //
-        glViewport(0, 0, w.GetDimensions().x, w.GetDimensions().y);
-        glDisable(GL_SCISSOR_TEST);
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClearDepth(1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // Draw octree
-        auto debug_draw_octree = [&]() {
-            if (!options.debug_draw_octree) return;
-
-            if (options.highlight_level == -1) {
-                for (auto& it : scene.get_octree().m_nodes) {
-                    if (it.second->first) {
-                        aabb b = LocationalCode::compute_bv(it.second->locational_code, scene.get_octree().root_size());
-                        debug.draw_aabb(b.pos, b.sca, glm::vec4(0.4 * it.second->locational_code, 1.0, 0, 0));
-                    }
-                }
-            }
-            // [TODO] Traverse octree
-        };
-
-        // Frustum to test
-        frustrum frust(cam.GetProjectionMatrix() * cam.GetCameraMatrix());
-
-        // Render modes
-        switch (options.render_mode) {
-            case 0:
-                // All is visible, regardless of their position
-                scene.MakeAllVisible();
-                break;
-            case 1:
-                // Make visible only those inside frustum
-                scene.FrustumCheck(frust);
-                break;
-            case 2:
-                // Make visible only those inside frustum (accelerate with octree)
-                scene.OctreeCheck(frust);
-                break;
-        }
-
-        //debug.draw_frustum_lines(frust.get_matrix(), vec4(1.f));
-        //debug.draw_plane(vec3(0.f), frust.mplanes[0].normal, frust.mplanes[0].d, vec4(0.5f, 0.5f, 0.5f, 0.5f));
-        //debug.draw_plane(vec3(0.f), frust.mplanes[1].normal, frust.mplanes[1].d, vec4(0.5f, 0.5f, 0.5f, 0.5f));
-        //debug.draw_plane(vec3(0.f), frust.mplanes[2].normal, frust.mplanes[2].d, vec4(0.5f, 0.5f, 0.5f, 0.5f));
-        //debug.draw_plane(vec3(0.f), frust.mplanes[3].normal, frust.mplanes[3].d, vec4(0.5f, 0.5f, 0.5f, 0.5f));
-        //debug.draw_plane(vec3(0.f), frust.mplanes[4].normal, frust.mplanes[4].d, vec4(0.5f, 0.5f, 0.5f, 0.5f));
-        //debug.draw_plane(vec3(0.f), frust.mplanes[5].normal, frust.mplanes[5].d, vec4(0.5f, 0.5f, 0.5f, 0.5f));
-
-        // Render
-        scene.Render(cam.GetProjectionMatrix(), cam.GetCameraMatrix());
-        debug_draw_octree();
-
-        // Sky view
-        if (options.skyview_enabled) {
-            glEnable(GL_SCISSOR_TEST);
-            ivec2 skyview_viewport_size(1000, 500);
-            glViewport(w.GetDimensions().x - skyview_viewport_size.x, 0, skyview_viewport_size.x, skyview_viewport_size.y);
-            glScissor(w.GetDimensions().x - skyview_viewport_size.x, 0, skyview_viewport_size.x, skyview_viewport_size.y);
-            glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // The visibility pass of the previous frame is done, from here until the next one starts the scene can be modified
+        scene.PresentVisibility();
+        scene.UpdateStreaming(cam.GetPosition(), dt);
 
-            // Special camera for sky view
-            sky_cam.set_position(vec3(500, 500, 500));
-            sky_cam.set_target(cam.GetPosition());
-            sky_cam.set_projection(50.0f, skyview_viewport_size, 0.1f, 1000.0f);
-            sky_cam.update();
-            scene.Render(sky_cam.GetProjectionMatrix(), sky_cam.GetCameraMatrix());
-
-            // Debug draw frustum
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-            glDisable(GL_CULL_FACE);
-
-            // Render everything from this camera
-            debug.change_camera(&sky_cam);
-            debug.draw_frustum_lines(frust.get_matrix(), vec4(1, 1, 1, 0.5f));
-            debug_draw_octree();
-            debug.change_camera(&cam); 
-        }
-
-        { // Editor
+        { // Editor, its widgets modify the scene so it is built before the visibility pass starts and drawn last
             // Stats
             imgui_new_frame();
             ImGui::SetNextWindowSizeConstraints(ImVec2(100, w.GetDimensions().y), ImVec2(std::numeric_limits<float>::max(), w.GetDimensions().y));
@@ -210,8 +153,21 @@ int main()
                 if (ImGui::RadioButton("Render all", options.render_mode == 0)) options.render_mode = 0;
                 if (ImGui::RadioButton("Frustum check", options.render_mode == 1)) options.render_mode = 1;
                 if (ImGui::RadioButton("Octree check", options.render_mode == 2)) options.render_mode = 2;
+                if (ImGui::RadioButton("BVH check", options.render_mode == 3)) options.render_mode = 3;
 
                 ImGui::Checkbox("Skyview", &options.skyview_enabled);
+                ImGui::Checkbox("LOD", &scene.lod_settings.enabled);
+                ImGui::SliderFloat("LOD hysteresis", &scene.lod_settings.hysteresis, 0.0f, 0.5f);
+                ImGui::Checkbox("HLOD proxies", &scene.lod_settings.hlod);
+                ImGui::SliderFloat("HLOD screen size", &scene.lod_settings.hlod_threshold, 0.0f, 1.0f);
+                ImGui::SliderFloat("Contribution culling (px)", &options.contribution_pixels, 0.0f, 16.0f);
+                ImGui::Checkbox("Front to back traversal", &scene.front_to_back);
+                ImGui::Checkbox("Depth sort draws", &scene.depth_sort);
+                ImGui::Checkbox("Cull by aggregate node bounds", &scene.aggregate_bounds);
+                ImGui::Checkbox("Refine straddling objects with OBBs", &scene.obb_culling);
+                ImGui::Checkbox("Coherent culling", &scene.get_culler().config.enabled);
+                ImGui::SliderFloat("Coherent culling reset distance", &scene.get_culler().config.max_translation, 0.0f, 128.0f);
+                ImGui::Checkbox("Pipelined culling", &options.pipelined);
 
                 ImGui::Separator();
                 { // DT
@@ -230,6 +186,19 @@ int main()
                     if (container.size() > 100) container.erase(container.begin());
                     ImGui::PlotLines("Draw calls", container.data(), static_cast<int>(container.size()), 0, "", 0, FLT_MAX, ImVec2(200, 64));
                     ImGui::Text("Current: %d", v);
+                    ImGui::Text("Indirect commands: %d", scene.stat_draw_commands);
+                    ImGui::Text("Triangles: %d", scene.stat_triangles);
+                    ImGui::Text("HLOD proxies: %d", scene.stat_hlod_proxies);
+                    ImGui::Text("Contribution culled: %d nodes, %d objects", scene.stat_contribution_culled_nodes, scene.stat_contribution_culled_objects);
+                    ImGui::Text("CPU submit: %.03f ms", scene.stat_submit_ms);
+                    auto const& pipeline = scene.get_pipeline().stats();
+                    ImGui::Text("CPU cull: %.03f ms, waited %.03f ms", pipeline.job_ms, pipeline.wait_ms);
+                    ImGui::Text("Cull to present: %.03f ms (%u frames late)", pipeline.latency_ms, pipeline.latency_frames);
+                    auto const look = scene.Raycast(cam.GetPosition(), normalize(cam.GetTarget() - cam.GetPosition()));
+                    if (look.object)
+                        ImGui::Text("Looking at: object %d, %.02f away", look.object->m_ID, look.t);
+                    else
+                        ImGui::Text("Looking at: nothing");
                 }
 
                 { // Frustum vs AABB
@@ -239,6 +208,7 @@ int main()
                     if (container.size() > 100) container.erase(container.begin());
                     ImGui::PlotLines("Frustum vs AABB", container.data(), static_cast<int>(container.size()), 0, "", 0, FLT_MAX, ImVec2(200, 64));
                     ImGui::Text("Current: %d", v);
+                    ImGui::Text("Cells reused from last frame: %d%s", scene.stat_cull_reused, scene.get_culler().frame_stats().reset ? " (reset)" : "");
                 }
 
                 { // Frustum vs AABB (passed)
@@ -248,6 +218,14 @@ int main()
                     if (container.size() > 100) container.erase(container.begin());
                     ImGui::PlotLines("Frustum vs AABB (passed)", container.data(), static_cast<int>(container.size()), 0, "", 0, FLT_MAX, ImVec2(200, 64));
                     ImGui::Text("Current: %d", v);
+                    ImGui::Text("Straddling, tested with OBB: %d, culled: %d", scene.stat_frustum_obb_checks, scene.stat_frustum_obb_culled);
+                }
+
+                if (auto const* streaming_stats = scene.get_streaming_stats()) { // Streaming
+                    ImGui::Separator();
+                    ImGui::Text("Resident: %.01f MB (%u cells)", streaming_stats->resident_bytes / (1024.0f * 1024.0f), streaming_stats->resident_cells);
+                    ImGui::Text("Page-ins/s: %.01f, pending: %u", streaming_stats->page_ins_per_second, streaming_stats->pending_cells);
+                    ImGui::Text("Stall: %.02f ms (total %.01f ms)", streaming_stats->stall_ms, streaming_stats->total_stall_ms);
                 }
 
                 ImGui::Separator();
@@ -255,13 +233,45 @@ int main()
                 ImGui::Checkbox("Debug draw octree", &options.debug_draw_octree);
                 if (ImGui::SliderInt("Octree levels", &options.octree_levels, 1, 10)) {
                     scene.get_octree().set_levels(options.octree_levels);
-                    scene.CreateOctree(options.octree_levels, options.octree_size_bit);
+                    scene.CreateOctree(options.octree_levels, options.octree_size_bit, options.adaptive_octree);
                 }
-                if (ImGui::SliderInt("Octree size bit", &options.octree_size_bit, 1, 32)) {
+                if (ImGui::SliderInt("Octree size bit", &options.octree_size_bit, 1, 10)) {
                     scene.get_octree().set_root_size((1u << options.octree_size_bit));
-                    scene.CreateOctree(options.octree_levels, options.octree_size_bit);
+                    scene.CreateOctree(options.octree_levels, options.octree_size_bit, options.adaptive_octree);
+                }
+                bool rebuild = ImGui::Checkbox("Adaptive octree", &options.adaptive_octree);
+                if (options.adaptive_octree) {
+                    auto& adaptive = scene.adaptive_octree;
+                    unsigned const split_min = 1, split_max = 256, merge_min = 0;
+                    if (ImGui::SliderScalar("Split above", ImGuiDataType_U32, &adaptive.split_count, &split_min, &split_max)) {
+                        adaptive.merge_count = std::min(adaptive.merge_count, adaptive.split_count - 1);
+                        rebuild              = true;
+                    }
+                    unsigned const merge_max = adaptive.split_count - 1; // Or nodes keep splitting and merging
+                    rebuild |= ImGui::SliderScalar("Merge below", ImGuiDataType_U32, &adaptive.merge_count, &merge_min, &merge_max);
+                }
+                if (rebuild)
+                    scene.CreateOctree(options.octree_levels, options.octree_size_bit, options.adaptive_octree);
+                { // Objects per node
+                    std::vector<float> histogram(17, 0.0f);
+                    for (auto const& it : scene.get_octree().m_nodes)
+                        histogram[std::min<std::size_t>(std::bit_width(it.second->object_count), 16)]++;
+                    ImGui::PlotHistogram("Objects per node (log2)", histogram.data(), static_cast<int>(histogram.size()), 0,
+                                         "", 0, FLT_MAX, ImVec2(200, 64));
+                    ImGui::Text("Nodes: %zu", scene.get_octree().m_nodes.size());
                 }
                 ImGui::SliderInt("Highlight level", &options.highlight_level, -1, options.octree_levels);
+                if (ImGui::Button("Auto-tune octree")) {
+                    auto report             = scene.TuneOctree(options.recorded_views, options.adaptive_octree);
+                    options.octree_levels   = static_cast<int>(report.levels);
+                    options.octree_size_bit = static_cast<int>(report.size_bit);
+                    std::ostringstream text;
+                    report.print(text);
+                    options.tuning_report = text.str();
+                    std::cout << options.tuning_report;
+                }
+                if (!options.tuning_report.empty())
+                    ImGui::TextUnformatted(options.tuning_report.c_str());
 
                 if (ImGui::Button("Color by octree node")) {
 
@@ -282,15 +292,110 @@ int main()
                     }
                 }
                 if (ImGui::Button("Color randomly")) {
-                    for (auto& obj : scene.objects()) {
+                    scene.ForEachObject([](GameObject& obj) {
                         auto col  = glm::linearRand(vec4(0, 0, 0, 1), vec4(1, 1, 1, 1));
                         obj.color = col;
-                    }
+                    });
                 }
             }
             ImGui::End();
-            imgui_end_frame();
         }
+
+        //
+        glViewport(0, 0, w.GetDimensions().x, w.GetDimensions().y);
+        glDisable(GL_SCISSOR_TEST);
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClearDepth(1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // Draw octree
+        auto debug_draw_octree = [&]() {
+            if (!options.debug_draw_octree) return;
+
+            if (options.highlight_level == -1) {
+                for (auto& it : scene.get_octree().m_nodes) {
+                    if (it.second->first) {
+                        aabb b = LocationalCode::compute_bv(it.second->locational_code, scene.get_octree().root_size());
+                        debug.draw_aabb(b.pos, b.sca, glm::vec4(0.4 * it.second->locational_code, 1.0, 0, 0));
+                    }
+                }
+            }
+            // [TODO] Traverse octree
+        };
+
+        // Frustum to test
+        frustrum frust(cam.GetProjectionMatrix() * cam.GetCameraMatrix());
+        options.recorded_views.push_back(frust);
+        if (options.recorded_views.size() > 120) options.recorded_views.erase(options.recorded_views.begin());
+
+        // Render modes, culled on the pipeline worker while this frame draws the previous visible set
+        scene.SetView(cam, w.GetDimensions());
+        scene.contribution_pixels = options.contribution_pixels;
+        scene.get_pipeline().set_pipelined(options.pipelined);
+        scene.StartVisibility([&scene, frust, render_mode = options.render_mode]() {
+            switch (render_mode) {
+                case 0:
+                    // All is visible, regardless of their position
+                    scene.MakeAllVisible();
+                    break;
+                case 1:
+                    // Make visible only those inside frustum
+                    scene.FrustumCheck(frust);
+                    break;
+                case 2:
+                    // Make visible only those inside frustum (accelerate with octree)
+                    scene.OctreeCheck(frust);
+                    break;
+                case 3:
+                    // Same, with the BVH instead of the octree
+                    scene.BvhCheck(frust);
+                    break;
+            }
+        });
+        if (!options.pipelined)
+            scene.PresentVisibility();
+
+        //debug.draw_frustum_lines(frust.get_matrix(), vec4(1.f));
+        //debug.draw_plane(vec3(0.f), frust.mplanes[0].normal, frust.mplanes[0].d, vec4(0.5f, 0.5f, 0.5f, 0.5f));
+        //debug.draw_plane(vec3(0.f), frust.mplanes[1].normal, frust.mplanes[1].d, vec4(0.5f, 0.5f, 0.5f, 0.5f));
+        //debug.draw_plane(vec3(0.f), frust.mplanes[2].normal, frust.mplanes[2].d, vec4(0.5f, 0.5f, 0.5f, 0.5f));
+        //debug.draw_plane(vec3(0.f), frust.mplanes[3].normal, frust.mplanes[3].d, vec4(0.5f, 0.5f, 0.5f, 0.5f));
+        //debug.draw_plane(vec3(0.f), frust.mplanes[4].normal, frust.mplanes[4].d, vec4(0.5f, 0.5f, 0.5f, 0.5f));
+        //debug.draw_plane(vec3(0.f), frust.mplanes[5].normal, frust.mplanes[5].d, vec4(0.5f, 0.5f, 0.5f, 0.5f));
+
+        // Render, with the camera the visible set was culled for
+        scene.Render(scene.get_drawn_projection(), scene.get_drawn_view());
+        debug_draw_octree();
+
+        // Sky view
+        if (options.skyview_enabled) {
+            glEnable(GL_SCISSOR_TEST);
+            ivec2 skyview_viewport_size(1000, 500);
+            glViewport(w.GetDimensions().x - skyview_viewport_size.x, 0, skyview_viewport_size.x, skyview_viewport_size.y);
+            glScissor(w.GetDimensions().x - skyview_viewport_size.x, 0, skyview_viewport_size.x, skyview_viewport_size.y);
+            glClearColor(0.3f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            // Special camera for sky view
+            sky_cam.set_position(vec3(500, 500, 500));
+            sky_cam.set_target(cam.GetPosition());
+            sky_cam.set_projection(50.0f, skyview_viewport_size, 0.1f, 1000.0f);
+            sky_cam.update();
+            scene.Render(sky_cam.GetProjectionMatrix(), sky_cam.GetCameraMatrix());
+
+            // Debug draw frustum
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glDisable(GL_CULL_FACE);
+
+            // Render everything from this camera
+            debug.change_camera(&sky_cam);
+            debug.draw_frustum_lines(frust.get_matrix(), vec4(1, 1, 1, 0.5f));
+            debug_draw_octree();
+            debug.change_camera(&cam); 
+        }
+
+        imgui_end_frame();
     }
     imgui_destroy();
     return 0;
@@ -3,12 +3,17 @@
 #include "geometry.hpp"
 #include "shape_utils.hpp"
 #include "shader.hpp"
+#include "scene_format.hpp"
+#include "octree_image.hpp"
 #include <iostream>
 #include <string>
 #include <cstring>
 #include <sstream>
 #include <fstream>
 #include <array>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include "camera.hpp"
 #include "geometry.hpp"
 
@@ -17,195 +22,235 @@
 #endif
 
 // Uniform locations
-constexpr int cUniformLocation_uniform_m2w   = 0;
 constexpr int cUniformLocation_uniform_view  = 1;
 constexpr int cUniformLocation_uniform_proj  = 2;
-constexpr int cUniformLocation_uniform_color = 3;
 
-scene::scene()
+// Vertex attributes, the per instance ones are fed from the render queue
+constexpr unsigned cAttribLocation_attr_position = 0;
+constexpr unsigned cAttribLocation_attr_m2w      = 1; // mat4, takes 4 locations
+constexpr unsigned cAttribLocation_attr_color    = 5;
+constexpr unsigned cBindingIndex_vertices        = 0;
+constexpr unsigned cBindingIndex_instances       = 1;
+
+scene::scene(streaming_config const* streaming)
 {
     { // Shader with uniforms
         auto vtx_code        = R"(
                 #version 440 core
                 layout(location = 0) in vec3 attr_position;
-                layout(location = 0) uniform mat4 uniform_m2w;
+                layout(location = 1) in mat4 attr_m2w;
+                layout(location = 5) in vec4 attr_color;
                 layout(location = 1) uniform mat4 uniform_view;
                 layout(location = 2) uniform mat4 uniform_proj;
-                layout(location = 3) uniform vec4 uniform_color;
+                out vec4 vtx_color;
                 void main()
                 {
                   vec4 vertex = vec4(attr_position, 1.0f);
-                  mat4 mvp = uniform_proj * uniform_view * uniform_m2w;
+                  mat4 mvp = uniform_proj * uniform_view * attr_m2w;
                   gl_Position = mvp * vertex;
+                  vtx_color = attr_color;
                 })";
         auto frag_code       = R"(
                 #version 440 core
+                in vec4 vtx_color;
                 out vec4 out_color;
-                layout(location = 0) uniform mat4 uniform_m2w;
-                layout(location = 1) uniform mat4 uniform_view;
-                layout(location = 2) uniform mat4 uniform_proj;
-                layout(location = 3) uniform vec4 uniform_color;
                 void main()
                 {
-                  out_color = uniform_color;
+                  out_color = vtx_color;
                 })";
         m_resources.m_shader = new ShaderProgram(
             Shader(vtx_code, Shader::EType::Vertex), 
             Shader(frag_code, Shader::EType::Fragment));
     }
+    InitMeshBuffer();
+
+    if (streaming) {
+        InitStreaming(*streaming);
+        return;
+    }
 
     LoadMirlo();
-    CreateOctree(6, 10);
+
+    // Level geometry is static, reuse the octree of a previous run if it matches
+    char const* octree_file = WORKDIR "assets/scene.octree";
+    if (!LoadOctreeImage(octree_file, 6, 10)) {
+        CreateOctree(6, 10);
+        SaveOctreeImage(octree_file);
+    }
+    LoadHlod(WORKDIR "assets/scene.hlod");
 }
 
 scene::~scene()
 {
+    PresentVisibility();
+    if (m_streamer)
+        m_streamer->evict_all();
+    m_streamer.reset();
+    glDeleteBuffers(1, &m_resources.m_vertex_vbo);
+    glDeleteBuffers(1, &m_resources.m_instance_vbo);
+    glDeleteBuffers(1, &m_resources.m_indirect_buffer);
+    glDeleteVertexArrays(1, &m_resources.m_vao);
     delete m_resources.m_shader;
 }
 
-mat4 abs(const mat4& mat)
+/**
+ * @brief
+ *  Single VAO for all meshes: positions come from the shared vertex buffer
+ *  and transform and color from the instance buffer
+ */
+void scene::InitMeshBuffer()
 {
-    mat4 result;
-    for (mat4::length_type i = 0; i < 4; ++i)
-        for (mat4::length_type j = 0; j < 4; ++j)
-            result[i][j] = abs(mat[i][j]);
-    return result;
+    glGenBuffers(1, &m_resources.m_vertex_vbo);
+    glGenBuffers(1, &m_resources.m_instance_vbo);
+    glGenBuffers(1, &m_resources.m_indirect_buffer);
+    glGenVertexArrays(1, &m_resources.m_vao);
+    glBindVertexArray(m_resources.m_vao);
+
+    glVertexAttribFormat(cAttribLocation_attr_position, 3, GL_FLOAT, GL_FALSE, 0);
+    glVertexAttribBinding(cAttribLocation_attr_position, cBindingIndex_vertices);
+    glEnableVertexAttribArray(cAttribLocation_attr_position);
+    for (unsigned col = 0; col < 4; ++col) {
+        glVertexAttribFormat(cAttribLocation_attr_m2w + col, 4, GL_FLOAT, GL_FALSE, offsetof(render_queue::instance, m2w) + col * sizeof(vec4));
+        glVertexAttribBinding(cAttribLocation_attr_m2w + col, cBindingIndex_instances);
+        glEnableVertexAttribArray(cAttribLocation_attr_m2w + col);
+    }
+    glVertexAttribFormat(cAttribLocation_attr_color, 4, GL_FLOAT, GL_FALSE, offsetof(render_queue::instance, color));
+    glVertexAttribBinding(cAttribLocation_attr_color, cBindingIndex_instances);
+    glEnableVertexAttribArray(cAttribLocation_attr_color);
+    glVertexBindingDivisor(cBindingIndex_instances, 1);
+
+    glBindVertexBuffer(cBindingIndex_instances, m_resources.m_instance_vbo, 0, sizeof(render_queue::instance));
 }
 
-aabb transform_aabb(aabb const& aabbp, mat4 const& m2w)
+/**
+ * @brief
+ *  Level 0 is the mesh itself, the rest are the files written by lod_build.
+ *  Empty if the mesh does not exist.
+ */
+scene::MeshLods scene::LoadMeshLods(unsigned mesh_index)
 {
-    vec3 center = vec3(m2w * vec4(aabbp.pos, 1.f));
-    vec3 extent = vec3(abs(m2w) * vec4(aabbp.sca, 0.f));
-    aabb result(center - extent, center + extent);
-    return result;
+    std::stringstream ss;
+    ss << WORKDIR "assets/mirlo_" << mesh_index;
+
+    MeshLods lods;
+    lods.push_back(load_binary_mesh(ss.str() + ".binary"));
+    if (lods.front().empty())
+        return {};
+    while (lods.size() < Lod::max_lods) {
+        auto triangles = load_binary_mesh(ss.str() + "_lod" + std::to_string(lods.size()) + ".binary");
+        if (triangles.empty())
+            break;
+        lods.push_back(std::move(triangles));
+    }
+    return lods;
 }
 
-void scene::LoadMirlo()
+scene::NaiveMesh scene::CreateMesh(unsigned mesh_index, MeshLods const& lods)
 {
-    int  i       = 0;
-    bool failure = false;
-    while (!failure) {
-        // Create filename of the mesh
-        std::stringstream ss;
-        ss << WORKDIR "assets/mirlo_" << i << ".binary";
-        std::string filename = ss.str();
-
-        // Open file
-        std::ifstream fs(filename, std::ios::binary);
-        if (!fs.is_open()) {
-            failure = true;
-            break;
+    // Local BV
+    auto const& triangles = lods.front();
+    vec3        bv_min    = triangles.front().a;
+    vec3        bv_max    = bv_min;
+    for (auto const& t : triangles) {
+        for (int v_idx = 0; v_idx < 3; ++v_idx) {
+            bv_min = glm::min(bv_min, t[v_idx]);
+            bv_max = glm::max(bv_max, t[v_idx]);
         }
+    }
 
-        // Check header
-        char header[6]{};
-        fs.read(header, sizeof(header) - 1);
-
-        // Read vertex count
-        unsigned vertex_count = 0;
-        fs.read(reinterpret_cast<char*>(&vertex_count), 4);
-
-        // Read index count
-        unsigned index_count = 0;
-        fs.read(reinterpret_cast<char*>(&index_count), 4);
-        assert(index_count == 0); // No indices in this lab
-
-        // Read attributes
-        bool has_positions = false;
-        bool has_normals   = false;
-        bool has_uvs       = false;
-        fs.read(reinterpret_cast<char*>(&has_positions), 1);
-        fs.read(reinterpret_cast<char*>(&has_normals), 1);
-        fs.read(reinterpret_cast<char*>(&has_uvs), 1);
-        assert(has_positions);
-        assert(!has_normals); // No extra data in this lab
-        assert(!has_uvs);     // No extra data in this lab
-
-        // Read vertices
-        unsigned                         triangle_count = vertex_count / 3;
-        std::vector<std::array<vec3, 3>> triangles(triangle_count);
-        for (unsigned t_idx = 0; t_idx < triangle_count; ++t_idx) {
-            for (unsigned v_idx = 0; v_idx < 3; ++v_idx) {
-                fs.read(reinterpret_cast<char*>(&triangles[t_idx][v_idx]), sizeof(vec3)); // Position
-            }
-        }
+    for (unsigned lod = 0; lod < lods.size(); ++lod)
+        UploadVertices(LodMeshId(mesh_index, lod), lods[lod]);
 
-        // Local BV
-        vec3 bv_min = triangles.front().at(0);
-        vec3 bv_max = bv_min;
-        for (unsigned t_idx = 0; t_idx < triangle_count; ++t_idx) {
-            for (unsigned v_idx = 0; v_idx < 3; ++v_idx) {
-                bv_min = glm::min(bv_min, triangles[t_idx][v_idx]);
-                bv_max = glm::max(bv_max, triangles[t_idx][v_idx]);
-            }
-        }
+    NaiveMesh mesh{};
+    mesh.vtx_count = static_cast<unsigned>(triangles.size() * 3);
+    mesh.lod_count = static_cast<unsigned>(lods.size());
+    mesh.bv_model  = aabb( bv_min, bv_max );
+    mesh.triangles = mesh_bvh(triangles);
+    return mesh;
+}
 
-        { // LOAD GRAPHICS MESH
-            uint32_t mesh_vbo = 0;
-            glGenBuffers(1, &mesh_vbo);
-            glBindBuffer(GL_ARRAY_BUFFER, mesh_vbo);
-            glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(sizeof(float) * 3 * 3 * triangles.size()), triangles.data(), GL_STATIC_DRAW);
-            uint32_t mesh_vao = 0;
-            glGenVertexArrays(1, &mesh_vao);
-            glBindVertexArray(mesh_vao);
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, nullptr);
-            glEnableVertexAttribArray(0);
-
-            NaiveMesh mesh{};
-            mesh.vao       = mesh_vao;
-            mesh.vtx_count = static_cast<unsigned>(triangles.size() * 3);
-            mesh.bv_model  = aabb( bv_min, bv_max );
-            m_resources.mirlo_meshes.push_back(mesh);
+void scene::UploadVertices(unsigned pool_id, std::span<triangle const> triangles)
+{
+    auto const& range = m_mesh_pool.add(pool_id, static_cast<uint32_t>(triangles.size() * 3));
+
+    // Grow the shared buffer keeping the meshes already in it
+    if (m_mesh_pool.size() > m_resources.m_vertex_capacity) {
+        unsigned capacity = std::max(m_mesh_pool.size(), m_resources.m_vertex_capacity * 2);
+        unsigned grown    = 0;
+        glGenBuffers(1, &grown);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(sizeof(vec3) * capacity), nullptr, GL_STATIC_DRAW);
+        if (m_resources.m_vertex_capacity) {
+            glBindBuffer(GL_COPY_READ_BUFFER, m_resources.m_vertex_vbo);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(sizeof(vec3) * m_resources.m_vertex_capacity));
         }
+        glDeleteBuffers(1, &m_resources.m_vertex_vbo);
+        m_resources.m_vertex_vbo      = grown;
+        m_resources.m_vertex_capacity = capacity;
+        glBindVertexArray(m_resources.m_vao);
+        glBindVertexBuffer(cBindingIndex_vertices, grown, 0, sizeof(vec3));
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, m_resources.m_vertex_vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(sizeof(vec3) * range.first), static_cast<GLsizeiptr>(sizeof(triangle) * triangles.size()), triangles.data());
+}
 
-        i++;
+GameObject scene::MakeObject(unsigned mesh_index, mat4 const& m2w, aabb const& bv) const
+{
+    auto const& mesh = m_resources.mirlo_meshes.at(mesh_index);
+    GameObject  obj{};
+    obj.color = glm::linearRand(vec4(0.2, 0.2, 0.2, 1), vec4(0.5, 0.5, 0.5, 1));
+    obj.m2w = m2w;
+    obj.mesh_index = mesh_index;
+    obj.mesh_vtx_count = mesh.vtx_count;
+    obj.bv = bv;
+    obj.oriented = obb(mesh.bv_model, m2w);
+    return obj;
+}
+
+void scene::LoadMirlo()
+{
+    unsigned i = 0;
+    for (;; ++i) {
+        MeshLods lods = LoadMeshLods(i);
+        if (lods.empty())
+            break;
+
+        m_resources.mirlo_meshes.push_back(CreateMesh(i, lods));
     }
     std::cout << "Loaded resources: " << i << "\n";
     if (i == 0) throw std::runtime_error("Could not load resources, ensure WORKDIR preprocessor definition is correct");
 
-    { // Load scene
-        // Create filename of the scene
-        std::stringstream ss;
-        ss << WORKDIR "assets/scene.txt";
-        std::string filename = ss.str();
-
-        std::ifstream fs(filename, std::ios::binary);
-        if (!fs.is_open()) {
-            throw std::runtime_error("Could not open scene file");
-        }
-
-        while (!fs.bad() && !fs.eof()) {
-            int  mesh_index = 0;
-            mat4 m2w        = glm::identity<mat4>();
-
-            fs >> mesh_index;
-            fs >> m2w[0].x >> m2w[0].y >> m2w[0].z >> m2w[0].w >>
-                m2w[1].x >> m2w[1].y >> m2w[1].z >> m2w[1].w >> 
-                m2w[2].x >> m2w[2].y >> m2w[2].z >> m2w[2].w >>
-                m2w[3].x >> m2w[3].y >> m2w[3].z >> m2w[3].w;
-
-            if (fs.bad() || fs.eof()) break;
-
-            // Create the objects
-            auto const& mesh = m_resources.mirlo_meshes.at(mesh_index);
-            GameObject  obj{};
-            obj.color = glm::linearRand(vec4(0.2, 0.2, 0.2, 1), vec4(0.5, 0.5, 0.5, 1));
-            obj.m2w = m2w;
-            obj.mesh_vao = mesh.vao;
-            obj.mesh_vtx_count = mesh.vtx_count;
-            obj.bv = transform_aabb(mesh.bv_model, m2w); // [TODO] Retrieve the AABB in world coordinates
-            m_objects.push_back(obj);
-        }
+    // Prefer the converted binary scene, it already stores world bounds, unless scene.txt changed since
+    mapped_file binary(WORKDIR "assets/scene.bin");
+    auto        records   = SceneFormat::binary_records(binary);
+    uint64_t    text_hash = octree_image::hash_file(WORKDIR "assets/scene.txt");
+    if (!records.empty() && text_hash && SceneFormat::binary_source_hash(binary) != text_hash) {
+        std::cout << "assets/scene.bin was not converted from the current assets/scene.txt, loading the text scene\n";
+        records = {};
+    }
+    if (!records.empty()) {
+        m_scene_hash = octree_image::hash_bytes(binary.data(), binary.size());
+        m_objects.reserve(records.size());
+        for (auto const& r : records)
+            m_objects.push_back(MakeObject(r.mesh_id, SceneFormat::record_transform(r), SceneFormat::record_bv(r)));
+        return;
     }
+
+    m_scene_hash = text_hash;
+    auto entries = SceneFormat::load_text(WORKDIR "assets/scene.txt");
+    m_objects.reserve(entries.size());
+    for (auto const& e : entries)
+        m_objects.push_back(MakeObject(e.mesh_index, e.m2w, transform_aabb(m_resources.mirlo_meshes.at(e.mesh_index).bv_model, e.m2w)));
 }
 
 /**
  * @brief
- *  Render all the objects without regard to their spatial situation
+ *  Render the render queue filled by the last visibility pass with a single
+ *  multi-draw, one indirect command per mesh
  */
 void scene::Render(mat4 const& p, mat4 const& v)
 {
-    stat_draw_calls = 0;
+    auto submit_start = std::chrono::high_resolution_clock::now();
 
     // Reset state
     glEnable(GL_CULL_FACE);
@@ -220,28 +265,121 @@ void scene::Render(mat4 const& p, mat4 const& v)
     shader->Bind();
     glUniformMatrix4fv(cUniformLocation_uniform_view, 1, GL_FALSE, &v[0][0]);
     glUniformMatrix4fv(cUniformLocation_uniform_proj, 1, GL_FALSE, &p[0][0]);
-    for (auto const& obj : m_objects) {
-        // Skip non visible
-        if (!obj.visible) continue;
-
-        // Shader
-        auto& m2w = obj.m2w;
-        glUniformMatrix4fv(cUniformLocation_uniform_m2w, 1, GL_FALSE, &m2w[0][0]);
-        glUniform4fv(cUniformLocation_uniform_color, 1, &obj.color[0]);
-        // Mesh
-        glBindVertexArray(obj.mesh_vao);
-        glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(obj.mesh_vtx_count));
-        stat_draw_calls++;
+
+    if (!m_draw_queue_uploaded)
+        UploadDrawQueue();
+
+    auto const& commands = m_draw_queue.commands();
+    stat_draw_calls      = commands.empty() ? 0 : 1;
+    stat_draw_commands   = static_cast<int>(commands.size());
+    if (!commands.empty()) {
+        glBindVertexArray(m_resources.m_vao);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_resources.m_indirect_buffer);
+        glMultiDrawArraysIndirect(GL_TRIANGLES, nullptr, static_cast<GLsizei>(commands.size()), 0);
     }
+
+    stat_submit_ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - submit_start).count();
+}
+
+/**
+ * @brief
+ *  Closes a visibility pass: sorts the visible objects by mesh into draw
+ *  commands. Runs on the pipeline worker, nothing is uploaded here.
+ */
+void scene::FlushRenderQueue()
+{
+    m_render_queue.build(depth_sort);
+    m_render_queue.build_commands(m_mesh_pool.ranges());
+
+    stat_triangles = 0;
+    for (auto const& c : m_render_queue.commands())
+        stat_triangles += static_cast<int>(c.count / 3 * c.instance_count);
 }
+
+/**
+ * @brief
+ *  Uploads the instance data and the indirect commands of the presented
+ *  visible set, orphaning the storage of the previous one
+ */
+void scene::UploadDrawQueue()
+{
+    auto const& instances = m_draw_queue.instances();
+    glBindBuffer(GL_ARRAY_BUFFER, m_resources.m_instance_vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(sizeof(render_queue::instance) * instances.size()), instances.data(), GL_STREAM_DRAW);
+
+    auto const& commands = m_draw_queue.commands();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_resources.m_indirect_buffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, static_cast<GLsizeiptr>(sizeof(render_queue::draw_arrays_indirect_command) * commands.size()), commands.data(), GL_STREAM_DRAW);
+    m_draw_queue_uploaded = true;
+}
+
+/**
+ * @brief
+ *  Runs a visibility pass for the view set with SetView. When pipelined it
+ *  runs on the worker and its result is presented by the next
+ *  PresentVisibility, the scene must not be modified until then.
+ */
+void scene::StartVisibility(std::function<void()> pass)
+{
+    m_pipeline.start(std::move(pass));
+}
+
+/**
+ * @brief
+ *  Waits for the visibility pass in flight and makes its visible set the
+ *  one Render draws. False if there was no pass in flight.
+ */
+bool scene::PresentVisibility()
+{
+    if (!m_pipeline.wait())
+        return false;
+
+    std::swap(m_render_queue, m_draw_queue);
+    m_draw_queue_uploaded = false;
+    m_drawn_view          = { m_view.view, m_view.proj };
+    return true;
+}
+
+/**
+ * @brief
+ *  Queues a visible object with the LOD that matches its size on screen
+ */
+void scene::Submit(GameObject& obj)
+{
+    obj.visible = true;
+    obj.lod     = static_cast<uint8_t>(Lod::select(lod_settings, Lod::screen_size(obj.bv, m_view.eye, m_view.proj[1][1]), obj.lod,
+                                                   m_resources.mirlo_meshes[obj.mesh_index].lod_count));
+    m_render_queue.push(LodMeshId(obj.mesh_index, obj.lod), obj.m2w, obj.color, -(m_view.view * vec4((obj.bv.min + obj.bv.max) * 0.5f, 1.0f)).z);
+}
+
+void scene::SetView(camera const& cam, ivec2 const& viewport)
+{
+    m_view.eye      = cam.GetPosition();
+    m_view.view     = cam.GetCameraMatrix();
+    m_view.proj     = cam.GetProjectionMatrix();
+    m_view.viewport = vec2(viewport);
+}
+
+/**
+ * @brief
+ *  Contribution culling: false if bv covers less than contribution_pixels
+ *  on screen
+ */
+bool scene::Contributes(aabb const& bv) const
+{
+    return contribution_pixels <= 0.0f || projected_extent_pixels(bv, m_view.view, m_view.proj, m_view.viewport) >= contribution_pixels;
+}
+
 void scene::MakeAllVisible()
 {
-    for (auto& obj : m_objects) {
-        obj.visible = true;
-    }
+    m_render_queue.clear();
+    ForEachObject([&](GameObject& obj) {
+        Submit(obj);
+    });
+    FlushRenderQueue();
 }
 
-void CheckFrustrumObjectCollisions(Octree<GameObject>::node* node, frustrum const& frus) {
+void scene::CheckFrustrumObjectCollisions(Octree<GameObject>::node* node, frustrum const& frus) {
     GameObject* pointer = node->first;
 
     while (pointer) {
@@ -253,7 +391,7 @@ void CheckFrustrumObjectCollisions(Octree<GameObject>::node* node, frustrum cons
         if (c == eOUTSIDE)  // its is outside, not render it
             pointer->visible = false;
         else
-            pointer->visible = true;
+            Submit(*pointer);
 
         pointer = pointer->m_octree_next_obj;
     }
@@ -270,142 +408,494 @@ void scene::FrustumCheck(frustrum const& frustum)
     stat_frustum_aabb_positive = 0;
 
     // [TODO]
+    m_render_queue.clear();
     for (auto& x : m_octree.m_nodes) {
         CheckFrustrumObjectCollisions(x.second, frustum);
     }
+    FlushRenderQueue();
 
 }
 
 /**
  * @brief
- *
+ *  Top down traversal of the octree, subtrees outside the frustum are
+ *  skipped and subtrees inside it are accepted without further tests
  */
 void scene::OctreeCheck(frustrum const& frustum)
 {
     stat_frustum_aabb_checks   = 0;
     stat_frustum_aabb_positive = 0;
-
-    for (auto& it : m_octree.m_nodes) {
-        if (it.second->first) {//if it has objects inside
-            aabb node = LocationalCode::compute_bv(it.second->locational_code, m_octree.root_size());
-            eResult c = ::classify_frustum_aabb_naive(frustum, node);
-            stat_frustum_aabb_checks++;
-
-            if (c == eINSIDE) {
-                GameObject* pointer = it.second->first;
-                while (pointer) {
-                    pointer->visible = true;
-                    pointer = pointer->m_octree_next_obj;
-                    stat_frustum_aabb_positive++;
-                }
-            }
-            else if (c == eOUTSIDE) {
-                GameObject* pointer = it.second->first;
-                while (pointer) {
-                    pointer->visible = false;
-                    pointer = pointer->m_octree_next_obj;
-                }
-            }
-            else {// overlaping
-                CheckFrustrumObjectCollisions(it.second, frustum);
-            }
-        }
+    stat_hlod_proxies          = 0;
+    stat_contribution_culled_nodes   = 0;
+    stat_contribution_culled_objects = 0;
+    stat_cull_reused                 = 0;
+    stat_frustum_obb_checks          = 0;
+    stat_frustum_obb_culled          = 0;
+
+    // The proxies are only valid for the octree they were built for
+    auto const& hlod     = m_hlod.info();
+    bool        use_hlod = lod_settings.hlod && hlod.proxy_count != 0 && hlod.root_size == m_octree.root_size() && hlod.levels == m_octree.levels();
+
+    // Cached classifications are only valid for the bounds they were made with
+    if (m_octree.bounds_revision() != m_culled_bounds.revision || aggregate_bounds != m_culled_bounds.aggregate) {
+        m_culler.clear();
+        m_culled_bounds = { m_octree.bounds_revision(), aggregate_bounds };
     }
-}
+    m_culler.begin_frame(frustum, m_view.eye);
 
-int GameObject::id_counter = 0;
+    m_render_queue.clear();
+    if (auto* root = m_octree.find_node(1u))
+        OctreeCheckNode(root, false, use_hlod);
+    FlushRenderQueue();
 
-void AddObjToNode(GameObject& obj, Octree<GameObject>::node* node) {
-    if (obj.m_octree_node->first == nullptr) {
-        obj.m_octree_node->first = &obj; //set this object as the first object
+    stat_frustum_aabb_checks = m_culler.frame_stats().tested;
+    stat_cull_reused         = m_culler.frame_stats().reused;
+}
+
+/**
+ * @brief
+ *  Same visible set as OctreeCheck from the BVH, without HLOD proxies nor
+ *  coherent culling
+ */
+void scene::BvhCheck(frustrum const& frustum)
+{
+    stat_frustum_aabb_checks         = 0;
+    stat_frustum_aabb_positive       = 0;
+    stat_hlod_proxies                = 0;
+    stat_contribution_culled_nodes   = 0;
+    stat_contribution_culled_objects = 0;
+    stat_cull_reused                 = 0;
+    stat_frustum_obb_checks          = 0;
+    stat_frustum_obb_culled          = 0;
+
+    if (m_bvh_dirty) {
+        std::vector<GameObject*> objects;
+        ForEachObject([&](GameObject& it) { objects.push_back(&it); });
+        m_bvh.build(objects);
+        m_bvh_dirty = false;
     }
-    else {
-        bool flag = false; //flag to check if the object was already inserted
-        GameObject* pointer = obj.m_octree_node->first;
-        while (pointer->m_octree_next_obj != nullptr) {
-            pointer = pointer->m_octree_next_obj;
-            if (pointer->m_ID == obj.m_ID) {//same object
-                flag = true;
-                break;
+
+    m_render_queue.clear();
+    m_bvh.frustum(frustum, [&](GameObject& obj) {
+        if (obb_culling && classify_frustum_aabb_naive(frustum, obj.bv) == eOVERLAPPING) {
+            stat_frustum_obb_checks++;
+            if (classify_frustum_obb(frustum, obj.oriented) == eOUTSIDE) {
+                stat_frustum_obb_culled++;
+                return;
             }
         }
-        //set the pointers if the object was not already inside, check also with the first and last objects
-        if (!flag && obj.m_octree_node->first->m_ID != obj.m_ID) {
-            pointer->m_octree_next_obj = &obj;
-            obj.m_octree_prev_obj = pointer;
+        stat_frustum_aabb_positive++;
+        if (Contributes(obj.bv))
+            Submit(obj);
+        else
+            stat_contribution_culled_objects++;
+    });
+    FlushRenderQueue();
+}
+
+/**
+ * @brief
+ * 	Closest triangle hit before tmax. Objects are found by the octree, the
+ * 	ones whose bv is hit are tested with the BVH of their mesh in model
+ * 	space.
+ */
+scene::RayHit scene::Raycast(vec3 const& origin, vec3 const& dir, float tmax)
+{
+    RayHit result;
+    vec3   inv = 1.0f / dir;
+    auto   hit = m_octree.raycast(origin, dir, tmax, [&](GameObject& obj, float t) {
+        if (intersection_time_ray_box(origin, inv, obj.bv.min, obj.bv.max, t) < 0.0f)
+            return -1.0f;
+        auto const& mesh     = m_resources.mirlo_meshes[obj.mesh_index].triangles;
+        auto        mesh_hit = mesh.raycast(origin, dir, glm::inverse(obj.m2w), t);
+        if (mesh_hit.t >= 0.0f)
+            result.tri = mesh.triangles()[mesh_hit.triangle];
+        return mesh_hit.t;
+    });
+    result.object = hit.object;
+    result.t      = hit.t;
+    return result;
+}
+
+/**
+ * @brief
+ * 	Closest surface point within radius. Objects are visited best first by
+ * 	the distance to their bv, the mesh BVH of each one finds its closest
+ * 	triangle under its m2w.
+ */
+scene::SurfaceHit scene::ClosestSurface(vec3 const& point, float radius)
+{
+    // The octree decides which candidate wins, so each one is kept until it has
+    std::vector<std::pair<GameObject*, mesh_bvh::closest>> candidates;
+    auto hit = m_octree.closest(point, radius, [&](GameObject& obj, float max_distance) {
+        auto const& mesh    = m_resources.mirlo_meshes[obj.mesh_index].triangles;
+        auto        closest = mesh.closest_point(point, obj.m2w, max_distance);
+        if (closest.triangle == UINT32_MAX)
+            return -1.0f;
+        candidates.emplace_back(&obj, closest);
+        return closest.distance;
+    });
+
+    SurfaceHit result;
+    result.object   = hit.object;
+    result.distance = hit.t;
+    for (auto const& [obj, closest] : candidates)
+        if (obj == hit.object) {
+            result.point  = closest.point;
+            result.normal = closest.normal;
         }
-    }
+    return result;
 }
 
-void EraseObjFromPrevNode(GameObject& obj, Octree<GameObject>& tree) {
-    //traverse through the linked list, in order to erase it from the prev linked list
-    GameObject* pointer = obj.m_octree_node->first;
-    if (obj.m_octree_node->first) {
-        //if it was in the 1 position
-        if (obj.m_octree_node->first->m_ID == obj.m_ID) {
-            if (pointer->m_octree_next_obj == nullptr) //alone in the linked list
-            {
-                obj.m_octree_node->first = nullptr;
-                if (obj.m_octree_node->children_active == 0) //if not children nodes delete
-                    tree.delete_node(obj.m_octree_node->locational_code);
+void scene::OctreeCheckNode(Octree<GameObject>::node* node, bool inside, bool use_hlod)
+{
+    unsigned loc     = node->locational_code;
+    aabb     cell    = LocationalCode::compute_bv(loc, m_octree.root_size());
+    bool     is_root = loc == 1u;
+
+    // The aggregate bounds what the subtree holds, even the objects outside the root cell linked to the root.
+    // The root cell does not bound those, so without aggregates the root is never culled
+    aabb const& bounds = aggregate_bounds ? node->bounds : cell;
+    if (aggregate_bounds && bounds.min.x > bounds.max.x)
+        return; // No objects below
+    if (!inside && (aggregate_bounds || !is_root)) {
+        eResult c = m_culler.classify(loc, bounds);
+        if (c == eOUTSIDE)
+            return;
+        inside = c == eINSIDE;
+    }
 
-            }
-            else { //stil more objects in the linked list
-                obj.m_octree_node->first = obj.m_octree_next_obj;
-                obj.m_octree_next_obj = nullptr;
-            }
+    // Too small to matter, the whole subtree is culled
+    if ((aggregate_bounds || !is_root) && !Contributes(bounds)) {
+        stat_contribution_culled_nodes++;
+        return;
+    }
+
+    // Far enough, the proxy replaces the whole subtree
+    if (use_hlod && !is_root && Lod::screen_size(cell, m_view.eye, m_view.proj[1][1]) < lod_settings.hlod_threshold) {
+        if (auto const* proxy = m_hlod.find(loc)) {
+            auto index = static_cast<unsigned>(proxy - m_hlod.proxies().data());
+            m_render_queue.push(m_hlod_pool_base + index, mat4(1.0f), vec4(0.35f, 0.35f, 0.35f, 1.0f));
+            stat_hlod_proxies++;
+            return;
         }
-        else {
-            while (pointer->m_octree_next_obj != nullptr) {
-                //traverse
-                pointer = pointer->m_octree_next_obj;
-
-                if (pointer->m_ID == obj.m_ID) {
-                    //if it is in the last position
-                    if (pointer->m_octree_next_obj == nullptr) {
-                        pointer->m_octree_prev_obj->m_octree_next_obj = nullptr;
-                    }
-                    else {
-                        pointer->m_octree_prev_obj->m_octree_next_obj = pointer->m_octree_next_obj;
-                        pointer->m_octree_next_obj->m_octree_prev_obj = pointer->m_octree_prev_obj;
-                    }
-
-                    //set to null the pointers of the object
-                    obj.m_octree_prev_obj = nullptr;
-                    obj.m_octree_next_obj = nullptr;
+    }
+
+    for (GameObject* pointer = node->first; pointer; pointer = pointer->m_octree_next_obj) {
+        if (!inside) {
+            eResult c = m_culler.classify(pointer->m_cull, pointer->bv);
+            if (c == eOVERLAPPING && obb_culling) {
+                stat_frustum_obb_checks++;
+                if (classify_frustum_obb(m_culler.current(), pointer->oriented) == eOUTSIDE) {
+                    c = eOUTSIDE;
+                    stat_frustum_obb_culled++;
                 }
             }
+            if (c == eOUTSIDE) {
+                pointer->visible = false;
+                continue;
+            }
+        }
+        if (!Contributes(pointer->bv)) {
+            pointer->visible = false;
+            stat_contribution_culled_objects++;
+            continue;
         }
+        Submit(*pointer);
+        stat_frustum_aabb_positive += inside;
     }
+
+    // Children nearest to the camera first, so objects come out roughly front to back.
+    // Seen from cell.min, the children keep their natural order
+    Octree<GameObject>::node* children[8];
+    unsigned                  count = m_octree.children_front_to_back(node, cell, front_to_back ? m_view.eye : cell.min, children);
+    for (unsigned i = 0; i < count; ++i)
+        OctreeCheckNode(children[i], inside, use_hlod);
 }
 
 /**
  * @brief
+ *  Uploads the HLOD proxies cached for this scene, if there are any
  */
-void scene::CreateOctree(int levels, int sizebit) {
+bool scene::LoadHlod(std::string const& filename)
+{
+    if (!m_hlod.load(filename, m_scene_hash))
+        return false;
+
+    m_hlod_pool_base = LodMeshId(static_cast<unsigned>(m_resources.mirlo_meshes.size()), 0);
+    for (std::size_t i = 0; i < m_hlod.proxies().size(); ++i)
+        UploadVertices(m_hlod_pool_base + static_cast<unsigned>(i), m_hlod.triangles(m_hlod.proxies()[i]));
+    std::cout << "Loaded HLOD proxies: " << m_hlod.proxies().size() << "\n";
+    return true;
+}
+
+int GameObject::id_counter = 0;
+
+/**
+ * @brief
+ */
+void scene::CreateOctree(int levels, int sizebit, bool adaptive) {
     m_octree.set_root_size(1u << sizebit);
    m_octree.set_levels(levels);
+   m_culler.clear(); // Cached cells depend on the root size
+
+   if (adaptive) {
+       // Nodes depend on the insertion history, rebuild from scratch
+       Octree<GameObject>::adaptive_settings settings = adaptive_octree;
+       settings.max_depth = static_cast<unsigned>(levels);
+       ForEachObject([](GameObject& it) {
+           it.m_octree_node     = nullptr;
+           it.m_octree_next_obj = nullptr;
+           it.m_octree_prev_obj = nullptr;
+       });
+       m_octree.clear();
+       m_octree.set_adaptive(true, settings);
+       ForEachObject([&](GameObject& it) { m_octree.insert(it); });
+       return;
+   }
+   m_octree.set_adaptive(false);
 
-   auto& renderables = m_objects;
    //traverse thorugh all renderables
-   for (auto& it : renderables) {
-       const glm::mat4& model = it.m2w;
+   ForEachObject([&](GameObject& it) {
        // get or create if not created yet the node that encapsulates the object
        Octree<GameObject>::node* new_node = m_octree.create_node(aabb(glm::vec4(it.bv.min, 1.f)
            , glm::vec4(it.bv.max, 1.f)));
        //check if it already had another octree::node list 
        if (it.m_octree_node) {
            if (it.m_octree_node == new_node)
-               continue;
+               return;
            else {
-               EraseObjFromPrevNode(it, m_octree);
-               it.m_octree_node = new_node;
-               AddObjToNode(it, it.m_octree_node);
+               unsigned loc = new_node->locational_code; // remove() may prune new_node
+               m_octree.remove(it);
+               m_octree.insert(it, loc);
            }
        }
        else {
-           it.m_octree_node = new_node;
-           AddObjToNode(it, it.m_octree_node);
+           m_octree.insert(it, new_node->locational_code);
        }
-   }
+   });
+}
+
+/**
+ * @brief
+ *  Picks the root size and levels from the object bounds, and the views
+ *  if any, then rebuilds the octree with them
+ */
+octree_tuning_report scene::TuneOctree(std::span<frustrum const> views, bool adaptive)
+{
+    std::vector<aabb> bvs;
+    ForEachObject([&](GameObject const& it) { bvs.push_back(it.bv); });
+
+    auto report = tune_octree(bvs, views);
+    CreateOctree(static_cast<int>(report.levels), static_cast<int>(report.size_bit), adaptive);
+    return report;
+}
+
+/**
+ * @brief
+ *  Links the objects using a saved octree image instead of computing the
+ *  node of every object. Fails if the image is missing, was built for
+ *  another scene or with other octree parameters.
+ */
+bool scene::LoadOctreeImage(std::string const& filename, int levels, int sizebit)
+{
+    octree_image image;
+    if (!image.open(filename, m_scene_hash))
+        return false;
+    if (image.info().levels != static_cast<unsigned>(levels) || image.info().root_size != (1u << sizebit) ||
+        image.info().object_count != m_objects.size())
+        return false;
+
+    // The scene hash does not cover the image, an object listed twice would be linked into two nodes
+    std::vector<bool> seen(m_objects.size());
+    for (auto const& n : image.nodes())
+        for (auto const& obj : image.objects().subspan(n.first_object, n.object_count)) {
+            if (obj.index >= m_objects.size() || seen[obj.index])
+                return false;
+            seen[obj.index] = true;
+        }
+
+    for (auto& obj : m_objects) {
+        obj.m_octree_node     = nullptr;
+        obj.m_octree_next_obj = nullptr;
+        obj.m_octree_prev_obj = nullptr;
+    }
+    m_octree.clear();
+    m_octree.set_adaptive(false);
+    m_octree.set_root_size(1u << sizebit);
+    m_octree.set_levels(levels);
+    m_culler.clear();
+
+    for (auto const& n : image.nodes()) {
+        m_octree.create_node(n.locational_code);
+        for (auto const& obj : image.objects().subspan(n.first_object, n.object_count))
+            m_octree.insert(m_objects[obj.index], n.locational_code);
+    }
+    return true;
+}
+
+bool scene::SaveOctreeImage(std::string const& filename) const
+{
+    auto image = octree_image::build(m_octree, m_scene_hash, [this](GameObject const& obj) {
+        return static_cast<uint32_t>(&obj - m_objects.data());
+    });
+    return octree_image::write(filename, image);
+}
+
+/**
+ * @brief
+ *  Streaming mode: objects are grouped by the octree cell at the streaming
+ *  level that contains them and only the cells around the camera are kept
+ *  in memory, together with the meshes they use. Objects that straddle
+ *  those cells are always resident. Needs the binary scene, which already
+ *  has the world bounds, so no mesh has to be read up front.
+ */
+void scene::InitStreaming(streaming_config config)
+{
+    if (!m_scene_file.open(WORKDIR "assets/scene.bin") || SceneFormat::binary_records(m_scene_file).empty())
+        throw std::runtime_error("Streaming needs assets/scene.bin, convert the scene with scene_convert");
+    if (uint64_t text_hash = octree_image::hash_file(WORKDIR "assets/scene.txt"); text_hash && SceneFormat::binary_source_hash(m_scene_file) != text_hash)
+        std::cout << "assets/scene.bin was not converted from the current assets/scene.txt, convert it again with scene_convert\n";
+    auto records = SceneFormat::binary_records(m_scene_file);
+
+    m_octree.set_root_size(1u << 10);
+    m_octree.set_levels(6);
+    config.root_size  = m_octree.root_size();
+    config.cell_level = std::min(config.cell_level, m_octree.levels());
+
+    std::vector<uint32_t> always_resident;
+    uint32_t              mesh_count = 0;
+    for (uint32_t i = 0; i < records.size(); ++i) {
+        mesh_count = std::max(mesh_count, records[i].mesh_id + 1);
+
+        unsigned loc   = LocationalCode::compute_locational_code(SceneFormat::record_bv(records[i]), m_octree.root_size(), m_octree.levels());
+        unsigned depth = 0;
+        while ((loc >> (3 * (depth + 1))) != 0)
+            ++depth;
+
+        if (depth < config.cell_level)
+            always_resident.push_back(i);
+        else
+            m_cell_records[loc >> (3 * (depth - config.cell_level))].push_back(i);
+    }
+    m_resources.mirlo_meshes.resize(mesh_count);
+    m_mesh_refs.resize(mesh_count);
+
+    // Objects that are never paged out, m_objects must not grow after this
+    CellPayload global = LoadCell(always_resident);
+    PageInCell(0, global);
+    m_objects = std::move(m_resident_cells[0].objects);
+    m_resident_cells.erase(0);
+    for (auto& obj : m_objects) {
+        obj.m_octree_node = nullptr;
+        LinkToOctree(obj);
+    }
+
+    std::vector<unsigned> cells;
+    for (auto const& it : m_cell_records)
+        cells.push_back(it.first);
+
+    m_streamer = std::make_unique<cell_streamer<CellPayload>>(
+        config, cells,
+        [this](unsigned cell) { return LoadCell(m_cell_records.at(cell)); },
+        [this](unsigned cell, CellPayload& payload) { return PageInCell(cell, payload); },
+        [this](unsigned cell) { PageOutCell(cell); });
+
+    std::cout << "Streaming " << cells.size() << " cells, " << m_objects.size() << " objects always resident\n";
+}
+
+/**
+ * @brief
+ *  Runs on the streaming workers, only reads data that is immutable while
+ *  streaming
+ */
+scene::CellPayload scene::LoadCell(std::vector<uint32_t> const& records) const
+{
+    auto        all = SceneFormat::binary_records(m_scene_file);
+    CellPayload payload;
+    payload.records.reserve(records.size());
+
+    std::vector<unsigned> meshes;
+    for (uint32_t i : records) {
+        payload.records.push_back(all[i]);
+        meshes.push_back(all[i].mesh_id);
+    }
+    std::sort(meshes.begin(), meshes.end());
+    meshes.erase(std::unique(meshes.begin(), meshes.end()), meshes.end());
+
+    for (unsigned mesh : meshes) {
+        auto lods = LoadMeshLods(mesh);
+        if (lods.empty())
+            throw std::runtime_error("Could not load mesh " + std::to_string(mesh));
+        payload.meshes.emplace_back(mesh, std::move(lods));
+    }
+    return payload;
+}
+
+/**
+ * @brief
+ *  Uploads the meshes not resident yet and links the objects. Every cell
+ *  is charged for all the meshes it uses.
+ */
+std::size_t scene::PageInCell(unsigned cell, CellPayload& payload)
+{
+    StreamedCell& resident = m_resident_cells[cell];
+    std::size_t   bytes    = 0;
+
+    for (auto const& [mesh, lods] : payload.meshes) {
+        if (m_mesh_refs[mesh]++ == 0)
+            m_resources.mirlo_meshes[mesh] = CreateMesh(mesh, lods);
+        resident.meshes.push_back(mesh);
+        for (auto const& triangles : lods)
+            bytes += triangles.size() * sizeof(triangle);
+    }
+
+    resident.objects.reserve(payload.records.size());
+    for (auto const& r : payload.records)
+        resident.objects.push_back(MakeObject(r.mesh_id, SceneFormat::record_transform(r), SceneFormat::record_bv(r)));
+    if (cell != 0)
+        for (auto& obj : resident.objects)
+            LinkToOctree(obj);
+    m_bvh_dirty = true;
+
+    return bytes + resident.objects.size() * sizeof(GameObject);
+}
+
+/**
+ * @brief
+ *  Links an object that is not in the octree, to the node of its bv or to
+ *  the deepest one containing it if the octree is adaptive
+ */
+void scene::LinkToOctree(GameObject& obj)
+{
+    if (m_octree.adaptive())
+        m_octree.insert(obj);
+    else
+        m_octree.insert(obj, LocationalCode::compute_locational_code(obj.bv, m_octree.root_size(), m_octree.levels()));
+}
+
+void scene::PageOutCell(unsigned cell)
+{
+    auto it = m_resident_cells.find(cell);
+    if (it == m_resident_cells.end())
+        return;
+
+    for (auto& obj : it->second.objects)
+        m_octree.remove(obj);
+    m_bvh_dirty = true;
+
+    for (unsigned mesh : it->second.meshes) {
+        if (--m_mesh_refs[mesh] == 0) {
+            for (unsigned lod = 0; lod < Lod::max_lods; ++lod)
+                m_mesh_pool.remove(LodMeshId(mesh, lod));
+            m_resources.mirlo_meshes[mesh] = NaiveMesh{};
+        }
+    }
+    m_resident_cells.erase(it);
+}
+
+void scene::UpdateStreaming(vec3 const& camera_position, float dt)
+{
+    if (m_streamer)
+        m_streamer->update(camera_position, dt);
 }
@@ -4,6 +4,21 @@
 #include "shapes.hpp"
 #include "octree.hpp"
 #include "shader.hpp"
+#include "cell_streamer.hpp"
+#include "render_queue.hpp"
+#include "lod.hpp"
+#include "hlod.hpp"
+#include "coherent_culling.hpp"
+#include "frame_pipeline.hpp"
+#include "octree_tuning.hpp"
+#include "bvh.hpp"
+#include "mesh_bvh.hpp"
+#include "camera.hpp"
+#include <span>
+#include "scene_format.hpp"
+#include <functional>
+#include <memory>
+#include <string>
 #include <vector>
 
 /**
@@ -15,18 +30,21 @@ struct GameObject
 
     // BV
     aabb bv = {};
+    obb  oriented = {}; // Tighter for rotated meshes, refines the objects whose bv straddles the frustum
 
     // Space partitioning data
     // [TODO]
     Octree<GameObject>::node* m_octree_node = nullptr;
     GameObject* m_octree_next_obj = nullptr;
     GameObject* m_octree_prev_obj = nullptr;
+    coherent_culler::entry m_cull; // Last frustum classification, reset when bv changes
     static int id_counter;
     int m_ID = id_counter++;
 
     // Render data
     mat4     m2w;
-    uint32_t mesh_vao;
+    uint32_t mesh_index;
+    uint8_t  lod = 0; // Selected by the last visibility pass
     uint32_t mesh_vtx_count;
     vec4     color;
 };
@@ -41,9 +59,24 @@ class scene
 
     struct NaiveMesh
     {
-        unsigned vao;
         unsigned vtx_count;
+        unsigned lod_count; // Every LOD is a range of the shared vertex buffer
         aabb     bv_model;
+        mesh_bvh triangles; // Of the full mesh, for exact ray hits
+    };
+
+    using MeshLods = std::vector<std::vector<triangle>>; // Level 0 is the full mesh
+
+    // Streaming: objects of a resident octree cell and the meshes they use
+    struct StreamedCell
+    {
+        std::vector<GameObject> objects;
+        std::vector<unsigned>   meshes;
+    };
+    struct CellPayload
+    {
+        std::vector<SceneFormat::record>                          records;
+        std::vector<std::pair<unsigned, MeshLods>>                meshes;
     };
 
     // Graphics resources
@@ -51,19 +84,122 @@ class scene
     {
         ::ShaderProgram*              m_shader;
         unsigned               m_mesh_quad = 0;
+        unsigned               m_vao = 0;             // Shared by all meshes
+        unsigned               m_vertex_vbo = 0;      // All the meshes, ranges in m_mesh_pool
+        unsigned               m_vertex_capacity = 0; // In vertices
+        unsigned               m_instance_vbo = 0;
+        unsigned               m_indirect_buffer = 0;
         std::vector<NaiveMesh> mirlo_meshes;
     } m_resources;
 
     Octree<GameObject> m_octree;
+    bvh<GameObject>    m_bvh;              // Alternative to the octree, rebuilt when objects come or go
+    bool               m_bvh_dirty = true;
+    mesh_pool          m_mesh_pool;
+    render_queue       m_render_queue; // Filled by the visibility passes
+    render_queue       m_draw_queue;   // Presented visible set, drawn by Render
+    bool               m_draw_queue_uploaded = false;
+    hlod_cache         m_hlod;
+    coherent_culler    m_culler; // Octree cell classifications kept across frames
+
+    // Node bounds the cached classifications were made with
+    struct
+    {
+        unsigned revision  = 0;
+        bool     aggregate = false;
+    } m_culled_bounds;
+    unsigned           m_hlod_pool_base = 0; // Mesh pool id of the first proxy
+
+    // Camera of the frame, for LOD selection and contribution culling
+    struct
+    {
+        vec3 eye      = {};
+        mat4 view     = mat4(1.0f);
+        mat4 proj     = mat4(1.0f);
+        vec2 viewport = vec2(1.0f);
+    } m_view;
+
+    // Camera the presented visible set was culled with
+    struct
+    {
+        mat4 view = mat4(1.0f);
+        mat4 proj = mat4(1.0f);
+    } m_drawn_view;
+    uint64_t           m_scene_hash = 0; // Contents of the loaded scene file
+
+    // Streaming mode
+    mapped_file                                          m_scene_file;
+    std::unordered_map<unsigned, std::vector<uint32_t>>  m_cell_records; // Scene records of each streamed cell
+    std::unordered_map<unsigned, StreamedCell>           m_resident_cells;
+    std::vector<unsigned>                                m_mesh_refs;
+    std::unique_ptr<cell_streamer<CellPayload>>          m_streamer;
+
+    // Culls the next frame while the current one is submitted
+    frame_pipeline m_pipeline;
+
+    void        InitMeshBuffer();
+    static MeshLods LoadMeshLods(unsigned mesh_index);
+    NaiveMesh   CreateMesh(unsigned mesh_index, MeshLods const& lods);
+    void        UploadVertices(unsigned pool_id, std::span<triangle const> triangles);
+    void        Submit(GameObject& obj);
+    bool        Contributes(aabb const& bv) const;
+    void        CheckFrustrumObjectCollisions(Octree<GameObject>::node* node, frustrum const& frus);
+    void        LinkToOctree(GameObject& obj);
+    void        OctreeCheckNode(Octree<GameObject>::node* node, bool inside, bool use_hlod); // Classifies against the frustum of m_culler
+    bool        LoadHlod(std::string const& filename);
+    void        FlushRenderQueue();
+    void        UploadDrawQueue();
+
+    // Meshes in the shared vertex buffer, one per mesh and LOD
+    static unsigned LodMeshId(unsigned mesh_index, unsigned lod) { return mesh_index * Lod::max_lods + lod; }
+    void        InitStreaming(streaming_config config);
+    CellPayload LoadCell(std::vector<uint32_t> const& records) const;
+    std::size_t PageInCell(unsigned cell, CellPayload& payload);
+    void        PageOutCell(unsigned cell);
+    GameObject  MakeObject(unsigned mesh_index, mat4 const& m2w, aabb const& bv) const;
 
   public:
     // Stats
-    int stat_draw_calls            = 0;
-    int stat_frustum_aabb_checks   = 0;
-    int stat_frustum_aabb_positive = 0;
+    int   stat_draw_calls                  = 0;
+    int   stat_draw_commands               = 0;    // Indirect commands of the multi-draw
+    int   stat_triangles                   = 0;    // Submitted, after LOD selection
+    int   stat_hlod_proxies                = 0;    // Drawn instead of their subtrees
+    int   stat_contribution_culled_nodes   = 0;    // Subtrees too small on screen
+    int   stat_contribution_culled_objects = 0;
+    int   stat_frustum_aabb_checks         = 0;
+    int   stat_frustum_aabb_positive       = 0;
+    int   stat_cull_reused                 = 0;    // Octree cells that kept last frame's classification
+    int   stat_frustum_obb_checks          = 0;    // Objects straddling the frustum tested again with their obb
+    int   stat_frustum_obb_culled          = 0;
+    float stat_submit_ms                   = 0.0f; // CPU time spent in Render
+
+    Lod::settings lod_settings;
+    float         contribution_pixels = 0.0f;  // Octree nodes and objects smaller on screen are culled, 0 disables
+    bool          front_to_back       = true;  // Octree check visits the children nearest to the camera first
+    bool          depth_sort          = false; // Exact front to back order inside every draw
+    bool          aggregate_bounds    = true;  // Octree check culls nodes by the bounds of their objects instead of their cell
+    bool          obb_culling         = true;  // Objects whose bv straddles the frustum are tested again with their obb
+    Octree<GameObject>::adaptive_settings adaptive_octree; // Used by CreateOctree when adaptive, max_depth is its levels
+
+    // Exact ray hit: the octree finds the objects, the mesh BVH their triangles
+    struct RayHit
+    {
+        GameObject* object = nullptr;
+        float       t      = -1.0f; // In units of the ray direction
+        triangle    tri;            // In model space
+    };
+
+    // Closest surface point, for decals, foot placement and snapping
+    struct SurfaceHit
+    {
+        GameObject* object   = nullptr;
+        float       distance = -1.0f;
+        vec3        point;  // In world space
+        vec3        normal; // In world space, by the triangle winding
+    };
 
   public:
-    scene();
+    explicit scene(streaming_config const* streaming = nullptr);
     ~scene();
     scene(scene const& rhs) = delete;
     scene& operator=(scene const& rhs) = delete;
@@ -72,12 +208,44 @@ class scene
     void MakeAllVisible();
     void FrustumCheck(frustrum const& frustum);
     void OctreeCheck(frustrum const& frustum);
+    void BvhCheck(frustrum const& frustum);
+    RayHit Raycast(vec3 const& origin, vec3 const& dir, float tmax = FLT_MAX);
+    SurfaceHit ClosestSurface(vec3 const& point, float radius = FLT_MAX);
     void Render(mat4 const& v, mat4 const& p);
-    void CreateOctree(int levels, int sizebit);
+    void CreateOctree(int levels, int sizebit, bool adaptive = false);
+    octree_tuning_report TuneOctree(std::span<frustrum const> views, bool adaptive = false);
+    bool LoadOctreeImage(std::string const& filename, int levels, int sizebit);
+    bool SaveOctreeImage(std::string const& filename) const;
+    void UpdateStreaming(vec3 const& camera_position, float dt);
+    void SetView(camera const& cam, ivec2 const& viewport);
+    void StartVisibility(std::function<void()> pass);
+    bool PresentVisibility();
+
+    template<typename F>
+    void ForEachObject(F&& f);
 
     [[nodiscard]] decltype(m_objects) const& objects() const { return m_objects; }
     [[nodiscard]] decltype(m_objects)&       objects() { return m_objects; }
     [[nodiscard]] decltype(m_octree)&        get_octree() { return m_octree; }
+    [[nodiscard]] coherent_culler&           get_culler() { return m_culler; }
+    [[nodiscard]] frame_pipeline&            get_pipeline() { return m_pipeline; }
+    [[nodiscard]] mat4 const&                get_drawn_view() const { return m_drawn_view.view; }
+    [[nodiscard]] mat4 const&                get_drawn_projection() const { return m_drawn_view.proj; }
+    [[nodiscard]] streaming_stats const*     get_streaming_stats() const { return m_streamer ? &m_streamer->stats() : nullptr; }
 };
 
+/**
+ * @brief
+ *  Visits the always resident objects and those of the streamed cells
+ */
+template<typename F>
+void scene::ForEachObject(F&& f)
+{
+    for (auto& obj : m_objects)
+        f(obj);
+    for (auto& it : m_resident_cells)
+        for (auto& obj : it.second.objects)
+            f(obj);
+}
+
 #endif // SCENE_HPP
@@ -0,0 +1,113 @@
+#include "bounds_update.hpp"
+#include <cmath>
+#include <cstring>
+
+// Set by the build rather than read from __FMA__, which MSVC does not define with /arch:AVX2
+#ifdef ENGINE_AVX2
+#include <immintrin.h>
+#define BOUNDS_UPDATE_AVX2 1
+#endif
+
+uint32_t bounds_updater::add(aabb const& local, mat4 const& m2w)
+{
+    if (m_size % 8 == 0)
+        m_blocks.push_back({});
+    uint32_t index = static_cast<uint32_t>(m_size++);
+    set_local(index, local);
+    set_transform(index, m2w);
+    return index;
+}
+
+void bounds_updater::set_local(uint32_t index, aabb const& local)
+{
+    block&   b = m_blocks[index / 8];
+    unsigned i = index % 8;
+    for (int e = 0; e < 3; ++e) {
+        b.center[e][i] = 0.5f * (local.min[e] + local.max[e]);
+        b.extent[e][i] = 0.5f * (local.max[e] - local.min[e]);
+    }
+    b.marked[i] = 1;
+}
+
+/**
+ * @brief
+ * 	Stores the affine part of m2w, marking the object only if it changed
+ */
+void bounds_updater::set_transform(uint32_t index, mat4 const& m2w)
+{
+    block&   b = m_blocks[index / 8];
+    unsigned i = index % 8;
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 4; ++c) {
+            float& stored = b.affine[r * 4 + c][i];
+            if (stored != m2w[c][r]) {
+                stored      = m2w[c][r];
+                b.marked[i] = 1;
+            }
+        }
+}
+
+/**
+ * @brief
+ * 	Recomputes the world bounds of the blocks with a marked object. The
+ * 	unmarked objects of those blocks get the same bounds they had.
+ */
+void bounds_updater::update()
+{
+    m_dirty.clear();
+    for (std::size_t index = 0; index < m_blocks.size(); ++index) {
+        block&   b = m_blocks[index];
+        uint64_t marks;
+        std::memcpy(&marks, b.marked, sizeof(marks));
+        if (!marks)
+            continue;
+
+#ifdef BOUNDS_UPDATE_AVX2
+        __m256 const sign = _mm256_set1_ps(-0.0f);
+        __m256 const c[3] = { _mm256_load_ps(b.center[0]), _mm256_load_ps(b.center[1]), _mm256_load_ps(b.center[2]) };
+        __m256 const e[3] = { _mm256_load_ps(b.extent[0]), _mm256_load_ps(b.extent[1]), _mm256_load_ps(b.extent[2]) };
+        for (int r = 0; r < 3; ++r) {
+            __m256 m0 = _mm256_load_ps(b.affine[r * 4 + 0]), m1 = _mm256_load_ps(b.affine[r * 4 + 1]);
+            __m256 m2 = _mm256_load_ps(b.affine[r * 4 + 2]), m3 = _mm256_load_ps(b.affine[r * 4 + 3]);
+            __m256 center = _mm256_fmadd_ps(m0, c[0], _mm256_fmadd_ps(m1, c[1], _mm256_fmadd_ps(m2, c[2], m3)));
+            __m256 extent = _mm256_fmadd_ps(_mm256_andnot_ps(sign, m0), e[0],
+                                            _mm256_fmadd_ps(_mm256_andnot_ps(sign, m1), e[1], _mm256_mul_ps(_mm256_andnot_ps(sign, m2), e[2])));
+            _mm256_store_ps(b.min[r], _mm256_sub_ps(center, extent));
+            _mm256_store_ps(b.max[r], _mm256_add_ps(center, extent));
+        }
+#else
+        for (int r = 0; r < 3; ++r) {
+            float const* m0 = b.affine[r * 4 + 0];
+            float const* m1 = b.affine[r * 4 + 1];
+            float const* m2 = b.affine[r * 4 + 2];
+            float const* m3 = b.affine[r * 4 + 3];
+            for (int i = 0; i < 8; ++i) {
+                float center = m0[i] * b.center[0][i] + m1[i] * b.center[1][i] + m2[i] * b.center[2][i] + m3[i];
+                float extent = std::abs(m0[i]) * b.extent[0][i] + std::abs(m1[i]) * b.extent[1][i] + std::abs(m2[i]) * b.extent[2][i];
+                b.min[r][i]  = center - extent;
+                b.max[r][i]  = center + extent;
+            }
+        }
+#endif
+
+        for (int i = 0; i < 8; ++i)
+            if (b.marked[i]) {
+                m_dirty.push_back(static_cast<uint32_t>(index * 8 + i));
+                b.marked[i] = 0;
+            }
+    }
+}
+
+void bounds_updater::clear()
+{
+    m_size = 0;
+    m_blocks.clear();
+    m_dirty.clear();
+}
+
+aabb bounds_updater::world(uint32_t index) const
+{
+    block const& b = m_blocks[index / 8];
+    unsigned     i = index % 8;
+    return aabb(vec3(b.min[0][i], b.min[1][i], b.min[2][i]), vec3(b.max[0][i], b.max[1][i], b.max[2][i]));
+}
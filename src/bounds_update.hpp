@@ -0,0 +1,73 @@
+#ifndef _BOUNDS_UPDATE__HPP_
+#define _BOUNDS_UPDATE__HPP_
+
+#include "octree.hpp"
+#include "shapes.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief
+ * 	World bounds of many objects refreshed at once from their local bounds
+ * 	and affine transforms, with the center and extent method of
+ * 	transform_aabb. Objects are stored in blocks of eight, as a structure
+ * 	of arrays within each block, so a block is transformed per iteration
+ * 	with AVX2 and FMA when the engine is built with them (ENGINE_AVX2) and
+ * 	one object at a time otherwise.
+ *
+ * 	set_transform() only marks an object if its transform changed. update()
+ * 	refreshes the blocks of eight holding a marked object and lists the
+ * 	marked objects in dirty(), for relocate_dirty() to move in an octree.
+ */
+class bounds_updater
+{
+public:
+    uint32_t add(aabb const& local, mat4 const& m2w);
+    void     set_local(uint32_t index, aabb const& local);
+    void     set_transform(uint32_t index, mat4 const& m2w);
+    void     update();
+    void     clear();
+
+    [[nodiscard]] aabb                      world(uint32_t index) const;
+    [[nodiscard]] std::span<uint32_t const> dirty() const { return m_dirty; }
+    [[nodiscard]] std::size_t               size() const { return m_size; }
+
+private:
+    // Eight objects, element by element, so a block is transformed with one load per element
+    struct alignas(32) block
+    {
+        float   affine[12][8]; // Rows of the 3x4 m2w
+        float   center[3][8];  // Local bounds
+        float   extent[3][8];  // Half size
+        float   min[3][8];     // World bounds
+        float   max[3][8];
+        uint8_t marked[8];
+    };
+
+    std::size_t           m_size = 0;
+    std::vector<block>    m_blocks;
+    std::vector<uint32_t> m_dirty; // Refreshed by the last update(), ascending
+};
+
+/**
+ * @brief
+ * 	Copies the world bounds of the objects refreshed by the last update()
+ * 	and relocates the linked ones as one batch, objects[i] being the object
+ * 	added as i
+ */
+template<typename T>
+void relocate_dirty(Octree<T>& tree, std::span<T> objects, bounds_updater const& bounds)
+{
+    std::vector<T*> moved;
+    moved.reserve(bounds.dirty().size());
+    for (uint32_t i : bounds.dirty()) {
+        T& obj = objects[i];
+        obj.bv = bounds.world(i);
+        if (obj.m_octree_node)
+            moved.push_back(&obj);
+    }
+    tree.relocate(std::span<T* const>(moved));
+}
+
+#endif
@@ -0,0 +1,448 @@
+#ifndef _BVH__HPP_
+#define _BVH__HPP_
+
+#include "geometry.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief
+ * 	Bounding volume hierarchy over objects with a world aabb bv, built top
+ * 	down with the binned surface area heuristic. Unlike the octree, nodes
+ * 	adapt to the objects, so long thin objects and objects of very
+ * 	different sizes do not pile up at the top of the tree.
+ *
+ * 	Nodes are stored depth first: the left child of an inner node follows
+ * 	it and the right one is at its offset, the objects of every subtree are
+ * 	contiguous. refit() updates the bounds after objects move, the
+ * 	hierarchy is kept so it degrades as they move far from where they were
+ * 	built, rebuild then. The objects are not owned and must outlive it.
+ * 	Queries take the same arguments as the Octree ones.
+ */
+template<typename T>
+class bvh
+{
+public:
+    struct build_settings
+    {
+        unsigned bins           = 16;
+        unsigned max_leaf_size  = 4;    // Larger leaves are split even if the SAH says otherwise
+        float    traversal_cost = 1.0f; // Of a node, relative to testing an object
+    };
+
+    struct node
+    {
+        vec3     min;
+        uint32_t offset; // First object of a leaf, right child of an inner node
+        vec3     max;
+        uint16_t count; // Objects of a leaf, 0 for inner nodes
+        uint16_t axis;  // Split axis of an inner node
+    };
+    static_assert(sizeof(node) == 32, "Two nodes per cache line");
+
+    struct hit
+    {
+        T*    object = nullptr;
+        float t      = -1.0f;
+    };
+
+    void build(std::span<T* const> objects, build_settings const& settings = {});
+    void refit();
+    void clear();
+
+    template<typename F>
+    void frustum(frustrum const& f, F&& visit) const;
+    template<typename F>
+    void query(aabb const& region, F&& visit) const;
+    template<typename F>
+    hit  raycast(vec3 const& origin, vec3 const& dir, float tmax, F&& intersect) const;
+    hit  raycast(vec3 const& origin, vec3 const& dir, float tmax = FLT_MAX) const;
+    void nearest(vec3 const& point, unsigned k, std::vector<T*>& out, float max_distance = FLT_MAX) const;
+
+    [[nodiscard]] std::span<node const> nodes() const { return m_nodes; }
+    [[nodiscard]] std::span<T* const>   objects() const { return m_objects; }
+    [[nodiscard]] bool                  empty() const { return m_nodes.empty(); }
+
+private:
+    struct build_item
+    {
+        aabb bv;
+        vec3 centroid;
+        T*   object;
+    };
+
+    static float half_area(vec3 const& min, vec3 const& max)
+    {
+        vec3 d = glm::max(max - min, vec3(0.0f));
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+
+    uint32_t build_node(std::span<build_item> items, std::size_t first, build_settings const& settings);
+    template<typename F>
+    void visit_subtree(uint32_t index, F& visit) const;
+
+    std::vector<node> m_nodes;
+    std::vector<T*>   m_objects; // In leaf order
+};
+
+template<typename T>
+void bvh<T>::build(std::span<T* const> objects, build_settings const& settings)
+{
+    clear();
+    if (objects.empty())
+        return;
+
+    std::vector<build_item> items;
+    items.reserve(objects.size());
+    for (T* obj : objects)
+        items.push_back({ obj->bv, (obj->bv.min + obj->bv.max) * 0.5f, obj });
+
+    m_nodes.reserve(2 * objects.size() / std::max(settings.max_leaf_size, 1u) + 1);
+    build_node(items, 0, settings);
+
+    m_objects.reserve(items.size());
+    for (auto const& item : items)
+        m_objects.push_back(item.object);
+}
+
+/**
+ * @brief
+ * 	Splits items, which are the objects from first on, at the cheapest bin
+ * 	boundary of the three axes, or makes a leaf if that is cheaper
+ */
+template<typename T>
+uint32_t bvh<T>::build_node(std::span<build_item> items, std::size_t first, build_settings const& settings)
+{
+    auto index = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.emplace_back();
+
+    vec3 min(FLT_MAX), max(-FLT_MAX), cmin(FLT_MAX), cmax(-FLT_MAX);
+    for (auto const& item : items) {
+        min  = glm::min(min, item.bv.min);
+        max  = glm::max(max, item.bv.max);
+        cmin = glm::min(cmin, item.centroid);
+        cmax = glm::max(cmax, item.centroid);
+    }
+    m_nodes[index].min = min;
+    m_nodes[index].max = max;
+
+    auto make_leaf = [&] {
+        m_nodes[index].offset = static_cast<uint32_t>(first);
+        m_nodes[index].count  = static_cast<uint16_t>(items.size());
+        return index;
+    };
+    if (items.size() <= 1)
+        return make_leaf();
+
+    // Binned SAH, cost relative to testing every object of the node
+    unsigned const bins      = std::max(settings.bins, 2u);
+    float          best_cost = FLT_MAX;
+    unsigned       best_axis = 0, best_split = 0;
+    struct bin
+    {
+        vec3     min   = vec3(FLT_MAX);
+        vec3     max   = vec3(-FLT_MAX);
+        unsigned count = 0;
+    };
+    std::vector<bin>   binned(bins);
+    std::vector<float> right_cost(bins);
+    for (unsigned axis = 0; axis < 3; ++axis) {
+        float extent = cmax[axis] - cmin[axis];
+        if (extent <= 0.0f)
+            continue;
+        float scale = static_cast<float>(bins) / extent;
+
+        std::fill(binned.begin(), binned.end(), bin{});
+        for (auto const& item : items) {
+            unsigned b = std::min(static_cast<unsigned>((item.centroid[axis] - cmin[axis]) * scale), bins - 1);
+            binned[b].min = glm::min(binned[b].min, item.bv.min);
+            binned[b].max = glm::max(binned[b].max, item.bv.max);
+            binned[b].count++;
+        }
+
+        // Right side swept from the end, cost of splitting before bin i
+        vec3     rmin(FLT_MAX), rmax(-FLT_MAX);
+        unsigned rcount = 0;
+        for (unsigned i = bins - 1; i > 0; --i) {
+            rmin   = glm::min(rmin, binned[i].min);
+            rmax   = glm::max(rmax, binned[i].max);
+            rcount += binned[i].count;
+            right_cost[i] = rcount ? half_area(rmin, rmax) * static_cast<float>(rcount) : 0.0f;
+        }
+        vec3     lmin(FLT_MAX), lmax(-FLT_MAX);
+        unsigned lcount = 0;
+        for (unsigned i = 1; i < bins; ++i) {
+            lmin   = glm::min(lmin, binned[i - 1].min);
+            lmax   = glm::max(lmax, binned[i - 1].max);
+            lcount += binned[i - 1].count;
+            if (lcount == 0 || lcount == items.size())
+                continue;
+            float cost = half_area(lmin, lmax) * static_cast<float>(lcount) + right_cost[i];
+            if (cost < best_cost) {
+                best_cost  = cost;
+                best_axis  = axis;
+                best_split = i;
+            }
+        }
+    }
+
+    float area      = half_area(min, max);
+    float leaf_cost = static_cast<float>(items.size());
+    float split_cost = best_cost == FLT_MAX ? FLT_MAX : settings.traversal_cost + (area > 0.0f ? best_cost / area : leaf_cost);
+    bool  must_split = items.size() > settings.max_leaf_size || items.size() > UINT16_MAX;
+    if (split_cost >= leaf_cost && !must_split)
+        return make_leaf();
+
+    std::size_t middle;
+    if (best_cost == FLT_MAX) {
+        // Every centroid in the same place, halve by count
+        middle = items.size() / 2;
+    }
+    else {
+        float scale = static_cast<float>(bins) / (cmax[best_axis] - cmin[best_axis]);
+        auto  it    = std::partition(items.begin(), items.end(), [&](build_item const& item) {
+            return std::min(static_cast<unsigned>((item.centroid[best_axis] - cmin[best_axis]) * scale), bins - 1) < best_split;
+        });
+        middle = static_cast<std::size_t>(it - items.begin());
+    }
+
+    m_nodes[index].count = 0;
+    m_nodes[index].axis  = static_cast<uint16_t>(best_axis);
+    build_node(items.first(middle), first, settings);
+    uint32_t right        = build_node(items.subspan(middle), first + middle, settings);
+    m_nodes[index].offset = right;
+    return index;
+}
+
+/**
+ * @brief
+ * 	Recomputes every node from the current object bounds. Children come
+ * 	after their parent, so going backwards visits them first.
+ */
+template<typename T>
+void bvh<T>::refit()
+{
+    for (std::size_t i = m_nodes.size(); i-- > 0;) {
+        node& n = m_nodes[i];
+        if (n.count) {
+            n.min = vec3(FLT_MAX);
+            n.max = vec3(-FLT_MAX);
+            for (uint32_t o = n.offset; o < n.offset + n.count; ++o) {
+                n.min = glm::min(n.min, m_objects[o]->bv.min);
+                n.max = glm::max(n.max, m_objects[o]->bv.max);
+            }
+        }
+        else {
+            node const& l = m_nodes[i + 1];
+            node const& r = m_nodes[n.offset];
+            n.min         = glm::min(l.min, r.min);
+            n.max         = glm::max(l.max, r.max);
+        }
+    }
+}
+
+template<typename T>
+void bvh<T>::clear()
+{
+    m_nodes.clear();
+    m_objects.clear();
+}
+
+template<typename T>
+template<typename F>
+void bvh<T>::visit_subtree(uint32_t index, F& visit) const
+{
+    // Objects of a subtree are contiguous: from its leftmost leaf to its rightmost one
+    uint32_t first = index, last = index;
+    while (m_nodes[first].count == 0)
+        first++;
+    while (m_nodes[last].count == 0)
+        last = m_nodes[last].offset;
+    for (uint32_t o = m_nodes[first].offset; o < m_nodes[last].offset + m_nodes[last].count; ++o)
+        visit(*m_objects[o]);
+}
+
+/**
+ * @brief
+ * 	Calls visit(obj) for every object not outside f. Subtrees inside f are
+ * 	accepted without further tests.
+ */
+template<typename T>
+template<typename F>
+void bvh<T>::frustum(frustrum const& f, F&& visit) const
+{
+    if (m_nodes.empty())
+        return;
+
+    std::vector<uint32_t> stack{ 0u };
+    while (!stack.empty()) {
+        uint32_t    index = stack.back();
+        node const& n     = m_nodes[index];
+        stack.pop_back();
+
+        eResult c = classify_frustum_aabb_naive(f, aabb(n.min, n.max));
+        if (c == eOUTSIDE)
+            continue;
+        if (c == eINSIDE) {
+            visit_subtree(index, visit);
+            continue;
+        }
+        if (n.count) {
+            for (uint32_t o = n.offset; o < n.offset + n.count; ++o)
+                if (classify_frustum_aabb_naive(f, m_objects[o]->bv) != eOUTSIDE)
+                    visit(*m_objects[o]);
+            continue;
+        }
+        stack.push_back(n.offset);
+        stack.push_back(index + 1);
+    }
+}
+
+/**
+ * @brief
+ * 	Calls visit(obj) for every object whose bv overlaps region
+ */
+template<typename T>
+template<typename F>
+void bvh<T>::query(aabb const& region, F&& visit) const
+{
+    if (m_nodes.empty())
+        return;
+
+    std::vector<uint32_t> stack{ 0u };
+    while (!stack.empty()) {
+        node const& n = m_nodes[stack.back()];
+        uint32_t    index = stack.back();
+        stack.pop_back();
+        if (!overlap_aabb_aabb(n.min, n.max, region.min, region.max))
+            continue;
+        if (n.count) {
+            for (uint32_t o = n.offset; o < n.offset + n.count; ++o)
+                if (overlap_aabb_aabb(m_objects[o]->bv.min, m_objects[o]->bv.max, region.min, region.max))
+                    visit(*m_objects[o]);
+            continue;
+        }
+        stack.push_back(n.offset);
+        stack.push_back(index + 1);
+    }
+}
+
+/**
+ * @brief
+ * 	Closest hit before tmax. intersect(obj, tmax) returns the hit time of
+ * 	the ray with the object or a negative value. Children are visited near
+ * 	first and skipped once they start after the closest hit.
+ */
+template<typename T>
+template<typename F>
+typename bvh<T>::hit bvh<T>::raycast(vec3 const& origin, vec3 const& dir, float tmax, F&& intersect) const
+{
+    hit result;
+    if (m_nodes.empty())
+        return result;
+
+    vec3 inv = 1.0f / dir;
+    if (intersection_time_ray_box(origin, inv, m_nodes[0].min, m_nodes[0].max, tmax) < 0.0f)
+        return result;
+
+    std::vector<std::pair<float, uint32_t>> stack{ { 0.0f, 0u } };
+    while (!stack.empty()) {
+        auto [t, index] = stack.back();
+        stack.pop_back();
+        if (t > tmax)
+            continue;
+
+        node const& n = m_nodes[index];
+        if (n.count) {
+            for (uint32_t o = n.offset; o < n.offset + n.count; ++o) {
+                float hit_t = intersect(*m_objects[o], tmax);
+                if (hit_t >= 0.0f && hit_t <= tmax) {
+                    tmax          = hit_t;
+                    result.object = m_objects[o];
+                    result.t      = hit_t;
+                }
+            }
+            continue;
+        }
+
+        uint32_t near = index + 1, far = n.offset;
+        if (dir[n.axis] < 0.0f)
+            std::swap(near, far);
+        float tnear = intersection_time_ray_box(origin, inv, m_nodes[near].min, m_nodes[near].max, tmax);
+        float tfar  = intersection_time_ray_box(origin, inv, m_nodes[far].min, m_nodes[far].max, tmax);
+        if (tfar >= 0.0f)
+            stack.emplace_back(tfar, far);
+        if (tnear >= 0.0f)
+            stack.emplace_back(tnear, near);
+    }
+    return result;
+}
+
+/**
+ * @brief
+ * 	Closest object bv hit before tmax
+ */
+template<typename T>
+typename bvh<T>::hit bvh<T>::raycast(vec3 const& origin, vec3 const& dir, float tmax) const
+{
+    vec3 inv = 1.0f / dir;
+    return raycast(origin, dir, tmax, [&](T const& obj, float t) { return intersection_time_ray_box(origin, inv, obj.bv.min, obj.bv.max, t); });
+}
+
+/**
+ * @brief
+ * 	The k objects whose bv is nearest to point, nearest first. Nodes are
+ * 	visited best first and the search stops once the next one is farther
+ * 	than the k-th object found.
+ */
+template<typename T>
+void bvh<T>::nearest(vec3 const& point, unsigned k, std::vector<T*>& out, float max_distance) const
+{
+    out.clear();
+    if (m_nodes.empty() || k == 0)
+        return;
+
+    using entry = std::pair<float, uint32_t>;
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> open;
+    std::vector<std::pair<float, T*>>                                   best; // Max heap of the k nearest
+    float                                                               bound = max_distance * max_distance;
+
+    open.emplace(sq_distance_point_box(point, m_nodes[0].min, m_nodes[0].max), 0u);
+    while (!open.empty() && open.top().first <= bound) {
+        node const& n = m_nodes[open.top().second];
+        uint32_t    index = open.top().second;
+        open.pop();
+
+        if (n.count) {
+            for (uint32_t o = n.offset; o < n.offset + n.count; ++o) {
+                float d = sq_distance_point_box(point, m_objects[o]->bv.min, m_objects[o]->bv.max);
+                if (d > bound)
+                    continue;
+                best.emplace_back(d, m_objects[o]);
+                std::push_heap(best.begin(), best.end());
+                if (best.size() > k) {
+                    std::pop_heap(best.begin(), best.end());
+                    best.pop_back();
+                }
+                if (best.size() == k)
+                    bound = best.front().first;
+            }
+            continue;
+        }
+        for (uint32_t child : { index + 1, n.offset })
+            if (float d = sq_distance_point_box(point, m_nodes[child].min, m_nodes[child].max); d <= bound)
+                open.emplace(d, child);
+    }
+
+    std::sort_heap(best.begin(), best.end());
+    for (auto const& [d, obj] : best)
+        out.push_back(obj);
+}
+
+#endif
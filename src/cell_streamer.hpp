@@ -0,0 +1,425 @@
+#ifndef _CELL_STREAMER__HPP_
+#define _CELL_STREAMER__HPP_
+
+#include "octree.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief
+ * 	Parameters of the cell streaming. Cells are the octree nodes at
+ * 	cell_level, whose bounds come from LocationalCode::compute_bv.
+ */
+struct streaming_config
+{
+    unsigned    root_size       = 1024;
+    unsigned    cell_level      = 2;
+    float       load_radius     = 150.0f; // Cells closer than this are paged in
+    float       required_radius = 20.0f;  // Cells closer than this must be resident, the caller stalls on them
+    float       prefetch_time   = 1.0f;   // Seconds of camera motion to look ahead
+    std::size_t budget_bytes    = 64u << 20;
+    unsigned    workers         = 2;      // 0 loads synchronously on the calling thread
+};
+
+struct streaming_stats
+{
+    std::size_t resident_bytes      = 0;
+    unsigned    resident_cells      = 0;
+    unsigned    pending_cells       = 0;
+    unsigned    page_ins            = 0;
+    unsigned    page_outs           = 0;
+    unsigned    failed_cells        = 0;
+    float       page_ins_per_second = 0.0f;
+    float       stall_ms            = 0.0f; // Last update
+    float       total_stall_ms      = 0.0f;
+};
+
+/**
+ * @brief
+ * 	Pages cells in and out around a moving camera. Payloads are produced by
+ * 	load() on worker threads, then handed to page_in() on the thread calling
+ * 	update(), which returns the bytes the cell keeps resident. Resident
+ * 	cells form an LRU cache bounded by the budget, cells wanted this frame
+ * 	are never evicted.
+ * @tparam Payload
+ */
+template<typename Payload>
+class cell_streamer
+{
+public:
+    using load_fn     = std::function<Payload(unsigned cell)>;
+    using page_in_fn  = std::function<std::size_t(unsigned cell, Payload& payload)>;
+    using page_out_fn = std::function<void(unsigned cell)>;
+
+    cell_streamer(streaming_config const& config, std::vector<unsigned> const& cells, load_fn load, page_in_fn page_in, page_out_fn page_out);
+    ~cell_streamer();
+    cell_streamer(cell_streamer const& rhs) = delete;
+    cell_streamer& operator=(cell_streamer const& rhs) = delete;
+
+    void update(vec3 const& camera_position, float dt);
+    void evict_all();
+
+    [[nodiscard]] bool is_resident(unsigned cell) const;
+    [[nodiscard]] streaming_stats const& stats() const { return m_stats; }
+    [[nodiscard]] streaming_config const& config() const { return m_config; }
+
+private:
+    enum class state : unsigned char { unloaded, pending, resident, failed };
+
+    struct cell
+    {
+        aabb     bv;
+        state    status    = state::unloaded;
+        unsigned last_used = 0;
+        std::size_t bytes  = 0;
+    };
+
+    struct completed_load
+    {
+        unsigned cell;
+        Payload  payload;
+        bool     failed;
+    };
+
+    void worker();
+    void submit(std::vector<std::pair<float, unsigned>> const& wanted);
+    void wait_for(unsigned cell);
+    void page_in_completed();
+    void evict_to_budget();
+    void page_out(unsigned code, cell& c);
+
+    streaming_config m_config;
+    load_fn          m_load;
+    page_in_fn       m_page_in;
+    page_out_fn      m_page_out;
+    streaming_stats  m_stats;
+
+    // Main thread only
+    std::unordered_map<unsigned, cell> m_cells;
+    vec3     m_prev_position{};
+    bool     m_has_prev = false;
+    unsigned m_frame    = 0;
+    float    m_window_time     = 0.0f;
+    unsigned m_window_page_ins = 0;
+
+    // Shared with the workers
+    std::mutex                  m_mutex;
+    std::condition_variable     m_work_cv;
+    std::condition_variable     m_done_cv;
+    std::deque<unsigned>        m_queue;
+    std::vector<completed_load> m_completed;
+    bool                        m_quit = false;
+    std::vector<std::thread>    m_workers;
+};
+
+template<typename Payload>
+cell_streamer<Payload>::cell_streamer(streaming_config const& config, std::vector<unsigned> const& cells, load_fn load, page_in_fn page_in, page_out_fn page_out)
+    : m_config(config), m_load(std::move(load)), m_page_in(std::move(page_in)), m_page_out(std::move(page_out))
+{
+    for (unsigned code : cells)
+        m_cells[code].bv = LocationalCode::compute_bv(code, static_cast<float>(m_config.root_size));
+
+    for (unsigned i = 0; i < m_config.workers; ++i)
+        m_workers.emplace_back(&cell_streamer::worker, this);
+}
+
+template<typename Payload>
+cell_streamer<Payload>::~cell_streamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_work_cv.notify_all();
+    for (auto& w : m_workers)
+        w.join();
+}
+
+template<typename Payload>
+void cell_streamer<Payload>::worker()
+{
+    for (;;)
+    {
+        unsigned code = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_cv.wait(lock, [this]() { return m_quit || !m_queue.empty(); });
+            if (m_quit)
+                return;
+            code = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        completed_load done{ code, Payload{}, false };
+        try
+        {
+            done.payload = m_load(code);
+        }
+        catch (...)
+        {
+            done.failed = true;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_completed.push_back(std::move(done));
+        }
+        m_done_cv.notify_all();
+    }
+}
+
+/**
+ * @brief
+ * 	Pages in what the workers finished, evicts down to the budget and
+ * 	schedules the cells around the camera and along its motion. Blocks
+ * 	until the cells within required_radius are resident.
+ */
+template<typename Payload>
+void cell_streamer<Payload>::update(vec3 const& camera_position, float dt)
+{
+    ++m_frame;
+
+    vec3 velocity = m_has_prev && dt > 0.0f ? (camera_position - m_prev_position) / dt : vec3(0.0f);
+    vec3 ahead    = camera_position + velocity * m_config.prefetch_time;
+    m_prev_position = camera_position;
+    m_has_prev      = true;
+
+    page_in_completed();
+
+    auto distance_to = [](vec3 const& p, aabb const& bv) {
+        return glm::length(p - glm::clamp(p, bv.min, bv.max));
+    };
+
+    // Cells around the camera now and where it is heading
+    std::vector<std::pair<float, unsigned>> wanted;
+    std::vector<unsigned>                   required;
+    for (auto& [code, c] : m_cells)
+    {
+        float d       = distance_to(camera_position, c.bv);
+        float d_ahead = distance_to(ahead, c.bv);
+        if (d > m_config.load_radius && d_ahead > m_config.load_radius)
+            continue;
+
+        c.last_used = m_frame;
+        if (d <= m_config.required_radius)
+            required.push_back(code);
+        if (c.status == state::unloaded || c.status == state::pending)
+            wanted.emplace_back(std::min(d, d_ahead), code);
+    }
+    std::sort(wanted.begin(), wanted.end());
+
+    // Stall on what must be drawn this frame
+    auto stall_start = std::chrono::high_resolution_clock::now();
+    for (unsigned code : required)
+        if (m_cells[code].status == state::unloaded || m_cells[code].status == state::pending)
+            wait_for(code);
+    m_stats.stall_ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - stall_start).count();
+    m_stats.total_stall_ms += m_stats.stall_ms;
+
+    evict_to_budget();
+    submit(wanted);
+
+    // Stats
+    m_window_time += dt;
+    if (m_window_time >= 1.0f)
+    {
+        m_stats.page_ins_per_second = m_window_page_ins / m_window_time;
+        m_window_time               = 0.0f;
+        m_window_page_ins           = 0;
+    }
+    m_stats.resident_cells = 0;
+    m_stats.pending_cells  = 0;
+    for (auto const& it : m_cells)
+    {
+        m_stats.resident_cells += it.second.status == state::resident;
+        m_stats.pending_cells += it.second.status == state::pending;
+    }
+}
+
+/**
+ * @brief
+ * 	Rebuilds the load queue in priority order. Queued cells that are no
+ * 	longer wanted are dropped, new ones are only added under the budget.
+ */
+template<typename Payload>
+void cell_streamer<Payload>::submit(std::vector<std::pair<float, unsigned>> const& wanted)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::unordered_set<unsigned> queued(m_queue.begin(), m_queue.end());
+        std::unordered_set<unsigned> keep;
+
+        m_queue.clear();
+        for (auto const& [priority, code] : wanted)
+        {
+            cell& c = m_cells[code];
+            if (c.status == state::pending && queued.count(code))
+            {
+                m_queue.push_back(code);
+                keep.insert(code);
+            }
+            else if (c.status == state::unloaded && m_stats.resident_bytes < m_config.budget_bytes)
+            {
+                c.status = state::pending;
+                m_queue.push_back(code);
+            }
+        }
+        for (unsigned code : queued)
+            if (!keep.count(code))
+                m_cells[code].status = state::unloaded;
+    }
+
+    if (m_workers.empty())
+    {
+        while (!m_queue.empty())
+        {
+            unsigned code = m_queue.front();
+            m_queue.pop_front();
+            wait_for(code);
+        }
+    }
+    else
+        m_work_cv.notify_all();
+}
+
+/**
+ * @brief
+ * 	Moves a cell to the front of the queue and blocks until it is resident
+ */
+template<typename Payload>
+void cell_streamer<Payload>::wait_for(unsigned code)
+{
+    if (m_workers.empty())
+    {
+        completed_load done{ code, Payload{}, false };
+        try
+        {
+            done.payload = m_load(code);
+        }
+        catch (...)
+        {
+            done.failed = true;
+        }
+        m_completed.push_back(std::move(done));
+        m_cells[code].status = state::pending;
+        page_in_completed();
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto it     = std::find(m_queue.begin(), m_queue.end(), code);
+        bool queued = it != m_queue.end();
+        if (queued)
+            m_queue.erase(it);
+        if (queued || m_cells[code].status == state::unloaded)
+        {
+            m_queue.push_front(code);
+            m_cells[code].status = state::pending;
+            m_work_cv.notify_one();
+        }
+
+        m_done_cv.wait(lock, [&]() {
+            return std::any_of(m_completed.begin(), m_completed.end(), [code](completed_load const& l) { return l.cell == code; });
+        });
+    }
+    page_in_completed();
+}
+
+template<typename Payload>
+void cell_streamer<Payload>::page_in_completed()
+{
+    std::vector<completed_load> completed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        completed.swap(m_completed);
+    }
+
+    for (auto& done : completed)
+    {
+        cell& c = m_cells[done.cell];
+        if (done.failed)
+        {
+            c.status = state::failed;
+            m_stats.failed_cells++;
+            continue;
+        }
+
+        c.bytes     = m_page_in(done.cell, done.payload);
+        c.status    = state::resident;
+        c.last_used = m_frame;
+        m_stats.resident_bytes += c.bytes;
+        m_stats.page_ins++;
+        m_window_page_ins++;
+    }
+}
+
+template<typename Payload>
+void cell_streamer<Payload>::page_out(unsigned code, cell& c)
+{
+    m_page_out(code);
+    m_stats.resident_bytes -= c.bytes;
+    m_stats.page_outs++;
+    c.bytes  = 0;
+    c.status = state::unloaded;
+}
+
+/**
+ * @brief
+ * 	Least recently used first, never the cells wanted this frame
+ */
+template<typename Payload>
+void cell_streamer<Payload>::evict_to_budget()
+{
+    while (m_stats.resident_bytes > m_config.budget_bytes)
+    {
+        unsigned victim = 0;
+        cell*    lru    = nullptr;
+        for (auto& [code, c] : m_cells)
+            if (c.status == state::resident && c.last_used < m_frame && (!lru || c.last_used < lru->last_used))
+            {
+                victim = code;
+                lru    = &c;
+            }
+        if (!lru)
+            return;
+        page_out(victim, *lru);
+    }
+}
+
+/**
+ * @brief
+ * 	Pages out every resident cell and drops the queued loads
+ */
+template<typename Payload>
+void cell_streamer<Payload>::evict_all()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (unsigned code : m_queue)
+            m_cells[code].status = state::unloaded;
+        m_queue.clear();
+    }
+    for (auto& [code, c] : m_cells)
+        if (c.status == state::resident)
+            page_out(code, c);
+    m_stats.resident_cells = 0;
+}
+
+template<typename Payload>
+bool cell_streamer<Payload>::is_resident(unsigned cell) const
+{
+    auto it = m_cells.find(cell);
+    return it != m_cells.end() && it->second.status == state::resident;
+}
+
+#endif
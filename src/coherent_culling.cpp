@@ -0,0 +1,105 @@
+#include "coherent_culling.hpp"
+#include <cfloat>
+
+namespace {
+    // Accumulated motion is reset before it loses float precision
+    constexpr float max_accumulated_motion = 1.0e4f;
+}
+
+float frustum_aabb_slack(frustrum const& f, aabb const& bv, eResult result)
+{
+    if (result == eOVERLAPPING)
+        return 0.0f;
+
+    vec3  c     = (bv.min + bv.max) * 0.5f;
+    vec3  h     = bv.max - c;
+    float slack = result == eINSIDE ? FLT_MAX : 0.0f;
+    for (unsigned i = 0; i < 6; ++i) {
+        float s = glm::dot(f.mplanes[i].n, c) - f.mplanes[i].d;
+        float r = glm::dot(glm::abs(f.mplanes[i].n), h);
+        if (result == eINSIDE)
+            slack = glm::min(slack, -(s + r)); // Inside every plane
+        else
+            slack = glm::max(slack, s - r); // Outside one plane is enough
+    }
+    return glm::max(slack, 0.0f);
+}
+
+/**
+ * @brief
+ * 	Bounds how far the planes moved since the previous frame. eye must be
+ * 	the apex of f, every plane keeps a constant offset from it unless the
+ * 	projection changes, which is accounted as translation.
+ */
+void coherent_culler::begin_frame(frustrum const& f, vec3 const& eye)
+{
+    m_stats = {};
+    if (m_frustum && config.enabled) {
+        float travel = glm::length(eye - m_eye);
+        float offset = 0.0f;
+        for (unsigned i = 0; i < 6; ++i) {
+            plane const& from = m_frustum->mplanes[i];
+            plane const& to   = f.mplanes[i];
+            m_stats.rotation  = glm::max(m_stats.rotation, glm::length(to.n - from.n));
+            offset            = glm::max(offset, glm::abs((glm::dot(to.n, eye) - to.d) - (glm::dot(from.n, m_eye) - from.d)));
+        }
+        m_stats.translation = travel + offset;
+        m_motion.rotation += m_stats.rotation;
+        m_motion.translation += m_stats.translation;
+        m_motion.travel += travel;
+    }
+
+    if (!m_frustum || !config.enabled || m_stats.translation > config.max_translation || m_stats.rotation > config.max_rotation ||
+        m_motion.translation > max_accumulated_motion || m_motion.travel > max_accumulated_motion) {
+        m_entries.clear();
+        m_epoch++;
+        m_motion      = {};
+        m_stats.reset = config.enabled;
+    }
+    m_frustum = f;
+    m_eye     = eye;
+}
+
+/**
+ * @brief
+ * 	Same result as classify_frustum_aabb_naive for the frustum of the
+ * 	current frame
+ */
+eResult coherent_culler::classify(unsigned loc, aabb const& cell)
+{
+    if (!config.enabled) {
+        m_stats.tested++;
+        return classify_frustum_aabb_naive(*m_frustum, cell);
+    }
+    return classify(m_entries[loc], cell);
+}
+
+/**
+ * @brief
+ * 	Same, for a box that keeps its cache entry itself
+ */
+eResult coherent_culler::classify(entry& cached, aabb const& bv)
+{
+    if (config.enabled && cached.epoch == m_epoch) {
+        float rotation = m_motion.rotation - cached.tested_at.rotation;
+        float distance = cached.distance + m_motion.travel - cached.tested_at.travel;
+        if (rotation * distance + m_motion.translation - cached.tested_at.translation < cached.slack) {
+            m_stats.reused++;
+            return cached.result;
+        }
+    }
+
+    m_stats.tested++;
+    eResult result = classify_frustum_aabb_naive(*m_frustum, bv);
+    vec3    farthest = glm::max(glm::abs(bv.min - m_eye), glm::abs(bv.max - m_eye));
+    cached           = { m_epoch, result, frustum_aabb_slack(*m_frustum, bv, result), glm::length(farthest), m_motion };
+    return result;
+}
+
+void coherent_culler::clear()
+{
+    m_frustum.reset();
+    m_entries.clear();
+    m_epoch++;
+    m_motion = {};
+}
@@ -0,0 +1,89 @@
+#ifndef _COHERENT_CULLING__HPP_
+#define _COHERENT_CULLING__HPP_
+
+#include "geometry.hpp"
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+/**
+ * @brief
+ * 	Frame to frame coherent frustum culling of octree cells. A cell
+ * 	classified as inside or outside remembers its distance to the frustum
+ * 	boundary. Between frames a plane turns and slides by a bounded amount,
+ * 	so a point at distance R from the eye changes its signed distance by at
+ * 	most rotation * R + translation. The cached result stays valid until
+ * 	the motion accumulated since the test could have covered that distance.
+ * 	Only cells near the boundary and straddling cells are tested again.
+ * 	Large camera motion, such as a teleport, drops the cache and culls from
+ * 	scratch.
+ *
+ * 	Cells are cached by locational code. Their bounds only depend on it,
+ * 	so the cache survives objects and nodes being added or removed, but not
+ * 	a new root size. Objects keep their entry themselves, like the octree
+ * 	links, and must reset it when their bounds change.
+ */
+class coherent_culler
+{
+public:
+    struct settings
+    {
+        bool  enabled         = true;
+        float max_translation = 32.0f; // Per frame, in world units, above which the cache is dropped
+        float max_rotation    = 0.2f; // Per frame, change of the plane normals
+    };
+
+    struct stats
+    {
+        int   tested      = 0; // Cells classified against the frustum
+        int   reused      = 0; // Cells that kept their cached result
+        bool  reset       = false;
+        float rotation    = 0.0f; // Motion bound since the last frame
+        float translation = 0.0f;
+    };
+
+    // Motion accumulated since the last reset
+    struct motion
+    {
+        float rotation    = 0.0f; // Sum of the largest normal change of every frame
+        float translation = 0.0f; // Sum of the eye and plane offset changes
+        float travel      = 0.0f; // Sum of the eye displacements
+    };
+
+    struct entry
+    {
+        uint32_t epoch    = 0; // Reset the entry was tested in, 0 if never
+        eResult  result   = eOVERLAPPING;
+        float    slack    = 0.0f; // Distance to the boundary when tested
+        float    distance = 0.0f; // Farthest point of the box from the eye when tested
+        motion   tested_at;
+    };
+
+    void    begin_frame(frustrum const& f, vec3 const& eye);
+    eResult classify(unsigned loc, aabb const& cell);
+    eResult classify(entry& cached, aabb const& bv);
+    void    clear();
+
+    settings config;
+
+    [[nodiscard]] stats const&    frame_stats() const { return m_stats; }
+    [[nodiscard]] frustrum const& current() const { return *m_frustum; } // Of the last begin_frame
+    [[nodiscard]] std::size_t  size() const { return m_entries.size(); }
+
+private:
+    std::optional<frustrum>             m_frustum;
+    vec3                                m_eye   = {};
+    uint32_t                            m_epoch = 1;
+    motion                              m_motion;
+    std::unordered_map<unsigned, entry> m_entries; // Cells
+    stats                               m_stats;
+};
+
+/**
+ * @brief
+ * 	How far the planes of f can move before the classification of bv can
+ * 	change. 0 for straddling boxes.
+ */
+float frustum_aabb_slack(frustrum const& f, aabb const& bv, eResult result);
+
+#endif
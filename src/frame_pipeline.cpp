@@ -0,0 +1,109 @@
+#include "frame_pipeline.hpp"
+
+frame_pipeline::frame_pipeline(bool pipelined)
+{
+    set_pipelined(pipelined);
+}
+
+frame_pipeline::~frame_pipeline()
+{
+    set_pipelined(false);
+}
+
+/**
+ * @brief
+ * 	Waits for the previous job if its result was not taken, then starts
+ * 	job
+ */
+void frame_pipeline::start(std::function<void()> job)
+{
+    wait();
+    m_pending    = true;
+    m_start_time = clock::now();
+
+    if (!pipelined()) {
+        job();
+        m_job_ms = std::chrono::duration<float, std::milli>(clock::now() - m_start_time).count();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job  = std::move(job);
+        m_busy = true;
+    }
+    m_work_cv.notify_one();
+}
+
+/**
+ * @brief
+ * 	Blocks until the started job is done. False if no job was started
+ * 	since the last call.
+ */
+bool frame_pipeline::wait()
+{
+    if (!m_pending)
+        return false;
+
+    auto wait_start = clock::now();
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done_cv.wait(lock, [this]() { return !m_busy; });
+    }
+    auto now = clock::now();
+
+    m_pending              = false;
+    m_stats.job_ms         = m_job_ms;
+    m_stats.wait_ms        = std::chrono::duration<float, std::milli>(now - wait_start).count();
+    m_stats.latency_ms     = std::chrono::duration<float, std::milli>(now - m_start_time).count();
+    m_stats.latency_frames = pipelined() ? 1 : 0;
+    return true;
+}
+
+/**
+ * @brief
+ * 	Starts or stops the worker, a job in flight is finished first
+ */
+void frame_pipeline::set_pipelined(bool pipelined)
+{
+    if (pipelined == this->pipelined())
+        return;
+
+    if (!pipelined) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done_cv.wait(lock, [this]() { return !m_busy; });
+            m_quit = true;
+        }
+        m_work_cv.notify_one();
+        m_worker.join();
+        m_quit = false;
+    }
+    else
+        m_worker = std::thread(&frame_pipeline::worker, this);
+}
+
+void frame_pipeline::worker()
+{
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_cv.wait(lock, [this]() { return m_quit || m_busy; });
+            if (m_quit)
+                return;
+            job = std::move(m_job);
+        }
+
+        auto start = clock::now();
+        job();
+        float ms = std::chrono::duration<float, std::milli>(clock::now() - start).count();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_job_ms = ms;
+            m_busy   = false;
+        }
+        m_done_cv.notify_all();
+    }
+}
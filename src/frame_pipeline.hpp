@@ -0,0 +1,64 @@
+#ifndef _FRAME_PIPELINE__HPP_
+#define _FRAME_PIPELINE__HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+struct frame_pipeline_stats
+{
+    float    job_ms         = 0.0f; // Duration of the last completed job
+    float    wait_ms        = 0.0f; // Time wait() blocked for it
+    float    latency_ms     = 0.0f; // From start() to the wait() that handed its result
+    unsigned latency_frames = 0;    // Frames the result is presented late
+};
+
+/**
+ * @brief
+ * 	Runs the work for the next frame, such as culling, on a worker thread
+ * 	while the calling thread submits the current one. start() hands over
+ * 	one job, wait() blocks until it is done so its result can be swapped
+ * 	in. Between wait() and the next start() the worker is idle, which is
+ * 	where the data it reads can be modified.
+ *
+ * 	When not pipelined, start() runs the job right away on the calling
+ * 	thread and results are presented in the same frame.
+ */
+class frame_pipeline
+{
+public:
+    explicit frame_pipeline(bool pipelined = true);
+    ~frame_pipeline();
+    frame_pipeline(frame_pipeline const&)            = delete;
+    frame_pipeline& operator=(frame_pipeline const&) = delete;
+
+    void start(std::function<void()> job);
+    bool wait();
+    void set_pipelined(bool pipelined);
+
+    [[nodiscard]] bool                        pipelined() const { return m_worker.joinable(); }
+    [[nodiscard]] frame_pipeline_stats const& stats() const { return m_stats; }
+
+private:
+    using clock = std::chrono::high_resolution_clock;
+
+    void worker();
+
+    frame_pipeline_stats m_stats;
+    bool                 m_pending = false; // A job was started and its result not handed yet
+    clock::time_point    m_start_time;
+
+    // Shared with the worker
+    std::mutex              m_mutex;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_done_cv;
+    std::function<void()>   m_job;
+    bool                    m_busy = false;
+    bool                    m_quit = false;
+    float                   m_job_ms = 0.0f;
+    std::thread             m_worker;
+};
+
+#endif
@@ -1,11 +1,55 @@
 #include "geometry.hpp"
 #include <algorithm>
+#include <cfloat>
 
 glm::vec3 closest_point_plane(const vec3& point, const vec3& plane_normal, const float point_dot_normal) {
 	float distance = glm::dot(plane_normal, point) - point_dot_normal;
 	return point - distance * plane_normal;
 }
 
+/**
+ * @brief
+ * 	Closest point of triangle abc to point, by the Voronoi region of the
+ * 	triangle the point is in (Ericson, Real-Time Collision Detection 5.1.5)
+ */
+glm::vec3 closest_point_triangle(const vec3& point, const vec3& a, const vec3& b, const vec3& c) {
+	vec3 ab = b - a;
+	vec3 ac = c - a;
+	vec3 ap = point - a;
+	float d1 = dot(ab, ap);
+	float d2 = dot(ac, ap);
+	if (d1 <= 0.0f && d2 <= 0.0f) // Vertex a
+		return a;
+
+	vec3 bp = point - b;
+	float d3 = dot(ab, bp);
+	float d4 = dot(ac, bp);
+	if (d3 >= 0.0f && d4 <= d3) // Vertex b
+		return b;
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) // Edge ab
+		return a + ab * (d1 / (d1 - d3));
+
+	vec3 cp = point - c;
+	float d5 = dot(ab, cp);
+	float d6 = dot(ac, cp);
+	if (d6 >= 0.0f && d5 <= d6) // Vertex c
+		return c;
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) // Edge ac
+		return a + ac * (d2 / (d2 - d6));
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) // Edge bc
+		return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+	// Inside the face
+	float denom = 1.0f / (va + vb + vc);
+	return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
 glm::vec3 closest_segment_segment(const vec3& p1, const vec3& q1, const vec3& p2, const vec3& q2, glm::vec3* result1, glm::vec3* result2) {
 	vec3 v = q1 - p1; // Segment A dir
 	vec3 w = q2 - p2; // Segment B dir
@@ -103,6 +147,39 @@ bool overlap_aabb_aabb(const vec3& aabb1_min, const vec3& aabb1_max, const vec3&
 		aabb1_max.x >= aabb2_min.x && aabb1_max.y >= aabb2_min.y && aabb1_max.z >= aabb2_min.z;
 }
 
+/**
+ * @brief
+ * 	Separating axis test (Akenine-Moller): the box axes, the triangle
+ * 	normal and the cross products of the edges with the box axes
+ */
+bool overlap_triangle_aabb(const vec3& a, const vec3& b, const vec3& c, const vec3& aabb_min, const vec3& aabb_max) {
+	vec3 center = (aabb_min + aabb_max) * 0.5f;
+	vec3 extent = (aabb_max - aabb_min) * 0.5f;
+	vec3 v[3] = { a - center, b - center, c - center };
+
+	// Box axes
+	for (int i = 0; i < 3; ++i)
+		if (std::min({ v[0][i], v[1][i], v[2][i] }) > extent[i] || std::max({ v[0][i], v[1][i], v[2][i] }) < -extent[i])
+			return false;
+
+	// Edges against the box axes
+	vec3 edges[3] = { v[1] - v[0], v[2] - v[1], v[0] - v[2] };
+	for (const vec3& e : edges)
+		for (int i = 0; i < 3; ++i) {
+			vec3 axis(0.0f);
+			axis[(i + 1) % 3] = -e[(i + 2) % 3];
+			axis[(i + 2) % 3] = e[(i + 1) % 3];
+			float p0 = dot(v[0], axis), p1 = dot(v[1], axis), p2 = dot(v[2], axis);
+			float r = dot(extent, abs(axis));
+			if (std::min({ p0, p1, p2 }) > r || std::max({ p0, p1, p2 }) < -r)
+				return false;
+		}
+
+	// Triangle plane
+	vec3 n = cross(edges[0], edges[1]);
+	return std::abs(dot(n, v[0])) <= dot(extent, abs(n));
+}
+
 bool overlap_sphere_sphere(const vec3& sphere1_center, const float sphere1_radius, const vec3& sphere2_center, const float sphere2_radius) {
 	return distance(sphere1_center, sphere2_center) <= (sphere1_radius + sphere2_radius);
 }
@@ -204,32 +281,126 @@ float intersection_time_ray_sphere(const vec3& rayorigin, const vec3& raydir, co
 }
 
 float intersection_time_ray_triangle(const vec3& rayorigin, const vec3& raydir, const vec3& a, const vec3& b, const vec3& c) {
-	vec3 ab(b - a);
-	vec3 bc(c - b);
-	vec3 n = normalize(cross(ab, bc));
-
-	float d = dot(n, a);
-	float t = (d - dot(n, rayorigin)) / dot(n, raydir);
+	return intersection_time_ray_triangle(make_ray_triangle_setup(rayorigin, raydir), a, b, c);
+}
 
-	if (t < 0) // Behind ray
+/**
+ * @brief
+ * 	First time in [0, tmax] a sphere moving by displacement touches the
+ * 	box, -1 if it does not. The center has to enter the box rounded by
+ * 	radius: the boxes grown by radius along one axis, the cylinders around
+ * 	the edges and the spheres at the corners (Ericson, Real-Time Collision
+ * 	Detection 5.5.7). The box grown along every axis bounds them, where
+ * 	the center enters it through a face that is already the answer.
+ */
+float intersection_time_sphere_aabb(const vec3& sphere_center, const float sphere_radius, const vec3& displacement, const vec3& aabb_min, const vec3& aabb_max, float tmax) {
+	vec3 inv = 1.0f / displacement;
+	float t = intersection_time_ray_box(sphere_center, inv, aabb_min - sphere_radius, aabb_max + sphere_radius, tmax);
+	if (t < 0.0f)
 		return -1.0f;
 
-	vec3 point = rayorigin + raydir * t;
+	vec3 p = sphere_center + t * displacement;
+	int outside = 0;
+	for (int i = 0; i < 3; ++i)
+		outside += p[i] < aabb_min[i] || aabb_max[i] < p[i];
+	if (outside <= 1)
+		return t;
+
+	// Entered the grown box by an edge or corner region, the earliest of the rounded box parts
+	float best = -1.0f;
+	auto keep = [&](float h) {
+		if (h >= 0.0f && h <= tmax && (best < 0.0f || h < best))
+			best = h;
+	};
+	for (int i = 0; i < 3; ++i)
+	{
+		vec3 grow(0.0f);
+		grow[i] = sphere_radius;
+		keep(intersection_time_ray_box(sphere_center, inv, aabb_min - grow, aabb_max + grow, tmax));
+	}
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		vec3 c(corner & 1 ? aabb_max.x : aabb_min.x, corner & 2 ? aabb_max.y : aabb_min.y, corner & 4 ? aabb_max.z : aabb_min.z);
+		keep(intersection_time_ray_sphere(sphere_center, displacement, c, sphere_radius));
+	}
 
-	vec3 ap(point - a);
-	if (dot(n, cross(ab, ap)) < 0) // Outside ab segment
-		return -1.0f;
+	// Edge cylinders along axis k, without caps: those are inside the corner spheres
+	for (int k = 0; k < 3; ++k)
+	{
+		int u = (k + 1) % 3, v = (k + 2) % 3;
+		float a = displacement[u] * displacement[u] + displacement[v] * displacement[v];
+		if (a == 0.0f) // Along the edge, it can only come in through the corner spheres
+			continue;
+		for (int edge = 0; edge < 4; ++edge)
+		{
+			float ou = sphere_center[u] - (edge & 1 ? aabb_max[u] : aabb_min[u]);
+			float ov = sphere_center[v] - (edge & 2 ? aabb_max[v] : aabb_min[v]);
+			float b = ou * displacement[u] + ov * displacement[v];
+			float c = ou * ou + ov * ov - sphere_radius * sphere_radius;
+			float disc = b * b - a * c;
+			if (disc < 0.0f)
+				continue;
+			float h = c <= 0.0f ? 0.0f : (-b - std::sqrt(disc)) / a;
+			float z = sphere_center[k] + h * displacement[k];
+			if (aabb_min[k] <= z && z <= aabb_max[k])
+				keep(h);
+		}
+	}
+	return best;
+}
 
-	vec3 bp(point - b);
-	if (dot(n, cross(bc, bp)) < 0) // Outside bc segment
-		return -1.0f;
+/**
+ * @brief
+ * 	Permutes the axes so the ray goes fastest along z, keeping the
+ * 	winding, and precomputes the shear that makes it the +z axis
+ */
+ray_triangle_setup make_ray_triangle_setup(const vec3& rayorigin, const vec3& raydir) {
+	vec3 d = abs(raydir);
+	int kz = d.x > d.y ? (d.x > d.z ? 0 : 2) : (d.y > d.z ? 1 : 2);
+	int kx = (kz + 1) % 3;
+	int ky = (kx + 1) % 3;
+	if (raydir[kz] < 0.0f)
+		std::swap(kx, ky);
+
+	float inv = 1.0f / raydir[kz];
+	return { rayorigin, vec3(-raydir[kx] * inv, -raydir[ky] * inv, inv), kx, ky, kz };
+}
 
-	vec3 ca(a - c);
-	vec3 cp(point - c);
-	if (dot(n, cross(ca, cp)) < 0) // Outside ca segment
+/**
+ * @brief
+ * 	Watertight test (Woop, Benthin and Wald 2013): the triangle goes to
+ * 	the space where the ray is the +z axis and the 2D edge functions of
+ * 	the origin decide the hit. A ray through a shared edge or vertex hits
+ * 	at least one of the triangles. Both faces are hit.
+ */
+float intersection_time_ray_triangle(const ray_triangle_setup& ray, const vec3& a, const vec3& b, const vec3& c) {
+	vec3 A = a - ray.origin;
+	vec3 B = b - ray.origin;
+	vec3 C = c - ray.origin;
+
+	// Sheared so the ray is +z
+	float ax = A[ray.kx] + ray.shear.x * A[ray.kz];
+	float ay = A[ray.ky] + ray.shear.y * A[ray.kz];
+	float bx = B[ray.kx] + ray.shear.x * B[ray.kz];
+	float by = B[ray.ky] + ray.shear.y * B[ray.kz];
+	float cx = C[ray.kx] + ray.shear.x * C[ray.kz];
+	float cy = C[ray.ky] + ray.shear.y * C[ray.kz];
+
+	// Edge functions in double: the products are exact, so the sign of a shared edge is the same for both
+	// triangles even if the compiler fuses the multiply and subtract
+	double u = static_cast<double>(cx) * by - static_cast<double>(cy) * bx;
+	double v = static_cast<double>(ax) * cy - static_cast<double>(ay) * cx;
+	double w = static_cast<double>(bx) * ay - static_cast<double>(by) * ax;
+
+	// Outside if the edge functions differ in sign
+	if (std::min({ u, v, w }) < 0.0 && std::max({ u, v, w }) > 0.0)
+		return -1.0f;
+	double det = u + v + w;
+	if (det == 0.0) // Seen edge on
 		return -1.0f;
 
-	return t;
+	float t = static_cast<float>((u * A[ray.kz] + v * B[ray.kz] + w * C[ray.kz]) / det) * ray.shear.z;
+	return t >= 0.0f ? t : -1.0f;
 }
 
 eResult classify_frustum_sphere_naive(vec3 frustrumnormals[6], float frustrumplaned[6], vec3 spherepos, float radius) {
@@ -284,4 +455,41 @@ eResult classify_frustum_aabb_naive(const frustrum& f, const aabb& bv)
 	}
 
 	return overlapped ? eOVERLAPPING : eINSIDE;
-}
\ No newline at end of file
+}
+
+// Same as the aabb test, the projection radius sums the half axes projected on the normal
+eResult classify_plane_obb(const vec3& plane_normal, const float d, const obb& box)
+{
+	float s = dot(plane_normal, box.center) - d;
+	float r = std::abs(dot(plane_normal, box.half_axes[0])) + std::abs(dot(plane_normal, box.half_axes[1])) + std::abs(dot(plane_normal, box.half_axes[2]));
+	if (s > r)
+		return eOUTSIDE;
+	return s < -r ? eINSIDE : eOVERLAPPING;
+}
+
+// Tighter than the world aabb of a rotated object, for the objects whose aabb straddles f
+eResult classify_frustum_obb(const frustrum& f, const obb& box)
+{
+	bool overlapped = false;
+	for (unsigned i = 0; i < 6; ++i)
+	{
+		eResult result = classify_plane_obb(f.mplanes[i].n, f.mplanes[i].d, box);
+		if (result == eOUTSIDE)
+			return eOUTSIDE;
+		overlapped |= result == eOVERLAPPING;
+	}
+
+	return overlapped ? eOVERLAPPING : eINSIDE;
+}
+
+// Size in pixels of the screen projection of the bounding sphere of bv, measured
+// at its nearest depth so it never underestimates. FLT_MAX if the sphere reaches
+// the camera plane.
+float projected_extent_pixels(const aabb& bv, const mat4& view, const mat4& proj, const vec2& viewport) {
+	float radius = 0.5f * glm::length(bv.max - bv.min);
+	vec3 center = vec3(view * vec4(0.5f * (bv.min + bv.max), 1.0f));
+	float depth = -center.z - radius; // The camera looks down -z
+	if (depth <= 0.0f)
+		return FLT_MAX;
+	return radius / depth * glm::max(proj[0][0] * viewport.x, proj[1][1] * viewport.y);
+}
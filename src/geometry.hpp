@@ -3,6 +3,7 @@
 
 #include "math.hpp"
 #include "shapes.hpp"
+#include <algorithm>
 
 enum eResult
 {
@@ -12,6 +13,7 @@ enum eResult
 };
 
 glm::vec3 closest_point_plane(const vec3& point, const vec3& plane_normal, const float point_dot_normal);
+glm::vec3 closest_point_triangle(const vec3& point, const vec3& a, const vec3& b, const vec3& c);
 glm::vec3 closest_segment_segment(const vec3& p1, const vec3& q1, const vec3& p2, const vec3& q2, glm::vec3* result1, glm::vec3* result2);
 bool overlap_point_aabb(const vec3& point, const vec3& aabb_min, const vec3& aabb_max);
 bool overlap_point_sphere(const vec3& point, const vec3& sphere_center, const float sphere_radius);
@@ -20,13 +22,55 @@ eResult classify_plane_triangle(const vec3& plane_normal, const float planepos_d
 eResult classify_plane_aabb(const vec3& plane_normal, const float planepos_dot_planenormal, const vec3& aabb_min, const vec3& aabb_max);
 eResult classify_plane_sphere(const vec3& plane_normal, const float planepos_dot_planenormal, const vec3& sphere_center, const float sphere_radius);
 bool overlap_aabb_aabb(const vec3& aabb1_min, const vec3& aabb1_max, const vec3& aabb2_min, const vec3& aabb2_max);
+bool overlap_triangle_aabb(const vec3& a, const vec3& b, const vec3& c, const vec3& aabb_min, const vec3& aabb_max);
 bool overlap_sphere_sphere(const vec3& sphere1_center, const float sphere1_radius, const vec3& sphere2_center, const float sphere2_radius);
 float intersection_time_ray_plane(const vec3& rayorigin, const vec3& raydir, const vec3& planenormal, const float planenormal_dot_planepos);
 float intersection_time_ray_aabb(const vec3& rayorigin, const vec3& raydir, const vec3& aabb_min, const vec3& aabb_max);
 float intersection_time_ray_sphere(const vec3& rayorigin, const vec3& raydir, const vec3& sphere_center, const float sphere_radius);
 float intersection_time_ray_triangle(const vec3& rayorigin, const vec3& raydir, const vec3& a, const vec3& b, const vec3& c);
+float intersection_time_sphere_aabb(const vec3& sphere_center, const float sphere_radius, const vec3& displacement, const vec3& aabb_min, const vec3& aabb_max, float tmax = 1.0f);
+
+// Ray set up once for many watertight ray-triangle tests: kz is the axis the ray moves fastest along and the shear maps it to +z
+struct ray_triangle_setup
+{
+	vec3 origin;
+	vec3 shear; // -dir[kx] / dir[kz], -dir[ky] / dir[kz], 1 / dir[kz]
+	int kx, ky, kz;
+};
+ray_triangle_setup make_ray_triangle_setup(const vec3& rayorigin, const vec3& raydir);
+float intersection_time_ray_triangle(const ray_triangle_setup& ray, const vec3& a, const vec3& b, const vec3& c);
 eResult classify_frustum_sphere_naive(vec3 frustrumnormals[6], float frustrumplaned[6], vec3 spherepos, float radius);
 eResult classify_frustum_aabb_naive(vec3 frustrumnormals[6], float frustrumplaned[6], vec3 aabbmin, vec3 aabbmax);
 eResult classify_frustum_aabb_naive(const frustrum& f, const aabb& bv);
+eResult classify_plane_obb(const vec3& plane_normal, const float planepos_dot_planenormal, const obb& box);
+eResult classify_frustum_obb(const frustrum& f, const obb& box);
+float projected_extent_pixels(const aabb& bv, const mat4& view, const mat4& proj, const vec2& viewport);
+
+// Slab test with 1 / raydir precomputed: entry time, 0 if the origin is inside, -1 if missed before tmax
+template<glm::length_t L>
+float intersection_time_ray_box(const glm::vec<L, float>& rayorigin, const glm::vec<L, float>& raydir_inv, const glm::vec<L, float>& box_min, const glm::vec<L, float>& box_max, float tmax)
+{
+	float tmin = 0.0f;
+	for (glm::length_t i = 0; i < L; ++i)
+	{
+		float t1 = (box_min[i] - rayorigin[i]) * raydir_inv[i];
+		float t2 = (box_max[i] - rayorigin[i]) * raydir_inv[i];
+		tmin = std::max(tmin, std::min(t1, t2));
+		tmax = std::min(tmax, std::max(t1, t2));
+	}
+	return tmin <= tmax ? tmin : -1.0f;
+}
+
+template<glm::length_t L>
+float sq_distance_point_box(const glm::vec<L, float>& point, const glm::vec<L, float>& box_min, const glm::vec<L, float>& box_max)
+{
+	float result = 0.0f;
+	for (glm::length_t i = 0; i < L; ++i)
+	{
+		float d = std::max({ box_min[i] - point[i], 0.0f, point[i] - box_max[i] });
+		result += d * d;
+	}
+	return result;
+}
 
 #endif // __GEOMETRY_HPP__
@@ -0,0 +1,261 @@
+#ifndef _HASH_GRID__HPP_
+#define _HASH_GRID__HPP_
+
+#include "geometry.hpp"
+#include <bit>
+#include <cfloat>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief
+ * 	Uniform grid over objects with a world aabb bv, with the cells hashed
+ * 	into a table so the world needs no bounds. Meant for many moving
+ * 	objects of similar size: there is no hierarchy to maintain, every
+ * 	frame the objects are counting sorted into the table again by
+ * 	rebuild().
+ *
+ * 	An object is stored in every cell it overlaps, up to max_cells, and
+ * 	larger objects are kept in a list that every query tests. Each object
+ * 	has a home cell, the one of its min corner, the entries of a bucket
+ * 	start with the objects at home there and the bucket keeps their bounds
+ * 	for the frustum query. The objects are not owned and must outlive it.
+ */
+template<typename T>
+class hash_grid
+{
+public:
+    struct settings
+    {
+        float    cell_size = 4.0f;
+        unsigned max_cells = 8; // Objects over more cells are tested by every query
+    };
+
+    void build(std::span<T* const> objects, settings const& s = {});
+    void rebuild();
+    void clear();
+
+    template<typename F>
+    void query(aabb const& region, F&& visit) const;
+    template<typename F>
+    void frustum(frustrum const& f, F&& visit) const;
+
+    [[nodiscard]] std::span<T* const> objects() const { return m_objects; }
+    [[nodiscard]] float               cell_size() const { return m_settings.cell_size; }
+    [[nodiscard]] std::size_t         bucket_count() const { return m_buckets.empty() ? 0 : m_buckets.size() - 1; }
+    [[nodiscard]] std::size_t         entry_count() const { return m_entries.size(); }
+    [[nodiscard]] std::size_t         large_count() const { return m_large.size(); }
+    [[nodiscard]] std::size_t         memory() const
+    {
+        return m_buckets.capacity() * sizeof(bucket) + m_entries.capacity() * sizeof(entry) + m_bounds.capacity() * sizeof(aabb) +
+               m_objects.capacity() * sizeof(T*) + m_large.capacity() * sizeof(uint32_t) + m_ranges.capacity() * sizeof(m_ranges[0]) +
+               m_cursors.capacity() * sizeof(m_cursors[0]);
+    }
+
+private:
+    using cell = glm::ivec3;
+
+    struct bucket
+    {
+        vec3     min;   // Bounds of the objects at home here
+        uint32_t first; // Entries from first to the next bucket's first, homes first
+        vec3     max;
+        uint32_t homes;
+    };
+    static_assert(sizeof(bucket) == 32, "Two buckets per cache line");
+
+    struct entry
+    {
+        uint64_t key;
+        uint32_t object;
+    };
+
+    // 21 bits per axis, cells further than 2^20 from the origin are clamped
+    static constexpr int cell_bias = 1 << 20;
+
+    cell cell_of(vec3 const& p) const
+    {
+        return glm::clamp(cell(glm::floor(p * m_inv_cell_size)), cell(1 - cell_bias), cell(cell_bias - 1));
+    }
+    static uint64_t key_of(cell const& c)
+    {
+        return (static_cast<uint64_t>(c.x + cell_bias) << 42) | (static_cast<uint64_t>(c.y + cell_bias) << 21) |
+               static_cast<uint64_t>(c.z + cell_bias);
+    }
+    uint32_t bucket_of(uint64_t key) const { return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ull) >> m_hash_shift); }
+
+    template<typename F>
+    static void for_each_cell(cell const& lo, cell const& hi, F&& f)
+    {
+        for (int x = lo.x; x <= hi.x; ++x)
+            for (int y = lo.y; y <= hi.y; ++y)
+                for (int z = lo.z; z <= hi.z; ++z)
+                    f(cell(x, y, z));
+    }
+
+    settings                                   m_settings;
+    float                                      m_inv_cell_size = 1.0f;
+    unsigned                                   m_hash_shift    = 63;
+    std::vector<T*>                            m_objects;
+    std::vector<aabb>                          m_bounds;  // Copied at rebuild, queries do not touch the objects
+    std::vector<bucket>                        m_buckets; // One more than the table size, for the end of the last one
+    std::vector<entry>                         m_entries;
+    std::vector<uint32_t>                      m_large;
+    std::vector<std::pair<cell, cell>>         m_ranges;  // Cells of every object, for the rebuild
+    std::vector<std::pair<uint32_t, uint32_t>> m_cursors; // Next home and other entry of every bucket, for the rebuild
+};
+
+template<typename T>
+void hash_grid<T>::build(std::span<T* const> objects, settings const& s)
+{
+    m_settings      = s;
+    m_inv_cell_size = 1.0f / s.cell_size;
+    m_objects.assign(objects.begin(), objects.end());
+    rebuild();
+}
+
+/**
+ * @brief
+ * 	Sorts the objects into the table again from their current bounds. The
+ * 	table is sized to the number of entries, rounded up to a power of two.
+ */
+template<typename T>
+void hash_grid<T>::rebuild()
+{
+    std::size_t const count = m_objects.size();
+    m_bounds.resize(count);
+    m_ranges.resize(count);
+    m_large.clear();
+
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        m_bounds[i]      = m_objects[i]->bv;
+        cell lo          = cell_of(m_bounds[i].min);
+        cell hi          = cell_of(m_bounds[i].max);
+        cell extent      = hi - lo + 1;
+        std::size_t size = static_cast<std::size_t>(extent.x) * extent.y * extent.z;
+        if (size > m_settings.max_cells) {
+            m_large.push_back(static_cast<uint32_t>(i));
+            hi = lo - 1; // No cells
+            size = 0;
+        }
+        m_ranges[i] = { lo, hi };
+        total += size;
+    }
+
+    std::size_t table = std::bit_ceil(std::max<std::size_t>(total, 2));
+    m_hash_shift      = 64 - static_cast<unsigned>(std::countr_zero(table));
+    m_buckets.assign(table + 1, { vec3(FLT_MAX), 0, vec3(-FLT_MAX), 0 });
+
+    // Count, using first as the size until the prefix sum
+    for (std::size_t i = 0; i < count; ++i) {
+        auto const& [lo, hi] = m_ranges[i];
+        if (hi.x < lo.x)
+            continue;
+        for_each_cell(lo, hi, [&](cell const& c) { m_buckets[bucket_of(key_of(c))].first++; });
+        bucket& home = m_buckets[bucket_of(key_of(lo))];
+        home.homes++;
+        home.min = glm::min(home.min, m_bounds[i].min);
+        home.max = glm::max(home.max, m_bounds[i].max);
+    }
+    uint32_t offset = 0;
+    for (auto& b : m_buckets)
+        offset += std::exchange(b.first, offset);
+
+    // Homes and the other entries are written from two cursors per bucket
+    m_entries.resize(total);
+    m_cursors.resize(table);
+    for (std::size_t b = 0; b < table; ++b)
+        m_cursors[b] = { m_buckets[b].first, m_buckets[b].first + m_buckets[b].homes };
+    for (std::size_t i = 0; i < count; ++i) {
+        auto const& [lo, hi] = m_ranges[i];
+        for_each_cell(lo, hi, [&](cell const& c) {
+            uint64_t key = key_of(c);
+            uint32_t b   = bucket_of(key);
+            m_entries[c == lo ? m_cursors[b].first++ : m_cursors[b].second++] = { key, static_cast<uint32_t>(i) };
+        });
+    }
+}
+
+template<typename T>
+void hash_grid<T>::clear()
+{
+    m_objects.clear();
+    m_bounds.clear();
+    m_buckets.clear();
+    m_entries.clear();
+    m_large.clear();
+    m_ranges.clear();
+    m_cursors.clear();
+}
+
+/**
+ * @brief
+ * 	Calls visit(obj) for every object whose bv overlaps region. An object
+ * 	in several of the cells is reported from the one holding the min
+ * 	corner of its overlap with region. Regions over more cells than the
+ * 	table holds test every object instead.
+ */
+template<typename T>
+template<typename F>
+void hash_grid<T>::query(aabb const& region, F&& visit) const
+{
+    auto overlaps = [&](uint32_t i) { return overlap_aabb_aabb(m_bounds[i].min, m_bounds[i].max, region.min, region.max); };
+    for (uint32_t i : m_large)
+        if (overlaps(i))
+            visit(*m_objects[i]);
+    if (m_entries.empty())
+        return;
+
+    cell lo = cell_of(region.min), hi = cell_of(region.max), extent = hi - lo + 1;
+    if (static_cast<double>(extent.x) * extent.y * extent.z > static_cast<double>(bucket_count())) {
+        for (std::size_t b = 0; b < bucket_count(); ++b)
+            for (uint32_t e = m_buckets[b].first; e < m_buckets[b].first + m_buckets[b].homes; ++e)
+                if (overlaps(m_entries[e].object))
+                    visit(*m_objects[m_entries[e].object]);
+        return;
+    }
+
+    for_each_cell(lo, hi, [&](cell const& c) {
+        uint64_t      key = key_of(c);
+        bucket const& b   = m_buckets[bucket_of(key)];
+        for (uint32_t e = b.first; e < (&b + 1)->first; ++e) {
+            uint32_t i = m_entries[e].object;
+            if (m_entries[e].key != key || !overlaps(i))
+                continue;
+            if (key_of(cell_of(glm::max(m_bounds[i].min, region.min))) == key)
+                visit(*m_objects[i]);
+        }
+    });
+}
+
+/**
+ * @brief
+ * 	Calls visit(obj) for every object not outside f, testing the bounds of
+ * 	the objects at home in each bucket first. Buckets inside f are accepted
+ * 	without further tests.
+ */
+template<typename T>
+template<typename F>
+void hash_grid<T>::frustum(frustrum const& f, F&& visit) const
+{
+    for (uint32_t i : m_large)
+        if (classify_frustum_aabb_naive(f, m_bounds[i]) != eOUTSIDE)
+            visit(*m_objects[i]);
+
+    for (std::size_t index = 0; index < bucket_count(); ++index) {
+        bucket const& b = m_buckets[index];
+        if (b.homes == 0)
+            continue;
+        eResult c = classify_frustum_aabb_naive(f, aabb(b.min, b.max));
+        if (c == eOUTSIDE)
+            continue;
+        for (uint32_t e = b.first; e < b.first + b.homes; ++e)
+            if (c == eINSIDE || classify_frustum_aabb_naive(f, m_bounds[m_entries[e].object]) != eOUTSIDE)
+                visit(*m_objects[m_entries[e].object]);
+    }
+}
+
+#endif
@@ -0,0 +1,62 @@
+#include "hlod.hpp"
+#include "mapped_file.hpp"
+#include <cstring>
+#include <fstream>
+
+bool hlod_cache::write(std::string const& filename) const
+{
+    std::ofstream fs(filename, std::ios::binary);
+    if (!fs.is_open())
+        return false;
+    fs.write(reinterpret_cast<char const*>(&m_header), sizeof(m_header));
+    fs.write(reinterpret_cast<char const*>(m_proxies.data()), static_cast<std::streamsize>(m_proxies.size() * sizeof(proxy)));
+    fs.write(reinterpret_cast<char const*>(m_triangles.data()), static_cast<std::streamsize>(m_triangles.size() * sizeof(triangle)));
+    return fs.good();
+}
+
+/**
+ * @brief
+ * 	Reads a cache, rejecting it if it was built from a different scene
+ */
+bool hlod_cache::load(std::string const& filename, uint64_t scene_hash)
+{
+    m_header = {};
+    m_proxies.clear();
+    m_triangles.clear();
+
+    mapped_file file;
+    if (!file.open(filename) || file.size() < sizeof(header))
+        return false;
+
+    header h;
+    std::memcpy(&h, file.data(), sizeof(h));
+    if (std::memcmp(h.magic, magic, sizeof(magic)) != 0 || h.version != version || h.scene_hash != scene_hash)
+        return false;
+    if (file.size() != sizeof(header) + std::size_t(h.proxy_count) * sizeof(proxy) + std::size_t(h.triangle_count) * sizeof(triangle))
+        return false;
+
+    char const* data = file.data() + sizeof(header);
+    m_proxies.resize(h.proxy_count);
+    std::memcpy(m_proxies.data(), data, m_proxies.size() * sizeof(proxy));
+    data += m_proxies.size() * sizeof(proxy);
+    m_triangles.resize(h.triangle_count);
+    std::memcpy(static_cast<void*>(m_triangles.data()), data, m_triangles.size() * sizeof(triangle));
+
+    for (auto const& p : m_proxies)
+    {
+        if (std::size_t(p.first_triangle) + p.triangle_count > m_triangles.size())
+        {
+            m_proxies.clear();
+            m_triangles.clear();
+            return false;
+        }
+    }
+    m_header = h;
+    return true;
+}
+
+hlod_cache::proxy const* hlod_cache::find(unsigned loc) const
+{
+    auto it = std::lower_bound(m_proxies.begin(), m_proxies.end(), loc, [](proxy const& p, unsigned code) { return p.locational_code < code; });
+    return it != m_proxies.end() && it->locational_code == loc ? &*it : nullptr;
+}
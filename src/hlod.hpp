@@ -0,0 +1,129 @@
+#ifndef _HLOD__HPP_
+#define _HLOD__HPP_
+
+#include "octree.hpp"
+#include "mesh_simplify.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+/**
+ * @brief
+ * 	Hierarchical LOD proxies: for the octree nodes at selected depths, the
+ * 	world space geometry of every object below the node merged and
+ * 	simplified into a single mesh. A traversal can draw the proxy instead
+ * 	of the subtree once the node is small on screen.
+ *
+ * 	Built offline (see tools/hlod_build) and cached next to the scene, the
+ * 	cache is only valid for the scene and octree settings it was built for.
+ */
+class hlod_cache
+{
+public:
+    static constexpr char     magic[4] = { 'H', 'L', 'O', 'D' };
+    static constexpr uint32_t version  = 1;
+
+    struct header
+    {
+        char     magic[4];
+        uint32_t version;
+        uint64_t scene_hash;
+        uint32_t root_size;
+        uint32_t levels;
+        uint32_t proxy_count;
+        uint32_t triangle_count;
+    };
+
+    struct proxy
+    {
+        uint32_t locational_code;
+        uint32_t first_triangle;
+        uint32_t triangle_count;
+        uint32_t source_triangles; // Before simplification
+    };
+    static_assert(sizeof(header) == 32 && sizeof(proxy) == 16 && sizeof(triangle) == 36, "Layouts are part of the file format");
+
+    struct build_settings
+    {
+        std::vector<unsigned> depths        = { 3, 4 }; // Octree depths that get a proxy
+        float                 ratio         = 0.02f;    // Of the source triangles
+        std::size_t           min_triangles = 64;
+        std::size_t           max_triangles = 4096;
+    };
+
+    template<typename T, typename TrianglesFn>
+    static hlod_cache build(Octree<T> const& tree, uint64_t scene_hash, build_settings const& settings, TrianglesFn&& world_triangles);
+
+    bool write(std::string const& filename) const;
+    bool load(std::string const& filename, uint64_t scene_hash);
+
+    [[nodiscard]] header const&              info() const { return m_header; }
+    [[nodiscard]] std::span<proxy const>     proxies() const { return m_proxies; }
+    [[nodiscard]] std::span<triangle const>  triangles(proxy const& p) const { return std::span<triangle const>(m_triangles).subspan(p.first_triangle, p.triangle_count); }
+
+    proxy const* find(unsigned loc) const;
+
+private:
+    header                m_header{};
+    std::vector<proxy>    m_proxies; // Sorted by locational code
+    std::vector<triangle> m_triangles;
+};
+
+/**
+ * @brief
+ * 	world_triangles(obj, out) appends the world space triangles of obj
+ */
+template<typename T, typename TrianglesFn>
+hlod_cache hlod_cache::build(Octree<T> const& tree, uint64_t scene_hash, build_settings const& settings, TrianglesFn&& world_triangles)
+{
+    hlod_cache cache;
+    std::copy(std::begin(magic), std::end(magic), cache.m_header.magic);
+    cache.m_header.version    = version;
+    cache.m_header.scene_hash = scene_hash;
+    cache.m_header.root_size  = tree.root_size();
+    cache.m_header.levels     = tree.levels();
+
+    std::vector<unsigned> codes;
+    for (auto const& it : tree.m_nodes)
+    {
+        unsigned depth = static_cast<unsigned>(std::bit_width(it.first) - 1) / 3;
+        if (std::find(settings.depths.begin(), settings.depths.end(), depth) != settings.depths.end())
+            codes.push_back(it.first);
+    }
+    std::sort(codes.begin(), codes.end());
+
+    std::vector<triangle>                        merged;
+    std::vector<typename Octree<T>::node const*> stack;
+    for (unsigned loc : codes)
+    {
+        merged.clear();
+        stack.assign(1, tree.find_node(loc));
+        while (!stack.empty())
+        {
+            auto const* n = stack.back();
+            stack.pop_back();
+            for (T const* obj = n->first; obj; obj = obj->m_octree_next_obj)
+                world_triangles(*obj, merged);
+            tree.for_each_child(n, [&](auto const* child) { stack.push_back(child); });
+        }
+        if (merged.empty())
+            continue;
+
+        auto target = static_cast<std::size_t>(static_cast<float>(merged.size()) * settings.ratio);
+        target      = std::clamp(target, settings.min_triangles, settings.max_triangles);
+        auto result = merged.size() > target ? simplify_mesh(merged, target) : merged;
+
+        proxy p{ loc, static_cast<uint32_t>(cache.m_triangles.size()), static_cast<uint32_t>(result.size()), static_cast<uint32_t>(merged.size()) };
+        cache.m_proxies.push_back(p);
+        cache.m_triangles.insert(cache.m_triangles.end(), result.begin(), result.end());
+    }
+
+    cache.m_header.proxy_count    = static_cast<uint32_t>(cache.m_proxies.size());
+    cache.m_header.triangle_count = static_cast<uint32_t>(cache.m_triangles.size());
+    return cache;
+}
+
+#endif
@@ -0,0 +1,388 @@
+#include "kd_tree.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <exception>
+#include <thread>
+
+namespace {
+    float half_area(aabb const& box)
+    {
+        vec3 d = glm::max(box.max - box.min, vec3(0.0f));
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+
+    /**
+     * @brief
+     * 	Bounds of the part of t inside box, by clipping the triangle against
+     * 	the six planes of the box. Falls back to the overlap of the bounds
+     * 	when rounding clips everything away.
+     */
+    aabb clip_bounds(triangle const& t, aabb const& box, aabb const& bv)
+    {
+        vec3 polygon[9] = { t.a, t.b, t.c }, clipped[9];
+        int  size       = 3;
+        for (int axis = 0; axis < 3 && size; ++axis)
+            for (int side = 0; side < 2 && size; ++side) {
+                float plane = side ? box.max[axis] : box.min[axis];
+                auto  in    = [&](vec3 const& p) { return side ? p[axis] <= plane : p[axis] >= plane; };
+                int   count = 0;
+                for (int i = 0; i < size; ++i) {
+                    vec3 const& p = polygon[i];
+                    vec3 const& q = polygon[(i + 1) % size];
+                    if (in(p))
+                        clipped[count++] = p;
+                    if (in(p) != in(q)) {
+                        vec3 x = glm::mix(p, q, (plane - p[axis]) / (q[axis] - p[axis]));
+                        x[axis] = plane;
+                        clipped[count++] = x;
+                    }
+                }
+                std::copy(clipped, clipped + count, polygon);
+                size = count;
+            }
+
+        aabb overlap(glm::max(bv.min, box.min), glm::min(bv.max, box.max));
+        if (size == 0)
+            return overlap;
+        aabb result(polygon[0], polygon[0]);
+        for (int i = 1; i < size; ++i) {
+            result.min = glm::min(result.min, polygon[i]);
+            result.max = glm::max(result.max, polygon[i]);
+        }
+        return aabb(glm::max(result.min, overlap.min), glm::min(result.max, overlap.max));
+    }
+
+    struct ray_interval
+    {
+        uint32_t node;
+        float    tmin, tmax;
+    };
+}
+
+void kd_tree::build(std::span<triangle const> triangles, build_settings const& settings)
+{
+    clear();
+    m_triangles = triangles;
+    m_settings  = settings;
+    if (triangles.empty())
+        return;
+
+    std::vector<reference> refs(triangles.size());
+    m_bounds = aabb(triangles[0].a, triangles[0].a);
+    for (std::size_t i = 0; i < triangles.size(); ++i) {
+        triangle const& t = triangles[i];
+        refs[i]           = { aabb(glm::min(t.a, glm::min(t.b, t.c)), glm::max(t.a, glm::max(t.b, t.c))), static_cast<uint32_t>(i) };
+        m_bounds.min      = glm::min(m_bounds.min, refs[i].bv.min);
+        m_bounds.max      = glm::max(m_bounds.max, refs[i].bv.max);
+    }
+    if (m_settings.max_depth == 0)
+        m_settings.max_depth = 8 + static_cast<unsigned>(1.3f * std::log2(static_cast<float>(triangles.size())));
+    unsigned threads = settings.threads ? settings.threads : std::max(1u, std::thread::hardware_concurrency());
+
+    m_nodes.reserve(2 * triangles.size());
+    m_indices.reserve(2 * triangles.size());
+    build_node(refs, m_bounds, 0, std::bit_width(threads - 1), m_nodes, m_indices, m_depth);
+}
+
+void kd_tree::clear()
+{
+    m_triangles = {};
+    m_nodes.clear();
+    m_indices.clear();
+    m_bounds = {};
+    m_depth  = 0;
+}
+
+/**
+ * @brief
+ * 	Appends the subtree of refs to nodes and indices. The references are
+ * 	consumed. Below spawn_depth the child above the split is built on its
+ * 	own thread into its own arrays, then appended with its indices moved.
+ */
+void kd_tree::build_node(std::vector<reference>& refs, aabb const& box, unsigned depth, unsigned spawn_depth, std::vector<node>& nodes,
+                         std::vector<uint32_t>& indices, unsigned& max_depth) const
+{
+    max_depth         = std::max(max_depth, depth + 1);
+    std::size_t count = refs.size();
+    auto        make_leaf = [&] {
+        node n;
+        n.first = static_cast<uint32_t>(indices.size());
+        n.bits  = static_cast<uint32_t>(count << 2) | 3u;
+        nodes.push_back(n);
+        for (auto const& r : refs)
+            indices.push_back(r.triangle);
+    };
+    float area = half_area(box);
+    if (count <= m_settings.max_leaf_size || depth >= m_settings.max_depth || area <= 0.0f)
+        return make_leaf();
+
+    // Binned SAH: a reference is below the planes after the bin of its min, above the ones before the bin of its max
+    unsigned const        bins      = std::max(m_settings.bins, 2u);
+    float                 best_cost = static_cast<float>(count);
+    int                   best_axis = -1;
+    float                 best_split = 0.0f;
+    std::vector<unsigned> starts(bins), ends(bins);
+    for (int axis = 0; axis < 3; ++axis) {
+        float extent = box.max[axis] - box.min[axis];
+        if (extent <= 0.0f)
+            continue;
+        float scale = static_cast<float>(bins) / extent;
+        auto  bin   = [&](float x) { return std::min(static_cast<unsigned>(std::max(x - box.min[axis], 0.0f) * scale), bins - 1); };
+
+        std::fill(starts.begin(), starts.end(), 0u);
+        std::fill(ends.begin(), ends.end(), 0u);
+        for (auto const& r : refs) {
+            starts[bin(r.bv.min[axis])]++;
+            ends[bin(r.bv.max[axis])]++;
+        }
+
+        std::size_t below = 0, above = count;
+        for (unsigned i = 1; i < bins; ++i) {
+            below += starts[i - 1];
+            above -= ends[i - 1];
+            float split = box.min[axis] + extent * static_cast<float>(i) / static_cast<float>(bins);
+            aabb  below_box = box, above_box = box;
+            below_box.max[axis] = above_box.min[axis] = split;
+
+            float cost = (half_area(below_box) * static_cast<float>(below) + half_area(above_box) * static_cast<float>(above)) / area;
+            if (below == 0 || above == 0)
+                cost *= 1.0f - m_settings.empty_bonus;
+            cost += m_settings.traversal_cost;
+            if (cost < best_cost) {
+                best_cost  = cost;
+                best_axis  = axis;
+                best_split = split;
+            }
+        }
+    }
+    if (best_axis < 0)
+        return make_leaf();
+
+    // References crossing the plane go to both sides, clipped to each
+    aabb below_box = box, above_box = box;
+    below_box.max[best_axis] = above_box.min[best_axis] = best_split;
+    std::vector<reference> below, above;
+    below.reserve(count / 2);
+    above.reserve(count / 2);
+    for (auto const& r : refs) {
+        bool in_below = r.bv.min[best_axis] < best_split || r.bv.max[best_axis] <= best_split;
+        bool in_above = r.bv.max[best_axis] > best_split;
+        if (in_below && in_above) {
+            triangle const& t = m_triangles[r.triangle];
+            below.push_back({ clip_bounds(t, below_box, r.bv), r.triangle });
+            above.push_back({ clip_bounds(t, above_box, r.bv), r.triangle });
+        }
+        else
+            (in_below ? below : above).push_back(r);
+    }
+    std::vector<reference>().swap(refs);
+
+    auto index = static_cast<uint32_t>(nodes.size());
+    node inner;
+    inner.split = best_split;
+    inner.bits  = static_cast<uint32_t>(best_axis);
+    nodes.push_back(inner);
+
+    if (depth >= spawn_depth) {
+        build_node(below, below_box, depth + 1, spawn_depth, nodes, indices, max_depth);
+        nodes[index].bits |= static_cast<uint32_t>(nodes.size()) << 2;
+        build_node(above, above_box, depth + 1, spawn_depth, nodes, indices, max_depth);
+        return;
+    }
+
+    std::vector<node>     above_nodes;
+    std::vector<uint32_t> above_indices;
+    unsigned              above_depth = 0;
+    std::exception_ptr    error;
+    std::thread           worker([&]() {
+        try {
+            build_node(above, above_box, depth + 1, spawn_depth, above_nodes, above_indices, above_depth);
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+    });
+    build_node(below, below_box, depth + 1, spawn_depth, nodes, indices, max_depth);
+    worker.join();
+    if (error)
+        std::rethrow_exception(error);
+
+    // Move the subtree above to its place
+    auto node_base  = static_cast<uint32_t>(nodes.size());
+    auto index_base = static_cast<uint32_t>(indices.size());
+    nodes[index].bits |= node_base << 2;
+    for (node n : above_nodes) {
+        if (n.leaf())
+            n.first += index_base;
+        else
+            n.bits += node_base << 2;
+        nodes.push_back(n);
+    }
+    indices.insert(indices.end(), above_indices.begin(), above_indices.end());
+    max_depth = std::max(max_depth, above_depth);
+}
+
+/**
+ * @brief
+ * 	Closest triangle hit before tmax. Nodes are visited front to back
+ * 	along the ray with the interval of the ray inside them, the walk stops
+ * 	at the first node that starts after the closest hit.
+ */
+kd_tree::hit kd_tree::raycast(vec3 const& origin, vec3 const& dir, float tmax) const
+{
+    hit result;
+    if (m_nodes.empty())
+        return result;
+
+    // Interval of the ray inside the bounds
+    vec3  inv   = 1.0f / dir;
+    float enter = 0.0f, exit = tmax;
+    for (int i = 0; i < 3; ++i) {
+        float t1 = (m_bounds.min[i] - origin[i]) * inv[i];
+        float t2 = (m_bounds.max[i] - origin[i]) * inv[i];
+        enter    = std::max(enter, std::min(t1, t2));
+        exit     = std::min(exit, std::max(t1, t2));
+    }
+    if (enter > exit)
+        return result;
+
+    // The far child is pushed at most once per level
+    ray_interval              fixed[64];
+    std::vector<ray_interval> grown;
+    ray_interval*             stack = fixed;
+    if (m_depth > 64) {
+        grown.resize(m_depth);
+        stack = grown.data();
+    }
+
+    ray_triangle_setup const ray = make_ray_triangle_setup(origin, dir);
+    float                    best = tmax;
+    unsigned                 size = 0;
+    ray_interval             current{ 0, enter, exit };
+    for (;;) {
+        if (current.tmin > best)
+            break;
+        node const& n = m_nodes[current.node];
+        if (!n.leaf()) {
+            unsigned axis   = n.axis();
+            float    tplane = (n.split - origin[axis]) * inv[axis];
+            bool     below_first = origin[axis] < n.split || (origin[axis] == n.split && dir[axis] <= 0.0f);
+            uint32_t first  = below_first ? current.node + 1 : n.above();
+            uint32_t second = below_first ? n.above() : current.node + 1;
+
+            if (!(tplane > 0.0f) || tplane > current.tmax)
+                current.node = first;
+            else if (tplane < current.tmin)
+                current.node = second;
+            else {
+                stack[size++] = { second, tplane, current.tmax };
+                current       = { first, current.tmin, tplane };
+            }
+            continue;
+        }
+
+        for (uint32_t i = n.first; i < n.first + n.count(); ++i) {
+            triangle const& tri = m_triangles[m_indices[i]];
+            float           hit_t = intersection_time_ray_triangle(ray, tri.a, tri.b, tri.c);
+            if (hit_t >= 0.0f && hit_t <= best) {
+                best            = hit_t;
+                result.t        = hit_t;
+                result.triangle = m_indices[i];
+            }
+        }
+        if (!size)
+            break;
+        current = stack[--size];
+    }
+    return result;
+}
+
+/**
+ * @brief
+ * 	Closest point of the triangles to point within max_distance. The child
+ * 	on the side of point is visited first, the other one only if its box
+ * 	is nearer than the closest point found.
+ */
+kd_tree::closest kd_tree::closest_point(vec3 const& point, float max_distance) const
+{
+    closest result;
+    if (m_nodes.empty())
+        return result;
+
+    struct pending
+    {
+        uint32_t node;
+        aabb     box;
+    };
+    std::vector<pending> stack{ { 0u, m_bounds } };
+    float                best = max_distance == FLT_MAX ? FLT_MAX : max_distance * max_distance;
+    while (!stack.empty()) {
+        auto [index, box] = stack.back();
+        stack.pop_back();
+        if (sq_distance_point_box(point, box.min, box.max) > best)
+            continue;
+
+        node const& n = m_nodes[index];
+        if (n.leaf()) {
+            for (uint32_t i = n.first; i < n.first + n.count(); ++i) {
+                triangle const& t = m_triangles[m_indices[i]];
+                if (sq_distance_point_box(point, glm::min(t.a, glm::min(t.b, t.c)), glm::max(t.a, glm::max(t.b, t.c))) > best)
+                    continue;
+                vec3  q = closest_point_triangle(point, t.a, t.b, t.c);
+                float d = glm::dot(q - point, q - point);
+                if (d <= best && (d < best || result.triangle == UINT32_MAX)) {
+                    best            = d;
+                    result.point    = q;
+                    result.triangle = m_indices[i];
+                }
+            }
+            continue;
+        }
+
+        unsigned axis      = n.axis();
+        aabb     below_box = box, above_box = box;
+        below_box.max[axis] = above_box.min[axis] = n.split;
+        pending below{ index + 1, below_box }, above{ n.above(), above_box };
+        if (point[axis] < n.split)
+            std::swap(below, above);
+        stack.push_back(below); // Far side
+        stack.push_back(above);
+    }
+    if (result.triangle != UINT32_MAX)
+        result.distance = std::sqrt(best);
+    return result;
+}
+
+/**
+ * @brief
+ * 	Sorted indices of the triangles overlapping region, each one once
+ * 	although references of it can be in several leaves
+ */
+void kd_tree::query(aabb const& region, std::vector<uint32_t>& out) const
+{
+    out.clear();
+    if (m_nodes.empty() || !overlap_aabb_aabb(region.min, region.max, m_bounds.min, m_bounds.max))
+        return;
+
+    std::vector<uint32_t> stack{ 0u };
+    while (!stack.empty()) {
+        node const& n = m_nodes[stack.back()];
+        uint32_t    index = stack.back();
+        stack.pop_back();
+        if (n.leaf()) {
+            for (uint32_t i = n.first; i < n.first + n.count(); ++i) {
+                triangle const& t = m_triangles[m_indices[i]];
+                if (overlap_triangle_aabb(t.a, t.b, t.c, region.min, region.max))
+                    out.push_back(m_indices[i]);
+            }
+            continue;
+        }
+        if (region.max[n.axis()] >= n.split)
+            stack.push_back(n.above());
+        if (region.min[n.axis()] <= n.split)
+            stack.push_back(index + 1);
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
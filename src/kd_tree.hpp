@@ -0,0 +1,99 @@
+#ifndef _KD_TREE__HPP_
+#define _KD_TREE__HPP_
+
+#include "geometry.hpp"
+#include <cfloat>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief
+ * 	k-d tree over a triangle soup, like the ones load_triangles returns,
+ * 	for offline ray, closest point and box queries. Split planes are
+ * 	chosen with the binned surface area heuristic. A triangle crossing a
+ * 	plane is referenced from both sides, its bounds clipped to each side
+ * 	so the splits below stay tight.
+ *
+ * 	Nodes are 8 bytes, stored depth first: the child below the split
+ * 	follows its parent and the one above is at an index. Leaves are ranges
+ * 	of triangle indices. The subtrees are built on threads, threads = 0
+ * 	uses every hardware thread. The triangles are not copied and must
+ * 	outlive it.
+ */
+class kd_tree
+{
+public:
+    struct build_settings
+    {
+        unsigned bins           = 32;
+        unsigned max_leaf_size  = 2;    // Smaller nodes are not split
+        unsigned max_depth      = 0;    // 0 picks 8 + 1.3 log2(triangles)
+        float    traversal_cost = 2.0f; // Relative to testing a triangle
+        float    empty_bonus    = 0.2f; // Cost discount of splits with an empty side
+        unsigned threads        = 0;
+    };
+
+    struct node
+    {
+        union
+        {
+            float    split; // Inner nodes
+            uint32_t first; // Leaves, in indices()
+        };
+        uint32_t bits; // Axis in the low 2 bits, 3 for leaves. Then the above child or the leaf size
+        [[nodiscard]] bool     leaf() const { return (bits & 3u) == 3u; }
+        [[nodiscard]] unsigned axis() const { return bits & 3u; }
+        [[nodiscard]] uint32_t above() const { return bits >> 2; }
+        [[nodiscard]] uint32_t count() const { return bits >> 2; }
+    };
+    static_assert(sizeof(node) == 8, "Eight nodes per cache line");
+
+    struct hit
+    {
+        float    t        = -1.0f;
+        uint32_t triangle = UINT32_MAX;
+    };
+
+    struct closest
+    {
+        vec3     point;
+        float    distance = FLT_MAX;
+        uint32_t triangle = UINT32_MAX;
+    };
+
+    void build(std::span<triangle const> triangles) { build(triangles, build_settings{}); }
+    void build(std::span<triangle const> triangles, build_settings const& settings);
+    void clear();
+
+    hit     raycast(vec3 const& origin, vec3 const& dir, float tmax = FLT_MAX) const;
+    closest closest_point(vec3 const& point, float max_distance = FLT_MAX) const;
+    void    query(aabb const& region, std::vector<uint32_t>& out) const;
+
+    [[nodiscard]] std::span<node const>     nodes() const { return m_nodes; }
+    [[nodiscard]] std::span<uint32_t const> indices() const { return m_indices; }
+    [[nodiscard]] std::span<triangle const> triangles() const { return m_triangles; }
+    [[nodiscard]] aabb const&               bounds() const { return m_bounds; }
+    [[nodiscard]] unsigned                  depth() const { return m_depth; }
+    [[nodiscard]] bool                      empty() const { return m_nodes.empty(); }
+    [[nodiscard]] std::size_t               memory() const { return m_nodes.size() * sizeof(node) + m_indices.size() * sizeof(uint32_t); }
+
+private:
+    struct reference
+    {
+        aabb     bv; // Clipped to the node
+        uint32_t triangle;
+    };
+
+    void build_node(std::vector<reference>& refs, aabb const& box, unsigned depth, unsigned spawn_depth, std::vector<node>& nodes,
+                    std::vector<uint32_t>& indices, unsigned& max_depth) const;
+
+    std::span<triangle const> m_triangles;
+    std::vector<node>         m_nodes;
+    std::vector<uint32_t>     m_indices;
+    aabb                      m_bounds = {};
+    unsigned                  m_depth  = 0;
+    build_settings            m_settings;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#include "lod.hpp"
+#include <algorithm>
+
+namespace Lod {
+    float screen_size(aabb const& bv, vec3 const& eye, float proj_y_scale)
+    {
+        float radius   = 0.5f * length(bv.max - bv.min);
+        float distance = length(0.5f * (bv.min + bv.max) - eye);
+        if (distance <= radius)
+            return 1.0f;
+        return radius * proj_y_scale / distance;
+    }
+
+    unsigned select(settings const& s, float size, unsigned current, unsigned lod_count)
+    {
+        if (!s.enabled || lod_count <= 1)
+            return 0;
+
+        unsigned lod = std::min(current, lod_count - 1);
+        while (lod + 1 < lod_count && lod < s.thresholds.size() && size < s.thresholds[lod] * (1.0f - s.hysteresis))
+            ++lod;
+        while (lod > 0 && size > s.thresholds[lod - 1] * (1.0f + s.hysteresis))
+            --lod;
+        return lod;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef _LOD__HPP_
+#define _LOD__HPP_
+
+#include "shapes.hpp"
+#include <array>
+
+namespace Lod {
+    constexpr unsigned max_lods = 4;
+
+    /**
+     * @brief
+     * 	Screen size thresholds, an object smaller than thresholds[k] uses
+     * 	at least LOD k+1. Switching needs to cross the threshold by the
+     * 	hysteresis fraction, so objects near it do not pop every frame.
+     */
+    struct settings
+    {
+        bool                            enabled    = true;
+        std::array<float, max_lods - 1> thresholds = { 0.15f, 0.06f, 0.02f };
+        float                           hysteresis = 0.15f;
+
+        // Octree nodes smaller than this on screen draw their HLOD proxy
+        bool  hlod           = true;
+        float hlod_threshold = 0.3f;
+    };
+
+    /**
+     * @brief
+     * 	Approximate height of the bounding sphere of bv on screen, as a
+     * 	fraction of the viewport height. proj_y_scale is the [1][1] element
+     * 	of the projection matrix.
+     */
+    float screen_size(aabb const& bv, vec3 const& eye, float proj_y_scale);
+
+    /**
+     * @brief
+     * 	LOD for an object of the given screen size that currently uses
+     * 	current, out of lod_count available levels
+     */
+    unsigned select(settings const& s, float size, unsigned current, unsigned lod_count);
+}
+
+#endif
@@ -0,0 +1,136 @@
+#include "mapped_file.hpp"
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+mapped_file::mapped_file(std::string const& filename)
+{
+    open(filename);
+}
+
+mapped_file::~mapped_file()
+{
+    close();
+}
+
+mapped_file::mapped_file(mapped_file&& rhs) noexcept
+{
+    swap(rhs);
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        close();
+        swap(rhs);
+    }
+    return *this;
+}
+
+void mapped_file::swap(mapped_file& rhs) noexcept
+{
+    std::swap(m_data, rhs.m_data);
+    std::swap(m_size, rhs.m_size);
+    std::swap(m_open, rhs.m_open);
+#ifdef _WIN32
+    std::swap(m_file, rhs.m_file);
+    std::swap(m_mapping, rhs.m_mapping);
+#else
+    std::swap(m_fd, rhs.m_fd);
+#endif
+}
+
+/**
+ * @brief
+ * 	Maps the whole file. Empty files open successfully with no data.
+ */
+bool mapped_file::open(std::string const& filename)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+    m_file = file;
+    m_size = static_cast<std::size_t>(size.QuadPart);
+
+    if (m_size)
+    {
+        m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping)
+            m_data = static_cast<char const*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!m_data)
+        {
+            close();
+            return false;
+        }
+    }
+#else
+    m_fd = ::open(filename.c_str(), O_RDONLY);
+    if (m_fd < 0)
+        return false;
+
+    struct stat st{};
+    if (fstat(m_fd, &st) != 0)
+    {
+        close();
+        return false;
+    }
+    m_size = static_cast<std::size_t>(st.st_size);
+
+    if (m_size)
+    {
+        void* ptr = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, m_fd, 0);
+        if (ptr == MAP_FAILED)
+        {
+            close();
+            return false;
+        }
+        m_data = static_cast<char const*>(ptr);
+    }
+#endif
+
+    m_open = true;
+    return true;
+}
+
+void mapped_file::close()
+{
+#ifdef _WIN32
+    if (m_data)
+        UnmapViewOfFile(m_data);
+    if (m_mapping)
+        CloseHandle(m_mapping);
+    if (m_file)
+        CloseHandle(m_file);
+    m_mapping = nullptr;
+    m_file    = nullptr;
+#else
+    if (m_data)
+        munmap(const_cast<char*>(m_data), m_size);
+    if (m_fd >= 0)
+        ::close(m_fd);
+    m_fd = -1;
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_open = false;
+}
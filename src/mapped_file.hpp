@@ -0,0 +1,44 @@
+#ifndef _MAPPED_FILE__HPP_
+#define _MAPPED_FILE__HPP_
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief
+ * 	Read-only memory mapping of a whole file. Several processes mapping
+ * 	the same file share its pages through the OS page cache.
+ */
+class mapped_file
+{
+public:
+    mapped_file() = default;
+    explicit mapped_file(std::string const& filename);
+    ~mapped_file();
+    mapped_file(mapped_file const& rhs) = delete;
+    mapped_file& operator=(mapped_file const& rhs) = delete;
+    mapped_file(mapped_file&& rhs) noexcept;
+    mapped_file& operator=(mapped_file&& rhs) noexcept;
+
+    bool open(std::string const& filename);
+    void close();
+
+    [[nodiscard]] bool is_open() const { return m_open; }
+    [[nodiscard]] char const* data() const { return m_data; }
+    [[nodiscard]] std::size_t size() const { return m_size; }
+
+private:
+    void swap(mapped_file& rhs) noexcept;
+
+    char const* m_data = nullptr;
+    std::size_t m_size = 0;
+    bool        m_open = false;
+#ifdef _WIN32
+    void* m_file    = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+#endif
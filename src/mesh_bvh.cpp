@@ -0,0 +1,214 @@
+#include "mesh_bvh.hpp"
+#include <utility>
+
+namespace {
+    /**
+     * @brief
+     * 	Slab test with the far time rounded up by 2 gamma(3) (Ize 2013), so
+     * 	rounding never culls a box a triangle on its boundary is hit in
+     */
+    float intersection_time_ray_node(vec3 const& origin, vec3 const& inv, mesh_bvh::node const& n, float tmax)
+    {
+        constexpr float epsilon = FLT_EPSILON * 0.5f;
+        constexpr float round   = 1.0f + 2.0f * (3.0f * epsilon) / (1.0f - 3.0f * epsilon);
+
+        vec3  t1 = (n.min - origin) * inv, t2 = (n.max - origin) * inv;
+        vec3  near = glm::min(t1, t2), far = glm::max(t1, t2);
+        float tmin = std::max({ near.x, near.y, near.z, 0.0f });
+        float tout = std::min({ far.x * round, far.y * round, far.z * round, tmax });
+        return tmin <= tout ? tmin : -1.0f;
+    }
+}
+
+mesh_bvh::mesh_bvh(std::span<triangle const> triangles, unsigned max_leaf_size)
+{
+    std::vector<triangle_ref>  refs(triangles.size());
+    std::vector<triangle_ref*> pointers(triangles.size());
+    for (std::size_t i = 0; i < triangles.size(); ++i) {
+        triangle const& t = triangles[i];
+        refs[i].bv        = aabb(glm::min(t.a, glm::min(t.b, t.c)), glm::max(t.a, glm::max(t.b, t.c)));
+        pointers[i]       = &refs[i];
+    }
+
+    bvh<triangle_ref> tree;
+    tree.build(pointers, { .max_leaf_size = max_leaf_size });
+    m_nodes.assign(tree.nodes().begin(), tree.nodes().end());
+    m_triangles.reserve(triangles.size());
+    for (triangle_ref const* ref : tree.objects())
+        m_triangles.push_back(triangles[static_cast<std::size_t>(ref - refs.data())]);
+
+    // Depth bounds the traversal stack, the left child follows its parent
+    std::vector<unsigned> depths(m_nodes.size(), 1);
+    for (std::size_t i = 0; i < m_nodes.size(); ++i) {
+        m_depth = std::max(m_depth, depths[i]);
+        if (m_nodes[i].count == 0)
+            depths[i + 1] = depths[m_nodes[i].offset] = depths[i] + 1;
+    }
+}
+
+/**
+ * @brief
+ * 	Closest triangle hit before tmax, in model space. The near child is
+ * 	visited first and the far one is pushed with its entry time, so it is
+ * 	skipped if a closer hit comes before it.
+ */
+mesh_bvh::hit mesh_bvh::raycast(vec3 const& origin, vec3 const& dir, float tmax) const
+{
+    hit result;
+    if (m_nodes.empty())
+        return result;
+
+    vec3 inv = 1.0f / dir;
+    if (intersection_time_ray_node(origin, inv, m_nodes[0], tmax) < 0.0f)
+        return result;
+
+    ray_triangle_setup const ray = make_ray_triangle_setup(origin, dir);
+
+    // At most one pushed node per level
+    std::pair<float, uint32_t>              fixed[64];
+    std::vector<std::pair<float, uint32_t>> grown;
+    auto*                                   stack = fixed;
+    if (m_depth > 64) {
+        grown.resize(m_depth);
+        stack = grown.data();
+    }
+
+    unsigned size  = 0;
+    uint32_t index = 0;
+    for (;;) {
+        node const& n = m_nodes[index];
+        if (n.count) {
+            for (uint32_t i = n.offset; i < n.offset + n.count; ++i) {
+                triangle const& tri = m_triangles[i];
+                float           t   = intersection_time_ray_triangle(ray, tri.a, tri.b, tri.c);
+                if (t >= 0.0f && t <= tmax) {
+                    tmax            = t;
+                    result.t        = t;
+                    result.triangle = i;
+                }
+            }
+        }
+        else {
+            uint32_t near = index + 1, far = n.offset;
+            if (dir[n.axis] < 0.0f)
+                std::swap(near, far);
+            float tnear = intersection_time_ray_node(origin, inv, m_nodes[near], tmax);
+            float tfar  = intersection_time_ray_node(origin, inv, m_nodes[far], tmax);
+            if (tfar >= 0.0f)
+                stack[size++] = { tfar, far };
+            if (tnear >= 0.0f) {
+                index = near;
+                continue;
+            }
+        }
+
+        // Next pushed node that starts before the closest hit
+        while (size && stack[size - 1].first > tmax)
+            size--;
+        if (!size)
+            break;
+        index = stack[--size].second;
+    }
+    return result;
+}
+
+/**
+ * @brief
+ * 	Closest hit of a world space ray with an instance, w2m is the inverse
+ * 	of its m2w
+ */
+mesh_bvh::hit mesh_bvh::raycast(vec3 const& origin, vec3 const& dir, mat4 const& w2m, float tmax) const
+{
+    return raycast(vec3(w2m * vec4(origin, 1.0f)), vec3(w2m * vec4(dir, 0.0f)), tmax);
+}
+
+/**
+ * @brief
+ * 	Closest point of the mesh to point within max_distance, in model space
+ */
+mesh_bvh::closest mesh_bvh::closest_point(vec3 const& point, float max_distance) const
+{
+    return closest_point(point, mat4(1.0f), max_distance);
+}
+
+/**
+ * @brief
+ * 	Closest point of an instance to a world space point within
+ * 	max_distance. Nodes are bounded by the world aabb of their box and the
+ * 	triangles are moved to world space, so the distance is exact under any
+ * 	m2w. The nearer child is visited first and the other one is skipped if
+ * 	a closer point comes before it.
+ */
+mesh_bvh::closest mesh_bvh::closest_point(vec3 const& point, mat4 const& m2w, float max_distance) const
+{
+    closest result;
+    if (m_nodes.empty())
+        return result;
+
+    auto distance_to = [&](node const& n) {
+        aabb bv = transform_aabb(aabb(n.min, n.max), m2w);
+        return sq_distance_point_box(point, bv.min, bv.max);
+    };
+    float best = max_distance == FLT_MAX ? FLT_MAX : max_distance * max_distance;
+    if (distance_to(m_nodes[0]) > best)
+        return result;
+
+    // At most one pushed node per level
+    std::pair<float, uint32_t>              fixed[64];
+    std::vector<std::pair<float, uint32_t>> grown;
+    auto*                                   stack = fixed;
+    if (m_depth > 64) {
+        grown.resize(m_depth);
+        stack = grown.data();
+    }
+
+    unsigned size  = 0;
+    uint32_t index = 0;
+    for (;;) {
+        node const& n = m_nodes[index];
+        if (n.count) {
+            for (uint32_t i = n.offset; i < n.offset + n.count; ++i) {
+                triangle const& tri = m_triangles[i];
+                vec3            a = vec3(m2w * vec4(tri.a, 1.0f)), b = vec3(m2w * vec4(tri.b, 1.0f)), c = vec3(m2w * vec4(tri.c, 1.0f));
+                vec3            q = closest_point_triangle(point, a, b, c);
+                float           d = glm::dot(q - point, q - point);
+                if (d < best || (d == best && result.triangle == UINT32_MAX)) {
+                    best            = d;
+                    result.point    = q;
+                    result.triangle = i;
+                }
+            }
+        }
+        else {
+            uint32_t near = index + 1, far = n.offset;
+            float    dnear = distance_to(m_nodes[near]), dfar = distance_to(m_nodes[far]);
+            if (dfar < dnear) {
+                std::swap(near, far);
+                std::swap(dnear, dfar);
+            }
+            if (dfar <= best)
+                stack[size++] = { dfar, far };
+            if (dnear <= best) {
+                index = near;
+                continue;
+            }
+        }
+
+        // Next pushed node that starts before the closest point
+        while (size && stack[size - 1].first > best)
+            size--;
+        if (!size)
+            break;
+        index = stack[--size].second;
+    }
+
+    if (result.triangle != UINT32_MAX) {
+        triangle const& tri = m_triangles[result.triangle];
+        vec3            n   = glm::cross(vec3(m2w * vec4(tri.b - tri.a, 0.0f)), vec3(m2w * vec4(tri.c - tri.a, 0.0f)));
+        if (glm::determinant(mat3(m2w)) < 0.0f) // Mirrored, the winding flips
+            n = -n;
+        result.normal   = glm::dot(n, n) > 0.0f ? glm::normalize(n) : vec3(0.0f);
+        result.distance = std::sqrt(best);
+    }
+    return result;
+}
@@ -0,0 +1,65 @@
+#ifndef _MESH_BVH__HPP_
+#define _MESH_BVH__HPP_
+
+#include "bvh.hpp"
+#include "geometry.hpp"
+#include <cfloat>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief
+ * 	Bounding volume hierarchy over the triangles of a mesh, in model
+ * 	space. Built once per mesh with the bvh binned SAH builder, the
+ * 	triangles are then stored in leaf order so a leaf is a range of them.
+ *
+ * 	Instances share it: a world space ray goes to model space through the
+ * 	inverse of the instance m2w. The direction is not normalized on the
+ * 	way, so hit times are the same in both spaces.
+ */
+class mesh_bvh
+{
+    struct triangle_ref
+    {
+        aabb bv;
+    };
+
+public:
+    using node = bvh<triangle_ref>::node;
+
+    struct hit
+    {
+        float    t        = -1.0f;
+        uint32_t triangle = UINT32_MAX; // In triangles()
+    };
+
+    struct closest
+    {
+        vec3     point;
+        vec3     normal; // Of the triangle, by its winding
+        float    distance = FLT_MAX;
+        uint32_t triangle = UINT32_MAX; // In triangles()
+    };
+
+    mesh_bvh() = default;
+    explicit mesh_bvh(std::span<triangle const> triangles, unsigned max_leaf_size = 4);
+
+    hit raycast(vec3 const& origin, vec3 const& dir, float tmax = FLT_MAX) const;
+    hit raycast(vec3 const& origin, vec3 const& dir, mat4 const& w2m, float tmax = FLT_MAX) const;
+    closest closest_point(vec3 const& point, float max_distance = FLT_MAX) const;
+    closest closest_point(vec3 const& point, mat4 const& m2w, float max_distance = FLT_MAX) const;
+
+    [[nodiscard]] std::span<node const>     nodes() const { return m_nodes; }
+    [[nodiscard]] std::span<triangle const> triangles() const { return m_triangles; }
+    [[nodiscard]] unsigned                  depth() const { return m_depth; }
+    [[nodiscard]] bool                      empty() const { return m_nodes.empty(); }
+    [[nodiscard]] std::size_t               memory() const { return m_nodes.size() * sizeof(node) + m_triangles.size() * sizeof(triangle); }
+
+private:
+    std::vector<node>     m_nodes;
+    std::vector<triangle> m_triangles; // In leaf order
+    unsigned              m_depth = 0;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#include "mesh_pool.hpp"
+#include <iterator>
+#include <stdexcept>
+
+mesh_range const& mesh_pool::add(uint32_t mesh, uint32_t vertex_count)
+{
+    if (mesh >= m_ranges.size())
+        m_ranges.resize(mesh + 1);
+    if (m_ranges[mesh].count != 0)
+        throw std::runtime_error("Mesh already in the pool");
+
+    mesh_range& r = m_ranges[mesh];
+    r.count       = vertex_count;
+    for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+        if (it->count < vertex_count)
+            continue;
+        r.first = it->first;
+        it->first += vertex_count;
+        it->count -= vertex_count;
+        if (it->count == 0)
+            m_free.erase(it);
+        return r;
+    }
+
+    r.first = m_end;
+    m_end += vertex_count;
+    return r;
+}
+
+void mesh_pool::remove(uint32_t mesh)
+{
+    if (mesh >= m_ranges.size() || m_ranges[mesh].count == 0)
+        return;
+    mesh_range freed = m_ranges[mesh];
+    m_ranges[mesh]   = {};
+
+    auto it = m_free.begin();
+    while (it != m_free.end() && it->first < freed.first)
+        ++it;
+
+    // Coalesce with the neighbours
+    if (it != m_free.end() && freed.first + freed.count == it->first) {
+        freed.count += it->count;
+        it = m_free.erase(it);
+    }
+    if (it != m_free.begin() && std::prev(it)->first + std::prev(it)->count == freed.first) {
+        std::prev(it)->count += freed.count;
+        freed = *std::prev(it);
+        it    = m_free.erase(std::prev(it));
+    }
+
+    if (freed.first + freed.count == m_end)
+        m_end = freed.first;
+    else
+        m_free.insert(it, freed);
+}
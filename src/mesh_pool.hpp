@@ -0,0 +1,38 @@
+#ifndef _MESH_POOL__HPP_
+#define _MESH_POOL__HPP_
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief
+ * 	Vertices of a mesh inside a shared vertex buffer
+ */
+struct mesh_range
+{
+    uint32_t first = 0;
+    uint32_t count = 0; // 0 if the mesh is not in the buffer
+};
+
+/**
+ * @brief
+ * 	Allocator of the ranges of a vertex buffer shared by all meshes. Freed
+ * 	ranges are coalesced and reused first fit, the buffer only needs to
+ * 	hold size() vertices.
+ */
+class mesh_pool
+{
+public:
+    mesh_range const& add(uint32_t mesh, uint32_t vertex_count);
+    void              remove(uint32_t mesh);
+
+    [[nodiscard]] std::vector<mesh_range> const& ranges() const { return m_ranges; } // Indexed by mesh
+    [[nodiscard]] uint32_t                       size() const { return m_end; }
+
+private:
+    std::vector<mesh_range> m_ranges;
+    std::vector<mesh_range> m_free; // Sorted by first, never adjacent
+    uint32_t                m_end = 0;
+};
+
+#endif
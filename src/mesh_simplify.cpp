@@ -0,0 +1,271 @@
+#include "mesh_simplify.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+
+namespace {
+    /**
+     * @brief
+     * 	Symmetric 4x4 matrix, only the upper triangle is stored
+     */
+    struct quadric
+    {
+        double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+
+        static quadric plane(vec3 const& n, float d, double weight)
+        {
+            double a = n.x, b = n.y, c = n.z, e = d;
+            quadric q;
+            q.a2 = weight * a * a; q.ab = weight * a * b; q.ac = weight * a * c; q.ad = weight * a * e;
+            q.b2 = weight * b * b; q.bc = weight * b * c; q.bd = weight * b * e;
+            q.c2 = weight * c * c; q.cd = weight * c * e;
+            q.d2 = weight * e * e;
+            return q;
+        }
+
+        quadric& operator+=(quadric const& q)
+        {
+            a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+            b2 += q.b2; bc += q.bc; bd += q.bd;
+            c2 += q.c2; cd += q.cd;
+            d2 += q.d2;
+            return *this;
+        }
+
+        double error(vec3 const& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+                 + b2 * y * y + 2 * bc * y * z + 2 * bd * y
+                 + c2 * z * z + 2 * cd * z
+                 + d2;
+        }
+
+        // Point of minimum error, false if the system is ill conditioned
+        bool optimum(vec3& out) const
+        {
+            double det = a2 * (b2 * c2 - bc * bc) - ab * (ab * c2 - bc * ac) + ac * (ab * bc - b2 * ac);
+            double scale = a2 * b2 * c2;
+            if (std::abs(det) <= 1e-9 * std::abs(scale) || det == 0.0)
+                return false;
+
+            double x = -ad * (b2 * c2 - bc * bc) + bd * (ab * c2 - bc * ac) - cd * (ab * bc - b2 * ac);
+            double y = -a2 * (bd * c2 - bc * cd) + ab * (ad * c2 - ac * cd) - ac * (ad * bc - bd * ac);
+            double z = -a2 * (b2 * cd - bd * bc) + ab * (ab * cd - bd * ac) - ad * (ab * bc - b2 * ac);
+            out      = vec3(static_cast<float>(x / det), static_cast<float>(y / det), static_cast<float>(z / det));
+            return true;
+        }
+    };
+
+    struct position_hash
+    {
+        std::size_t operator()(vec3 const& p) const
+        {
+            uint32_t bits[3];
+            std::memcpy(bits, &p, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+
+    struct collapse
+    {
+        double   cost;
+        uint32_t v0, v1;
+        uint32_t stamp0, stamp1;
+        vec3     position;
+
+        bool operator>(collapse const& rhs) const { return cost > rhs.cost; }
+    };
+
+    uint64_t edge_key(uint32_t a, uint32_t b)
+    {
+        return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+    }
+
+    constexpr double cBorderWeight = 1000.0;
+}
+
+std::vector<triangle> simplify_mesh(std::vector<triangle> const& triangles, std::size_t target_triangles)
+{
+    // Weld
+    std::vector<vec3>                               positions;
+    std::vector<std::array<uint32_t, 3>>            faces;
+    std::unordered_map<vec3, uint32_t, position_hash> welded;
+    faces.reserve(triangles.size());
+    for (auto const& t : triangles) {
+        std::array<uint32_t, 3> f{};
+        for (int v = 0; v < 3; ++v) {
+            auto [it, inserted] = welded.try_emplace(t[v], static_cast<uint32_t>(positions.size()));
+            if (inserted)
+                positions.push_back(t[v]);
+            f[v] = it->second;
+        }
+        if (f[0] != f[1] && f[1] != f[2] && f[0] != f[2])
+            faces.push_back(f);
+    }
+
+    std::vector<quadric>               quadrics(positions.size());
+    std::vector<std::vector<uint32_t>> vertex_faces(positions.size());
+    std::unordered_map<uint64_t, int>  edge_uses;
+    for (uint32_t i = 0; i < faces.size(); ++i) {
+        auto const& f = faces[i];
+        vec3        n = cross(positions[f[1]] - positions[f[0]], positions[f[2]] - positions[f[0]]);
+        float       l = length(n);
+        if (l > 0.0f) {
+            n /= l;
+            quadric q = quadric::plane(n, -dot(n, positions[f[0]]), 0.5 * l);
+            for (uint32_t v : f)
+                quadrics[v] += q;
+        }
+        for (int e = 0; e < 3; ++e) {
+            vertex_faces[f[e]].push_back(i);
+            edge_uses[edge_key(f[e], f[(e + 1) % 3])]++;
+        }
+    }
+
+    // Borders: plane through the edge, perpendicular to its face
+    for (auto const& f : faces) {
+        vec3 n = cross(positions[f[1]] - positions[f[0]], positions[f[2]] - positions[f[0]]);
+        for (int e = 0; e < 3; ++e) {
+            uint32_t a = f[e], b = f[(e + 1) % 3];
+            if (edge_uses[edge_key(a, b)] != 1)
+                continue;
+            vec3  edge = positions[b] - positions[a];
+            vec3  side = cross(edge, n);
+            float l    = length(side);
+            if (l == 0.0f)
+                continue;
+            side /= l;
+            quadric q = quadric::plane(side, -dot(side, positions[a]), cBorderWeight * dot(edge, edge));
+            quadrics[a] += q;
+            quadrics[b] += q;
+        }
+    }
+
+    std::vector<uint32_t> stamps(positions.size(), 0);
+    std::vector<bool>     removed(positions.size(), false);
+    std::vector<bool>     dead_faces(faces.size(), false);
+    std::size_t           live = faces.size();
+
+    std::priority_queue<collapse, std::vector<collapse>, std::greater<>> heap;
+    auto push_edge = [&](uint32_t a, uint32_t b) {
+        quadric q = quadrics[a];
+        q += quadrics[b];
+
+        collapse c{ 0.0, a, b, stamps[a], stamps[b], {} };
+        vec3 candidates[4] = { positions[a], positions[b], (positions[a] + positions[b]) * 0.5f, {} };
+        int  count         = 3;
+        if (q.optimum(candidates[3]))
+            count = 4;
+        c.cost = std::numeric_limits<double>::max();
+        for (int i = 0; i < count; ++i) {
+            double e = q.error(candidates[i]);
+            if (e < c.cost) {
+                c.cost     = e;
+                c.position = candidates[i];
+            }
+        }
+        heap.push(c);
+    };
+    for (auto const& it : edge_uses)
+        push_edge(static_cast<uint32_t>(it.first >> 32), static_cast<uint32_t>(it.first));
+
+    // Moving v to p must not turn around any face of v that survives
+    auto flips = [&](uint32_t v, uint32_t other, vec3 const& p) {
+        for (uint32_t fi : vertex_faces[v]) {
+            if (dead_faces[fi])
+                continue;
+            auto const& f = faces[fi];
+            if (f[0] == other || f[1] == other || f[2] == other)
+                continue;
+            vec3 corners[3] = { positions[f[0]], positions[f[1]], positions[f[2]] };
+            vec3 before     = cross(corners[1] - corners[0], corners[2] - corners[0]);
+            for (int i = 0; i < 3; ++i)
+                if (f[i] == v)
+                    corners[i] = p;
+            vec3 after = cross(corners[1] - corners[0], corners[2] - corners[0]);
+            if (dot(before, after) <= 0.0f)
+                return true;
+        }
+        return false;
+    };
+
+    std::vector<uint32_t> neighbours;
+    while (live > target_triangles && !heap.empty()) {
+        collapse c = heap.top();
+        heap.pop();
+        if (removed[c.v0] || removed[c.v1] || stamps[c.v0] != c.stamp0 || stamps[c.v1] != c.stamp1)
+            continue;
+        if (flips(c.v0, c.v1, c.position) || flips(c.v1, c.v0, c.position))
+            continue;
+
+        // Collapse v1 into v0
+        uint32_t v0 = c.v0, v1 = c.v1;
+        positions[v0] = c.position;
+        quadrics[v0] += quadrics[v1];
+        removed[v1] = true;
+        for (uint32_t fi : vertex_faces[v1]) {
+            if (dead_faces[fi])
+                continue;
+            auto& f = faces[fi];
+            if (f[0] == v0 || f[1] == v0 || f[2] == v0) {
+                dead_faces[fi] = true;
+                live--;
+                continue;
+            }
+            for (auto& v : f)
+                if (v == v1)
+                    v = v0;
+            vertex_faces[v0].push_back(fi);
+        }
+        vertex_faces[v1].clear();
+        std::erase_if(vertex_faces[v0], [&](uint32_t fi) { return dead_faces[fi]; });
+        stamps[v0]++;
+
+        neighbours.clear();
+        for (uint32_t fi : vertex_faces[v0])
+            for (uint32_t v : faces[fi])
+                if (v != v0)
+                    neighbours.push_back(v);
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        for (uint32_t n : neighbours)
+            push_edge(v0, n);
+    }
+
+    std::vector<triangle> result;
+    result.reserve(live);
+    for (uint32_t i = 0; i < faces.size(); ++i) {
+        if (dead_faces[i])
+            continue;
+        triangle t;
+        t.a = positions[faces[i][0]];
+        t.b = positions[faces[i][1]];
+        t.c = positions[faces[i][2]];
+        result.push_back(t);
+    }
+    return result;
+}
+
+std::vector<std::vector<triangle>> build_lod_chain(std::vector<triangle> const& triangles, unsigned levels, float ratio, std::size_t min_triangles)
+{
+    std::vector<std::vector<triangle>> chain;
+    chain.push_back(triangles);
+    for (unsigned level = 1; level < levels; ++level) {
+        auto const& previous = chain.back();
+        auto        target   = static_cast<std::size_t>(static_cast<float>(previous.size()) * ratio);
+        if (target < min_triangles)
+            break;
+        auto simplified = simplify_mesh(previous, target);
+        if (simplified.empty() || simplified.size() > previous.size() * 9 / 10)
+            break;
+        chain.push_back(std::move(simplified));
+    }
+    return chain;
+}
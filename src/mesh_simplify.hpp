@@ -0,0 +1,25 @@
+#ifndef _MESH_SIMPLIFY__HPP_
+#define _MESH_SIMPLIFY__HPP_
+
+#include "shapes.hpp"
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief
+ * 	Quadric error metric simplification (Garland and Heckbert) of a
+ * 	triangle soup. Vertices sharing a position are welded first, open
+ * 	borders are kept in place by penalizing the planes perpendicular to
+ * 	them, and collapses that would flip a triangle are rejected.
+ */
+std::vector<triangle> simplify_mesh(std::vector<triangle> const& triangles, std::size_t target_triangles);
+
+/**
+ * @brief
+ * 	LOD chain, level 0 is the input and every level keeps about ratio of
+ * 	the triangles of the previous one. Stops early when a level would have
+ * 	less than min_triangles or the mesh cannot be simplified further.
+ */
+std::vector<std::vector<triangle>> build_lod_chain(std::vector<triangle> const& triangles, unsigned levels, float ratio = 0.5f, std::size_t min_triangles = 16);
+
+#endif
@@ -1,8 +1,16 @@
 #ifndef _OCTREE__HPP_
 #define _OCTREE__HPP_
 
+#include "geometry.hpp"
 #include "shapes.hpp"
+#include <bit>
+#include <cfloat>
+#include <functional>
+#include <queue>
+#include <span>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 
 namespace LocationalCode {
     static const unsigned maxBits = sizeof(unsigned) * 8;
@@ -16,68 +24,182 @@ namespace LocationalCode {
     int compute_locational_code(const aabb& bv, const unsigned root_size, const unsigned levels);
 
     aabb compute_bv(unsigned loc, float size);
+
+    unsigned nearest_child(const aabb& cell, const glm::vec3& eye);
+
+    // Cell and object bounds of a tree of the given dimension
+    template<unsigned dimension>
+    using box = std::conditional_t<dimension == 2, rect, aabb>;
+
+    template<unsigned dimension>
+    int compute_locational_code(const box<dimension>& bv, const unsigned root_size, const unsigned levels);
+
+    template<unsigned dimension>
+    box<dimension> compute_bv(unsigned loc, float size);
+
+    template<unsigned dimension>
+    unsigned nearest_child(const box<dimension>& cell, const glm::vec<dimension, float>& eye);
+
+    /**
+     * @brief
+     * 	Calls f(0) ... f(count - 1), expanded at compile time
+     */
+    template<unsigned count, typename F>
+    void unroll(F&& f)
+    {
+        [&]<unsigned... i>(std::integer_sequence<unsigned, i...>) { (f(i), ...); }(std::make_integer_sequence<unsigned, count>{});
+    }
 }
 
 /**
  * @brief
- * 	Linear octree, each node stores a head for a linked list of T
+ * 	Linear octree, each node stores a head for a linked list of T and the
+ * 	aggregate bounds of its objects and of its descendants, refit as
+ * 	objects are inserted, removed and relocated.
+ *
+ * 	Objects go to the node given by their locational code, which subdivides
+ * 	to the same level everywhere. In adaptive mode insert(obj) puts them in
+ * 	the deepest existing node that contains them instead. A node splits
+ * 	when it holds more than split_count objects and its subtree merges
+ * 	back into it when it holds less than merge_count.
+ *
+ * 	Every level takes Dim bits of the locational code: 2 for a quadtree,
+ * 	3 for an octree. Both share the same interface.
  * @tparam T
+ * 	Has a world bv of bounds_type, which must not change while linked
+ * 	unless relocate() is called
  */
-template <typename T>
+template <typename T, unsigned Dim = 3>
 class Octree
 {
+    static_assert(Dim == 2 || Dim == 3, "Quadtrees and octrees only");
+
 public:
+    static constexpr unsigned dimension  = Dim;
+    static constexpr unsigned children   = 1u << Dim;
+    static constexpr unsigned child_mask = children - 1;
+    static constexpr unsigned max_levels = (LocationalCode::maxBits - 1) / Dim;
+
+    using bounds_type = LocationalCode::box<Dim>;
+    using vec_type    = glm::vec<Dim, float>;
+
+    static bounds_type empty_bounds() { return bounds_type(vec_type(FLT_MAX), vec_type(-FLT_MAX)); }
+
     struct node
     {
         unsigned int locational_code = 0;
         unsigned char  children_active = 0;
         T* first = nullptr;
+        bounds_type bounds = empty_bounds(); // Objects of the subtree, empty if it has none
+        unsigned int object_count = 0;  // In the list of this node
+        unsigned int subtree_count = 0; // In this node and its descendants
+    };
+
+    struct hit
+    {
+        T* object = nullptr;
+        float t = -1.0f;
+    };
+
+    struct adaptive_settings
+    {
+        unsigned int split_count = 32;
+        unsigned int merge_count = 8; // Lower than split_count, or nodes keep splitting and merging
+        unsigned int max_depth = 8;   // Also capped by the root size and the locational code bits
     };
 
     std::unordered_map<unsigned int, node*> m_nodes;
 private:
-    unsigned int m_root_size;
-    unsigned int m_levels;
+    unsigned int m_root_size = 1;
+    unsigned int m_levels = 0;
+    unsigned int m_bounds_revision = 0; // Changes with any aggregate bounds
+    bool m_adaptive = false;
+    adaptive_settings m_adaptive_settings;
+
+    void link(T& obj, node* n);
+    void unlink(T& obj);
+    void refit(unsigned int loc);
+    void split(node* n);
+    void merge(node* n);
+    template<typename F>
+    void visit_subtree(const node* n, F& visit)const;
+    template<typename F>
+    hit cast(const vec_type& origin, const vec_type& dir, float tmax, const vec_type& pad, F& intersect)const;
 
 public:
     ~Octree();
 
     void clear();
-    node* create_node(const aabb& bv);
+    node* create_node(const bounds_type& bv);
     node* create_node(unsigned int loc);
-    node* find_node(const aabb& bv)const;
+    node* find_node(const bounds_type& bv)const;
     node* find_node(unsigned int loc)const;
     void delete_node(unsigned int loc);
     void children_nodes(node* n, std::vector<node*>& childrens, int level)const;
+    unsigned children_front_to_back(const node* n, const bounds_type& cell, const vec_type& eye, node* (&childrens)[children])const;
+    template<typename F>
+    void for_each_child(const node* n, F&& f)const;
+    template<typename F>
+    void query(const bounds_type& region, F&& f)const;
+    template<typename F>
+    void frustum(const frustrum& f, F&& visit)const requires (Dim == 3);
+    template<typename F>
+    hit raycast(const vec_type& origin, const vec_type& dir, float tmax, F&& intersect)const;
+    hit raycast(const vec_type& origin, const vec_type& dir, float tmax = FLT_MAX)const;
+    template<typename F>
+    hit sweep_aabb(const bounds_type& box, const vec_type& displacement, F&& intersect)const;
+    hit sweep_aabb(const bounds_type& box, const vec_type& displacement)const;
+    template<typename F>
+    hit sweep_sphere(const vec_type& center, float radius, const vec_type& displacement, F&& intersect)const requires (Dim == 3);
+    hit sweep_sphere(const vec_type& center, float radius, const vec_type& displacement)const requires (Dim == 3);
+    void nearest(const vec_type& point, unsigned k, std::vector<T*>& out, float max_distance = FLT_MAX)const;
+    template<typename F>
+    hit closest(const vec_type& point, float max_distance, F&& distance)const;
+    node* insert(T& obj, unsigned int loc);
+    void remove(T& obj);
+    node* relocate(T& obj, unsigned int loc);
+    node* insert(T& obj);
+    node* relocate(T& obj);
+    void relocate(std::span<T* const> objects);
+    void prune(node* n);
     void set_root_size(unsigned s);
     void set_levels(unsigned l);
+    void set_adaptive(bool adaptive, const adaptive_settings& s = {});
+    [[nodiscard]] bool adaptive() const { return m_adaptive; }
+    [[nodiscard]] static unsigned depth(unsigned loc) { return (std::bit_width(loc) - 1) / Dim; }
+    [[nodiscard]] static bool overlaps(const bounds_type& a, const bounds_type& b);
     [[nodiscard]] unsigned root_size() const { return m_root_size; }
+    [[nodiscard]] unsigned levels() const { return m_levels; }
+    [[nodiscard]] unsigned bounds_revision() const { return m_bounds_revision; }
 };
 
+template<typename T>
+using Quadtree = Octree<T, 2>;
+
 #include "Octree.inl"
 
-template<typename T>
-Octree<T>::~Octree()
+template<typename T, unsigned Dim>
+Octree<T, Dim>::~Octree()
 {
     clear();
 }
 
-template<typename T>
-void Octree<T>::clear()
+template<typename T, unsigned Dim>
+void Octree<T, Dim>::clear()
 {
     for (auto& it : m_nodes)
         delete it.second;
     m_nodes.clear();
 }
 
-template<typename T>
-typename Octree<T>::node* Octree<T>::create_node(const aabb& bv)
+template<typename T, unsigned Dim>
+typename Octree<T, Dim>::node* Octree<T, Dim>::create_node(const bounds_type& bv)
 {
-    return create_node(LocationalCode::compute_locational_code(bv, m_root_size, m_levels));
+    return create_node(LocationalCode::compute_locational_code<Dim>(bv, m_root_size, m_levels));
 }
 
-template<typename T>
-typename Octree<T>::node* Octree<T>::create_node(unsigned int loc)
+template<typename T, unsigned Dim>
+typename Octree<T, Dim>::node* Octree<T, Dim>::create_node(unsigned int loc)
 {
     if (loc == 0u)
         return nullptr;
@@ -90,28 +212,31 @@ typename Octree<T>::node* Octree<T>::create_node(unsigned int loc)
     n->locational_code = loc;
     n->children_active = 0;
     n->first = nullptr;
+    n->bounds = empty_bounds();
+    n->object_count = 0;
+    n->subtree_count = 0;
 
     if (loc == 0b1)
         return n;
 
-    node* parent = create_node(loc >> 3);
+    node* parent = create_node(loc >> Dim);
     if (parent)
     {
-        int childLoc = (loc & 0b111);
+        int childLoc = (loc & child_mask);
         parent->children_active |= 1u << childLoc;
     }
 
     return n;
 }
 
-template<typename T>
-typename Octree<T>::node* Octree<T>::find_node(const aabb& bv) const
+template<typename T, unsigned Dim>
+typename Octree<T, Dim>::node* Octree<T, Dim>::find_node(const bounds_type& bv) const
 {
-    return find_node(LocationalCode::compute_locational_code(bv, m_root_size, m_levels));
+    return find_node(LocationalCode::compute_locational_code<Dim>(bv, m_root_size, m_levels));
 }
 
-template<typename T>
-typename Octree<T>::node* Octree<T>::find_node(unsigned int loc)const
+template<typename T, unsigned Dim>
+typename Octree<T, Dim>::node* Octree<T, Dim>::find_node(unsigned int loc)const
 {
     auto found = m_nodes.find(loc);
     if (found != m_nodes.end())
@@ -119,8 +244,8 @@ typename Octree<T>::node* Octree<T>::find_node(unsigned int loc)const
     return nullptr;
 }
 
-template<typename T>
-void Octree<T>::delete_node(unsigned int loc)
+template<typename T, unsigned Dim>
+void Octree<T, Dim>::delete_node(unsigned int loc)
 {
     auto found = m_nodes.find(loc);
     if (found != m_nodes.end())
@@ -130,8 +255,8 @@ void Octree<T>::delete_node(unsigned int loc)
     }
 }
 
-template<typename T>
-void Octree<T>::children_nodes(node* n, std::vector<node*>& childrens, int level)const
+template<typename T, unsigned Dim>
+void Octree<T, Dim>::children_nodes(node* n, std::vector<node*>& childrens, int level)const
 {
     if (level == 0)
     {
@@ -145,10 +270,10 @@ void Octree<T>::children_nodes(node* n, std::vector<node*>& childrens, int level
             return;
     }
 
-    for (int i = 0; i < 8; i++)
-        if (n->children_active & (1 << i))
+    for (unsigned i = 0; i < children; i++)
+        if (n->children_active & (1u << i))
         {
-            int lc = (n->locational_code << 3) + i;
+            int lc = (n->locational_code << Dim) + i;
 
             node* found = find_node(lc);
             if (found)
@@ -156,16 +281,726 @@ void Octree<T>::children_nodes(node* n, std::vector<node*>& childrens, int level
         }
 }
 
-template<typename T>
-void Octree<T>::set_root_size(unsigned s)
+/**
+ * @brief
+ * 	Active children of n, nearest to eye first. No child can occlude one
+ * 	that comes before it, returns how many were written
+ */
+template<typename T, unsigned Dim>
+unsigned Octree<T, Dim>::children_front_to_back(const node* n, const bounds_type& cell, const vec_type& eye, node* (&childrens)[children])const
+{
+    unsigned count   = 0;
+    unsigned nearest = LocationalCode::nearest_child<Dim>(cell, eye);
+    LocationalCode::unroll<children>([&](unsigned i)
+    {
+        unsigned c = nearest ^ i;
+        if (n->children_active & (1u << c))
+            if (node* found = find_node((n->locational_code << Dim) + c))
+                childrens[count++] = found;
+    });
+    return count;
+}
+
+/**
+ * @brief
+ * 	Calls f(child) for every child node of n
+ */
+template<typename T, unsigned Dim>
+template<typename F>
+void Octree<T, Dim>::for_each_child(const node* n, F&& f)const
+{
+    LocationalCode::unroll<children>([&](unsigned i)
+    {
+        if (n->children_active & (1u << i))
+            if (node* child = find_node((n->locational_code << Dim) + i))
+                f(child);
+    });
+}
+
+/**
+ * @brief
+ * 	Calls f(obj) for every object whose bv overlaps region, skipping the
+ * 	subtrees whose aggregate bounds do not
+ */
+template<typename T, unsigned Dim>
+template<typename F>
+void Octree<T, Dim>::query(const bounds_type& region, F&& f)const
+{
+    node* root = find_node(1u);
+    if (!root)
+        return;
+
+    node* stack[max_levels * (children - 1) + 1];
+    unsigned size = 0;
+    stack[size++] = root;
+    while (size)
+    {
+        node* n = stack[--size];
+        if (!overlaps(n->bounds, region))
+            continue;
+        for (T* obj = n->first; obj; obj = obj->m_octree_next_obj)
+            if (overlaps(obj->bv, region))
+                f(*obj);
+        for_each_child(n, [&](node* child)
+        {
+            stack[size++] = child;
+        });
+    }
+}
+
+template<typename T, unsigned Dim>
+template<typename F>
+void Octree<T, Dim>::visit_subtree(const node* n, F& visit)const
+{
+    for (T* obj = n->first; obj; obj = obj->m_octree_next_obj)
+        visit(*obj);
+    for_each_child(n, [&](node* child)
+    {
+        visit_subtree(child, visit);
+    });
+}
+
+/**
+ * @brief
+ * 	Calls visit(obj) for every object not outside f, testing the aggregate
+ * 	bounds of the nodes. Subtrees inside f are accepted without further
+ * 	tests.
+ */
+template<typename T, unsigned Dim>
+template<typename F>
+void Octree<T, Dim>::frustum(const frustrum& f, F&& visit)const requires (Dim == 3)
+{
+    node* root = find_node(1u);
+    if (!root)
+        return;
+
+    node* stack[max_levels * (children - 1) + 1];
+    unsigned size = 0;
+    stack[size++] = root;
+    while (size)
+    {
+        node* n = stack[--size];
+        if (n->subtree_count == 0)
+            continue;
+        eResult c = classify_frustum_aabb_naive(f, n->bounds);
+        if (c == eOUTSIDE)
+            continue;
+        if (c == eINSIDE)
+        {
+            visit_subtree(n, visit);
+            continue;
+        }
+        for (T* obj = n->first; obj; obj = obj->m_octree_next_obj)
+            if (classify_frustum_aabb_naive(f, obj->bv) != eOUTSIDE)
+                visit(*obj);
+        for_each_child(n, [&](node* child)
+        {
+            stack[size++] = child;
+        });
+    }
+}
+
+/**
+ * @brief
+ * 	Closest hit before tmax. intersect(obj, tmax) returns the hit time of
+ * 	the ray with the object or a negative value. Nodes are visited by the
+ * 	entry time of their aggregate bounds grown by pad and skipped once they
+ * 	start after the closest hit.
+ */
+template<typename T, unsigned Dim>
+template<typename F>
+typename Octree<T, Dim>::hit Octree<T, Dim>::cast(const vec_type& origin, const vec_type& dir, float tmax, const vec_type& pad, F& intersect)const
+{
+    hit result;
+    node* root = find_node(1u);
+    if (!root)
+        return result;
+
+    vec_type inv = 1.0f / dir;
+    float t = intersection_time_ray_box(origin, inv, root->bounds.min - pad, root->bounds.max + pad, tmax);
+    if (t < 0.0f)
+        return result;
+
+    std::pair<float, node*> stack[max_levels * (children - 1) + 1];
+    unsigned size = 0;
+    stack[size++] = { t, root };
+    while (size)
+    {
+        auto [entry, n] = stack[--size];
+        if (entry > tmax)
+            continue;
+        for (T* obj = n->first; obj; obj = obj->m_octree_next_obj)
+        {
+            float hit_t = intersect(*obj, tmax);
+            if (hit_t >= 0.0f && hit_t <= tmax)
+            {
+                tmax = hit_t;
+                result = { obj, hit_t };
+            }
+        }
+
+        // Children sorted far to near, so the nearest is popped first
+        unsigned first = size;
+        for_each_child(n, [&](node* child)
+        {
+            if (float child_t = intersection_time_ray_box(origin, inv, child->bounds.min - pad, child->bounds.max + pad, tmax); child_t >= 0.0f)
+                stack[size++] = { child_t, child };
+        });
+        std::sort(stack + first, stack + size, [](auto const& a, auto const& b) { return a.first > b.first; });
+    }
+    return result;
+}
+
+/**
+ * @brief
+ * 	Closest hit before tmax. intersect(obj, tmax) returns the hit time of
+ * 	the ray with the object or a negative value.
+ */
+template<typename T, unsigned Dim>
+template<typename F>
+typename Octree<T, Dim>::hit Octree<T, Dim>::raycast(const vec_type& origin, const vec_type& dir, float tmax, F&& intersect)const
+{
+    return cast(origin, dir, tmax, vec_type(0.0f), intersect);
+}
+
+/**
+ * @brief
+ * 	Closest object bv hit before tmax
+ */
+template<typename T, unsigned Dim>
+typename Octree<T, Dim>::hit Octree<T, Dim>::raycast(const vec_type& origin, const vec_type& dir, float tmax)const
+{
+    vec_type inv = 1.0f / dir;
+    return raycast(origin, dir, tmax, [&](const T& obj, float t) { return intersection_time_ray_box(origin, inv, obj.bv.min, obj.bv.max, t); });
+}
+
+/**
+ * @brief
+ * 	Earliest object hit by box moving by displacement, as the fraction of
+ * 	displacement travelled. intersect(obj, tmax) returns the time of impact
+ * 	with the object or a negative value. Only the nodes whose aggregate
+ * 	bounds the swept box touches are visited: those the ray of its center
+ * 	hits once grown by its half size. One sweep replaces substepping the
+ * 	motion with overlap queries, and does not tunnel through thin objects.
+ */
+template<typename T, unsigned Dim>
+template<typename F>
+typename Octree<T, Dim>::hit Octree<T, Dim>::sweep_aabb(const bounds_type& box, const vec_type& displacement, F&& intersect)const
+{
+    return cast((box.min + box.max) * 0.5f, displacement, 1.0f, (box.max - box.min) * 0.5f, intersect);
+}
+
+/**
+ * @brief
+ * 	Earliest object bv hit by box moving by displacement
+ */
+template<typename T, unsigned Dim>
+typename Octree<T, Dim>::hit Octree<T, Dim>::sweep_aabb(const bounds_type& box, const vec_type& displacement)const
+{
+    vec_type center = (box.min + box.max) * 0.5f;
+    vec_type half = (box.max - box.min) * 0.5f;
+    vec_type inv = 1.0f / displacement;
+    return sweep_aabb(box, displacement, [&](const T& obj, float t) { return intersection_time_ray_box(center, inv, obj.bv.min - half, obj.bv.max + half, t); });
+}
+
+/**
+ * @brief
+ * 	Earliest object hit by a sphere moving by displacement, as the fraction
+ * 	of displacement travelled. Nodes are visited as for the box around the
+ * 	sphere, which never starts later than the sphere.
+ */
+template<typename T, unsigned Dim>
+template<typename F>
+typename Octree<T, Dim>::hit Octree<T, Dim>::sweep_sphere(const vec_type& center, float radius, const vec_type& displacement, F&& intersect)const requires (Dim == 3)
+{
+    return cast(center, displacement, 1.0f, vec_type(radius), intersect);
+}
+
+/**
+ * @brief
+ * 	Earliest object bv hit by a sphere moving by displacement, exact at the
+ * 	edges and corners of the bv
+ */
+template<typename T, unsigned Dim>
+typename Octree<T, Dim>::hit Octree<T, Dim>::sweep_sphere(const vec_type& center, float radius, const vec_type& displacement)const requires (Dim == 3)
+{
+    return sweep_sphere(center, radius, displacement, [&](const T& obj, float t) { return intersection_time_sphere_aabb(center, radius, displacement, obj.bv.min, obj.bv.max, t); });
+}
+
+/**
+ * @brief
+ * 	The k objects whose bv is nearest to point, nearest first. Nodes are
+ * 	visited best first by the distance to their aggregate bounds.
+ */
+template<typename T, unsigned Dim>
+void Octree<T, Dim>::nearest(const vec_type& point, unsigned k, std::vector<T*>& out, float max_distance)const
+{
+    out.clear();
+    node* root = find_node(1u);
+    if (!root || k == 0)
+        return;
+
+    using entry = std::pair<float, node*>;
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> open;
+    std::vector<std::pair<float, T*>> best; // Max heap of the k nearest
+    float bound = max_distance * max_distance;
+
+    open.emplace(sq_distance_point_box(point, root->bounds.min, root->bounds.max), root);
+    while (!open.empty() && open.top().first <= bound)
+    {
+        node* n = open.top().second;
+        open.pop();
+        for (T* obj = n->first; obj; obj = obj->m_octree_next_obj)
+        {
+            float d = sq_distance_point_box(point, obj->bv.min, obj->bv.max);
+            if (d > bound)
+                continue;
+            best.emplace_back(d, obj);
+            std::push_heap(best.begin(), best.end());
+            if (best.size() > k)
+            {
+                std::pop_heap(best.begin(), best.end());
+                best.pop_back();
+            }
+            if (best.size() == k)
+                bound = best.front().first;
+        }
+        for_each_child(n, [&](node* child)
+        {
+            if (float d = sq_distance_point_box(point, child->bounds.min, child->bounds.max); d <= bound)
+                open.emplace(d, child);
+        });
+    }
+
+    std::sort_heap(best.begin(), best.end());
+    for (auto const& [d, obj] : best)
+        out.push_back(obj);
+}
+
+/**
+ * @brief
+ * 	Object with the nearest surface to point within max_distance, t being
+ * 	its distance. distance(obj, max) returns the distance of point to the
+ * 	surface of obj or a negative value if it is not within max. Nodes and
+ * 	objects share one queue ordered by the distance to their bounds, so
+ * 	surfaces are tested nearest bounds first and the search stops at the
+ * 	first bounds past the nearest surface found.
+ */
+template<typename T, unsigned Dim>
+template<typename F>
+typename Octree<T, Dim>::hit Octree<T, Dim>::closest(const vec_type& point, float max_distance, F&& distance)const
+{
+    hit result;
+    node* root = find_node(1u);
+    if (!root)
+        return result;
+
+    struct entry
+    {
+        float d; // Squared, to the bounds
+        node* n;
+        T* obj;
+        bool operator>(const entry& rhs) const { return d > rhs.d; }
+    };
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> open;
+    float bound = max_distance == FLT_MAX ? FLT_MAX : max_distance * max_distance;
+
+    open.push({ sq_distance_point_box(point, root->bounds.min, root->bounds.max), root, nullptr });
+    while (!open.empty() && open.top().d <= bound)
+    {
+        entry e = open.top();
+        open.pop();
+        if (e.obj)
+        {
+            float d = distance(*e.obj, result.object ? result.t : max_distance);
+            if (d >= 0.0f && (!result.object || d <= result.t) && d * d <= bound)
+            {
+                result = { e.obj, d };
+                bound = d * d;
+            }
+            continue;
+        }
+
+        for (T* obj = e.n->first; obj; obj = obj->m_octree_next_obj)
+            if (float d = sq_distance_point_box(point, obj->bv.min, obj->bv.max); d <= bound)
+                open.push({ d, nullptr, obj });
+        for_each_child(e.n, [&](node* child)
+        {
+            if (float d = sq_distance_point_box(point, child->bounds.min, child->bounds.max); d <= bound)
+                open.push({ d, child, nullptr });
+        });
+    }
+    return result;
+}
+
+template<typename T, unsigned Dim>
+bool Octree<T, Dim>::overlaps(const bounds_type& a, const bounds_type& b)
+{
+    bool result = true;
+    LocationalCode::unroll<Dim>([&](unsigned i) { result &= a.min[i] <= b.max[i] && b.min[i] <= a.max[i]; });
+    return result;
+}
+
+/**
+ * @brief
+ * 	Links an object that is not in any node at the head of the node list
+ */
+template<typename T, unsigned Dim>
+typename Octree<T, Dim>::node* Octree<T, Dim>::insert(T& obj, unsigned int loc)
+{
+    node* n = create_node(loc);
+    if (!n)
+        return nullptr;
+    link(obj, n);
+    return n;
+}
+
+/**
+ * @brief
+ * 	Unlinks an object from its node and prunes the nodes left empty. In
+ * 	adaptive mode the subtrees left with too few objects are merged.
+ */
+template<typename T, unsigned Dim>
+void Octree<T, Dim>::remove(T& obj)
+{
+    node* n = obj.m_octree_node;
+    if (!n)
+        return;
+
+    unlink(obj);
+    unsigned loc = n->locational_code;
+    prune(n);
+    refit(loc);
+
+    if (!m_adaptive)
+        return;
+
+    // Highest ancestor left with too few objects, counts only grow going up
+    node* merged = nullptr;
+    for (unsigned it = loc; it != 0u; it >>= Dim)
+        if (node* ancestor = find_node(it))
+        {
+            if (ancestor->subtree_count >= m_adaptive_settings.merge_count)
+                break;
+            merged = ancestor;
+        }
+    if (merged && merged->children_active)
+        merge(merged);
+}
+
+/**
+ * @brief
+ * 	Moves an object whose bv changed to the node loc, or refits its node
+ * 	if it stays there
+ */
+template<typename T, unsigned Dim>
+typename Octree<T, Dim>::node* Octree<T, Dim>::relocate(T& obj, unsigned int loc)
+{
+    node* n = obj.m_octree_node;
+    if (n && n->locational_code == loc)
+    {
+        refit(loc);
+        return n;
+    }
+    remove(obj);
+    return insert(obj, loc);
+}
+
+/**
+ * @brief
+ * 	Adaptive mode: links an object to the deepest existing node that
+ * 	contains it, which splits if it gets too many objects
+ */
+template<typename T, unsigned Dim>
+typename Octree<T, Dim>::node* Octree<T, Dim>::insert(T& obj)
+{
+    unsigned target = LocationalCode::compute_locational_code<Dim>(obj.bv, m_root_size, m_levels);
+    node*    n      = create_node(1u);
+    for (unsigned d = 1; d <= depth(target); d++)
+    {
+        // Nodes over split_count were split already, what is left in them does not fit a child
+        unsigned child = target >> (Dim * (depth(target) - d));
+        node*    found = find_node(child);
+        if (!found && n->object_count <= m_adaptive_settings.split_count)
+            break;
+        n = found ? found : create_node(child);
+    }
+
+    link(obj, n);
+    if (n->object_count == m_adaptive_settings.split_count + 1 && depth(n->locational_code) < m_levels)
+        split(n);
+    return obj.m_octree_node;
+}
+
+/**
+ * @brief
+ * 	Adaptive mode: moves an object whose bv changed
+ */
+template<typename T, unsigned Dim>
+typename Octree<T, Dim>::node* Octree<T, Dim>::relocate(T& obj)
+{
+    remove(obj);
+    return insert(obj);
+}
+
+/**
+ * @brief
+ * 	Moves many objects whose bv changed. Their nodes are refit once for the
+ * 	whole batch, deepest first, instead of once per object. In adaptive
+ * 	mode they are relocated one at a time.
+ */
+template<typename T, unsigned Dim>
+void Octree<T, Dim>::relocate(std::span<T* const> objects)
+{
+    if (m_adaptive)
+    {
+        for (T* obj : objects)
+            relocate(*obj);
+        return;
+    }
+
+    // Deeper nodes have larger codes, so a max heap refits children before their parents
+    std::priority_queue<unsigned> pending;
+    for (T* obj : objects)
+    {
+        unsigned loc = LocationalCode::compute_locational_code<Dim>(obj->bv, m_root_size, m_levels);
+        node*    n   = obj->m_octree_node;
+        if (n)
+        {
+            pending.push(n->locational_code);
+            if (n->locational_code == loc)
+                continue;
+            unlink(*obj);
+        }
+        insert(*obj, loc);
+        pending.push(loc);
+    }
+
+    unsigned last = 0;
+    while (!pending.empty())
+    {
+        unsigned loc = pending.top();
+        pending.pop();
+        if (loc == last || loc == 0u)
+            continue;
+        last = loc;
+
+        node* n = find_node(loc);
+        if (n && !n->first && n->children_active == 0)
+        {
+            prune(n);
+            pending.push(loc >> Dim);
+            continue;
+        }
+        if (!n)
+        {
+            pending.push(loc >> Dim);
+            continue;
+        }
+
+        vec_type mn = vec_type(FLT_MAX), mx = vec_type(-FLT_MAX);
+        for (T* obj = n->first; obj; obj = obj->m_octree_next_obj)
+        {
+            mn = glm::min(mn, obj->bv.min);
+            mx = glm::max(mx, obj->bv.max);
+        }
+        for_each_child(n, [&](node* child)
+        {
+            mn = glm::min(mn, child->bounds.min);
+            mx = glm::max(mx, child->bounds.max);
+        });
+        if (mn == n->bounds.min && mx == n->bounds.max)
+            continue;
+        n->bounds = bounds_type(mn, mx);
+        m_bounds_revision++;
+        pending.push(loc >> Dim);
+    }
+}
+
+template<typename T, unsigned Dim>
+void Octree<T, Dim>::link(T& obj, node* n)
+{
+    obj.m_octree_node     = n;
+    obj.m_octree_prev_obj = nullptr;
+    obj.m_octree_next_obj = n->first;
+    if (n->first)
+        n->first->m_octree_prev_obj = &obj;
+    n->first = &obj;
+    n->object_count++;
+
+    // Grow the aggregates up to the first one that already contains obj
+    bool grow = true;
+    for (node* it = n; it; it = it->locational_code == 0b1 ? nullptr : find_node(it->locational_code >> Dim))
+    {
+        it->subtree_count++;
+        vec_type mn = glm::min(it->bounds.min, obj.bv.min);
+        vec_type mx = glm::max(it->bounds.max, obj.bv.max);
+        grow = grow && (mn != it->bounds.min || mx != it->bounds.max);
+        if (grow)
+        {
+            it->bounds = bounds_type(mn, mx);
+            m_bounds_revision++;
+        }
+    }
+}
+
+/**
+ * @brief
+ * 	Takes an object out of its node list, the aggregates are not refit
+ */
+template<typename T, unsigned Dim>
+void Octree<T, Dim>::unlink(T& obj)
+{
+    node* n = obj.m_octree_node;
+    if (obj.m_octree_prev_obj)
+        obj.m_octree_prev_obj->m_octree_next_obj = obj.m_octree_next_obj;
+    else
+        n->first = obj.m_octree_next_obj;
+    if (obj.m_octree_next_obj)
+        obj.m_octree_next_obj->m_octree_prev_obj = obj.m_octree_prev_obj;
+    n->object_count--;
+    for (node* it = n; it; it = it->locational_code == 0b1 ? nullptr : find_node(it->locational_code >> Dim))
+        it->subtree_count--;
+
+    obj.m_octree_node     = nullptr;
+    obj.m_octree_next_obj = nullptr;
+    obj.m_octree_prev_obj = nullptr;
+}
+
+/**
+ * @brief
+ * 	Moves the objects of n that fit in a child down to it, then splits the
+ * 	children that got too many. The aggregate of n does not change.
+ */
+template<typename T, unsigned Dim>
+void Octree<T, Dim>::split(node* n)
+{
+    unsigned loc = n->locational_code;
+    unsigned d   = depth(loc);
+    for (T* obj = n->first; obj;)
+    {
+        T*       next   = obj->m_octree_next_obj;
+        unsigned target = LocationalCode::compute_locational_code<Dim>(obj->bv, m_root_size, m_levels);
+        if (depth(target) > d)
+        {
+            unlink(*obj);
+            link(*obj, create_node(target >> (Dim * (depth(target) - d - 1))));
+        }
+        obj = next;
+    }
+
+    if (d + 1 < m_levels)
+        for (unsigned i = 0; i < children; i++)
+            if (n->children_active & (1u << i))
+                if (node* child = find_node((loc << Dim) + i); child && child->object_count > m_adaptive_settings.split_count)
+                    split(child);
+}
+
+/**
+ * @brief
+ * 	Moves the objects of the descendants of n up to it and deletes them.
+ * 	The aggregate of n does not change.
+ */
+template<typename T, unsigned Dim>
+void Octree<T, Dim>::merge(node* n)
+{
+    std::vector<node*> subtree;
+    children_nodes(n, subtree, -1);
+    for (node* it : subtree)
+    {
+        if (it == n)
+            continue;
+        while (T* obj = it->first)
+        {
+            unlink(*obj);
+            link(*obj, n);
+        }
+    }
+    for (node* it : subtree)
+        if (it != n)
+            delete_node(it->locational_code);
+    n->children_active = 0;
+}
+
+/**
+ * @brief
+ * 	Recomputes the aggregate bounds of the deepest existing node on the
+ * 	path to loc, and of its ancestors while they change
+ */
+template<typename T, unsigned Dim>
+void Octree<T, Dim>::refit(unsigned int loc)
+{
+    node* n = nullptr;
+    while (loc != 0u && !(n = find_node(loc)))
+        loc >>= Dim;
+
+    while (n)
+    {
+        vec_type mn = vec_type(FLT_MAX), mx = vec_type(-FLT_MAX);
+        for (T* obj = n->first; obj; obj = obj->m_octree_next_obj)
+        {
+            mn = glm::min(mn, obj->bv.min);
+            mx = glm::max(mx, obj->bv.max);
+        }
+        for_each_child(n, [&](node* child)
+        {
+            mn = glm::min(mn, child->bounds.min);
+            mx = glm::max(mx, child->bounds.max);
+        });
+        if (mn == n->bounds.min && mx == n->bounds.max)
+            return;
+        n->bounds = bounds_type(mn, mx);
+        m_bounds_revision++;
+        n = n->locational_code == 0b1 ? nullptr : find_node(n->locational_code >> Dim);
+    }
+}
+
+/**
+ * @brief
+ * 	Deletes a node without objects nor children, then tries its parent
+ */
+template<typename T, unsigned Dim>
+void Octree<T, Dim>::prune(node* n)
+{
+    while (n && !n->first && n->children_active == 0)
+    {
+        unsigned loc = n->locational_code;
+        delete_node(loc);
+        if (loc == 0b1)
+            return;
+
+        n = find_node(loc >> Dim);
+        if (n)
+            n->children_active &= ~(1u << (loc & child_mask));
+    }
+}
+
+template<typename T, unsigned Dim>
+void Octree<T, Dim>::set_root_size(unsigned s)
 {
     m_root_size = s;
 }
 
-template<typename T>
-void Octree<T>::set_levels(unsigned l)
+template<typename T, unsigned Dim>
+void Octree<T, Dim>::set_levels(unsigned l)
 {
     m_levels = l;
 }
 
+/**
+ * @brief
+ * 	Switches insert(obj) and remove() to adaptive subdivision, objects
+ * 	already in the tree are not moved. Subdivides up to max_depth, which
+ * 	becomes the level count.
+ */
+template<typename T, unsigned Dim>
+void Octree<T, Dim>::set_adaptive(bool adaptive, const adaptive_settings& s)
+{
+    m_adaptive = adaptive;
+    if (!adaptive)
+        return;
+    m_adaptive_settings = s;
+    m_levels            = std::min({ s.max_depth, static_cast<unsigned>(std::bit_width(m_root_size) - 1), max_levels });
+}
+
 #endif
\ No newline at end of file
@@ -75,7 +75,7 @@ namespace LocationalCode
         biggest >>= (bigSentinel - smallSentinel);
 
         unsigned commonBits = 1;
-        for (long int i = smallSentinel - dimension; i >= 0; i -= dimension)
+        for (long int i = static_cast<long int>(smallSentinel) - static_cast<long int>(dimension); i >= 0; i -= dimension)
         {
             unsigned smallShift = smallest >> i;
             unsigned bigShift = biggest >> i;
@@ -86,6 +86,50 @@ namespace LocationalCode
         }
         return commonBits;
     }
+
+    template<unsigned dimension>
+    int compute_locational_code(const box<dimension>& bv, const unsigned root_size, const unsigned levels)
+    {
+        // rounded values
+        using pos = glm::vec<dimension, long long>;
+        unsigned minLoc = compute_locational_code<dimension>(pos(glm::floor(bv.min)), root_size, levels);
+        unsigned maxLoc = compute_locational_code<dimension>(pos(glm::ceil(bv.max)), root_size, levels);
+
+        return common_locational_code<dimension>(minLoc, maxLoc);
+    }
+
+    template<unsigned dimension>
+    box<dimension> compute_bv(unsigned loc, float size)
+    {
+        size /= 2.0f;
+        glm::vec<dimension, float> min(-size), max(size);
+
+        // From the root down, each level halves the cell on every axis
+        unsigned depth = (std::bit_width(loc) - 1) / dimension;
+        for (unsigned level = depth; level-- > 0;)
+        {
+            unsigned code = loc >> (level * dimension);
+            unroll<dimension>([&](unsigned j) { (code & (1u << j)) ? min[j] += size : max[j] -= size; });
+            size /= 2.0f;
+        }
+        return box<dimension>(min, max);
+    }
+
+    /**
+     * @brief
+     * 	Child of cell on the same side of every splitting plane as eye.
+     * 	Visiting the children as nearest ^ i, i = 0..2^dimension-1, goes
+     * 	front to back: a child comes after all the children that differ from
+     * 	nearest in a subset of its axes, which are the only ones that can
+     * 	occlude it
+     */
+    template<unsigned dimension>
+    unsigned nearest_child(const box<dimension>& cell, const glm::vec<dimension, float>& eye)
+    {
+        unsigned child = 0;
+        unroll<dimension>([&](unsigned j) { child |= (eye[j] >= (cell.min[j] + cell.max[j]) * 0.5f ? 1u : 0u) << j; });
+        return child;
+    }
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include "octree_image.hpp"
+#include "geometry.hpp"
+#include <bit>
+#include <fstream>
+
+/**
+ * @brief
+ * 	FNV-1a, 64 bits
+ */
+uint64_t octree_image::hash_bytes(void const* data, std::size_t size, uint64_t seed)
+{
+    auto const* bytes = static_cast<unsigned char const*>(data);
+    uint64_t    h     = seed;
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+/**
+ * @brief
+ * 	Hash of the file contents, 0 if the file can not be opened
+ */
+uint64_t octree_image::hash_file(std::string const& filename)
+{
+    mapped_file file;
+    if (!file.open(filename))
+        return 0;
+    return hash_bytes(file.data(), file.size());
+}
+
+bool octree_image::write(std::string const& filename, std::vector<char> const& image)
+{
+    std::ofstream fs(filename, std::ios::binary);
+    if (!fs.is_open())
+        return false;
+    fs.write(image.data(), static_cast<std::streamsize>(image.size()));
+    return fs.good();
+}
+
+/**
+ * @brief
+ * 	Maps an image, rejecting it if it was built from a different scene
+ */
+bool octree_image::open(std::string const& filename, uint64_t scene_hash)
+{
+    close();
+    if (!m_file.open(filename))
+        return false;
+    if (!view(m_file.data(), m_file.size()) || m_header->scene_hash != scene_hash)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief
+ * 	Uses an image already in memory. Only the structure is validated, the
+ * 	data is not copied.
+ */
+bool octree_image::view(char const* data, std::size_t size)
+{
+    m_header  = nullptr;
+    m_nodes   = {};
+    m_objects = {};
+
+    if (!data || size < sizeof(header))
+        return false;
+
+    auto const* h = reinterpret_cast<header const*>(data);
+    if (std::memcmp(h->magic, magic, sizeof(magic)) != 0 || h->version != version)
+        return false;
+    if (h->nodes_offset > size || (size - h->nodes_offset) / sizeof(node) < h->node_count)
+        return false;
+    if (h->objects_offset > size || (size - h->objects_offset) / sizeof(object) < h->object_count)
+        return false;
+
+    std::span<node const>   nodes(reinterpret_cast<node const*>(data + h->nodes_offset), h->node_count);
+    std::span<object const> objects(reinterpret_cast<object const*>(data + h->objects_offset), h->object_count);
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+        node const& n = nodes[i];
+        if (n.first_object > objects.size() || objects.size() - n.first_object < n.object_count)
+            return false;
+        if (n.child_mask && (n.first_child >= nodes.size() || nodes.size() - n.first_child < static_cast<unsigned>(std::popcount(n.child_mask))))
+            return false;
+        if (n.child_mask && n.first_child <= i) // Breadth first, a child before its parent would make the traversals cycle
+            return false;
+    }
+
+    m_header  = h;
+    m_nodes   = nodes;
+    m_objects = objects;
+    return true;
+}
+
+void octree_image::close()
+{
+    m_header  = nullptr;
+    m_nodes   = {};
+    m_objects = {};
+    m_file.close();
+}
+
+/**
+ * @brief
+ * 	Walks down from the root following the child bits of the code
+ */
+octree_image::node const* octree_image::find_node(unsigned loc) const
+{
+    if (m_nodes.empty() || loc == 0)
+        return nullptr;
+
+    unsigned depth = 0;
+    while ((loc >> (depth * 3)) > 1)
+        ++depth;
+
+    node const* n = &m_nodes[0];
+    while (depth--)
+    {
+        unsigned child = (loc >> (depth * 3)) & 0b111;
+        if (!(n->child_mask & (1u << child)))
+            return nullptr;
+        n = &m_nodes[n->first_child + std::popcount(n->child_mask & ((1u << child) - 1))];
+    }
+    return n->locational_code == loc ? n : nullptr;
+}
+
+void octree_image::query_frustum(frustrum const& frustum, std::vector<uint32_t>& result) const
+{
+    if (m_nodes.empty())
+        return;
+
+    std::vector<std::pair<uint32_t, bool>> stack{ { 0u, false } }; // Node, already known to be inside
+    while (!stack.empty())
+    {
+        auto [index, inside] = stack.back();
+        stack.pop_back();
+
+        node const& n = m_nodes[index];
+        if (!inside)
+        {
+            eResult c = classify_frustum_aabb_naive(frustum, aabb(n.bv_min, n.bv_max));
+            if (c == eOUTSIDE)
+                continue;
+            inside = c == eINSIDE;
+        }
+
+        for (auto const& obj : m_objects.subspan(n.first_object, n.object_count))
+            if (inside || classify_frustum_aabb_naive(frustum, aabb(obj.bv_min, obj.bv_max)) != eOUTSIDE)
+                result.push_back(obj.index);
+
+        for (unsigned c = 0, count = std::popcount(n.child_mask); c < count; ++c)
+            stack.emplace_back(n.first_child + c, inside);
+    }
+}
+
+void octree_image::query_aabb(aabb const& bv, std::vector<uint32_t>& result) const
+{
+    if (m_nodes.empty())
+        return;
+
+    std::vector<uint32_t> stack{ 0u };
+    while (!stack.empty())
+    {
+        node const& n = m_nodes[stack.back()];
+        stack.pop_back();
+        if (!overlap_aabb_aabb(n.bv_min, n.bv_max, bv.min, bv.max))
+            continue;
+
+        for (auto const& obj : m_objects.subspan(n.first_object, n.object_count))
+            if (overlap_aabb_aabb(obj.bv_min, obj.bv_max, bv.min, bv.max))
+                result.push_back(obj.index);
+
+        for (unsigned c = 0, count = std::popcount(n.child_mask); c < count; ++c)
+            stack.push_back(n.first_child + c);
+    }
+}
@@ -0,0 +1,149 @@
+#ifndef _OCTREE_IMAGE__HPP_
+#define _OCTREE_IMAGE__HPP_
+
+#include "octree.hpp"
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+/**
+ * @brief
+ * 	Read-only, relocatable snapshot of an Octree. Every reference inside the
+ * 	image is an index, so it can be queried in place from a memory mapping
+ * 	(and shared by several processes) without deserializing it.
+ *
+ * 	Nodes are stored breadth first and the children of a node are
+ * 	contiguous, ordered by child index. Objects are stored grouped by node.
+ */
+class octree_image
+{
+public:
+    static constexpr char     magic[4] = { 'O', 'C', 'T', 'I' };
+    static constexpr uint32_t version  = 1;
+
+    struct header
+    {
+        char     magic[4];
+        uint32_t version;
+        uint64_t scene_hash;     // Hash of the scene the image was built from
+        uint32_t root_size;
+        uint32_t levels;
+        uint32_t node_count;
+        uint32_t object_count;
+        uint64_t nodes_offset;   // From the start of the image
+        uint64_t objects_offset; // From the start of the image
+    };
+
+    struct node
+    {
+        uint32_t  locational_code;
+        uint32_t  child_mask;
+        uint32_t  first_child;  // Index of the first child node
+        uint32_t  first_object; // Index into the object array
+        glm::vec3 bv_min;       // Cell bounds, grown to fit its objects
+        uint32_t  object_count;
+        glm::vec3 bv_max;
+        uint32_t  reserved;
+    };
+
+    struct object
+    {
+        uint32_t  index; // Index of the object in the scene
+        glm::vec3 bv_min;
+        glm::vec3 bv_max;
+    };
+    static_assert(sizeof(header) == 48 && sizeof(node) == 48 && sizeof(object) == 28, "Layouts are part of the file format");
+
+    static uint64_t hash_bytes(void const* data, std::size_t size, uint64_t seed = 14695981039346656037ull);
+    static uint64_t hash_file(std::string const& filename);
+
+    template<typename T, typename IndexFn>
+    static std::vector<char> build(Octree<T> const& tree, uint64_t scene_hash, IndexFn&& index_of);
+    static bool write(std::string const& filename, std::vector<char> const& image);
+
+    bool open(std::string const& filename, uint64_t scene_hash);
+    bool view(char const* data, std::size_t size);
+    void close();
+
+    [[nodiscard]] bool is_open() const { return m_header != nullptr; }
+    [[nodiscard]] header const& info() const { return *m_header; }
+    [[nodiscard]] std::span<node const> nodes() const { return m_nodes; }
+    [[nodiscard]] std::span<object const> objects() const { return m_objects; }
+
+    node const* find_node(unsigned loc) const;
+    void query_frustum(frustrum const& frustum, std::vector<uint32_t>& result) const;
+    void query_aabb(aabb const& bv, std::vector<uint32_t>& result) const;
+
+private:
+    mapped_file           m_file;
+    header const*         m_header = nullptr;
+    std::span<node const> m_nodes;
+    std::span<object const> m_objects;
+};
+
+/**
+ * @brief
+ * 	Serializes a tree. index_of maps an object to its index in the scene.
+ */
+template<typename T, typename IndexFn>
+std::vector<char> octree_image::build(Octree<T> const& tree, uint64_t scene_hash, IndexFn&& index_of)
+{
+    std::vector<node>   nodes;
+    std::vector<object> objects;
+
+    // Breadth first, so siblings end up contiguous
+    std::vector<typename Octree<T>::node const*> queue;
+    if (auto* root = tree.find_node(1u))
+        queue.push_back(root);
+
+    for (std::size_t i = 0; i < queue.size(); ++i)
+    {
+        auto const* n = queue[i];
+
+        node out{};
+        out.locational_code = n->locational_code;
+        out.first_object    = static_cast<uint32_t>(objects.size());
+        aabb cell           = LocationalCode::compute_bv(n->locational_code, static_cast<float>(tree.root_size()));
+        out.bv_min          = cell.min;
+        out.bv_max          = cell.max;
+
+        // Objects outside the root cell are stored at the root, so grow the bounds
+        for (T const* obj = n->first; obj; obj = obj->m_octree_next_obj)
+        {
+            objects.push_back({ static_cast<uint32_t>(index_of(*obj)), obj->bv.min, obj->bv.max });
+            out.bv_min = glm::min(out.bv_min, obj->bv.min);
+            out.bv_max = glm::max(out.bv_max, obj->bv.max);
+        }
+        out.object_count = static_cast<uint32_t>(objects.size()) - out.first_object;
+
+        out.first_child = static_cast<uint32_t>(queue.size());
+        tree.for_each_child(n, [&](auto* child)
+        {
+            out.child_mask |= 1u << (child->locational_code & Octree<T>::child_mask);
+            queue.push_back(child);
+        });
+        nodes.push_back(out);
+    }
+
+    header h{};
+    std::copy(std::begin(magic), std::end(magic), h.magic);
+    h.version        = version;
+    h.scene_hash     = scene_hash;
+    h.root_size      = tree.root_size();
+    h.levels         = tree.levels();
+    h.node_count     = static_cast<uint32_t>(nodes.size());
+    h.object_count   = static_cast<uint32_t>(objects.size());
+    h.nodes_offset   = sizeof(header);
+    h.objects_offset = h.nodes_offset + nodes.size() * sizeof(node);
+
+    std::vector<char> image(h.objects_offset + objects.size() * sizeof(object));
+    std::memcpy(image.data(), &h, sizeof(h));
+    std::memcpy(image.data() + h.nodes_offset, nodes.data(), nodes.size() * sizeof(node));
+    std::memcpy(image.data() + h.objects_offset, objects.data(), objects.size() * sizeof(object));
+    return image;
+}
+
+#endif
@@ -0,0 +1,187 @@
+#include "octree_tuning.hpp"
+#include "octree.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+    // Keeps the benchmarked culling from being optimized away
+    volatile std::size_t visible_sink = 0;
+
+    struct tuned_object
+    {
+        aabb                          bv;
+        Octree<tuned_object>::node*   m_octree_node     = nullptr;
+        tuned_object*                 m_octree_next_obj = nullptr;
+        tuned_object*                 m_octree_prev_obj = nullptr;
+    };
+
+    // Same traversal as scene::OctreeCheck with aggregate bounds, returns the visible count
+    std::size_t cull(Octree<tuned_object> const& tree, frustrum const& f, Octree<tuned_object>::node const* n, bool inside)
+    {
+        if (!inside) {
+            eResult c = classify_frustum_aabb_naive(f, n->bounds);
+            if (c == eOUTSIDE)
+                return 0;
+            inside = c == eINSIDE;
+        }
+        std::size_t visible = 0;
+        for (auto const* obj = n->first; obj; obj = obj->m_octree_next_obj)
+            visible += inside || classify_frustum_aabb_naive(f, obj->bv) != eOUTSIDE;
+        tree.for_each_child(n, [&](auto const* child) { visible += cull(tree, f, child, inside); });
+        return visible;
+    }
+
+    octree_candidate evaluate(std::span<aabb const> bvs, unsigned size_bit, unsigned levels)
+    {
+        octree_candidate candidate{ size_bit, levels };
+        std::unordered_map<unsigned, std::size_t> counts;
+        for (auto const& bv : bvs)
+            counts[LocationalCode::compute_locational_code(bv, 1u << size_bit, levels)]++;
+
+        std::unordered_set<unsigned> nodes;
+        for (auto const& [loc, count] : counts)
+            for (unsigned it = loc; it != 0u && nodes.insert(it).second; it >>= 3)
+                ;
+        candidate.nodes        = nodes.size();
+        candidate.root_objects = counts.contains(1u) ? counts[1u] : 0;
+        candidate.occupancy    = static_cast<float>(bvs.size()) / static_cast<float>(std::max<std::size_t>(counts.size(), 1));
+        return candidate;
+    }
+
+    float benchmark(std::span<aabb const> bvs, std::span<frustrum const> views, unsigned size_bit, unsigned levels, unsigned runs)
+    {
+        std::vector<tuned_object> objects(bvs.size());
+        Octree<tuned_object>      tree;
+        tree.set_root_size(1u << size_bit);
+        tree.set_levels(levels);
+        for (std::size_t i = 0; i < bvs.size(); ++i) {
+            objects[i].bv = bvs[i];
+            tree.insert(objects[i], LocationalCode::compute_locational_code(bvs[i], tree.root_size(), tree.levels()));
+        }
+
+        using clock = std::chrono::high_resolution_clock;
+        float best = FLT_MAX;
+        for (unsigned run = 0; run < std::max(runs, 1u); ++run) {
+            auto start = clock::now();
+            for (auto const& f : views)
+                visible_sink = visible_sink + cull(tree, f, tree.find_node(1u), false);
+            best = std::min(best, std::chrono::duration<float, std::milli>(clock::now() - start).count());
+        }
+        return best / static_cast<float>(views.size());
+    }
+}
+
+/**
+ * @brief
+ * 	Objects that end up in the root because they are not inside the root
+ * 	cell of the given size
+ */
+std::size_t octree_objects_outside(std::span<aabb const> bvs, unsigned root_size)
+{
+    float half = static_cast<float>(root_size / 2);
+    return std::count_if(bvs.begin(), bvs.end(), [half](aabb const& bv) {
+        return glm::any(glm::lessThan(glm::floor(bv.min), vec3(-half))) || !glm::all(glm::lessThan(glm::ceil(bv.max), vec3(half)));
+    });
+}
+
+/**
+ * @brief
+ * 	The root is the smallest power of two cell, centered at the origin,
+ * 	that contains all but the outliers. Levels go as deep as cells stay
+ * 	cell_to_object times larger than the median object and non empty nodes
+ * 	keep min_occupancy objects on average. With views, the candidates
+ * 	around that estimate are culled against them and the fastest is chosen.
+ */
+octree_tuning_report tune_octree(std::span<aabb const> bvs, std::span<frustrum const> views, octree_tuning_settings const& settings)
+{
+    octree_tuning_report report;
+    report.object_count = bvs.size();
+    report.size_bit     = 1;
+    report.levels       = report.estimated_levels = 1;
+    if (bvs.empty())
+        return report;
+
+    // Extent and size distribution
+    report.extent = bvs[0];
+    std::vector<float> sizes;
+    sizes.reserve(bvs.size());
+    for (auto const& bv : bvs) {
+        report.extent.min = glm::min(report.extent.min, bv.min);
+        report.extent.max = glm::max(report.extent.max, bv.max);
+        vec3 side         = bv.max - bv.min;
+        sizes.push_back(std::max({ side.x, side.y, side.z }));
+    }
+    std::nth_element(sizes.begin(), sizes.begin() + sizes.size() / 2, sizes.end());
+    report.median_size = sizes[sizes.size() / 2];
+    std::nth_element(sizes.begin(), sizes.begin() + sizes.size() * 9 / 10, sizes.end());
+    report.p90_size = sizes[sizes.size() * 9 / 10];
+
+    // Root: smallest that leaves out no more than the outliers. The
+    // locational code holds 3 bits per power of two of the root size.
+    unsigned max_size_bit = (LocationalCode::maxBits - 1) / 3;
+    auto     allowed      = static_cast<std::size_t>(settings.outliers * static_cast<float>(bvs.size()));
+    while (report.size_bit < max_size_bit && octree_objects_outside(bvs, 1u << report.size_bit) > allowed)
+        report.size_bit++;
+
+    // Depth from the statistics
+    unsigned max_levels = std::min(settings.max_levels, report.size_bit);
+    for (unsigned levels = 1; levels <= max_levels; ++levels) {
+        auto  candidate = evaluate(bvs, report.size_bit, levels);
+        float cell      = std::ldexp(1.0f, static_cast<int>(report.size_bit - levels));
+        if (levels == 1 || (cell >= settings.cell_to_object * report.median_size && candidate.occupancy >= settings.min_occupancy))
+            report.estimated_levels = levels;
+        report.candidates.push_back(candidate);
+    }
+    report.levels       = report.estimated_levels;
+    report.outside_root = octree_objects_outside(bvs, 1u << report.size_bit);
+    if (!settings.benchmark || views.empty())
+        return report;
+
+    std::vector<frustrum> sampled;
+    std::size_t           view_count = std::min<std::size_t>(views.size(), std::max(settings.benchmark_views, 1u));
+    for (std::size_t i = 0; i < view_count; ++i)
+        sampled.push_back(views[i * views.size() / view_count]);
+
+    // Fastest around the estimate, also with a root twice as large
+    unsigned estimated_size_bit = report.size_bit;
+    float    best               = FLT_MAX;
+    for (unsigned size_bit = estimated_size_bit; size_bit <= std::min(estimated_size_bit + 1, max_size_bit); ++size_bit) {
+        unsigned first = report.estimated_levels > settings.benchmark_levels ? report.estimated_levels - settings.benchmark_levels : 1;
+        unsigned last  = std::min({ report.estimated_levels + settings.benchmark_levels + (size_bit - estimated_size_bit), settings.max_levels, size_bit });
+        for (unsigned levels = first; levels <= last; ++levels) {
+            bool  listed    = size_bit == estimated_size_bit;
+            auto& candidate = listed ? report.candidates[levels - 1] : report.candidates.emplace_back(evaluate(bvs, size_bit, levels));
+            candidate.ms    = benchmark(bvs, sampled, size_bit, levels, settings.benchmark_runs);
+            if (candidate.ms < best) {
+                best            = candidate.ms;
+                report.size_bit = size_bit;
+                report.levels   = levels;
+            }
+        }
+    }
+    report.outside_root = octree_objects_outside(bvs, 1u << report.size_bit);
+    report.benchmarked  = true;
+    return report;
+}
+
+void octree_tuning_report::print(std::ostream& os) const
+{
+    os << object_count << " objects, extent (" << extent.min.x << ", " << extent.min.y << ", " << extent.min.z << ") to (" << extent.max.x
+       << ", " << extent.max.y << ", " << extent.max.z << "), object size median " << median_size << ", 90% " << p90_size << "\n";
+    os << "  " << outside_root << " objects outside the chosen root\n";
+    for (auto const& c : candidates) {
+        os << "  root 2^" << c.size_bit << ", " << c.levels << " levels: " << c.nodes << " nodes, " << c.root_objects << " objects in the root, "
+           << c.occupancy << " per node";
+        if (c.ms >= 0.0f)
+            os << ", " << c.ms << " ms";
+        if (c.size_bit == size_bit && c.levels == levels)
+            os << " <- chosen";
+        os << "\n";
+    }
+    if (benchmarked && levels != estimated_levels)
+        os << "  estimated " << estimated_levels << " levels from the statistics\n";
+}
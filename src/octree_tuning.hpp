@@ -0,0 +1,55 @@
+#ifndef _OCTREE_TUNING__HPP_
+#define _OCTREE_TUNING__HPP_
+
+#include "geometry.hpp"
+#include <ostream>
+#include <span>
+#include <vector>
+
+struct octree_tuning_settings
+{
+    float    outliers         = 0.01f; // Fraction of the objects that may be left outside the root, they are stored in it
+    float    cell_to_object   = 4.0f; // Smallest cell size over the median object size
+    float    min_occupancy    = 4.0f; // Objects per non empty node, below it deeper levels are not worth it
+    unsigned max_levels       = 10;   // The locational code fits 10 levels
+    bool     benchmark        = true; // Time the candidates around the estimate, needs views
+    unsigned benchmark_levels = 2;    // Levels tried above and below the estimate
+    unsigned benchmark_runs   = 3;    // Best of
+    unsigned benchmark_views  = 64;   // Evenly sampled from the given views
+};
+
+struct octree_candidate
+{
+    unsigned    size_bit     = 0;
+    unsigned    levels       = 0;
+    std::size_t nodes        = 0;
+    std::size_t root_objects = 0;    // Straddling the root center or outside the root cell
+    float       occupancy    = 0.0f; // Objects per non empty node
+    float       ms           = -1.0f; // Culling time per view, negative if not benchmarked
+};
+
+/**
+ * @brief
+ * 	Octree parameters picked for a scene, with the statistics they come
+ * 	from and every candidate that was considered
+ */
+struct octree_tuning_report
+{
+    aabb        extent;
+    float       median_size  = 0.0f; // Largest side of the object bounds
+    float       p90_size     = 0.0f;
+    unsigned    size_bit     = 0; // Chosen, the root size is 2^size_bit
+    unsigned    levels       = 0;
+    unsigned    estimated_levels = 0; // From the statistics alone
+    bool        benchmarked  = false;
+    std::size_t object_count = 0;
+    std::size_t outside_root = 0; // With the chosen root size
+    std::vector<octree_candidate> candidates;
+
+    void print(std::ostream& os) const;
+};
+
+std::size_t          octree_objects_outside(std::span<aabb const> bvs, unsigned root_size);
+octree_tuning_report tune_octree(std::span<aabb const> bvs, std::span<frustrum const> views = {}, octree_tuning_settings const& settings = {});
+
+#endif
@@ -0,0 +1,399 @@
+#ifndef _QUANTIZED_OCTREE__HPP_
+#define _QUANTIZED_OCTREE__HPP_
+
+#include "octree.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define QUANTIZED_OCTREE_SSE2 1
+#endif
+
+/**
+ * @brief
+ * 	Read-only snapshot of an Octree for culling, with the object bounds
+ * 	stored as Q (8 or 16 bits) per axis relative to the aggregate bounds of
+ * 	their node. A node is 32 bytes, an object is its index plus 6 or 12
+ * 	bytes of bounds, against the 48 bytes of an aabb.
+ *
+ * 	Bounds are always rounded outward, so culling with them never drops an
+ * 	object the float bounds keep, and are decoded with SSE2 when available.
+ * 	Nodes are stored breadth first and the children of a node are
+ * 	contiguous, objects are stored grouped by node like in octree_image.
+ */
+template<typename Q>
+class quantized_octree
+{
+    static_assert(std::is_same_v<Q, uint8_t> || std::is_same_v<Q, uint16_t>, "8 or 16 bits per axis");
+
+public:
+    static constexpr uint32_t levels = std::numeric_limits<Q>::max();
+
+    struct node
+    {
+        vec3     origin;       // Bounds decode to origin + q * step, q from 0 to levels
+        uint32_t first_object; // Up to the first object of the next node
+        vec3     step;
+        uint32_t children;     // First child << 4 | child count
+        [[nodiscard]] uint32_t first_child() const { return children >> 4; }
+        [[nodiscard]] uint32_t child_count() const { return children & 15u; }
+    };
+    static_assert(sizeof(node) == 32, "Two nodes per cache line");
+
+    struct box
+    {
+        Q min[3];
+        Q max[3];
+    };
+    static_assert(sizeof(box) == 6 * sizeof(Q), "Packed bounds");
+
+    template<typename T, typename IndexFn>
+    void build(Octree<T> const& tree, IndexFn&& index_of);
+    void clear();
+
+    void frustum(frustrum const& f, std::vector<uint32_t>& out) const;
+    void query(aabb const& region, std::vector<uint32_t>& out) const;
+
+    [[nodiscard]] aabb node_bounds(uint32_t index) const;
+    [[nodiscard]] aabb object_bounds(uint32_t index) const;
+
+    [[nodiscard]] std::span<node const>     nodes() const { return { m_nodes.data(), node_count() }; }
+    [[nodiscard]] std::span<box const>      boxes() const { return { m_boxes.data(), m_indices.size() }; }
+    [[nodiscard]] std::span<uint32_t const> indices() const { return m_indices; }
+    [[nodiscard]] std::size_t               node_count() const { return m_nodes.empty() ? 0 : m_nodes.size() - 1; }
+    [[nodiscard]] bool                      empty() const { return m_nodes.empty(); }
+    [[nodiscard]] std::size_t               memory() const
+    {
+        return m_nodes.size() * sizeof(node) + m_boxes.size() * sizeof(box) + m_indices.size() * sizeof(uint32_t);
+    }
+
+private:
+    // Boxes are read 16 bytes at a time
+    static constexpr std::size_t box_padding = (16 + sizeof(box) - 1) / sizeof(box);
+
+    static node make_node(vec3 const& mn, vec3 const& mx);
+    static box  quantize(node const& n, aabb const& bv);
+    template<typename F>
+    void decode(uint32_t index, F&& f) const;
+
+    std::vector<node>     m_nodes; // One more, for the end of the objects of the last one
+    std::vector<box>      m_boxes; // box_padding more, for the loads of the last ones
+    std::vector<uint32_t> m_indices;
+};
+
+namespace QuantizedBounds {
+    // Both ways the compiler may evaluate origin + q * step
+    inline float decode_low(float origin, float step, uint32_t q)
+    {
+        float scaled = static_cast<float>(q) * step;
+        return std::min(origin + scaled, std::fma(static_cast<float>(q), step, origin));
+    }
+    inline float decode_high(float origin, float step, uint32_t q)
+    {
+        float scaled = static_cast<float>(q) * step;
+        return std::max(origin + scaled, std::fma(static_cast<float>(q), step, origin));
+    }
+
+    inline bool overlaps(vec3 const& mn, vec3 const& mx, aabb const& region)
+    {
+        return overlap_aabb_aabb(mn, mx, region.min, region.max);
+    }
+
+#ifdef QUANTIZED_OCTREE_SSE2
+    inline bool overlaps(__m128 mn, __m128 mx, aabb const& region)
+    {
+        __m128 rmin = _mm_setr_ps(region.min.x, region.min.y, region.min.z, 0.0f);
+        __m128 rmax = _mm_setr_ps(region.max.x, region.max.y, region.max.z, 0.0f);
+        return (_mm_movemask_ps(_mm_and_ps(_mm_cmple_ps(mn, rmax), _mm_cmple_ps(rmin, mx))) & 7) == 7;
+    }
+#endif
+
+    /**
+     * @brief
+     * 	Planes of a frustum, transposed so one box is tested against four
+     * 	planes at a time. An object is outside a plane when its corner
+     * 	nearest to the plane is in front of it, the unused lanes never are.
+     */
+    struct frustum_planes
+    {
+        alignas(16) float nx[8], ny[8], nz[8], d[8];
+
+        explicit frustum_planes(frustrum const& f)
+        {
+            for (unsigned i = 0; i < 8; ++i) {
+                bool used = i < 6;
+                nx[i]     = used ? f.mplanes[i].n.x : 0.0f;
+                ny[i]     = used ? f.mplanes[i].n.y : 0.0f;
+                nz[i]     = used ? f.mplanes[i].n.z : 0.0f;
+                d[i]      = used ? f.mplanes[i].d : 1.0f;
+            }
+        }
+
+        eResult classify(vec3 const& mn, vec3 const& mx) const
+        {
+            bool overlapping = false;
+            for (unsigned i = 0; i < 6; ++i) {
+                float nearest = nx[i] * (nx[i] > 0.0f ? mn.x : mx.x) + ny[i] * (ny[i] > 0.0f ? mn.y : mx.y) +
+                                nz[i] * (nz[i] > 0.0f ? mn.z : mx.z) - d[i];
+                if (nearest > 0.0f)
+                    return eOUTSIDE;
+                float farthest = nx[i] * (nx[i] > 0.0f ? mx.x : mn.x) + ny[i] * (ny[i] > 0.0f ? mx.y : mn.y) +
+                                 nz[i] * (nz[i] > 0.0f ? mx.z : mn.z) - d[i];
+                overlapping |= farthest >= 0.0f;
+            }
+            return overlapping ? eOVERLAPPING : eINSIDE;
+        }
+
+#ifdef QUANTIZED_OCTREE_SSE2
+        // Box corners as (x, y, z, unused) lanes
+        eResult classify(__m128 mn, __m128 mx) const
+        {
+            __m128 const zero = _mm_setzero_ps();
+            __m128 const lx = _mm_shuffle_ps(mn, mn, 0x00), ly = _mm_shuffle_ps(mn, mn, 0x55), lz = _mm_shuffle_ps(mn, mn, 0xAA);
+            __m128 const hx = _mm_shuffle_ps(mx, mx, 0x00), hy = _mm_shuffle_ps(mx, mx, 0x55), hz = _mm_shuffle_ps(mx, mx, 0xAA);
+
+            int overlapping = 0;
+            for (unsigned g = 0; g < 8; g += 4) {
+                __m128 px = _mm_load_ps(nx + g), py = _mm_load_ps(ny + g), pz = _mm_load_ps(nz + g), pd = _mm_load_ps(d + g);
+                __m128 sx = _mm_cmpgt_ps(px, zero), sy = _mm_cmpgt_ps(py, zero), sz = _mm_cmpgt_ps(pz, zero);
+                auto   select = [](__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); };
+
+                __m128 nearest = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, select(sx, lx, hx)), _mm_mul_ps(py, select(sy, ly, hy))),
+                                                       _mm_mul_ps(pz, select(sz, lz, hz))),
+                                            pd);
+                if (_mm_movemask_ps(_mm_cmpgt_ps(nearest, zero)))
+                    return eOUTSIDE;
+                __m128 farthest = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px, select(sx, hx, lx)), _mm_mul_ps(py, select(sy, hy, ly))),
+                                                        _mm_mul_ps(pz, select(sz, hz, lz))),
+                                             pd);
+                overlapping |= _mm_movemask_ps(_mm_cmpge_ps(farthest, zero));
+            }
+            return overlapping ? eOVERLAPPING : eINSIDE;
+        }
+#endif
+    };
+}
+
+/**
+ * @brief
+ * 	Quantization grid of a node with aggregate bounds [mn, mx]. The grid
+ * 	is widened by a few ulps and checked so that its decoded ends contain
+ * 	the bounds whether or not the decode is fused.
+ */
+template<typename Q>
+typename quantized_octree<Q>::node quantized_octree<Q>::make_node(vec3 const& mn, vec3 const& mx)
+{
+    node n{};
+    for (int i = 0; i < 3; ++i) {
+        float slack = 4.0f * FLT_EPSILON * (std::abs(mn[i]) + std::abs(mx[i])) + FLT_MIN;
+        n.origin[i] = mn[i] - slack;
+        n.step[i]   = (mx[i] - mn[i] + 2.0f * slack) / static_cast<float>(levels);
+        while (QuantizedBounds::decode_low(n.origin[i], n.step[i], levels) < mx[i])
+            n.step[i] = std::nextafter(n.step[i], FLT_MAX);
+    }
+    return n;
+}
+
+/**
+ * @brief
+ * 	Rounds bv outward to the grid of n, it must be inside the node bounds
+ */
+template<typename Q>
+typename quantized_octree<Q>::box quantized_octree<Q>::quantize(node const& n, aabb const& bv)
+{
+    box b{};
+    for (int i = 0; i < 3; ++i) {
+        double   scale = n.step[i] > 0.0f ? 1.0 / n.step[i] : 0.0;
+        double   lo    = std::floor((static_cast<double>(bv.min[i]) - n.origin[i]) * scale);
+        double   hi    = std::ceil((static_cast<double>(bv.max[i]) - n.origin[i]) * scale);
+        uint32_t qmin  = static_cast<uint32_t>(std::clamp(lo, 0.0, static_cast<double>(levels)));
+        uint32_t qmax  = static_cast<uint32_t>(std::clamp(hi, 0.0, static_cast<double>(levels)));
+        while (qmin > 0 && QuantizedBounds::decode_high(n.origin[i], n.step[i], qmin) > bv.min[i])
+            qmin--;
+        while (qmax < levels && QuantizedBounds::decode_low(n.origin[i], n.step[i], qmax) < bv.max[i])
+            qmax++;
+        b.min[i] = static_cast<Q>(qmin);
+        b.max[i] = static_cast<Q>(qmax);
+    }
+    return b;
+}
+
+/**
+ * @brief
+ * 	Snapshots a tree. index_of maps an object to its index in the scene.
+ */
+template<typename Q>
+template<typename T, typename IndexFn>
+void quantized_octree<Q>::build(Octree<T> const& tree, IndexFn&& index_of)
+{
+    static_assert(Octree<T>::children <= 15u, "The child count takes 4 bits of node::children");
+    clear();
+
+    // Breadth first, so siblings end up contiguous
+    std::vector<typename Octree<T>::node const*> queue;
+    if (auto* root = tree.find_node(1u))
+        queue.push_back(root);
+
+    for (std::size_t i = 0; i < queue.size(); ++i) {
+        auto const* n      = queue[i];
+        bool const  filled = n->subtree_count != 0;
+
+        node out         = filled ? make_node(n->bounds.min, n->bounds.max) : node{};
+        out.first_object = static_cast<uint32_t>(m_indices.size());
+        for (T const* obj = n->first; obj; obj = obj->m_octree_next_obj) {
+            m_indices.push_back(static_cast<uint32_t>(index_of(*obj)));
+            m_boxes.push_back(quantize(out, obj->bv));
+        }
+
+        uint32_t first = static_cast<uint32_t>(queue.size()), count = 0;
+        tree.for_each_child(n, [&](auto const* child) {
+            queue.push_back(child);
+            count++;
+        });
+        out.children = first << 4 | count;
+        m_nodes.push_back(out);
+    }
+    if (m_nodes.empty())
+        return;
+
+    node end{};
+    end.first_object = static_cast<uint32_t>(m_indices.size());
+    m_nodes.push_back(end);
+    m_boxes.resize(m_boxes.size() + box_padding);
+}
+
+template<typename Q>
+void quantized_octree<Q>::clear()
+{
+    m_nodes.clear();
+    m_boxes.clear();
+    m_indices.clear();
+}
+
+template<typename Q>
+aabb quantized_octree<Q>::node_bounds(uint32_t index) const
+{
+    node const& n = m_nodes[index];
+    return aabb(n.origin, n.origin + n.step * static_cast<float>(levels));
+}
+
+template<typename Q>
+aabb quantized_octree<Q>::object_bounds(uint32_t index) const
+{
+    auto it = std::upper_bound(m_nodes.begin(), m_nodes.end() - 1, index, [](uint32_t i, node const& n) { return i < n.first_object; });
+    node const& n = *(it - 1);
+    box const&  b = m_boxes[index];
+    return aabb(n.origin + vec3(b.min[0], b.min[1], b.min[2]) * n.step, n.origin + vec3(b.max[0], b.max[1], b.max[2]) * n.step);
+}
+
+/**
+ * @brief
+ * 	Calls f(i, min, max) with the decoded bounds of every object of a
+ * 	node, as (x, y, z, unused) SSE2 lanes or as vec3 without SSE2
+ */
+template<typename Q>
+template<typename F>
+void quantized_octree<Q>::decode(uint32_t index, F&& f) const
+{
+    node const& n     = m_nodes[index];
+    uint32_t    first = n.first_object, last = m_nodes[index + 1].first_object;
+#ifdef QUANTIZED_OCTREE_SSE2
+    __m128 const  origin = _mm_setr_ps(n.origin.x, n.origin.y, n.origin.z, 0.0f);
+    __m128 const  step   = _mm_setr_ps(n.step.x, n.step.y, n.step.z, 0.0f);
+    __m128i const zero   = _mm_setzero_si128();
+    for (uint32_t i = first; i < last; ++i) {
+        // Widened to 16 bits: min x, y, z, max x, y, z
+        __m128i raw;
+        if constexpr (sizeof(Q) == 1)
+            raw = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(&m_boxes[i])), zero);
+        else
+            raw = _mm_loadu_si128(reinterpret_cast<__m128i const*>(&m_boxes[i]));
+        __m128 mn = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(raw, zero)), step), origin);
+        __m128 mx = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_srli_si128(raw, 6), zero)), step), origin);
+        f(i, mn, mx);
+    }
+#else
+    for (uint32_t i = first; i < last; ++i) {
+        box const& b = m_boxes[i];
+        f(i, n.origin + vec3(b.min[0], b.min[1], b.min[2]) * n.step, n.origin + vec3(b.max[0], b.max[1], b.max[2]) * n.step);
+    }
+#endif
+}
+
+/**
+ * @brief
+ * 	Indices of the objects not outside f. Subtrees inside f are accepted
+ * 	without decoding their objects.
+ */
+template<typename Q>
+void quantized_octree<Q>::frustum(frustrum const& f, std::vector<uint32_t>& out) const
+{
+    if (m_nodes.empty())
+        return;
+
+    QuantizedBounds::frustum_planes const planes(f);
+    std::vector<std::pair<uint32_t, bool>> stack{ { 0u, false } }; // Node, already known to be inside
+    while (!stack.empty()) {
+        auto [index, inside] = stack.back();
+        stack.pop_back();
+
+        node const& n     = m_nodes[index];
+        uint32_t    first = n.first_object, last = m_nodes[index + 1].first_object;
+        if (!inside) {
+            aabb    bv = node_bounds(index);
+            eResult c  = planes.classify(bv.min, bv.max);
+            if (c == eOUTSIDE)
+                continue;
+            inside = c == eINSIDE;
+        }
+
+        if (inside)
+            out.insert(out.end(), m_indices.begin() + first, m_indices.begin() + last);
+        else
+            decode(index, [&](uint32_t i, auto const& mn, auto const& mx) {
+                if (planes.classify(mn, mx) != eOUTSIDE)
+                    out.push_back(m_indices[i]);
+            });
+
+        for (uint32_t c = 0; c < n.child_count(); ++c)
+            stack.emplace_back(n.first_child() + c, inside);
+    }
+}
+
+/**
+ * @brief
+ * 	Indices of the objects whose decoded bounds overlap region
+ */
+template<typename Q>
+void quantized_octree<Q>::query(aabb const& region, std::vector<uint32_t>& out) const
+{
+    if (m_nodes.empty())
+        return;
+
+    std::vector<uint32_t> stack{ 0u };
+    while (!stack.empty()) {
+        uint32_t index = stack.back();
+        stack.pop_back();
+
+        aabb bv = node_bounds(index);
+        if (!overlap_aabb_aabb(bv.min, bv.max, region.min, region.max))
+            continue;
+
+        decode(index, [&](uint32_t i, auto const& mn, auto const& mx) {
+            if (QuantizedBounds::overlaps(mn, mx, region))
+                out.push_back(m_indices[i]);
+        });
+
+        node const& n = m_nodes[index];
+        for (uint32_t c = 0; c < n.child_count(); ++c)
+            stack.push_back(n.first_child() + c);
+    }
+}
+
+#endif
@@ -0,0 +1,76 @@
+#include "render_queue.hpp"
+#include <algorithm>
+
+void render_queue::clear()
+{
+    m_pushed.clear();
+    m_meshes.clear();
+    m_depths.clear();
+    m_instances.clear();
+    m_batches.clear();
+    m_commands.clear();
+}
+
+void render_queue::push(uint32_t mesh, mat4 const& m2w, vec4 const& color, float depth)
+{
+    m_pushed.push_back({ m2w, color });
+    m_meshes.push_back(mesh);
+    m_depths.push_back(depth);
+}
+
+/**
+ * @brief
+ * 	Counting sort by mesh, stable so instances keep their push order
+ * 	inside a batch unless sort_by_depth orders them by increasing depth
+ */
+void render_queue::build(bool sort_by_depth)
+{
+    m_batches.clear();
+    m_counts.clear();
+    for (uint32_t mesh : m_meshes) {
+        if (mesh >= m_counts.size())
+            m_counts.resize(mesh + 1, 0);
+        m_counts[mesh]++;
+    }
+
+    uint32_t first = 0;
+    for (uint32_t mesh = 0; mesh < m_counts.size(); ++mesh) {
+        uint32_t count = m_counts[mesh];
+        if (count == 0)
+            continue;
+        m_batches.push_back({ mesh, first, count });
+        m_counts[mesh] = first;
+        first += count;
+    }
+
+    m_order.resize(m_pushed.size());
+    for (uint32_t i = 0; i < m_pushed.size(); ++i)
+        m_order[m_counts[m_meshes[i]]++] = i;
+
+    if (sort_by_depth)
+        for (auto const& b : m_batches) {
+            auto begin = m_order.begin() + b.first_instance;
+            std::sort(begin, begin + b.instance_count, [this](uint32_t l, uint32_t r) {
+                return m_depths[l] < m_depths[r] || (m_depths[l] == m_depths[r] && l < r);
+            });
+        }
+
+    m_instances.resize(m_pushed.size());
+    for (std::size_t i = 0; i < m_order.size(); ++i)
+        m_instances[i] = m_pushed[m_order[i]];
+}
+
+/**
+ * @brief
+ * 	One command per batch, batches of meshes missing from the shared
+ * 	buffer are dropped
+ */
+void render_queue::build_commands(std::span<mesh_range const> meshes)
+{
+    m_commands.clear();
+    for (auto const& b : m_batches) {
+        if (b.mesh >= meshes.size() || meshes[b.mesh].count == 0)
+            continue;
+        m_commands.push_back({ meshes[b.mesh].count, b.instance_count, meshes[b.mesh].first, b.first_instance });
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef _RENDER_QUEUE__HPP_
+#define _RENDER_QUEUE__HPP_
+
+#include "math.hpp"
+#include "mesh_pool.hpp"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief
+ * 	Visible objects of a frame grouped by mesh. build() sorts the pushed
+ * 	instances by mesh into one contiguous instance buffer, so every batch
+ * 	can be drawn with a single instanced draw call. build_commands() turns
+ * 	the batches into indirect draw commands over a shared vertex buffer,
+ * 	so the whole queue can be submitted with one multi-draw. Instances can
+ * 	optionally be sorted front to back by a depth key inside each batch.
+ */
+class render_queue
+{
+public:
+    // Layout of the instance buffer uploaded to the GPU
+    struct instance
+    {
+        mat4 m2w;
+        vec4 color;
+    };
+
+    struct batch
+    {
+        uint32_t mesh;
+        uint32_t first_instance;
+        uint32_t instance_count;
+    };
+
+    // Same layout as the GL DrawArraysIndirectCommand
+    struct draw_arrays_indirect_command
+    {
+        uint32_t count;
+        uint32_t instance_count;
+        uint32_t first;
+        uint32_t base_instance;
+    };
+
+    void clear();
+    void push(uint32_t mesh, mat4 const& m2w, vec4 const& color, float depth = 0.0f);
+    void build(bool sort_by_depth = false);
+    void build_commands(std::span<mesh_range const> meshes);
+
+    [[nodiscard]] std::vector<batch> const&                        batches() const { return m_batches; }
+    [[nodiscard]] std::vector<instance> const&                     instances() const { return m_instances; }
+    [[nodiscard]] std::vector<draw_arrays_indirect_command> const& commands() const { return m_commands; }
+    [[nodiscard]] std::size_t                                      size() const { return m_pushed.size(); }
+
+private:
+    std::vector<instance>                     m_pushed;    // In push order
+    std::vector<uint32_t>                     m_meshes;    // Mesh of each pushed instance
+    std::vector<float>                        m_depths;    // Depth key of each pushed instance
+    std::vector<uint32_t>                     m_counts;    // Scratch, instances per mesh
+    std::vector<uint32_t>                     m_order;     // Scratch, pushed index of each sorted instance
+    std::vector<instance>                     m_instances; // Sorted by mesh
+    std::vector<batch>                        m_batches;
+    std::vector<draw_arrays_indirect_command> m_commands;
+};
+
+#endif
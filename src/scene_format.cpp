@@ -0,0 +1,216 @@
+#include "scene_format.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+namespace SceneFormat
+{
+    namespace
+    {
+        // Below this many bytes per thread it is not worth spawning workers
+        const std::size_t cMinChunkSize = 64 * 1024;
+
+        bool is_space(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+        }
+
+        template<typename T>
+        bool next_value(char const*& it, char const* end, T& value)
+        {
+            while (it != end && is_space(*it))
+                ++it;
+            auto [ptr, ec] = std::from_chars(it, end, value);
+            if (ec != std::errc())
+                return false;
+            it = ptr;
+            return true;
+        }
+
+        char const* next_line(char const* it, char const* end)
+        {
+            it = std::find(it, end, '\n');
+            return it == end ? end : it + 1;
+        }
+
+        /**
+         * @brief
+         * 	Entries start on a line holding a single token (the mesh index),
+         * 	so realign a chunk start that landed on a matrix line
+         */
+        char const* entry_start(char const* begin, char const* it, char const* end)
+        {
+            if (it == begin)
+                return it;
+            it = next_line(it - 1, end);
+            while (it != end)
+            {
+                char const* line_end = std::find(it, end, '\n');
+                char const* token    = std::find_if_not(it, line_end, is_space);
+                char const* gap      = std::find_if(token, line_end, is_space);
+                if (token != line_end && std::find_if_not(gap, line_end, is_space) == line_end)
+                    return it;
+                it = line_end == end ? end : line_end + 1;
+            }
+            return end;
+        }
+
+        void parse_chunk(char const* it, char const* end, std::vector<text_entry>& out)
+        {
+            for (;;)
+            {
+                text_entry entry{};
+                if (!next_value(it, end, entry.mesh_index))
+                    break;
+                for (mat4::length_type c = 0; c < 4; ++c)
+                    for (mat4::length_type r = 0; r < 4; ++r)
+                        if (!next_value(it, end, entry.m2w[c][r]))
+                            throw std::runtime_error("Truncated scene entry");
+                out.push_back(entry);
+            }
+
+            // Only trailing whitespace is allowed after the last entry
+            if (std::find_if_not(it, end, is_space) != end)
+                throw std::runtime_error("Malformed scene entry");
+        }
+    }
+
+    record make_record(uint32_t mesh_id, mat4 const& m2w, aabb const& bv_model)
+    {
+        record r{};
+        glm::mat4 t = glm::transpose(m2w);
+        r.affine[0] = t[0];
+        r.affine[1] = t[1];
+        r.affine[2] = t[2];
+        aabb bv   = transform_aabb(bv_model, m2w);
+        r.bv_min  = bv.min;
+        r.bv_max  = bv.max;
+        r.mesh_id = mesh_id;
+        return r;
+    }
+
+    mat4 record_transform(record const& r)
+    {
+        return glm::transpose(mat4(r.affine[0], r.affine[1], r.affine[2], vec4(0, 0, 0, 1)));
+    }
+
+    aabb record_bv(record const& r)
+    {
+        return aabb(r.bv_min, r.bv_max);
+    }
+
+    /**
+     * @brief
+     * 	Locale independent parse with std::from_chars. The buffer is split
+     * 	at entry boundaries and each chunk is parsed on its own thread.
+     */
+    std::vector<text_entry> parse_text(std::string_view text, unsigned threads)
+    {
+        char const* begin = text.data();
+        char const* end   = begin + text.size();
+
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = static_cast<unsigned>(std::clamp<std::size_t>(text.size() / cMinChunkSize, 1, threads));
+
+        std::vector<char const*> bounds(threads + 1, end);
+        bounds[0] = begin;
+        for (unsigned i = 1; i < threads; ++i)
+            bounds[i] = entry_start(bounds[i - 1], std::max(bounds[i - 1], begin + text.size() * i / threads), end);
+
+        std::vector<std::vector<text_entry>> parts(threads);
+        if (threads == 1)
+            parse_chunk(begin, end, parts[0]);
+        else
+        {
+            std::vector<std::thread>        workers;
+            std::vector<std::exception_ptr> errors(threads);
+            for (unsigned i = 0; i < threads; ++i)
+                workers.emplace_back([&, i]() {
+                    try
+                    {
+                        parts[i].reserve((bounds[i + 1] - bounds[i]) / 160);
+                        parse_chunk(bounds[i], bounds[i + 1], parts[i]);
+                    }
+                    catch (...)
+                    {
+                        errors[i] = std::current_exception();
+                    }
+                });
+            for (auto& w : workers)
+                w.join();
+            for (auto& e : errors)
+                if (e)
+                    std::rethrow_exception(e);
+        }
+
+        std::size_t count = 0;
+        for (auto const& p : parts)
+            count += p.size();
+
+        std::vector<text_entry> entries;
+        entries.reserve(count);
+        for (auto const& p : parts)
+            entries.insert(entries.end(), p.begin(), p.end());
+        return entries;
+    }
+
+    std::vector<text_entry> load_text(std::string const& filename, unsigned threads)
+    {
+        mapped_file file;
+        if (!file.open(filename))
+            throw std::runtime_error("Could not open scene file");
+        return parse_text(std::string_view(file.data(), file.size()), threads);
+    }
+
+    bool write_binary(std::string const& filename, std::span<record const> records, uint64_t source_hash)
+    {
+        std::ofstream fs(filename, std::ios::binary);
+        if (!fs.is_open())
+            return false;
+
+        header h{};
+        std::memcpy(h.magic, magic, sizeof(magic));
+        h.version      = version;
+        h.record_count = static_cast<uint32_t>(records.size());
+        h.record_size  = sizeof(record);
+        h.source_hash  = source_hash;
+        fs.write(reinterpret_cast<char const*>(&h), sizeof(h));
+        fs.write(reinterpret_cast<char const*>(records.data()), static_cast<std::streamsize>(records.size_bytes()));
+        return fs.good();
+    }
+
+    /**
+     * @brief
+     * 	Records of a mapped binary scene, empty if the file is not valid
+     */
+    std::span<record const> binary_records(mapped_file const& file)
+    {
+        if (file.size() < sizeof(header))
+            return {};
+
+        header const* h = reinterpret_cast<header const*>(file.data());
+        if (std::memcmp(h->magic, magic, sizeof(magic)) != 0 || h->version != version || h->record_size != sizeof(record))
+            return {};
+        if (file.size() < sizeof(header) + std::size_t(h->record_count) * sizeof(record))
+            return {};
+
+        return { reinterpret_cast<record const*>(file.data() + sizeof(header)), h->record_count };
+    }
+
+    /**
+     * @brief
+     * 	Hash of the text scene a binary scene was converted from, 0 if the
+     * 	file is not valid or the hash is unknown
+     */
+    uint64_t binary_source_hash(mapped_file const& file)
+    {
+        if (binary_records(file).empty())
+            return 0;
+        return reinterpret_cast<header const*>(file.data())->source_hash;
+    }
+}
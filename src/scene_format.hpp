@@ -0,0 +1,63 @@
+#ifndef _SCENE_FORMAT__HPP_
+#define _SCENE_FORMAT__HPP_
+
+#include "shapes.hpp"
+#include "mapped_file.hpp"
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief
+ * 	Scene description files. The text format is a list of
+ * 	"mesh_index m2w[16]" entries (column major). The binary format is a
+ * 	header followed by fixed-size records that can be used in place from a
+ * 	memory mapped file. The header keeps the hash of the text scene it was
+ * 	converted from, so a conversion older than its text can be told apart.
+ */
+namespace SceneFormat {
+    static const char     magic[4] = { 'S', 'C', 'N', 'B' };
+    static const uint32_t version  = 2;
+
+    struct header
+    {
+        char     magic[4];
+        uint32_t version;
+        uint32_t record_count;
+        uint32_t record_size;
+        uint64_t source_hash; // Of the text scene it was converted from, 0 if unknown
+        uint64_t reserved;
+    };
+
+    struct record
+    {
+        glm::vec4 affine[3]; // Rows of the 3x4 model to world matrix
+        glm::vec3 bv_min;    // World AABB
+        uint32_t  mesh_id;
+        glm::vec3 bv_max;
+        uint32_t  reserved;
+    };
+    static_assert(sizeof(header) == 32, "Header layout is part of the file format");
+    static_assert(sizeof(record) == 80, "Record layout is part of the file format");
+
+    struct text_entry
+    {
+        int  mesh_index;
+        mat4 m2w;
+    };
+
+    record make_record(uint32_t mesh_id, mat4 const& m2w, aabb const& bv_model);
+    mat4 record_transform(record const& r);
+    aabb record_bv(record const& r);
+
+    std::vector<text_entry> parse_text(std::string_view text, unsigned threads = 0);
+    std::vector<text_entry> load_text(std::string const& filename, unsigned threads = 0);
+
+    bool write_binary(std::string const& filename, std::span<record const> records, uint64_t source_hash = 0);
+    std::span<record const> binary_records(mapped_file const& file);
+    uint64_t binary_source_hash(mapped_file const& file);
+}
+
+#endif
@@ -1,40 +1,47 @@
 #include "shapes.hpp"
+#include "triangle_format.hpp"
+#include <exception>
 #include <fstream>
 #include <iostream>
-#include <sstream>
 
 aabb::aabb(glm::vec3 _min, glm::vec3 _max) : min(_min), max(_max) {
 	pos = glm::vec3((_max.x + _min.x) / 2, (_max.y + _min.y) / 2, (_max.z + _min.z) / 2);
 	sca = glm::vec3(glm::abs(_max.x - _min.x), glm::abs(_max.y - _min.y), glm::abs(_max.z - _min.z));
 }
 
+obb::obb(aabb const& local, glm::mat4 const& m2w) {
+	center = glm::vec3(m2w * glm::vec4(local.pos, 1.f));
+	for (int i = 0; i < 3; ++i)
+		half_axes[i] = glm::vec3(m2w[i]) * (local.sca[i] * 0.5f);
+}
+
+/**
+ * @brief
+ * 	World AABB of a model space AABB (center and half extent method)
+ */
+aabb transform_aabb(aabb const& bv, mat4 const& m2w) {
+	mat4 abs_m2w;
+	for (mat4::length_type i = 0; i < 4; ++i)
+		abs_m2w[i] = glm::abs(m2w[i]);
+
+	vec3 center = vec3(m2w * vec4(bv.pos, 1.f));
+	vec3 extent = vec3(abs_m2w * vec4(bv.sca * 0.5f, 0.f)); // sca is the full size
+	return aabb(center - extent, center + extent);
+}
+
+/**
+ * @brief
+ * 	Loads a triangle soup text file, see TriangleFormat. Returns an empty
+ * 	list if the file cannot be read.
+ */
 std::vector<triangle> load_triangles(std::string const& filename) {
-		std::vector<triangle> tris;
-	std::ifstream file(filename);
-	if (!file.is_open()) {
-		std::cerr << "Could not open file " << filename << std::endl;
-		return tris;
+	try {
+		return TriangleFormat::load_text(filename);
 	}
-
-	std::string line;
-	while (std::getline(file, line)) {
-		if (line.empty() || line[0] == '#') continue;
-		std::stringstream ss(line);
-		std::string type;
-		ss >> type;
-		if (type == "v") {
-			glm::vec3 v;
-			ss >> v.x >> v.y >> v.z;
-		}
-		else if (type == "f") {
-			triangle t;
-			ss >> t.a.x >> t.a.y >> t.a.z;
-			ss >> t.b.x >> t.b.y >> t.b.z;
-			ss >> t.c.x >> t.c.y >> t.c.z;
-			tris.push_back(t);
-		}
+	catch (std::exception const& e) {
+		std::cerr << e.what() << std::endl;
+		return {};
 	}
-	return tris;
 }
 
 std::vector<aabb> triangles_to_aabbs(std::vector<triangle> const& tris) {
@@ -48,6 +55,72 @@ std::vector<aabb> triangles_to_aabbs(std::vector<triangle> const& tris) {
 	return bvs;
 }
 
+/**
+ * @brief
+ * 	Loads a position-only triangle list from the ".binary" mesh format.
+ * 	Returns an empty list if the file does not exist.
+ */
+std::vector<triangle> load_binary_mesh(std::string const& filename) {
+	std::vector<triangle> tris;
+	std::ifstream fs(filename, std::ios::binary);
+	if (!fs.is_open())
+		return tris;
+
+	// Check header
+	char header[6]{};
+	fs.read(header, sizeof(header) - 1);
+
+	// Vertex and index counts
+	unsigned vertex_count = 0;
+	unsigned index_count = 0;
+	fs.read(reinterpret_cast<char*>(&vertex_count), 4);
+	fs.read(reinterpret_cast<char*>(&index_count), 4);
+
+	// Attributes
+	bool has_positions = false;
+	bool has_normals = false;
+	bool has_uvs = false;
+	fs.read(reinterpret_cast<char*>(&has_positions), 1);
+	fs.read(reinterpret_cast<char*>(&has_normals), 1);
+	fs.read(reinterpret_cast<char*>(&has_uvs), 1);
+	if (!has_positions || index_count != 0)
+		return tris;
+
+	tris.resize(vertex_count / 3);
+	for (auto& t : tris) {
+		for (int v = 0; v < 3; ++v) {
+			fs.read(reinterpret_cast<char*>(&t[v]), sizeof(glm::vec3));
+			if (has_normals) fs.seekg(sizeof(glm::vec3), std::ios::cur);
+			if (has_uvs) fs.seekg(sizeof(glm::vec2), std::ios::cur);
+		}
+	}
+	if (!fs)
+		tris.clear();
+	return tris;
+}
+
+/**
+ * @brief
+ * 	Writes positions only, in the format read by load_binary_mesh
+ */
+bool save_binary_mesh(std::string const& filename, std::vector<triangle> const& tris) {
+	std::ofstream fs(filename, std::ios::binary);
+	if (!fs.is_open())
+		return false;
+
+	unsigned vertex_count = static_cast<unsigned>(tris.size() * 3);
+	unsigned index_count = 0;
+	bool attributes[3] = { true, false, false }; // Positions, normals, uvs
+	fs.write("CS350", 5);
+	fs.write(reinterpret_cast<char const*>(&vertex_count), 4);
+	fs.write(reinterpret_cast<char const*>(&index_count), 4);
+	fs.write(reinterpret_cast<char const*>(attributes), sizeof(attributes));
+	for (auto const& t : tris)
+		for (int v = 0; v < 3; ++v)
+			fs.write(reinterpret_cast<char const*>(&t[v]), sizeof(glm::vec3));
+	return static_cast<bool>(fs);
+}
+
 plane::plane()
 	: d(0)
 	, n(vec3(0))
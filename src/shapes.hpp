@@ -15,6 +15,23 @@ struct aabb {
 	aabb(glm::vec3 _min, glm::vec3 _max);
 };
 
+// Local box under the rotation and scale of m2w, as the three world half axes
+struct obb {
+	glm::vec3 center;
+	glm::vec3 half_axes[3]; // Columns of m2w times the local half size
+
+	obb() : center{ 0.f, 0.f, 0.f }, half_axes{} {}
+	obb(aabb const& local, glm::mat4 const& m2w);
+};
+
+struct rect {
+	glm::vec2 min;
+	glm::vec2 max;
+
+	rect() : min{ 0.f, 0.f }, max{ 0.f, 0.f } {}
+	rect(glm::vec2 _min, glm::vec2 _max) : min(_min), max(_max) {}
+};
+
 struct triangle {
 	glm::vec3 a, b, c;
 
@@ -88,7 +105,11 @@ struct frustrum {
 };
 
 
+aabb transform_aabb(aabb const& bv, mat4 const& m2w);
+
 std::vector<triangle> load_triangles(std::string const& filename);
 std::vector<aabb> triangles_to_aabbs(std::vector<triangle> const& tris);
+std::vector<triangle> load_binary_mesh(std::string const& filename);
+bool save_binary_mesh(std::string const& filename, std::vector<triangle> const& tris);
 
 #endif
\ No newline at end of file
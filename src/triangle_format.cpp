@@ -0,0 +1,202 @@
+#include "triangle_format.hpp"
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+namespace TriangleFormat
+{
+    namespace
+    {
+        // Below this many bytes per thread it is not worth spawning workers
+        const std::size_t cMinChunkSize = 64 * 1024;
+
+        bool is_blank(char c)
+        {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+
+        char const* line_end(char const* it, char const* end)
+        {
+            auto* nl = static_cast<char const*>(std::memchr(it, '\n', static_cast<std::size_t>(end - it)));
+            return nl ? nl : end;
+        }
+
+        char const* next_line(char const* it, char const* end)
+        {
+            it = line_end(it, end);
+            return it == end ? end : it + 1;
+        }
+
+        // Start of the first line at or after it
+        char const* line_start(char const* begin, char const* it, char const* end)
+        {
+            return it == begin ? it : next_line(it - 1, end);
+        }
+
+        // First token of the line is "f"
+        bool is_face(char const*& it, char const* eol)
+        {
+            while (it != eol && is_blank(*it))
+                ++it;
+            if (eol - it < 2 || it[0] != 'f' || !is_blank(it[1]))
+                return false;
+            it += 2;
+            return true;
+        }
+
+        std::size_t count_chunk(char const* it, char const* end)
+        {
+            std::size_t count = 0;
+            while (it != end)
+            {
+                char const* eol = line_end(it, end);
+                count += is_face(it, eol);
+                it = eol == end ? end : eol + 1;
+            }
+            return count;
+        }
+
+        void parse_chunk(char const* it, char const* end, triangle* out)
+        {
+            while (it != end)
+            {
+                char const* eol = line_end(it, end);
+                if (is_face(it, eol))
+                {
+                    float values[9];
+                    for (int i = 0; i < 9; ++i)
+                    {
+                        while (it != eol && is_blank(*it))
+                            ++it;
+                        auto [ptr, ec] = std::from_chars(it, eol, values[i]);
+                        if (ec != std::errc())
+                            throw std::runtime_error("Malformed triangle line");
+                        it = ptr;
+                    }
+                    *out++ = triangle(vec3(values[0], values[1], values[2]), vec3(values[3], values[4], values[5]),
+                                      vec3(values[6], values[7], values[8]));
+                }
+                it = eol == end ? end : eol + 1;
+            }
+        }
+
+        template<typename F>
+        void run_chunks(unsigned threads, F&& f)
+        {
+            if (threads == 1)
+            {
+                f(0u);
+                return;
+            }
+
+            std::vector<std::thread>        workers;
+            std::vector<std::exception_ptr> errors(threads);
+            for (unsigned i = 0; i < threads; ++i)
+                workers.emplace_back([&, i]() {
+                    try
+                    {
+                        f(i);
+                    }
+                    catch (...)
+                    {
+                        errors[i] = std::current_exception();
+                    }
+                });
+            for (auto& w : workers)
+                w.join();
+            for (auto& e : errors)
+                if (e)
+                    std::rethrow_exception(e);
+        }
+
+        /**
+         * @brief
+         * 	Parses [begin, end), which starts and ends at line boundaries,
+         * 	into out. The text is split at line boundaries, the triangles of
+         * 	every chunk are counted first so each thread writes its own slice
+         * 	of out.
+         */
+        void parse_range(char const* begin, char const* end, unsigned threads, std::vector<triangle>& out)
+        {
+            std::size_t const size = static_cast<std::size_t>(end - begin);
+            threads = static_cast<unsigned>(std::clamp<std::size_t>(size / cMinChunkSize, 1, threads));
+
+            std::vector<char const*> bounds(threads + 1, end);
+            bounds[0] = begin;
+            for (unsigned i = 1; i < threads; ++i)
+                bounds[i] = line_start(begin, std::max(bounds[i - 1], begin + size * i / threads), end);
+
+            std::vector<std::size_t> offsets(threads + 1, 0);
+            run_chunks(threads, [&](unsigned i) { offsets[i + 1] = count_chunk(bounds[i], bounds[i + 1]); });
+            for (unsigned i = 0; i < threads; ++i)
+                offsets[i + 1] += offsets[i];
+
+            out.resize(offsets[threads]);
+            run_chunks(threads, [&](unsigned i) { parse_chunk(bounds[i], bounds[i + 1], out.data() + offsets[i]); });
+        }
+
+        unsigned thread_count(unsigned threads)
+        {
+            return threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+        }
+    }
+
+    /**
+     * @brief
+     * 	Locale independent parse with std::from_chars, split across threads
+     * 	at line boundaries
+     */
+    std::vector<triangle> parse_text(std::string_view text, unsigned threads)
+    {
+        std::vector<triangle> triangles;
+        parse_range(text.data(), text.data() + text.size(), thread_count(threads), triangles);
+        return triangles;
+    }
+
+    std::vector<triangle> load_text(std::string const& filename, unsigned threads)
+    {
+        mapped_file file;
+        if (!file.open(filename))
+            throw std::runtime_error("Could not open file " + filename);
+        return parse_text(std::string_view(file.data(), file.size()), threads);
+    }
+
+    /**
+     * @brief
+     * 	Parses the text a window of about window bytes at a time, handing
+     * 	each batch to visit in file order, so memory stays bounded by the
+     * 	window whatever the file size. Returns the number of triangles.
+     */
+    std::size_t stream_text(std::string_view text, batch_fn const& visit, unsigned threads, std::size_t window)
+    {
+        char const* const begin = text.data();
+        char const* const end   = begin + text.size();
+        threads                 = thread_count(threads);
+        window                  = std::max<std::size_t>(window, 1);
+
+        std::vector<triangle> batch;
+        std::size_t           count = 0;
+        for (char const* it = begin; it != end;)
+        {
+            char const* stop = static_cast<std::size_t>(end - it) > window ? next_line(it + window - 1, end) : end;
+            parse_range(it, stop, threads, batch);
+            if (!batch.empty())
+                visit(count, batch);
+            count += batch.size();
+            it = stop;
+        }
+        return count;
+    }
+
+    std::size_t stream_file(std::string const& filename, batch_fn const& visit, unsigned threads, std::size_t window)
+    {
+        mapped_file file;
+        if (!file.open(filename))
+            throw std::runtime_error("Could not open file " + filename);
+        return stream_text(std::string_view(file.data(), file.size()), visit, threads, window);
+    }
+}
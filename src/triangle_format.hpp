@@ -0,0 +1,34 @@
+#ifndef _TRIANGLE_FORMAT__HPP_
+#define _TRIANGLE_FORMAT__HPP_
+
+#include "shapes.hpp"
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief
+ * 	Triangle soup text files, as read by load_triangles. Every
+ * 	"f ax ay az bx by bz cx cy cz" line is a triangle, other lines
+ * 	("v ...", "# ...", blank) are skipped.
+ */
+namespace TriangleFormat {
+    // Called with the index of the first triangle of the batch in the file
+    using batch_fn = std::function<void(std::size_t first, std::span<triangle const> batch)>;
+
+    // Bytes of text parsed per batch when streaming
+    static const std::size_t default_window = 16 * 1024 * 1024;
+
+    std::vector<triangle> parse_text(std::string_view text, unsigned threads = 0);
+    std::vector<triangle> load_text(std::string const& filename, unsigned threads = 0);
+
+    std::size_t stream_text(std::string_view text, batch_fn const& visit, unsigned threads = 0,
+                            std::size_t window = default_window);
+    std::size_t stream_file(std::string const& filename, batch_fn const& visit, unsigned threads = 0,
+                            std::size_t window = default_window);
+}
+
+#endif
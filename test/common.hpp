@@ -4,7 +4,11 @@
 #include "math.hpp"
 #include "geometry.hpp"
 #include "shapes.hpp"
+#include "octree.hpp"
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <vector>
 
 #ifndef WORKDIR
 #define WORKDIR "../../"
@@ -16,6 +20,54 @@ inline char const* test_name()
     return ::testing::UnitTest::GetInstance()->current_test_info()->name();
 }
 
+// Minimal object that can be linked into an Octree
+struct test_object
+{
+    aabb bv = {};
+    Octree<test_object>::node* m_octree_node = nullptr;
+    test_object* m_octree_next_obj = nullptr;
+    test_object* m_octree_prev_obj = nullptr;
+};
+
+// Boxes over a 200 unit cube with sides in [min_size, max_size), the given share of them stretched
+// along one axis. Seeded, so a test gets the same boxes whatever runs before it
+inline std::vector<test_object> seeded_boxes(std::size_t count, unsigned seed, float min_size, float max_size, float stretched_share, float stretch)
+{
+    std::mt19937                          rng(seed);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f), size(min_size, max_size), unit(0.0f, 1.0f);
+    std::vector<test_object>              objects(count);
+    for (auto& obj : objects) {
+        vec3 p = vec3(position(rng), position(rng), position(rng));
+        vec3 s = vec3(size(rng), size(rng), size(rng));
+        if (unit(rng) < stretched_share)
+            s[rng() % 3] *= stretch;
+        obj.bv = aabb(p, p + s);
+    }
+    return objects;
+}
+
+// Boxes centered up to extent away from center, with half sizes in [min_half, max_half]. Drawn from
+// the shared glm random sequence, so they depend on the tests that ran before
+inline std::vector<test_object> random_objects(unsigned count, float extent, vec3 center = vec3(0.0f), float min_half = 0.1f, float max_half = 3.0f)
+{
+    std::vector<test_object> objects(count);
+    for (auto& obj : objects) {
+        vec3 c = center + glm::linearRand(vec3(-extent), vec3(extent));
+        vec3 h = glm::linearRand(vec3(min_half), vec3(max_half));
+        obj.bv = aabb(c - h, c + h);
+    }
+    return objects;
+}
+
+// Pointers of a query result, in a comparable order
+template<typename Container>
+std::vector<test_object const*> sorted(Container const& c)
+{
+    std::vector<test_object const*> v(c.begin(), c.end());
+    std::sort(v.begin(), v.end());
+    return v;
+}
+
 namespace testing::internal {
     AssertionResult DoubleNearPredFormat(const char* expr1, const char* expr2, const char* abs_error_expr, glm::vec2 const& val1, glm::vec2 const& val2, double abs_error);
     AssertionResult DoubleNearPredFormat(const char* expr1, const char* expr2, const char* abs_error_expr, glm::vec3 const& val1, glm::vec3 const& val2, double abs_error);
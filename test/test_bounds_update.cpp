@@ -0,0 +1,72 @@
+#include "common.hpp"
+#include "bounds_update.hpp"
+
+namespace {
+    mat4 random_transform()
+    {
+        mat4 m2w = glm::translate(mat4(1.0f), glm::linearRand(vec3(-50.0f), vec3(50.0f)));
+        m2w      = glm::rotate(m2w, glm::linearRand(0.0f, 6.28f), glm::normalize(glm::linearRand(vec3(-1.0f), vec3(1.0f))));
+        return glm::scale(m2w, glm::linearRand(vec3(0.5f), vec3(2.0f)));
+    }
+}
+
+TEST(bounds_update, matches_transform_aabb)
+{
+    std::vector<aabb>     locals;
+    std::vector<mat4>     transforms;
+    bounds_updater        bounds;
+    for (int i = 0; i < 37; ++i) { // Not a whole number of blocks
+        vec3 c = glm::linearRand(vec3(-2.0f), vec3(2.0f)), h = glm::linearRand(vec3(0.1f), vec3(3.0f));
+        locals.emplace_back(c - h, c + h);
+        transforms.push_back(random_transform());
+        ASSERT_EQ(bounds.add(locals.back(), transforms.back()), static_cast<uint32_t>(i));
+    }
+
+    bounds.update();
+    ASSERT_EQ(bounds.dirty().size(), 37u);
+    for (uint32_t i = 0; i < 37; ++i)
+        ASSERT_NEAR(bounds.world(i), transform_aabb(locals[i], transforms[i]), 1e-4);
+
+    // Only the objects whose transform changes are refreshed
+    bounds.set_transform(3, transforms[3]);
+    bounds.update();
+    ASSERT_TRUE(bounds.dirty().empty());
+
+    transforms[5]  = random_transform();
+    transforms[36] = random_transform();
+    for (uint32_t i = 0; i < 37; ++i)
+        bounds.set_transform(i, transforms[i]);
+    bounds.update();
+    ASSERT_EQ(std::vector<uint32_t>(bounds.dirty().begin(), bounds.dirty().end()), (std::vector<uint32_t>{ 5, 36 }));
+    for (uint32_t i = 0; i < 37; ++i)
+        ASSERT_NEAR(bounds.world(i), transform_aabb(locals[i], transforms[i]), 1e-4);
+}
+
+TEST(bounds_update, relocates_dirty_objects)
+{
+    std::vector<test_object> objects(20);
+    bounds_updater           bounds;
+    Octree<test_object>      tree;
+    tree.set_root_size(256);
+    tree.set_levels(5);
+
+    aabb const local(vec3(-1.0f), vec3(1.0f));
+    for (uint32_t i = 0; i < objects.size(); ++i)
+        bounds.add(local, glm::translate(mat4(1.0f), vec3(10.0f * i - 100.0f, 0.0f, 0.0f)));
+    bounds.update();
+    relocate_dirty<test_object>(tree, objects, bounds);
+    for (auto& obj : objects) // Not linked yet, only the bounds are copied
+        tree.insert(obj, LocationalCode::compute_locational_code(obj.bv, tree.root_size(), tree.levels()));
+
+    bounds.set_transform(7, glm::translate(mat4(1.0f), vec3(0.0f, 60.0f, 60.0f)));
+    bounds.update();
+    relocate_dirty<test_object>(tree, objects, bounds);
+
+    ASSERT_NEAR(objects[7].bv, aabb(vec3(-1.0f, 59.0f, 59.0f), vec3(1.0f, 61.0f, 61.0f)), 1e-5);
+    ASSERT_EQ(objects[7].m_octree_node->locational_code,
+              static_cast<unsigned>(LocationalCode::compute_locational_code(objects[7].bv, tree.root_size(), tree.levels())));
+
+    std::vector<test_object*> found;
+    tree.query(aabb(vec3(-2.0f, 58.0f, 58.0f), vec3(2.0f, 62.0f, 62.0f)), [&](test_object& obj) { found.push_back(&obj); });
+    ASSERT_EQ(found, std::vector<test_object*>{ &objects[7] });
+}
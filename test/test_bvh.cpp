@@ -0,0 +1,118 @@
+#include "common.hpp"
+#include "bvh.hpp"
+
+TEST(bvh, build_layout)
+{
+    auto                      objects = seeded_boxes(2000, 1, 0.1f, 4.0f, 0.1f, 40.0f);
+    std::vector<test_object*> pointers;
+    for (auto& obj : objects)
+        pointers.push_back(&obj);
+
+    bvh<test_object> tree;
+    tree.build(pointers, { .bins = 16, .max_leaf_size = 4 });
+    ASSERT_EQ(tree.objects().size(), objects.size());
+    ASSERT_EQ(sorted(tree.objects()), sorted(pointers));
+
+    // Depth first: left child next, children inside their parent, leaves cover every object once
+    auto        nodes = tree.nodes();
+    std::size_t leaf_objects = 0;
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        auto const& n = nodes[i];
+        if (n.count) {
+            ASSERT_LE(n.count, 4u);
+            leaf_objects += n.count;
+            for (uint32_t o = n.offset; o < n.offset + n.count; ++o)
+                ASSERT_TRUE(glm::all(glm::lessThan(n.min, tree.objects()[o]->bv.min + 1e-4f)) && glm::all(glm::lessThan(tree.objects()[o]->bv.max, n.max + 1e-4f)));
+            continue;
+        }
+        ASSERT_GT(n.offset, i + 1);
+        ASSERT_LT(n.offset, nodes.size());
+        for (auto const* child : { &nodes[i + 1], &nodes[n.offset] })
+            ASSERT_TRUE(glm::all(glm::lessThan(n.min, child->min + 1e-4f)) && glm::all(glm::lessThan(child->max, n.max + 1e-4f)));
+    }
+    ASSERT_EQ(leaf_objects, objects.size());
+
+    // Refit follows moved objects
+    for (std::size_t i = 0; i < objects.size(); i += 3) {
+        objects[i].bv.min += 5.0f;
+        objects[i].bv.max += 5.0f;
+    }
+    tree.refit();
+    for (auto const& n : tree.nodes())
+        for (uint32_t o = n.offset; n.count && o < n.offset + n.count; ++o)
+            ASSERT_TRUE(glm::all(glm::lessThan(n.min, tree.objects()[o]->bv.min + 1e-4f)) && glm::all(glm::lessThan(tree.objects()[o]->bv.max, n.max + 1e-4f)));
+}
+
+TEST(bvh, queries_match_octree)
+{
+    auto                      objects = seeded_boxes(3000, 2, 0.1f, 4.0f, 0.1f, 40.0f);
+    std::vector<test_object*> pointers;
+    for (auto& obj : objects)
+        pointers.push_back(&obj);
+
+    bvh<test_object> tree;
+    tree.build(pointers);
+    Octree<test_object> octree;
+    octree.set_root_size(256);
+    octree.set_levels(5);
+    for (auto* obj : pointers)
+        octree.insert(*obj, LocationalCode::compute_locational_code(obj->bv, octree.root_size(), octree.levels()));
+
+    std::mt19937                          rng(3);
+    std::uniform_real_distribution<float> position(-120.0f, 120.0f), direction(-1.0f, 1.0f);
+    for (int i = 0; i < 50; ++i) {
+        vec3 p   = vec3(position(rng), position(rng), position(rng));
+        vec3 dir = glm::normalize(vec3(direction(rng), direction(rng), direction(rng)));
+
+        // Frustum
+        frustrum                        f(glm::perspective(glm::radians(60.0f), 1.0f, 0.5f, 80.0f) * glm::lookAt(p, p + dir, vec3(0, 1, 0)));
+        std::vector<test_object const*> expected, from_bvh, from_octree;
+        for (auto const& obj : objects)
+            if (classify_frustum_aabb_naive(f, obj.bv) != eOUTSIDE)
+                expected.push_back(&obj);
+        tree.frustum(f, [&](test_object& obj) { from_bvh.push_back(&obj); });
+        octree.frustum(f, [&](test_object& obj) { from_octree.push_back(&obj); });
+        ASSERT_EQ(sorted(from_bvh), expected);
+        ASSERT_EQ(sorted(from_octree), expected);
+
+        // Box
+        aabb region(p, p + vec3(30.0f, 10.0f, 20.0f));
+        expected.clear(), from_bvh.clear(), from_octree.clear();
+        for (auto const& obj : objects)
+            if (overlap_aabb_aabb(obj.bv.min, obj.bv.max, region.min, region.max))
+                expected.push_back(&obj);
+        tree.query(region, [&](test_object& obj) { from_bvh.push_back(&obj); });
+        octree.query(region, [&](test_object& obj) { from_octree.push_back(&obj); });
+        ASSERT_EQ(sorted(from_bvh), expected);
+        ASSERT_EQ(sorted(from_octree), expected);
+
+        // Ray, closest bv hit
+        float closest = FLT_MAX;
+        for (auto const& obj : objects)
+            if (float t = intersection_time_ray_box(p, 1.0f / dir, obj.bv.min, obj.bv.max, FLT_MAX); t >= 0.0f)
+                closest = std::min(closest, t);
+        auto bvh_hit    = tree.raycast(p, dir);
+        auto octree_hit = octree.raycast(p, dir);
+        ASSERT_EQ(bvh_hit.object != nullptr, closest != FLT_MAX);
+        ASSERT_EQ(octree_hit.object != nullptr, closest != FLT_MAX);
+        if (bvh_hit.object) {
+            ASSERT_FLOAT_EQ(bvh_hit.t, closest);
+            ASSERT_FLOAT_EQ(octree_hit.t, closest);
+        }
+
+        // k nearest, compared by distance since ties can come in any order
+        std::vector<float> distances;
+        for (auto const& obj : objects)
+            distances.push_back(sq_distance_point_box(p, obj.bv.min, obj.bv.max));
+        std::sort(distances.begin(), distances.end());
+        std::vector<test_object*> knn_bvh, knn_octree;
+        tree.nearest(p, 8, knn_bvh);
+        octree.nearest(p, 8, knn_octree);
+        ASSERT_EQ(knn_bvh.size(), 8u);
+        ASSERT_EQ(knn_octree.size(), 8u);
+        for (unsigned k = 0; k < 8; ++k) {
+            ASSERT_FLOAT_EQ(sq_distance_point_box(p, knn_bvh[k]->bv.min, knn_bvh[k]->bv.max), distances[k]);
+            ASSERT_FLOAT_EQ(sq_distance_point_box(p, knn_octree[k]->bv.min, knn_octree[k]->bv.max), distances[k]);
+        }
+    }
+}
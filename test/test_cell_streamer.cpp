@@ -0,0 +1,143 @@
+#include "common.hpp"
+#include "cell_streamer.hpp"
+#include <atomic>
+#include <set>
+
+namespace {
+    struct fake_payload
+    {
+        unsigned    cell  = 0;
+        std::size_t bytes = 0;
+    };
+
+    // Every cell at the given level of the octree
+    std::vector<unsigned> all_cells(unsigned level)
+    {
+        std::vector<unsigned> cells;
+        for (unsigned i = 0; i < (1u << (3 * level)); ++i)
+            cells.push_back((1u << (3 * level)) + i);
+        return cells;
+    }
+
+    struct fake_world
+    {
+        std::set<unsigned>    resident;
+        std::atomic<unsigned> loads{ 0 };
+
+        cell_streamer<fake_payload>::load_fn load()
+        {
+            return [this](unsigned cell) {
+                loads++;
+                return fake_payload{ cell, 1000 };
+            };
+        }
+        cell_streamer<fake_payload>::page_in_fn page_in()
+        {
+            return [this](unsigned cell, fake_payload& p) {
+                EXPECT_EQ(p.cell, cell);
+                EXPECT_FALSE(resident.count(cell));
+                resident.insert(cell);
+                return p.bytes;
+            };
+        }
+        cell_streamer<fake_payload>::page_out_fn page_out()
+        {
+            return [this](unsigned cell) {
+                EXPECT_TRUE(resident.count(cell));
+                resident.erase(cell);
+            };
+        }
+    };
+}
+
+TEST(cell_streamer, scripted_path)
+{
+    streaming_config config;
+    config.root_size       = 1024;
+    config.cell_level      = 2; // 256 units per cell
+    config.load_radius     = 150.0f;
+    config.required_radius = 10.0f;
+    config.prefetch_time   = 0.0f;
+    config.budget_bytes    = 8000;
+    config.workers         = 0;
+
+    fake_world                  world;
+    cell_streamer<fake_payload> streamer(config, all_cells(2), world.load(), world.page_in(), world.page_out());
+
+    float const dt = 0.1f;
+    float max_rate = 0.0f;
+    for (int frame = 0; frame <= 100; ++frame) {
+        vec3 camera(-500.0f + frame * 10.0f, 10.0f, 30.0f);
+        streamer.update(camera, dt);
+
+        // The cell under the camera is always there
+        unsigned here = LocationalCode::compute_locational_code(glm::i64vec3(glm::floor(camera)), config.root_size, config.cell_level);
+        ASSERT_TRUE(streamer.is_resident(here)) << "frame " << frame;
+        ASSERT_TRUE(world.resident.count(here));
+
+        ASSERT_EQ(streamer.stats().resident_cells, world.resident.size());
+        ASSERT_EQ(streamer.stats().resident_bytes, world.resident.size() * 1000);
+        ASSERT_LE(streamer.stats().resident_bytes, config.budget_bytes);
+        max_rate = std::max(max_rate, streamer.stats().page_ins_per_second);
+    }
+
+    // Moved across 4 cells with a budget of 8, so the old ones were evicted
+    ASSERT_GT(streamer.stats().page_outs, 0u);
+    ASSERT_EQ(streamer.stats().page_ins - streamer.stats().page_outs, world.resident.size());
+    ASSERT_GT(max_rate, 0.0f);
+
+    streamer.evict_all();
+    ASSERT_TRUE(world.resident.empty());
+    ASSERT_EQ(streamer.stats().resident_bytes, 0u);
+}
+
+TEST(cell_streamer, prefetch_along_velocity)
+{
+    streaming_config config;
+    config.root_size       = 1024;
+    config.cell_level      = 2;
+    config.load_radius     = 10.0f;
+    config.required_radius = 0.0f;
+    config.prefetch_time   = 1.0f;
+    config.workers         = 0;
+
+    fake_world                  world;
+    cell_streamer<fake_payload> streamer(config, all_cells(2), world.load(), world.page_in(), world.page_out());
+
+    // Cell spanning x in [0, 256), the next one starts at 256
+    unsigned ahead = LocationalCode::compute_locational_code(glm::i64vec3(300, 10, 30), config.root_size, config.cell_level);
+    streamer.update(vec3(100, 10, 30), 0.1f);
+    ASSERT_FALSE(streamer.is_resident(ahead));
+
+    // 200 units per second, one second ahead is the next cell
+    streamer.update(vec3(120, 10, 30), 0.1f);
+    ASSERT_TRUE(streamer.is_resident(ahead));
+}
+
+TEST(cell_streamer, async_workers)
+{
+    streaming_config config;
+    config.root_size       = 1024;
+    config.cell_level      = 2;
+    config.load_radius     = 300.0f;
+    config.required_radius = 50.0f;
+    config.budget_bytes    = 20000;
+    config.workers         = 3;
+
+    fake_world world;
+    {
+        cell_streamer<fake_payload> streamer(config, all_cells(2), world.load(), world.page_in(), world.page_out());
+        for (int frame = 0; frame < 200; ++frame) {
+            vec3 camera(400.0f * std::sin(frame * 0.05f), 0.0f, 400.0f * std::cos(frame * 0.05f));
+            streamer.update(camera, 1.0f / 60.0f);
+
+            unsigned here = LocationalCode::compute_locational_code(glm::i64vec3(glm::floor(camera)), config.root_size, config.cell_level);
+            ASSERT_TRUE(streamer.is_resident(here));
+            ASSERT_EQ(streamer.stats().resident_cells, world.resident.size());
+        }
+        ASSERT_GT(world.loads.load(), 0u);
+        ASSERT_GE(streamer.stats().total_stall_ms, 0.0f);
+        streamer.evict_all();
+    }
+    ASSERT_TRUE(world.resident.empty());
+}
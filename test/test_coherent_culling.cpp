@@ -0,0 +1,94 @@
+#include "common.hpp"
+#include "coherent_culling.hpp"
+#include <random>
+
+namespace {
+    frustrum make_frustum(vec3 const& eye, vec3 const& dir)
+    {
+        return frustrum(glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 200.0f) * glm::lookAt(eye, eye + dir, vec3(0, 1, 0)));
+    }
+}
+
+TEST(coherent_culling, matches_full_culling)
+{
+    // Every cell of a 4 level octree
+    float                 root_size = 256.0f;
+    std::vector<unsigned> cells;
+    for (unsigned loc = 0b1000; loc < (1u << 13); ++loc)
+        cells.push_back(loc);
+
+    coherent_culler culler;
+    std::mt19937    rng(7);
+    std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+
+    // And boxes that keep their own entry
+    std::uniform_real_distribution<float>              position(-100.0f, 100.0f);
+    std::vector<std::pair<aabb, coherent_culler::entry>> boxes(500);
+    for (auto& box : boxes) {
+        vec3 p    = vec3(position(rng), position(rng), position(rng));
+        box.first = aabb(p, p + vec3(1.0f + step(rng)));
+    }
+
+    vec3  eye(0, 10, -60);
+    float yaw    = 0.0f;
+    int   reused = 0;
+    for (int frame = 0; frame < 200; ++frame) {
+        eye += vec3(step(rng), 0.2f * step(rng), 1.0f + step(rng));
+        yaw += 0.02f * step(rng);
+        frustrum f = make_frustum(eye, vec3(std::sin(yaw), -0.1f, std::cos(yaw)));
+
+        culler.begin_frame(f, eye);
+        ASSERT_EQ(culler.frame_stats().reset, frame == 0);
+        for (unsigned loc : cells) {
+            aabb cell = LocationalCode::compute_bv(loc, root_size);
+            ASSERT_EQ(culler.classify(loc, cell), classify_frustum_aabb_naive(f, cell));
+        }
+        for (auto& [bv, entry] : boxes)
+            ASSERT_EQ(culler.classify(entry, bv), classify_frustum_aabb_naive(f, bv));
+        reused += culler.frame_stats().reused;
+    }
+    ASSERT_GT(reused, static_cast<int>(cells.size()) * 100);
+
+    // A teleport drops the cache
+    culler.begin_frame(make_frustum(vec3(80, 10, 80), vec3(-1, 0, 0)), vec3(80, 10, 80));
+    ASSERT_TRUE(culler.frame_stats().reset);
+    ASSERT_EQ(culler.size(), 0u);
+}
+
+TEST(coherent_culling, slack)
+{
+    frustrum f = make_frustum(vec3(0), vec3(0, 0, -1));
+    aabb     bv(vec3(-1, -1, -11), vec3(1, 1, -9));
+    ASSERT_EQ(classify_frustum_aabb_naive(f, bv), eINSIDE);
+
+    // Moving the box by less than its slack keeps it inside
+    float slack = frustum_aabb_slack(f, bv, eINSIDE);
+    ASSERT_GT(slack, 0.0f);
+    ASSERT_LT(slack, 10.0f);
+    ASSERT_EQ(classify_frustum_aabb_naive(f, aabb(bv.min - vec3(0, 0, slack * 0.99f), bv.max - vec3(0, 0, slack * 0.99f))), eINSIDE);
+
+    // Straddling boxes have no slack
+    ASSERT_EQ(frustum_aabb_slack(f, aabb(vec3(-1), vec3(1)), eOVERLAPPING), 0.0f);
+
+}
+
+TEST(coherent_culling, motion)
+{
+    coherent_culler culler;
+    culler.begin_frame(make_frustum(vec3(0), vec3(0, 0, -1)), vec3(0));
+
+    // Translating the camera slides the planes by the distance travelled
+    culler.begin_frame(make_frustum(vec3(0.5f, 0, 0), vec3(0, 0, -1)), vec3(0.5f, 0, 0));
+    ASSERT_FALSE(culler.frame_stats().reset);
+    ASSERT_NEAR(culler.frame_stats().translation, 0.5f, 1e-4f);
+    ASSERT_NEAR(culler.frame_stats().rotation, 0.0f, 1e-4f);
+
+    // Turning it changes the normals by about the angle
+    culler.begin_frame(make_frustum(vec3(0.5f, 0, 0), vec3(std::sin(0.05f), 0, -std::cos(0.05f))), vec3(0.5f, 0, 0));
+    ASSERT_FALSE(culler.frame_stats().reset);
+    ASSERT_NEAR(culler.frame_stats().translation, 0.0f, 1e-3f);
+    ASSERT_NEAR(culler.frame_stats().rotation, 0.05f, 1e-3f);
+
+    culler.begin_frame(make_frustum(vec3(0.5f, 0, 0), vec3(0, 0, 1)), vec3(0.5f, 0, 0));
+    ASSERT_TRUE(culler.frame_stats().reset);
+}
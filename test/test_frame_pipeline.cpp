@@ -0,0 +1,55 @@
+#include "common.hpp"
+#include "frame_pipeline.hpp"
+#include <atomic>
+
+TEST(frame_pipeline, same_frame)
+{
+    frame_pipeline pipeline(false);
+    int            result = 0;
+    ASSERT_FALSE(pipeline.wait());
+
+    pipeline.start([&]() { result = 1; });
+    ASSERT_EQ(result, 1);
+    ASSERT_TRUE(pipeline.wait());
+    ASSERT_FALSE(pipeline.wait());
+    ASSERT_EQ(pipeline.stats().latency_frames, 0u);
+}
+
+TEST(frame_pipeline, overlaps_the_caller)
+{
+    frame_pipeline   pipeline;
+    std::atomic<int> stage = 0;
+
+    // The job only finishes once the caller got past start()
+    pipeline.start([&]() {
+        while (stage.load() == 0)
+            std::this_thread::yield();
+        stage = 2;
+    });
+    stage = 1;
+    ASSERT_TRUE(pipeline.wait());
+    ASSERT_EQ(stage.load(), 2);
+    ASSERT_EQ(pipeline.stats().latency_frames, 1u);
+
+    // Double buffered: the job for frame N+1 writes the back buffer while frame N reads the front
+    int buffers[2] = {};
+    int front      = 0;
+    for (int frame = 1; frame <= 50; ++frame) {
+        int back = front ^ 1;
+        pipeline.start([&buffers, back, frame]() { buffers[back] = frame; });
+        ASSERT_EQ(buffers[front], frame - 1);
+        ASSERT_TRUE(pipeline.wait());
+        front = back;
+    }
+
+    // Switching modes finishes the job in flight
+    std::atomic<bool> done = false;
+    pipeline.start([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        done = true;
+    });
+    pipeline.set_pipelined(false);
+    ASSERT_TRUE(done.load());
+    ASSERT_FALSE(pipeline.pipelined());
+    ASSERT_TRUE(pipeline.wait());
+}
@@ -0,0 +1,152 @@
+#include "common.hpp"
+#include <cfloat>
+#include <random>
+
+TEST(geometry, projected_extent_pixels)
+{
+    mat4 proj = glm::perspective(glm::radians(90.0f), 2.0f, 0.1f, 1000.0f);
+    mat4 view = glm::lookAt(vec3(0), vec3(0, 0, -1), vec3(0, 1, 0));
+    vec2 viewport(2000, 1000);
+
+    // Sphere of radius sqrt(3) at depth 100: 1000 px per unit at depth 1
+    aabb  bv(vec3(-1, -1, -101), vec3(1, 1, -99));
+    float r = std::sqrt(3.0f);
+    ASSERT_NEAR(projected_extent_pixels(bv, view, proj, viewport), r / (100.0f - r) * 1000.0f, 1e-2f);
+
+    // Half as big twice as far, roughly
+    aabb far_bv(vec3(-1, -1, -201), vec3(1, 1, -199));
+    ASSERT_LT(projected_extent_pixels(far_bv, view, proj, viewport), projected_extent_pixels(bv, view, proj, viewport) * 0.51f);
+
+    // Around or behind the camera it is never culled
+    ASSERT_EQ(projected_extent_pixels(aabb(vec3(-1), vec3(1)), view, proj, viewport), FLT_MAX);
+    ASSERT_EQ(projected_extent_pixels(aabb(vec3(-1, -1, 10), vec3(1, 1, 12)), view, proj, viewport), FLT_MAX);
+}
+
+TEST(geometry, intersection_time_ray_triangle)
+{
+    vec3 a(0, 0, 0), b(1, 0, 0), c(0, 1, 0);
+    ASSERT_FLOAT_EQ(intersection_time_ray_triangle(vec3(0.25f, 0.25f, 2), vec3(0, 0, -1), a, b, c), 2.0f);
+    ASSERT_FLOAT_EQ(intersection_time_ray_triangle(vec3(0.25f, 0.25f, -2), vec3(0, 0, 0.5f), a, b, c), 4.0f); // Back face, t in units of dir
+    ASSERT_EQ(intersection_time_ray_triangle(vec3(0.25f, 0.25f, 2), vec3(0, 0, 1), a, b, c), -1.0f);          // Behind
+    ASSERT_EQ(intersection_time_ray_triangle(vec3(0.75f, 0.75f, 2), vec3(0, 0, -1), a, b, c), -1.0f);
+    ASSERT_EQ(intersection_time_ray_triangle(vec3(-1, 0.5f, 0), vec3(1, 0, 0), a, b, c), -1.0f); // Edge on
+
+    // Watertight: rays through the shared edges and vertex of a fan always hit one of its triangles
+    std::vector<triangle> fan;
+    vec3                  center(0.3f, -0.2f, 0.1f);
+    for (int i = 0; i < 7; ++i) {
+        float a0 = glm::two_pi<float>() * i / 7.0f, a1 = glm::two_pi<float>() * (i + 1) / 7.0f;
+        fan.emplace_back(center, center + vec3(std::cos(a0), std::sin(a0), 0.1f * i), center + vec3(std::cos(a1), std::sin(a1), 0.1f * ((i + 1) % 7)));
+    }
+    vec3 eye(-3.1f, 2.3f, 5.7f);
+    for (auto const& t : fan)
+        for (vec3 target : { t.a, (t.a + t.b) * 0.5f, glm::mix(t.a, t.b, 0.3331f), glm::mix(t.a, t.b, 0.9f) }) {
+            int hits = 0;
+            for (auto const& other : fan)
+                hits += intersection_time_ray_triangle(eye, target - eye, other.a, other.b, other.c) >= 0.0f;
+            ASSERT_GE(hits, 1);
+        }
+}
+
+TEST(geometry, closest_point_triangle)
+{
+    vec3 a(0, 0, 0), b(2, 0, 0), c(0, 2, 0);
+    ASSERT_NEAR(closest_point_triangle(vec3(0.5f, 0.5f, 3), a, b, c), vec3(0.5f, 0.5f, 0), 1e-6f); // Face
+    ASSERT_NEAR(closest_point_triangle(vec3(-1, -1, 1), a, b, c), a, 1e-6f);                       // Vertices
+    ASSERT_NEAR(closest_point_triangle(vec3(3, -1, 0), a, b, c), b, 1e-6f);
+    ASSERT_NEAR(closest_point_triangle(vec3(-1, 5, -2), a, b, c), c, 1e-6f);
+    ASSERT_NEAR(closest_point_triangle(vec3(1, -3, 1), a, b, c), vec3(1, 0, 0), 1e-6f); // Edges
+    ASSERT_NEAR(closest_point_triangle(vec3(-2, 1, 0), a, b, c), vec3(0, 1, 0), 1e-6f);
+    ASSERT_NEAR(closest_point_triangle(vec3(2, 2, 0), a, b, c), vec3(1, 1, 0), 1e-6f);
+}
+
+TEST(geometry, overlap_triangle_aabb)
+{
+    vec3 a(0, 0, 0), b(2, 0, 0), c(0, 2, 0);
+    ASSERT_TRUE(overlap_triangle_aabb(a, b, c, vec3(0.2f, 0.2f, -1), vec3(0.4f, 0.4f, 1)));   // Through the face
+    ASSERT_FALSE(overlap_triangle_aabb(a, b, c, vec3(0.2f, 0.2f, 0.1f), vec3(0.4f, 0.4f, 1))); // Above it
+    ASSERT_FALSE(overlap_triangle_aabb(a, b, c, vec3(1.2f, 1.2f, -1), vec3(2, 2, 1)));         // Bounds overlap, past the edge bc
+    ASSERT_TRUE(overlap_triangle_aabb(a, b, c, vec3(0.9f, 0.9f, -1), vec3(2, 2, 1)));
+    ASSERT_TRUE(overlap_triangle_aabb(a, b, c, vec3(-1), vec3(3)));                             // Inside the box
+}
+
+TEST(geometry, classify_frustum_obb)
+{
+    frustrum f(glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f));
+
+    // A thin rod turned 45 degrees next to the right plane x = -z: its aabb straddles it, the rod does not
+    aabb rod(vec3(-4.0f, -0.1f, -0.1f), vec3(4.0f, 0.1f, 0.1f));
+    mat4 m2w = glm::rotate(glm::translate(mat4(1.0f), vec3(12.0f, 0.0f, -10.0f)), glm::radians(45.0f), vec3(0, 1, 0));
+    ASSERT_EQ(classify_frustum_aabb_naive(f, transform_aabb(rod, m2w)), eOVERLAPPING);
+    ASSERT_EQ(classify_frustum_obb(f, obb(rod, m2w)), eOUTSIDE);
+
+    ASSERT_EQ(classify_frustum_obb(f, obb(rod, glm::translate(mat4(1.0f), vec3(0.0f, 0.0f, -50.0f)))), eINSIDE);
+    ASSERT_EQ(classify_frustum_obb(f, obb(rod, glm::translate(mat4(1.0f), vec3(0.0f, 0.0f, -2.0f)))), eOVERLAPPING);
+
+    // Never tighter than the box itself: a corner inside f keeps it visible, and it is at most as loose as its aabb
+    for (int i = 0; i < 500; ++i) {
+        mat4 t = glm::translate(mat4(1.0f), glm::linearRand(vec3(-30.0f, -30.0f, -60.0f), vec3(30.0f, 30.0f, 5.0f)));
+        t      = glm::rotate(t, glm::linearRand(0.0f, 6.28f), glm::normalize(glm::linearRand(vec3(-1.0f), vec3(1.0f))));
+        t      = glm::scale(t, glm::linearRand(vec3(0.5f), vec3(2.0f)));
+        aabb local(glm::linearRand(vec3(-5.0f), vec3(-0.1f)), glm::linearRand(vec3(0.1f), vec3(5.0f)));
+
+        eResult oriented = classify_frustum_obb(f, obb(local, t));
+        eResult aligned  = classify_frustum_aabb_naive(f, transform_aabb(local, t));
+        if (aligned == eOUTSIDE) {
+            ASSERT_EQ(oriented, eOUTSIDE);
+        }
+        if (aligned == eINSIDE) {
+            ASSERT_EQ(oriented, eINSIDE);
+        }
+        for (int corner = 0; corner < 8; ++corner) {
+            vec3 p(corner & 1 ? local.max.x : local.min.x, corner & 2 ? local.max.y : local.min.y, corner & 4 ? local.max.z : local.min.z);
+            vec3 w = vec3(t * vec4(p, 1.0f));
+            bool inside = true;
+            for (auto const& pl : f.mplanes)
+                inside &= dot(pl.n, w) - pl.d < 0.0f;
+            if (inside) {
+                ASSERT_NE(oriented, eOUTSIDE);
+            }
+        }
+    }
+}
+
+TEST(geometry, intersection_time_sphere_aabb)
+{
+    vec3 mn(-1.0f), mx(1.0f);
+
+    // Face, edge and corner regions of the rounded box
+    ASSERT_NEAR(intersection_time_sphere_aabb(vec3(-10, 0, 0), 1.0f, vec3(20, 0, 0), mn, mx), 8.0f / 20.0f, 1e-6f);
+    ASSERT_NEAR(intersection_time_sphere_aabb(vec3(-10, 1.5f, 0), 1.0f, vec3(20, 0, 0), mn, mx), (9.0f - std::sqrt(0.75f)) / 20.0f, 1e-5f);
+    ASSERT_EQ(intersection_time_sphere_aabb(vec3(-10, 1.9f, 1.9f), 1.0f, vec3(20, 0, 0), mn, mx), -1.0f); // The grown box is hit, the edge missed
+    float d = 10.0f * std::sqrt(3.0f);
+    ASSERT_NEAR(intersection_time_sphere_aabb(vec3(10), 1.0f, vec3(-20), mn, mx), (d - std::sqrt(3.0f) - 1.0f) / (2.0f * d), 1e-5f);
+    ASSERT_EQ(intersection_time_sphere_aabb(vec3(0.5f), 1.0f, vec3(5), mn, mx), 0.0f); // Already touching
+    ASSERT_EQ(intersection_time_sphere_aabb(vec3(-10, 0, 0), 1.0f, vec3(5, 0, 0), mn, mx), -1.0f); // Stops short
+
+    // Earliest step closer than the radius, refined by bisection
+    std::mt19937                          rng(49);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (int i = 0; i < 300; ++i) {
+        vec3  c      = 6.0f * vec3(unit(rng), unit(rng), unit(rng));
+        vec3  disp   = 12.0f * vec3(unit(rng), unit(rng), unit(rng));
+        float radius = 1.05f + 0.95f * unit(rng);
+        auto  touching = [&](float t) { return sq_distance_point_box(c + t * disp, mn, mx) <= radius * radius; };
+
+        float expected = -1.0f;
+        for (int step = 0; step <= 4000 && expected < 0.0f; ++step)
+            if (touching(step / 4000.0f)) {
+                float lo = std::max(0.0f, (step - 1) / 4000.0f), hi = step / 4000.0f;
+                for (int k = 0; k < 30 && step; ++k)
+                    (touching(0.5f * (lo + hi)) ? hi : lo) = 0.5f * (lo + hi);
+                expected = hi;
+            }
+
+        float t = intersection_time_sphere_aabb(c, radius, disp, mn, mx);
+        if (expected < 0.0f) {
+            ASSERT_TRUE(t < 0.0f || touching(t + 1e-4f)) << i; // Only a grazing hit between two steps
+        } else {
+            ASSERT_NEAR(t, expected, 1e-3f) << i;
+        }
+    }
+}
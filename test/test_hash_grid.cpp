@@ -0,0 +1,85 @@
+#include "common.hpp"
+#include "hash_grid.hpp"
+
+TEST(hash_grid, build)
+{
+    auto                      objects = seeded_boxes(500, 1, 0.2f, 6.0f, 0.05f, 10.0f);
+    std::vector<test_object*> pointers;
+    for (auto& obj : objects)
+        pointers.push_back(&obj);
+
+    hash_grid<test_object> grid;
+    grid.build(pointers, { .cell_size = 4.0f, .max_cells = 8 });
+    ASSERT_EQ(grid.objects().size(), objects.size());
+
+    // Every object is in all the cells it overlaps, unless it overlaps too many
+    std::size_t cells = 0, large = 0;
+    for (auto const& obj : objects) {
+        glm::ivec3  extent = glm::ivec3(glm::floor(obj.bv.max / 4.0f)) - glm::ivec3(glm::floor(obj.bv.min / 4.0f)) + 1;
+        std::size_t count  = static_cast<std::size_t>(extent.x) * extent.y * extent.z;
+        if (count > 8)
+            large++;
+        else
+            cells += count;
+    }
+    ASSERT_GT(large, 0u);
+    ASSERT_EQ(grid.large_count(), large);
+    ASSERT_EQ(grid.entry_count(), cells);
+    ASSERT_GE(grid.bucket_count(), cells);
+    ASSERT_LT(grid.bucket_count(), 2 * cells);
+
+    // A region covering the world finds every object once
+    std::vector<test_object const*> found;
+    grid.query(aabb(vec3(-200.0f), vec3(200.0f)), [&](test_object& obj) { found.push_back(&obj); });
+    ASSERT_EQ(sorted(found), sorted(pointers));
+
+    grid.clear();
+    ASSERT_EQ(grid.bucket_count(), 0u);
+    found.clear();
+    grid.query(aabb(vec3(-200.0f), vec3(200.0f)), [&](test_object& obj) { found.push_back(&obj); });
+    ASSERT_TRUE(found.empty());
+}
+
+TEST(hash_grid, queries_follow_moving_objects)
+{
+    auto                      objects = seeded_boxes(3000, 2, 0.2f, 6.0f, 0.05f, 10.0f);
+    std::vector<test_object*> pointers;
+    for (auto& obj : objects)
+        pointers.push_back(&obj);
+
+    hash_grid<test_object> grid;
+    grid.build(pointers, { .cell_size = 3.0f });
+
+    std::mt19937                          rng(3);
+    std::uniform_real_distribution<float> position(-120.0f, 120.0f), direction(-1.0f, 1.0f), step(-2.0f, 2.0f);
+    for (int frame = 0; frame < 10; ++frame) {
+        for (auto& obj : objects) {
+            vec3 d = vec3(step(rng), step(rng), step(rng));
+            obj.bv = aabb(obj.bv.min + d, obj.bv.max + d);
+        }
+        grid.rebuild();
+
+        for (int i = 0; i < 10; ++i) {
+            vec3 p = vec3(position(rng), position(rng), position(rng));
+
+            // Region, duplicates would show in the sorted list
+            aabb                            region(p, p + vec3(30.0f, 7.0f, 12.0f));
+            std::vector<test_object const*> expected, found;
+            for (auto const& obj : objects)
+                if (overlap_aabb_aabb(obj.bv.min, obj.bv.max, region.min, region.max))
+                    expected.push_back(&obj);
+            grid.query(region, [&](test_object& obj) { found.push_back(&obj); });
+            ASSERT_EQ(sorted(found), expected);
+
+            // Frustum
+            vec3     dir = glm::normalize(vec3(direction(rng), direction(rng), direction(rng)));
+            frustrum f(glm::perspective(glm::radians(60.0f), 1.0f, 0.5f, 80.0f) * glm::lookAt(p, p + dir, vec3(0, 1, 0)));
+            expected.clear(), found.clear();
+            for (auto const& obj : objects)
+                if (classify_frustum_aabb_naive(f, obj.bv) != eOUTSIDE)
+                    expected.push_back(&obj);
+            grid.frustum(f, [&](test_object& obj) { found.push_back(&obj); });
+            ASSERT_EQ(sorted(found), expected);
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#include "common.hpp"
+#include "hlod.hpp"
+#include <cstdio>
+
+namespace {
+    // Closed box, 12 triangles, outward facing
+    void append_box(aabb const& bv, std::vector<triangle>& out)
+    {
+        vec3 c[8];
+        for (int i = 0; i < 8; ++i)
+            c[i] = vec3(i & 1 ? bv.max.x : bv.min.x, i & 2 ? bv.max.y : bv.min.y, i & 4 ? bv.max.z : bv.min.z);
+        int const faces[6][4] = { { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 } };
+        for (auto const& f : faces) {
+            triangle a, b;
+            a.a = c[f[0]]; a.b = c[f[1]]; a.c = c[f[2]];
+            b.a = c[f[0]]; b.b = c[f[2]]; b.c = c[f[3]];
+            out.push_back(a);
+            out.push_back(b);
+        }
+    }
+}
+
+TEST(hlod, build_and_cache)
+{
+    // 8 boxes in every depth 2 cell of the (-32, -32, -32) octant
+    std::vector<test_object> objects;
+    for (int x = 0; x < 4; ++x)
+        for (int y = 0; y < 4; ++y)
+            for (int z = 0; z < 4; ++z) {
+                vec3 p = vec3(-60 + 16 * x, -60 + 16 * y, -60 + 16 * z);
+                objects.push_back({ aabb(p, p + vec3(2)), nullptr, nullptr, nullptr });
+            }
+    Octree<test_object> tree;
+    tree.set_root_size(128);
+    tree.set_levels(3);
+    for (auto& obj : objects)
+        tree.insert(obj, LocationalCode::compute_locational_code(obj.bv, tree.root_size(), tree.levels()));
+
+    hlod_cache::build_settings settings;
+    settings.depths        = { 1, 2 };
+    settings.ratio         = 0.25f;
+    settings.min_triangles = 8;
+    auto cache = hlod_cache::build(tree, 7, settings, [](test_object const& obj, std::vector<triangle>& out) { append_box(obj.bv, out); });
+
+    // The octant and its 8 children
+    ASSERT_EQ(cache.proxies().size(), 9u);
+    auto const* octant = cache.find(0b1000);
+    ASSERT_NE(octant, nullptr);
+    ASSERT_EQ(octant->source_triangles, 64u * 12u);
+    ASSERT_LE(octant->triangle_count, 64u * 12u / 4u);
+    ASSERT_EQ(cache.find(0b1111), nullptr);
+
+    // The proxy stays inside the boxes it replaces
+    for (auto const& t : cache.triangles(*octant))
+        for (int v = 0; v < 3; ++v) {
+            ASSERT_GE(glm::min(t[v].x, glm::min(t[v].y, t[v].z)), -60.001f);
+            ASSERT_LE(glm::max(t[v].x, glm::max(t[v].y, t[v].z)), -9.999f);
+        }
+
+    char const* path = "test_hlod.hlod";
+    ASSERT_TRUE(cache.write(path));
+    hlod_cache loaded;
+    ASSERT_FALSE(loaded.load(path, 8));
+    ASSERT_TRUE(loaded.load(path, 7));
+    ASSERT_EQ(loaded.info().root_size, 128u);
+    ASSERT_EQ(loaded.proxies().size(), 9u);
+    ASSERT_EQ(loaded.find(0b1000)->triangle_count, octant->triangle_count);
+    ASSERT_EQ(loaded.triangles(*loaded.find(0b1000)).front().a, cache.triangles(*octant).front().a);
+    std::remove(path);
+}
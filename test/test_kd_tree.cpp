@@ -0,0 +1,83 @@
+#include "common.hpp"
+#include "kd_tree.hpp"
+#include <random>
+
+namespace {
+    // Small triangles in a box with a few large ones crossing many planes, and an axis aligned floor
+    std::vector<triangle> make_triangles(std::size_t count, unsigned seed)
+    {
+        std::mt19937                          rng(seed);
+        std::uniform_real_distribution<float> position(-50.0f, 50.0f), offset(-1.0f, 1.0f);
+        std::vector<triangle>                 triangles;
+        for (std::size_t i = 0; i < count; ++i) {
+            vec3  p = vec3(position(rng), position(rng), position(rng));
+            float s = i % 100 == 0 ? 30.0f : 2.0f;
+            triangles.emplace_back(p, p + s * vec3(offset(rng), offset(rng), offset(rng)), p + s * vec3(offset(rng), offset(rng), offset(rng)));
+        }
+        triangles.emplace_back(vec3(-60, -50, -60), vec3(60, -50, -60), vec3(60, -50, 60));
+        triangles.emplace_back(vec3(-60, -50, -60), vec3(60, -50, 60), vec3(-60, -50, 60));
+        return triangles;
+    }
+}
+
+TEST(kd_tree, queries_match_brute_force)
+{
+    auto const triangles = make_triangles(5000, 1);
+    kd_tree    tree;
+    tree.build(triangles, { .threads = 1 });
+    ASSERT_FALSE(tree.empty());
+    ASSERT_LE(tree.depth(), 8 + 1.3f * std::log2(5002.0f) + 1);
+
+    // Every triangle is referenced, some more than once
+    std::vector<uint32_t> referenced(tree.indices().begin(), tree.indices().end());
+    std::sort(referenced.begin(), referenced.end());
+    ASSERT_GT(referenced.size(), triangles.size());
+    referenced.erase(std::unique(referenced.begin(), referenced.end()), referenced.end());
+    ASSERT_EQ(referenced.size(), triangles.size());
+
+    // Built on threads: the same tree
+    kd_tree parallel;
+    parallel.build(triangles, { .threads = 4 });
+    ASSERT_EQ(parallel.nodes().size(), tree.nodes().size());
+    ASSERT_TRUE(std::equal(parallel.indices().begin(), parallel.indices().end(), tree.indices().begin(), tree.indices().end()));
+
+    std::mt19937                          rng(2);
+    std::uniform_real_distribution<float> position(-70.0f, 70.0f), unit(-1.0f, 1.0f);
+    std::vector<uint32_t>                 found, expected;
+    for (int i = 0; i < 200; ++i) {
+        vec3 p   = vec3(position(rng), position(rng), position(rng));
+        vec3 dir = glm::normalize(vec3(unit(rng), unit(rng), unit(rng)));
+        if (i % 10 == 0)
+            dir = vec3(0, -1, 0); // Along a split axis
+
+        // Ray
+        float closest = -1.0f;
+        for (auto const& t : triangles)
+            if (float hit = intersection_time_ray_triangle(p, dir, t.a, t.b, t.c); hit >= 0.0f && (closest < 0.0f || hit < closest))
+                closest = hit;
+        auto hit = tree.raycast(p, dir);
+        ASSERT_EQ(hit.t, closest);
+        if (closest >= 0.0f) {
+            ASSERT_EQ(parallel.raycast(p, dir).triangle, hit.triangle);
+        }
+
+        // Closest point
+        float nearest = FLT_MAX;
+        for (auto const& t : triangles)
+            nearest = std::min(nearest, glm::distance(p, closest_point_triangle(p, t.a, t.b, t.c)));
+        auto point = tree.closest_point(p);
+        ASSERT_FLOAT_EQ(point.distance, nearest);
+        ASSERT_FLOAT_EQ(glm::distance(point.point, p), nearest);
+        ASSERT_EQ(tree.closest_point(p, nearest * 0.9f).triangle, UINT32_MAX);
+
+        // Box
+        aabb region(p, p + vec3(20.0f, 5.0f, 10.0f));
+        expected.clear();
+        for (uint32_t t = 0; t < triangles.size(); ++t) {
+            if (overlap_triangle_aabb(triangles[t].a, triangles[t].b, triangles[t].c, region.min, region.max))
+                expected.push_back(t);
+        }
+        tree.query(region, found);
+        ASSERT_EQ(found, expected);
+    }
+}
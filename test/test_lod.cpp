@@ -0,0 +1,87 @@
+#include "common.hpp"
+#include "lod.hpp"
+#include "mesh_simplify.hpp"
+#include <cfloat>
+
+namespace {
+    // Flat n x n grid of quads on the XZ plane, [0, n]
+    std::vector<triangle> grid(int n)
+    {
+        std::vector<triangle> tris;
+        for (int x = 0; x < n; ++x) {
+            for (int z = 0; z < n; ++z) {
+                vec3     p00(x, 0, z), p10(x + 1, 0, z), p01(x, 0, z + 1), p11(x + 1, 0, z + 1);
+                triangle a, b;
+                a.a = p00; a.b = p01; a.c = p11;
+                b.a = p00; b.b = p11; b.c = p10;
+                tris.push_back(a);
+                tris.push_back(b);
+            }
+        }
+        return tris;
+    }
+}
+
+TEST(lod, simplify_keeps_shape)
+{
+    auto input  = grid(16);
+    auto output = simplify_mesh(input, 32);
+    ASSERT_LE(output.size(), 32u);
+    ASSERT_GT(output.size(), 0u);
+
+    // Flat and borders in place: same extent and area, nothing flipped
+    vec3  bv_min(FLT_MAX), bv_max(-FLT_MAX);
+    float area = 0.0f;
+    for (auto const& t : output) {
+        for (int v = 0; v < 3; ++v) {
+            ASSERT_NEAR(t[v].y, 0.0f, 1e-4f);
+            bv_min = glm::min(bv_min, t[v]);
+            bv_max = glm::max(bv_max, t[v]);
+        }
+        vec3 n = cross(t.b - t.a, t.c - t.a);
+        ASSERT_GT(n.y, 0.0f);
+        area += 0.5f * length(n);
+    }
+    ASSERT_NEAR(bv_min, vec3(0, 0, 0), 1e-3f);
+    ASSERT_NEAR(bv_max, vec3(16, 0, 16), 1e-3f);
+    ASSERT_NEAR(area, 256.0f, 1e-2f);
+}
+
+TEST(lod, chain)
+{
+    auto chain = build_lod_chain(grid(16), 4, 0.5f);
+    ASSERT_EQ(chain.size(), 4u);
+    ASSERT_EQ(chain[0].size(), 512u);
+    for (unsigned i = 1; i < chain.size(); ++i)
+        ASSERT_LE(chain[i].size(), chain[i - 1].size() / 2);
+}
+
+TEST(lod, select_hysteresis)
+{
+    Lod::settings s;
+    s.thresholds = { 0.2f, 0.1f, 0.05f };
+    s.hysteresis = 0.1f;
+
+    ASSERT_EQ(Lod::select(s, 0.5f, 0, 4), 0u);
+    ASSERT_EQ(Lod::select(s, 0.01f, 0, 4), 3u);
+    ASSERT_EQ(Lod::select(s, 0.01f, 0, 2), 1u);
+    ASSERT_EQ(Lod::select(s, 0.5f, 3, 4), 0u);
+
+    // Just under the threshold keeps the current level until past the band
+    ASSERT_EQ(Lod::select(s, 0.19f, 0, 4), 0u);
+    ASSERT_EQ(Lod::select(s, 0.17f, 0, 4), 1u);
+    ASSERT_EQ(Lod::select(s, 0.21f, 1, 4), 1u);
+    ASSERT_EQ(Lod::select(s, 0.23f, 1, 4), 0u);
+
+    s.enabled = false;
+    ASSERT_EQ(Lod::select(s, 0.01f, 2, 4), 0u);
+}
+
+TEST(lod, screen_size)
+{
+    aabb  bv(vec3(-1), vec3(1));
+    float near_size = Lod::screen_size(bv, vec3(0, 0, 10), 1.0f);
+    float far_size  = Lod::screen_size(bv, vec3(0, 0, 20), 1.0f);
+    ASSERT_NEAR(near_size, 2.0f * far_size, 1e-4f);
+    ASSERT_EQ(Lod::screen_size(bv, vec3(0), 1.0f), 1.0f);
+}
@@ -0,0 +1,112 @@
+#include "common.hpp"
+#include "mesh_bvh.hpp"
+#include <random>
+
+namespace {
+    // Triangles around the surface of a sphere, some large ones crossing it
+    std::vector<triangle> make_triangles(std::size_t count, unsigned seed)
+    {
+        std::mt19937                          rng(seed);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f), size(0.05f, 0.5f);
+        std::vector<triangle>                 triangles;
+        for (std::size_t i = 0; i < count; ++i) {
+            vec3  p = glm::normalize(vec3(unit(rng), unit(rng), unit(rng))) * 10.0f;
+            float s = i % 50 == 0 ? 5.0f : size(rng);
+            triangles.emplace_back(p, p + s * vec3(unit(rng), unit(rng), unit(rng)), p + s * vec3(unit(rng), unit(rng), unit(rng)));
+        }
+        return triangles;
+    }
+
+    float brute_force(std::vector<triangle> const& triangles, vec3 const& origin, vec3 const& dir)
+    {
+        float closest = -1.0f;
+        for (auto const& t : triangles)
+            if (float hit = intersection_time_ray_triangle(origin, dir, t.a, t.b, t.c); hit >= 0.0f && (closest < 0.0f || hit < closest))
+                closest = hit;
+        return closest;
+    }
+}
+
+TEST(mesh_bvh, raycast_matches_brute_force)
+{
+    auto const triangles = make_triangles(4000, 1);
+    mesh_bvh   tree(triangles);
+    ASSERT_EQ(tree.triangles().size(), triangles.size());
+    ASSERT_GT(tree.depth(), 1u);
+    ASSERT_LE(tree.depth(), 64u);
+    ASSERT_TRUE(mesh_bvh().empty());
+    ASSERT_EQ(mesh_bvh().raycast(vec3(0), vec3(1, 0, 0)).triangle, UINT32_MAX);
+
+    // An instance scaled, rotated and moved
+    mat4 m2w = glm::translate(vec3(100, -20, 5)) * glm::rotate(0.7f, glm::normalize(vec3(1, 2, 3))) * glm::scale(vec3(2.0f));
+    mat4 w2m = glm::inverse(m2w);
+
+    std::mt19937                          rng(2);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    int                                   hits = 0;
+    for (int i = 0; i < 300; ++i) {
+        vec3 origin = vec3(unit(rng), unit(rng), unit(rng)) * (i % 2 ? 4.0f : 20.0f);
+        vec3 dir    = glm::normalize(vec3(unit(rng), unit(rng), unit(rng)));
+
+        float expected = brute_force(triangles, origin, dir);
+        auto  result   = tree.raycast(origin, dir);
+        ASSERT_EQ(result.t, expected);
+        if (expected < 0.0f) {
+            ASSERT_EQ(result.triangle, UINT32_MAX);
+            continue;
+        }
+        hits++;
+        triangle const& t = tree.triangles()[result.triangle];
+        ASSERT_EQ(intersection_time_ray_triangle(origin, dir, t.a, t.b, t.c), expected);
+
+        // Same hit time through the instance
+        vec3 world_origin = vec3(m2w * vec4(origin, 1.0f));
+        vec3 world_dir    = vec3(m2w * vec4(dir, 0.0f));
+        auto instanced    = tree.raycast(world_origin, world_dir, w2m);
+        ASSERT_NEAR(instanced.t, expected, 1e-3f);
+        ASSERT_NEAR(glm::distance(world_origin + world_dir * instanced.t, vec3(m2w * vec4(origin + dir * expected, 1.0f))), 0.0f, 1e-2f);
+
+        // Nothing closer than tmax
+        ASSERT_EQ(tree.raycast(origin, dir, expected * 0.5f).triangle, UINT32_MAX);
+    }
+    ASSERT_GT(hits, 30);
+}
+
+TEST(mesh_bvh, closest_point_matches_brute_force)
+{
+    auto const triangles = make_triangles(3000, 3);
+    mesh_bvh   tree(triangles);
+    ASSERT_EQ(mesh_bvh().closest_point(vec3(0)).triangle, UINT32_MAX);
+
+    // Scaled unevenly and mirrored, distances are not the model space ones
+    mat4 m2w = glm::translate(vec3(-30, 4, 12)) * glm::rotate(1.1f, glm::normalize(vec3(3, -1, 2))) * glm::scale(vec3(0.5f, 3.0f, -1.5f));
+
+    std::mt19937                          rng(4);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (int i = 0; i < 200; ++i) {
+        bool instanced = i % 2;
+        mat4 m         = instanced ? m2w : mat4(1.0f);
+        vec3 point     = vec3(m * vec4(vec3(unit(rng), unit(rng), unit(rng)) * 14.0f, 1.0f));
+
+        float expected = FLT_MAX;
+        for (auto const& t : triangles) {
+            vec3 q   = closest_point_triangle(point, vec3(m * vec4(t.a, 1.0f)), vec3(m * vec4(t.b, 1.0f)), vec3(m * vec4(t.c, 1.0f)));
+            expected = std::min(expected, glm::distance(q, point));
+        }
+
+        auto result = tree.closest_point(point, m);
+        ASSERT_NE(result.triangle, UINT32_MAX);
+        ASSERT_NEAR(result.distance, expected, 1e-4f * std::max(1.0f, expected));
+        ASSERT_NEAR(glm::distance(result.point, point), result.distance, 1e-3f);
+
+        // Unit normal of the triangle found, by its model space winding
+        triangle const& t    = tree.triangles()[result.triangle];
+        vec3            a    = vec3(m * vec4(t.a, 1.0f)), b = vec3(m * vec4(t.b, 1.0f)), c = vec3(m * vec4(t.c, 1.0f));
+        float           sign = glm::determinant(mat3(m)) < 0.0f ? -1.0f : 1.0f;
+        ASSERT_NEAR(glm::length(result.normal), 1.0f, 1e-4f);
+        ASSERT_GT(sign * glm::dot(result.normal, glm::cross(b - a, c - a)), 0.0f);
+
+        // Nothing within a smaller radius
+        ASSERT_EQ(tree.closest_point(point, m, expected * 0.99f).triangle, UINT32_MAX);
+    }
+}
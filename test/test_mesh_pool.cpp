@@ -0,0 +1,56 @@
+#include "common.hpp"
+#include "mesh_pool.hpp"
+#include "render_queue.hpp"
+
+TEST(mesh_pool, reuse_freed_ranges)
+{
+    mesh_pool pool;
+    ASSERT_EQ(pool.add(0, 30).first, 0u);
+    ASSERT_EQ(pool.add(1, 60).first, 30u);
+    ASSERT_EQ(pool.add(2, 90).first, 90u);
+    ASSERT_EQ(pool.size(), 180u);
+    ASSERT_THROW(pool.add(1, 3), std::runtime_error);
+
+    // Coalesced hole of 90 vertices at the front
+    pool.remove(0);
+    pool.remove(1);
+    ASSERT_EQ(pool.ranges()[1].count, 0u);
+    ASSERT_EQ(pool.add(3, 45).first, 0u);
+    ASSERT_EQ(pool.add(4, 45).first, 45u);
+    ASSERT_EQ(pool.add(5, 3).first, 180u);
+
+    // Freeing the tail shrinks the pool
+    pool.remove(5);
+    pool.remove(2);
+    ASSERT_EQ(pool.size(), 90u);
+    pool.remove(3);
+    pool.remove(4);
+    ASSERT_EQ(pool.size(), 0u);
+}
+
+TEST(mesh_pool, indirect_commands)
+{
+    mesh_pool pool;
+    pool.add(0, 30);
+    pool.add(2, 12);
+
+    render_queue queue;
+    queue.push(2, mat4(1), vec4(1));
+    queue.push(0, mat4(1), vec4(1));
+    queue.push(2, mat4(1), vec4(1));
+    queue.push(1, mat4(1), vec4(1)); // Not in the pool
+    queue.build();
+    queue.build_commands(pool.ranges());
+
+    auto const& commands = queue.commands();
+    ASSERT_EQ(commands.size(), 2u);
+    ASSERT_EQ(commands[0].count, 30u);
+    ASSERT_EQ(commands[0].instance_count, 1u);
+    ASSERT_EQ(commands[0].first, 0u);
+    ASSERT_EQ(commands[0].base_instance, 0u);
+    ASSERT_EQ(commands[1].count, 12u);
+    ASSERT_EQ(commands[1].instance_count, 2u);
+    ASSERT_EQ(commands[1].first, 30u);
+    ASSERT_EQ(commands[1].base_instance, 2u);
+    static_assert(sizeof(render_queue::draw_arrays_indirect_command) == 16);
+}
@@ -0,0 +1,124 @@
+#include "common.hpp"
+#include "octree_image.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    void build_tree(Octree<test_object>& tree, std::vector<test_object>& objects, unsigned root_size, unsigned levels)
+    {
+        tree.set_root_size(root_size);
+        tree.set_levels(levels);
+        for (auto& obj : objects)
+            tree.insert(obj, LocationalCode::compute_locational_code(obj.bv, root_size, levels));
+    }
+}
+
+TEST(octree_image, layout)
+{
+    std::vector<test_object> objects = random_objects(500, 70.0f); // Some outside the root
+    Octree<test_object>      tree;
+    build_tree(tree, objects, 128, 4);
+
+    auto image = octree_image::build(tree, 42, [&](test_object const& obj) { return &obj - objects.data(); });
+
+    octree_image view;
+    ASSERT_TRUE(view.view(image.data(), image.size()));
+    ASSERT_EQ(view.info().scene_hash, 42u);
+    ASSERT_EQ(view.info().object_count, objects.size());
+    ASSERT_EQ(view.nodes().size(), tree.m_nodes.size());
+
+    for (auto const& [loc, n] : tree.m_nodes) {
+        auto const* found = view.find_node(loc);
+        ASSERT_NE(found, nullptr);
+        ASSERT_EQ(found->locational_code, loc);
+        ASSERT_EQ(found->child_mask, n->children_active);
+
+        std::vector<uint32_t> expected, stored;
+        for (auto* obj = n->first; obj; obj = obj->m_octree_next_obj)
+            expected.push_back(static_cast<uint32_t>(obj - objects.data()));
+        for (auto const& obj : view.objects().subspan(found->first_object, found->object_count))
+            stored.push_back(obj.index);
+        ASSERT_EQ(expected, stored);
+    }
+    ASSERT_EQ(view.find_node(0b1000000000), nullptr);
+}
+
+TEST(octree_image, relocatable_queries)
+{
+    std::vector<test_object> objects = random_objects(2000, 60.0f);
+    Octree<test_object>      tree;
+    build_tree(tree, objects, 128, 5);
+    auto image = octree_image::build(tree, 0, [&](test_object const& obj) { return &obj - objects.data(); });
+
+    // Copy to another address, nothing in the image may depend on where it lives
+    std::vector<char> moved(image);
+    image.assign(image.size(), 0);
+
+    octree_image view;
+    ASSERT_TRUE(view.view(moved.data(), moved.size()));
+
+    frustrum f(glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f) * glm::lookAt(vec3(0, 10, -40), vec3(0), vec3(0, 1, 0)));
+    std::vector<uint32_t> visible;
+    view.query_frustum(f, visible);
+    std::sort(visible.begin(), visible.end());
+
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 0; i < objects.size(); ++i)
+        if (classify_frustum_aabb_naive(f, objects[i].bv) != eOUTSIDE)
+            expected.push_back(i);
+    ASSERT_EQ(visible, expected);
+
+    aabb box(vec3(-10, -5, -10), vec3(20, 5, 3));
+    std::vector<uint32_t> overlapping;
+    view.query_aabb(box, overlapping);
+    std::sort(overlapping.begin(), overlapping.end());
+    expected.clear();
+    for (uint32_t i = 0; i < objects.size(); ++i)
+        if (overlap_aabb_aabb(objects[i].bv.min, objects[i].bv.max, box.min, box.max))
+            expected.push_back(i);
+    ASSERT_EQ(overlapping, expected);
+}
+
+TEST(octree_image, scene_hash_check)
+{
+    std::vector<test_object> objects = random_objects(10, 10.0f);
+    Octree<test_object>      tree;
+    build_tree(tree, objects, 64, 3);
+
+    char const* path = "test_octree_image.octree";
+    ASSERT_TRUE(octree_image::write(path, octree_image::build(tree, 1234, [&](test_object const& obj) { return &obj - objects.data(); })));
+
+    octree_image image;
+    ASSERT_FALSE(image.open(path, 4321));
+    ASSERT_TRUE(image.open(path, 1234));
+    ASSERT_EQ(image.info().root_size, 64u);
+    ASSERT_EQ(image.info().levels, 3u);
+    image.close();
+    std::remove(path);
+
+    // Truncated images are rejected
+    auto bytes = octree_image::build(tree, 0, [&](test_object const& obj) { return &obj - objects.data(); });
+    ASSERT_FALSE(image.view(bytes.data(), bytes.size() - 1));
+}
+
+TEST(octree_image, cyclic_children_rejected)
+{
+    std::vector<test_object> objects = random_objects(200, 60.0f);
+    Octree<test_object>      tree;
+    build_tree(tree, objects, 128, 4);
+    auto bytes = octree_image::build(tree, 0, [&](test_object const& obj) { return &obj - objects.data(); });
+
+    octree_image image;
+    ASSERT_TRUE(image.view(bytes.data(), bytes.size()));
+    ASSERT_NE(image.nodes()[0].child_mask, 0u);
+
+    // The root as its own first child, the traversals would never end
+    octree_image::header h;
+    std::memcpy(&h, bytes.data(), sizeof(h));
+    octree_image::node root;
+    std::memcpy(&root, bytes.data() + h.nodes_offset, sizeof(root));
+    root.first_child = 0;
+    std::memcpy(bytes.data() + h.nodes_offset, &root, sizeof(root));
+    ASSERT_FALSE(image.view(bytes.data(), bytes.size()));
+}
@@ -0,0 +1,76 @@
+#include "common.hpp"
+#include "octree_tuning.hpp"
+#include <random>
+
+TEST(octree_tuning, statistics)
+{
+    // 4096 unit boxes spread over [-300, 500), nothing fits a 512 root
+    std::mt19937                          rng(3);
+    std::uniform_real_distribution<float> position(-300.0f, 499.0f);
+    std::vector<aabb>                     bvs(4096);
+    for (auto& bv : bvs) {
+        vec3 p = vec3(position(rng), position(rng), position(rng));
+        bv     = aabb(p, p + vec3(1.0f));
+    }
+    ASSERT_GT(octree_objects_outside(bvs, 512), 0u);
+
+    auto report = tune_octree(bvs);
+    ASSERT_FALSE(report.benchmarked);
+    ASSERT_EQ(report.size_bit, 10u);
+    ASSERT_EQ(octree_objects_outside(bvs, 1u << report.size_bit), 0u);
+    ASSERT_NEAR(report.median_size, 1.0f, 1e-3f);
+
+    // A few far objects do not grow the root
+    std::vector<aabb> with_outliers = bvs;
+    for (int i = 0; i < 20; ++i)
+        with_outliers.push_back(aabb(vec3(5000.0f + i), vec3(5001.0f + i)));
+    auto outliers = tune_octree(with_outliers);
+    ASSERT_EQ(outliers.size_bit, report.size_bit);
+    ASSERT_EQ(outliers.outside_root, 20u);
+
+    // As deep as non empty nodes keep 4 objects on average
+    ASSERT_EQ(report.levels, report.estimated_levels);
+    ASSERT_EQ(report.candidates.size(), 10u);
+    ASSERT_GE(report.candidates[report.levels - 1].occupancy, 4.0f);
+    ASSERT_LT(report.candidates[report.levels].occupancy, 4.0f);
+
+    // Larger objects get larger cells, 4 times their size
+    for (auto& bv : bvs)
+        bv.max = bv.min + vec3(40.0f);
+    auto  large = tune_octree(bvs);
+    float cell  = std::ldexp(1.0f, static_cast<int>(large.size_bit - large.levels));
+    ASSERT_GE(cell, 160.0f);
+    ASSERT_LT(cell, 320.0f);
+}
+
+TEST(octree_tuning, benchmark)
+{
+    std::mt19937                          rng(5);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::vector<aabb>                     bvs(2000);
+    for (auto& bv : bvs) {
+        vec3 p = vec3(position(rng), position(rng), position(rng));
+        bv     = aabb(p, p + vec3(0.5f));
+    }
+    std::vector<frustrum> views;
+    for (int i = 0; i < 8; ++i) {
+        vec3 eye = vec3(0, 0, -150 + 20 * i);
+        views.emplace_back(glm::perspective(glm::radians(60.0f), 1.0f, 0.1f, 100.0f) * glm::lookAt(eye, vec3(0), vec3(0, 1, 0)));
+    }
+
+    auto report = tune_octree(bvs, views);
+    ASSERT_TRUE(report.benchmarked);
+
+    // The chosen candidate is the fastest one timed
+    float                   best   = FLT_MAX;
+    octree_candidate const* chosen = nullptr;
+    for (auto const& c : report.candidates) {
+        if (c.ms >= 0.0f && c.ms < best)
+            best = c.ms;
+        if (c.size_bit == report.size_bit && c.levels == report.levels)
+            chosen = &c;
+    }
+    ASSERT_NE(chosen, nullptr);
+    ASSERT_EQ(chosen->ms, best);
+    ASSERT_EQ(octree_objects_outside(bvs, 1u << report.size_bit), 0u);
+}
@@ -0,0 +1,69 @@
+#include "common.hpp"
+#include "quantized_octree.hpp"
+#include <algorithm>
+
+namespace {
+    bool contains(aabb const& outer, aabb const& inner)
+    {
+        return glm::min(outer.min, inner.min) == outer.min && glm::max(outer.max, inner.max) == outer.max;
+    }
+
+    template<typename Q>
+    void check_queries(std::vector<test_object>& objects, Octree<test_object> const& tree)
+    {
+        quantized_octree<Q> compact;
+        compact.build(tree, [&](test_object const& obj) { return &obj - objects.data(); });
+        ASSERT_EQ(compact.node_count(), tree.m_nodes.size());
+        ASSERT_EQ(compact.indices().size(), objects.size());
+
+        // Rounded outward, and not by more than one step per side
+        for (uint32_t i = 0; i < objects.size(); ++i) {
+            aabb const& bv      = objects[compact.indices()[i]].bv;
+            aabb        decoded = compact.object_bounds(i);
+            ASSERT_TRUE(contains(decoded, bv)) << i;
+            ASSERT_TRUE(contains(compact.node_bounds(0), decoded)) << i;
+        }
+
+        frustrum f(glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f) *
+                   glm::lookAt(vec3(1000, 10, -40), vec3(1000, 0, 0), vec3(0, 1, 0)));
+        aabb     box(vec3(990, -5, -10), vec3(1020, 5, 3));
+        std::vector<uint32_t> visible, overlapping, float_visible, float_overlapping, decoded_visible, decoded_overlapping;
+        compact.frustum(f, visible);
+        compact.query(box, overlapping);
+        std::sort(visible.begin(), visible.end());
+        std::sort(overlapping.begin(), overlapping.end());
+
+        for (uint32_t i = 0; i < objects.size(); ++i) {
+            uint32_t index = compact.indices()[i];
+            aabb     bv    = compact.object_bounds(i);
+            if (classify_frustum_aabb_naive(f, objects[index].bv) != eOUTSIDE)
+                float_visible.push_back(index);
+            if (overlap_aabb_aabb(objects[index].bv.min, objects[index].bv.max, box.min, box.max))
+                float_overlapping.push_back(index);
+            if (overlap_aabb_aabb(bv.min, bv.max, box.min, box.max))
+                decoded_overlapping.push_back(index);
+        }
+        std::sort(float_visible.begin(), float_visible.end());
+        std::sort(float_overlapping.begin(), float_overlapping.end());
+        std::sort(decoded_overlapping.begin(), decoded_overlapping.end());
+
+        // Never culls what the float bounds keep
+        ASSERT_GT(float_visible.size(), 0u);
+        ASSERT_TRUE(std::includes(visible.begin(), visible.end(), float_visible.begin(), float_visible.end()));
+        ASSERT_TRUE(std::includes(overlapping.begin(), overlapping.end(), float_overlapping.begin(), float_overlapping.end()));
+        ASSERT_EQ(overlapping, decoded_overlapping);
+    }
+}
+
+TEST(quantized_octree, conservative_queries)
+{
+    std::vector<test_object> objects = random_objects(3000, 60.0f, vec3(1000.0f, 0.0f, 0.0f), 0.01f); // Away from the origin
+    Octree<test_object>      tree;
+    tree.set_root_size(2048);
+    tree.set_levels(8);
+    for (auto& obj : objects)
+        tree.insert(obj, LocationalCode::compute_locational_code(obj.bv, tree.root_size(), tree.levels()));
+
+    check_queries<uint16_t>(objects, tree);
+    check_queries<uint8_t>(objects, tree);
+}
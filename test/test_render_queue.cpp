@@ -0,0 +1,70 @@
+#include "common.hpp"
+#include "render_queue.hpp"
+
+TEST(render_queue, batches_by_mesh)
+{
+    render_queue queue;
+    queue.push(7, glm::translate(vec3(0, 0, 0)), vec4(1));
+    queue.push(2, glm::translate(vec3(1, 0, 0)), vec4(1));
+    queue.push(7, glm::translate(vec3(2, 0, 0)), vec4(1));
+    queue.push(2, glm::translate(vec3(3, 0, 0)), vec4(1));
+    queue.push(5, glm::translate(vec3(4, 0, 0)), vec4(1));
+    queue.build();
+
+    auto const& batches = queue.batches();
+    ASSERT_EQ(batches.size(), 3u);
+    ASSERT_EQ(batches[0].mesh, 2u);
+    ASSERT_EQ(batches[0].first_instance, 0u);
+    ASSERT_EQ(batches[0].instance_count, 2u);
+    ASSERT_EQ(batches[1].mesh, 5u);
+    ASSERT_EQ(batches[1].first_instance, 2u);
+    ASSERT_EQ(batches[1].instance_count, 1u);
+    ASSERT_EQ(batches[2].mesh, 7u);
+    ASSERT_EQ(batches[2].first_instance, 3u);
+    ASSERT_EQ(batches[2].instance_count, 2u);
+
+    // Push order is kept inside a batch
+    std::vector<float> x;
+    for (auto const& i : queue.instances())
+        x.push_back(i.m2w[3][0]);
+    ASSERT_EQ(x, (std::vector<float>{ 1, 3, 4, 0, 2 }));
+}
+
+TEST(render_queue, reuse)
+{
+    render_queue queue;
+    queue.push(3, mat4(1), vec4(1));
+    queue.build();
+    queue.clear();
+    queue.build();
+    ASSERT_TRUE(queue.batches().empty());
+    ASSERT_TRUE(queue.instances().empty());
+
+    queue.push(0, mat4(1), vec4(0.5f));
+    queue.build();
+    ASSERT_EQ(queue.batches().size(), 1u);
+    ASSERT_EQ(queue.instances()[0].color, vec4(0.5f));
+}
+
+TEST(render_queue, depth_sort)
+{
+    render_queue queue;
+    queue.push(1, glm::translate(vec3(0, 0, 0)), vec4(1), 5.0f);
+    queue.push(0, glm::translate(vec3(1, 0, 0)), vec4(1), 3.0f);
+    queue.push(1, glm::translate(vec3(2, 0, 0)), vec4(1), 1.0f);
+    queue.push(0, glm::translate(vec3(3, 0, 0)), vec4(1), 4.0f);
+    queue.push(1, glm::translate(vec3(4, 0, 0)), vec4(1), 1.0f);
+    queue.build(true);
+
+    // Nearest first inside each batch, ties keep their push order
+    std::vector<float> x;
+    for (auto const& i : queue.instances())
+        x.push_back(i.m2w[3][0]);
+    ASSERT_EQ(x, (std::vector<float>{ 1, 3, 2, 4, 0 }));
+
+    queue.build();
+    x.clear();
+    for (auto const& i : queue.instances())
+        x.push_back(i.m2w[3][0]);
+    ASSERT_EQ(x, (std::vector<float>{ 1, 3, 0, 2, 4 }));
+}
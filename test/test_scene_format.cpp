@@ -0,0 +1,86 @@
+#include "common.hpp"
+#include "scene_format.hpp"
+#include <cstdio>
+#include <fstream>
+
+TEST(scene_format, parse_text)
+{
+    char const* text = "3\n"
+                       "1 0 0 0 0 2 0 0 0 0 3 0 4 5 6 1 \n"
+                       "0\r\n"
+                       "1e-2 0 0 0 0 1 0 0 0 0 1 0 -1.5 0 0 1";
+    auto entries = SceneFormat::parse_text(text, 1);
+    ASSERT_EQ(entries.size(), 2u);
+    ASSERT_EQ(entries[0].mesh_index, 3);
+    ASSERT_EQ(entries[1].mesh_index, 0);
+    ASSERT_NEAR(vec3(entries[0].m2w[3]), vec3(4, 5, 6), 1e-6);
+    ASSERT_NEAR(entries[0].m2w[1][1], 2.0f, 1e-6);
+    ASSERT_NEAR(entries[1].m2w[0][0], 0.01f, 1e-6);
+    ASSERT_NEAR(entries[1].m2w[3][0], -1.5f, 1e-6);
+}
+
+TEST(scene_format, parse_text_malformed)
+{
+    ASSERT_THROW(SceneFormat::parse_text("1\n1 0 0 0 0 1", 1), std::runtime_error);
+    ASSERT_THROW(SceneFormat::parse_text("1\n1 0 0 0 0 1 0 0 0 0 1 0 0 0 0 1\nfoo", 1), std::runtime_error);
+}
+
+TEST(scene_format, parse_text_threaded)
+{
+    auto single   = SceneFormat::load_text(WORKDIR "assets/scene.txt", 1);
+    auto threaded = SceneFormat::load_text(WORKDIR "assets/scene.txt", 7);
+    ASSERT_GT(single.size(), 0u);
+    ASSERT_EQ(single.size(), threaded.size());
+    for (std::size_t i = 0; i < single.size(); ++i) {
+        ASSERT_EQ(single[i].mesh_index, threaded[i].mesh_index);
+        ASSERT_EQ(single[i].m2w, threaded[i].m2w);
+    }
+}
+
+TEST(scene_format, binary_round_trip)
+{
+    mat4 m2w = glm::translate(vec3(10, 0, -5)) * glm::rotate(0.5f, vec3(0, 1, 0)) * glm::scale(vec3(2));
+    aabb model(vec3(-1), vec3(1));
+
+    std::vector<SceneFormat::record> records = {
+        SceneFormat::make_record(7, m2w, model),
+        SceneFormat::make_record(1, glm::identity<mat4>(), model),
+    };
+    char const* path = "test_scene_format.bin";
+    ASSERT_TRUE(SceneFormat::write_binary(path, records, 0x1234));
+
+    {
+        mapped_file file(path);
+        auto        view = SceneFormat::binary_records(file);
+        ASSERT_EQ(view.size(), 2u);
+        ASSERT_EQ(view[0].mesh_id, 7u);
+        ASSERT_EQ(view[1].mesh_id, 1u);
+        ASSERT_EQ(SceneFormat::binary_source_hash(file), 0x1234u);
+
+        mat4 loaded = SceneFormat::record_transform(view[0]);
+        for (int c = 0; c < 4; ++c)
+            ASSERT_NEAR(vec3(loaded[c]), vec3(m2w[c]), 1e-5);
+        ASSERT_NEAR(SceneFormat::record_bv(view[0]), transform_aabb(model, m2w), 1e-5);
+        ASSERT_NEAR(SceneFormat::record_bv(view[1]), model, 1e-5);
+    }
+    std::remove(path);
+}
+
+TEST(scene_format, binary_invalid)
+{
+    char const* path = "test_scene_format_invalid.bin";
+    {
+        std::ofstream fs(path, std::ios::binary);
+        fs << "not a scene";
+    }
+    {
+        mapped_file file(path);
+        ASSERT_TRUE(file.is_open());
+        ASSERT_TRUE(SceneFormat::binary_records(file).empty());
+        ASSERT_EQ(SceneFormat::binary_source_hash(file), 0u);
+    }
+    std::remove(path);
+
+    mapped_file missing("does_not_exist.bin");
+    ASSERT_FALSE(missing.is_open());
+}
@@ -0,0 +1,79 @@
+#include "common.hpp"
+#include "triangle_format.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+
+namespace {
+    std::string make_text(std::size_t count)
+    {
+        std::mt19937                          rng(45);
+        std::uniform_real_distribution<float> coord(-100.0f, 100.0f);
+        std::string                           text = "# generated\n";
+        char                                  line[256];
+        for (std::size_t i = 0; i < count; ++i) {
+            if (i % 7 == 0)
+                text += "v 1 2 3\n";
+            int n = std::snprintf(line, sizeof(line), "f %g %g %g %g %g %g %g %g %g\n", coord(rng), coord(rng), coord(rng), coord(rng),
+                                  coord(rng), coord(rng), coord(rng), coord(rng), coord(rng));
+            text.append(line, static_cast<std::size_t>(n));
+        }
+        return text;
+    }
+
+    bool same(std::vector<triangle> const& lhs, std::vector<triangle> const& rhs)
+    {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                          [](triangle const& l, triangle const& r) { return l.a == r.a && l.b == r.b && l.c == r.c; });
+    }
+}
+
+TEST(triangle_format, parse_text)
+{
+    char const* text = "# comment\n"
+                       "v 0 0 0\n"
+                       "f 0 0 0 1 0 0 0 1 0\r\n"
+                       "\n"
+                       "  f\t1e-2 -2 3  4 5 6 7 8 -9.5\n"
+                       "fx 1 1 1\n"
+                       "f 1 1 1 2 2 2 3 3 3";
+    auto triangles = TriangleFormat::parse_text(text, 1);
+    ASSERT_EQ(triangles.size(), 3u);
+    ASSERT_NEAR(triangles[0].b, vec3(1, 0, 0), 1e-6);
+    ASSERT_NEAR(triangles[1].a, vec3(0.01f, -2, 3), 1e-6);
+    ASSERT_NEAR(triangles[1].c, vec3(7, 8, -9.5f), 1e-6);
+    ASSERT_NEAR(triangles[2].c, vec3(3, 3, 3), 1e-6);
+
+    ASSERT_THROW(TriangleFormat::parse_text("f 0 0 0 1 0 0 0 1\n", 1), std::runtime_error);
+    ASSERT_THROW(TriangleFormat::parse_text("f 0 0 0 1 0 0\n0 1 0\n", 1), std::runtime_error);
+    ASSERT_TRUE(load_triangles("does_not_exist.txt").empty());
+}
+
+TEST(triangle_format, threaded_and_streamed)
+{
+    std::string text   = make_text(20000);
+    auto        single = TriangleFormat::parse_text(text, 1);
+    ASSERT_EQ(single.size(), 20000u);
+    ASSERT_TRUE(same(TriangleFormat::parse_text(text, 7), single));
+
+    std::vector<triangle> streamed;
+    std::size_t           batches = 0;
+    std::size_t           count   = TriangleFormat::stream_text(
+        text,
+        [&](std::size_t first, std::span<triangle const> batch) {
+            ASSERT_EQ(first, streamed.size());
+            streamed.insert(streamed.end(), batch.begin(), batch.end());
+            batches++;
+        },
+        3, 100000);
+    ASSERT_EQ(count, single.size());
+    ASSERT_GT(batches, 10u);
+    ASSERT_TRUE(same(streamed, single));
+
+    char const* path = "test_triangles.txt";
+    std::ofstream(path, std::ios::binary) << text;
+    ASSERT_TRUE(same(load_triangles(path), single));
+    std::remove(path);
+}
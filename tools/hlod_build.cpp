@@ -0,0 +1,116 @@
+//
+// Builds the HLOD proxies of the scene octree and caches them next to the
+// scene. Uses the same octree settings as the demo by default.
+//
+// Usage: hlod_build [output] [levels] [size bit] [ratio]
+//
+#include "hlod.hpp"
+#include "lod.hpp"
+#include "octree_image.hpp"
+#include "scene_format.hpp"
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#ifndef WORKDIR
+#define WORKDIR "./"
+#endif
+
+namespace {
+    struct object
+    {
+        aabb     bv = {};
+        mat4     m2w;
+        unsigned mesh = 0;
+
+        Octree<object>::node* m_octree_node     = nullptr;
+        object*               m_octree_next_obj = nullptr;
+        object*               m_octree_prev_obj = nullptr;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    std::string output   = argc > 1 ? argv[1] : WORKDIR "assets/scene.hlod";
+    unsigned    levels   = argc > 2 ? static_cast<unsigned>(std::stoul(argv[2])) : 6;
+    unsigned    size_bit = argc > 3 ? static_cast<unsigned>(std::stoul(argv[3])) : 10;
+
+    hlod_cache::build_settings settings;
+    if (argc > 4)
+        settings.ratio = std::stof(argv[4]);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Coarsest LOD of every mesh, the proxies are far away anyway
+    std::vector<std::vector<triangle>> meshes;
+    std::vector<aabb>                  mesh_bvs;
+    for (;;) {
+        std::string prefix = WORKDIR "assets/mirlo_" + std::to_string(meshes.size());
+        auto        lod0   = load_binary_mesh(prefix + ".binary");
+        if (lod0.empty())
+            break;
+
+        vec3 bv_min = lod0.front().a, bv_max = bv_min;
+        for (auto const& t : lod0)
+            for (int v = 0; v < 3; ++v) {
+                bv_min = glm::min(bv_min, t[v]);
+                bv_max = glm::max(bv_max, t[v]);
+            }
+        mesh_bvs.emplace_back(bv_min, bv_max);
+
+        std::vector<triangle> coarsest = std::move(lod0);
+        for (unsigned k = 1; k < Lod::max_lods; ++k) {
+            auto lod = load_binary_mesh(prefix + "_lod" + std::to_string(k) + ".binary");
+            if (lod.empty())
+                break;
+            coarsest = std::move(lod);
+        }
+        meshes.push_back(std::move(coarsest));
+    }
+    if (meshes.empty()) {
+        std::cerr << "No meshes found in " WORKDIR "assets\n";
+        return 1;
+    }
+
+    // Same scene and hash the demo uses
+    std::vector<object> objects;
+    uint64_t            scene_hash = 0;
+    mapped_file         binary(WORKDIR "assets/scene.bin");
+    auto                records = SceneFormat::binary_records(binary);
+    if (!records.empty()) {
+        scene_hash = octree_image::hash_bytes(binary.data(), binary.size());
+        for (auto const& r : records)
+            objects.push_back({ SceneFormat::record_bv(r), SceneFormat::record_transform(r), r.mesh_id });
+    }
+    else {
+        scene_hash = octree_image::hash_file(WORKDIR "assets/scene.txt");
+        for (auto const& e : SceneFormat::load_text(WORKDIR "assets/scene.txt"))
+            objects.push_back({ transform_aabb(mesh_bvs.at(e.mesh_index), e.m2w), e.m2w, static_cast<unsigned>(e.mesh_index) });
+    }
+
+    Octree<object> tree;
+    tree.set_root_size(1u << size_bit);
+    tree.set_levels(levels);
+    for (auto& obj : objects)
+        tree.insert(obj, LocationalCode::compute_locational_code(obj.bv, tree.root_size(), tree.levels()));
+
+    auto cache = hlod_cache::build(tree, scene_hash, settings, [&](object const& obj, std::vector<triangle>& out) {
+        for (auto t : meshes.at(obj.mesh)) {
+            for (int v = 0; v < 3; ++v)
+                t[v] = vec3(obj.m2w * vec4(t[v], 1.0f));
+            out.push_back(t);
+        }
+    });
+    if (!cache.write(output)) {
+        std::cerr << "Could not write " << output << "\n";
+        return 1;
+    }
+
+    std::size_t source = 0;
+    for (auto const& p : cache.proxies())
+        source += p.source_triangles;
+    float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "Built " << cache.info().proxy_count << " proxies (" << source << " -> " << cache.info().triangle_count << " triangles) to "
+              << output << " in " << ms << " ms\n";
+    return 0;
+}
@@ -0,0 +1,60 @@
+//
+// Generates the LOD chain of every mesh with quadric error simplification.
+// Level k of <prefix><i>.binary is written to <prefix><i>_lod<k>.binary,
+// every level keeps about ratio of the triangles of the previous one.
+//
+// Usage: lod_build [mesh prefix] [levels] [ratio]
+//
+#include "lod.hpp"
+#include "mesh_simplify.hpp"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#ifndef WORKDIR
+#define WORKDIR "./"
+#endif
+
+int main(int argc, char** argv)
+{
+    std::string prefix = argc > 1 ? argv[1] : WORKDIR "assets/mirlo_";
+    unsigned    levels = argc > 2 ? static_cast<unsigned>(std::stoul(argv[2])) : Lod::max_lods;
+    float       ratio  = argc > 3 ? std::stof(argv[3]) : 0.5f;
+    if (levels < 2 || levels > Lod::max_lods || ratio <= 0.0f || ratio >= 1.0f) {
+        std::cerr << "levels must be in [2, " << Lod::max_lods << "] and ratio in (0, 1)\n";
+        return 1;
+    }
+
+    auto        start = std::chrono::high_resolution_clock::now();
+    std::size_t meshes = 0, triangles = 0, written = 0;
+    for (;; ++meshes) {
+        std::stringstream ss;
+        ss << prefix << meshes;
+        auto lod0 = load_binary_mesh(ss.str() + ".binary");
+        if (lod0.empty())
+            break;
+
+        auto chain = build_lod_chain(lod0, levels, ratio);
+        triangles += lod0.size();
+        std::cout << ss.str() << ": " << lod0.size();
+        for (unsigned k = 1; k < chain.size(); ++k) {
+            std::string filename = ss.str() + "_lod" + std::to_string(k) + ".binary";
+            if (!save_binary_mesh(filename, chain[k])) {
+                std::cerr << "\nCould not write " << filename << "\n";
+                return 1;
+            }
+            written += chain[k].size();
+            std::cout << " -> " << chain[k].size();
+        }
+        std::cout << "\n";
+    }
+    if (meshes == 0) {
+        std::cerr << "No meshes found with prefix " << prefix << "\n";
+        return 1;
+    }
+
+    float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "Simplified " << meshes << " meshes (" << triangles << " triangles, " << written << " in LODs) in " << ms << " ms\n";
+    return 0;
+}
@@ -0,0 +1,75 @@
+//
+// Converts a text scene description into the binary scene format.
+//
+// Usage: scene_convert [scene.txt] [scene.bin] [mesh prefix]
+//
+#include "scene_format.hpp"
+#include "octree_image.hpp"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+#ifndef WORKDIR
+#define WORKDIR "./"
+#endif
+
+int main(int argc, char** argv)
+{
+    std::string input  = argc > 1 ? argv[1] : WORKDIR "assets/scene.txt";
+    std::string output = argc > 2 ? argv[2] : WORKDIR "assets/scene.bin";
+    std::string prefix = argc > 3 ? argv[3] : WORKDIR "assets/mirlo_";
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Model space bounds of every mesh
+    std::vector<aabb> mesh_bvs;
+    for (;;) {
+        std::stringstream ss;
+        ss << prefix << mesh_bvs.size() << ".binary";
+        auto triangles = load_binary_mesh(ss.str());
+        if (triangles.empty())
+            break;
+
+        vec3 bv_min = triangles.front().a;
+        vec3 bv_max = bv_min;
+        for (auto const& t : triangles)
+            for (int v = 0; v < 3; ++v) {
+                bv_min = glm::min(bv_min, t[v]);
+                bv_max = glm::max(bv_max, t[v]);
+            }
+        mesh_bvs.emplace_back(bv_min, bv_max);
+    }
+    if (mesh_bvs.empty()) {
+        std::cerr << "No meshes found with prefix " << prefix << "\n";
+        return 1;
+    }
+
+    std::vector<SceneFormat::text_entry> entries;
+    try {
+        entries = SceneFormat::load_text(input);
+    }
+    catch (std::exception const& e) {
+        std::cerr << input << ": " << e.what() << "\n";
+        return 1;
+    }
+
+    std::vector<SceneFormat::record> records;
+    records.reserve(entries.size());
+    for (auto const& e : entries) {
+        if (e.mesh_index < 0 || static_cast<std::size_t>(e.mesh_index) >= mesh_bvs.size()) {
+            std::cerr << input << ": mesh index " << e.mesh_index << " out of range\n";
+            return 1;
+        }
+        records.push_back(SceneFormat::make_record(e.mesh_index, e.m2w, mesh_bvs[e.mesh_index]));
+    }
+
+    // The demo only prefers the binary scene while it matches its text
+    if (!SceneFormat::write_binary(output, records, octree_image::hash_file(input))) {
+        std::cerr << "Could not write " << output << "\n";
+        return 1;
+    }
+
+    float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "Converted " << records.size() << " objects (" << mesh_bvs.size() << " meshes) to " << output << " in " << ms << " ms\n";
+    return 0;
+}